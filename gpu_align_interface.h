@@ -34,6 +34,15 @@
 #define GPU_CIGAR_INSERTION   ((char) 3)
 #define GPU_CIGAR_DELETION    ((char) 4)
 
+/* BAM CIGAR operations (packed as length << GPU_BAM_CIGAR_SHIFT | operation) */
+#define GPU_BAM_CIGAR_SHIFT   4
+#define GPU_BAM_CIGAR_M       0
+#define GPU_BAM_CIGAR_I       1
+#define GPU_BAM_CIGAR_D       2
+#define GPU_BAM_CIGAR_S       4
+#define GPU_BAM_CIGAR_EQUAL   7
+#define GPU_BAM_CIGAR_DIFF    8
+
 typedef char  gpu_bpm_align_cigar_event_t;
 typedef char  gpu_bpm_align_qry_entry_t;
 
@@ -75,6 +84,15 @@ typedef struct {
   uint32_t                    cigarLenght;
 } gpu_bpm_align_cigar_info_t;
 
+typedef struct {
+  uint64_t                    position;       // Text position of the first aligned base (BAM pos)
+  uint32_t                    cigar_offset;   // First packed operation in the CIGAR arena
+  uint32_t                    cigar_length;   // BAM n_cigar_op (0 for the candidates not aligned)
+  uint32_t                    md_offset;      // First char of the MD value in the MD arena (NUL terminated)
+  uint32_t                    md_length;      // Chars of the MD value (terminator excluded)
+  uint32_t                    edit_distance;  // NM: mismatches, inserted and deleted bases (soft-clips excluded)
+} gpu_bpm_align_bam_info_t;
+
 /*
  * Obtain Buffers
  */
@@ -108,4 +126,24 @@ void gpu_bpm_align_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEntr
 void gpu_bpm_align_receive_buffer_(void* const bpmBuffer);
 void gpu_bpm_align_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t numPEQEntries, const uint32_t numQueryBases,
                                             const uint32_t numQueries, const uint32_t numCandidates);
+
+/*
+ * Batch functions (caller arrays are processed in as many sub-batches as the buffer layout requires)
+ */
+/* BPM align batch primitives (queries stored in order, cigars holds query size + 1 entries per candidate) */
+void gpu_bpm_align_send_batch_(void* const bpmBuffer, const gpu_bpm_align_qry_entry_t* const queries, const gpu_bpm_align_peq_entry_t* const peqEntries,
+                               const gpu_bpm_align_qry_info_t* const qryInfo, const gpu_bpm_align_cand_info_t* const candidates,
+                               const uint32_t numCandidates, const uint32_t queryBinSize,
+                               gpu_bpm_align_cigar_info_t* const cigarsInfo, gpu_bpm_align_cigar_entry_t* const cigars);
+void gpu_bpm_align_receive_batch_(void* const bpmBuffer);
+
+/*
+ * BAM output (host reference kept by gpu_buffers_dto_t.hostReferenceText, numThreads = 0 uses a single worker per buffer)
+ */
+/* Query-only runs at the ends are soft-clipped, extendedCigar selects =/X instead of M, arenas are filled in candidate order */
+void gpu_bpm_align_bam_output_(const void* const bpmBuffer, const gpu_bpm_align_cand_info_t* const candidates,
+                               const gpu_bpm_align_cigar_info_t* const cigarsInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                               const uint32_t numCandidates, const bool extendedCigar, const uint32_t numThreads,
+                               gpu_bpm_align_bam_info_t* const bamInfo, uint32_t* const bamCigars, const uint32_t maxBamCigars,
+                               char* const md, const uint32_t maxMdChars);
 #endif /* GPU_BPM_ALIGN_INTERFACE_H_ */
@@ -30,9 +30,36 @@ typedef enum
   GPU_REF_ASCII,
   GPU_REF_GEM_FILE,
   GPU_REF_GEM_FULL,
-  GPU_REF_GEM_ONLY_FORWARD
+  GPU_REF_GEM_ONLY_FORWARD,
+  GPU_REF_GEM_VIRTUAL_FULL   /* Forward strand stored, reverse-complement served from it */
 } gpu_ref_coding_t;
 
+typedef enum
+{
+  GPU_PAIR_FILTER_ORIENTATION_FR,   /* Forward mate upstream, reverse mate downstream (paired-end libraries) */
+  GPU_PAIR_FILTER_ORIENTATION_RF,   /* Reverse mate upstream, forward mate downstream (mate-pair libraries) */
+  GPU_PAIR_FILTER_ORIENTATION_FF    /* Both mates on the same strand, mate 1 upstream in the strand direction */
+} gpu_pair_filter_orientation_t;
+
+typedef enum
+{
+  GPU_PAIR_FILTER_STRAND_FORWARD,
+  GPU_PAIR_FILTER_STRAND_REVERSE
+} gpu_pair_filter_strand_t;
+
+typedef enum
+{
+  GPU_REFERENCE_TEXT_ASCII,         /* One char per base (ACGTN) */
+  GPU_REFERENCE_TEXT_CODES,         /* One encoded base per byte (GPU_ENC_DNA_CHAR_*, non-bases are N) */
+  GPU_REFERENCE_TEXT_2BITS          /* Four bases per byte from the low bits (reference layout, non-bases are served as A) */
+} gpu_reference_text_format_t;
+
+typedef enum
+{
+  GPU_REFERENCE_TEXT_FORWARD,
+  GPU_REFERENCE_TEXT_REVERSE        /* Reverse-complement of the window */
+} gpu_reference_text_strand_t;
+
 
 /*
  * Common types for Device & Host
@@ -75,6 +102,9 @@ typedef struct {
   char              *reference;
   gpu_ref_coding_t  refCoding;
   uint64_t          refSize;
+  bool              maskedNRuns;  /* Non-bases masked by the N-run intervals (the masked bitmap is not kept) */
+  uint32_t          minimizerW;   /* Minimizer index sampling: k-mers per window and k-mer length (0 = default 10 and 15) */
+  uint32_t          minimizerK;
 } gpu_reference_dto_t;
 
 /* K-MER filter data structures */
@@ -92,6 +122,63 @@ typedef struct{
   uint32_t query_size;
 } gpu_kmer_filter_qry_info_t;
 
+/* Paired-end pairing data structures */
+typedef struct {
+  uint64_t position;           // Leftmost forward-strand text position of the mate (decoded position)
+  uint32_t strand;             // gpu_pair_filter_strand_t
+  uint32_t reserved;
+} gpu_pair_filter_mate_entry_t;
+
+typedef struct {
+  uint32_t init_offset_mate1;  // Decoded positions of each mate [init_offset, init_offset + num)
+  uint32_t num_mate1;
+  uint32_t init_offset_mate2;
+  uint32_t num_mate2;
+  uint32_t size_mate1;         // Read lengths (the insert size spans the downstream mate)
+  uint32_t size_mate2;
+} gpu_pair_filter_qry_info_t;
+
+typedef struct {
+  uint32_t id_mate1;           // Entries relative to the mate lists of the read pair
+  uint32_t id_mate2;
+  uint32_t insert_size;
+} gpu_pair_filter_pair_entry_t;
+
+typedef struct {
+  uint32_t init_offset;        // First pair slot of the read pair (maxPairsPerQuery slots)
+  uint32_t num_pairs;
+  uint32_t num_dropped;        // Concordant pairs discarded when the slots are exhausted
+} gpu_pair_filter_result_t;
+
+/* Minimizer seeding data structures */
+typedef char      gpu_minimizer_seed_qry_entry_t;
+
+typedef struct{
+  uint32_t init_offset;
+  uint32_t query_size;
+} gpu_minimizer_seed_qry_info_t;
+
+typedef struct {
+  uint64_t position;           // First text position of the window (same layout as the K-MER and BPM filter candidates)
+  uint32_t query;
+  uint32_t size;               // Query size plus the band at both sides of the chained diagonals
+} gpu_minimizer_seed_cand_info_t;
+
+typedef struct {
+  uint32_t init_offset;        // First candidate slot of the query (maxCandidatesPerQuery slots)
+  uint32_t num_candidates;     // Windows sorted by text position
+  uint32_t num_dropped;        // Chains discarded when the slots are exhausted (the ones with less anchors)
+  uint32_t num_anchors;        // Minimizer hits of the query below the occurrence threshold
+} gpu_minimizer_seed_result_t;
+
+/* Candidate text extraction data structures */
+typedef struct {
+  uint64_t position;           // First text position of the window (complete coordinate space of the reference)
+  uint32_t size;               // Bases beyond the end of the reference are served as non-bases
+  uint32_t strand;             // gpu_reference_text_strand_t
+  uint64_t init_offset;        // First output byte of the window (filled by the extraction, windows are stored in order)
+} gpu_reference_text_request_t;
+
 /*
  * Obtain Buffers
  */
@@ -105,6 +192,16 @@ gpu_kmer_filter_qry_entry_t* gpu_kmer_filter_buffer_get_queries_(const void* con
 gpu_kmer_filter_cand_info_t* gpu_kmer_filter_buffer_get_candidates_(const void* const kmerBuffer);
 gpu_kmer_filter_qry_info_t*  gpu_kmer_filter_buffer_get_qry_info_(const void* const kmerBuffer);
 gpu_kmer_filter_alg_entry_t* gpu_kmer_filter_buffer_get_alignments_(const void* const kmerBuffer);
+/* Paired-end pairing get primitives */
+gpu_pair_filter_mate_entry_t* gpu_pair_filter_buffer_get_mates_(const void* const pairBuffer);
+gpu_pair_filter_qry_info_t*   gpu_pair_filter_buffer_get_qry_info_(const void* const pairBuffer);
+gpu_pair_filter_result_t*     gpu_pair_filter_buffer_get_results_(const void* const pairBuffer);
+gpu_pair_filter_pair_entry_t* gpu_pair_filter_buffer_get_pairs_(const void* const pairBuffer);
+/* Minimizer seeding get primitives */
+gpu_minimizer_seed_qry_entry_t* gpu_minimizer_seed_buffer_get_queries_(const void* const seedBuffer);
+gpu_minimizer_seed_qry_info_t*  gpu_minimizer_seed_buffer_get_qry_info_(const void* const seedBuffer);
+gpu_minimizer_seed_result_t*    gpu_minimizer_seed_buffer_get_results_(const void* const seedBuffer);
+gpu_minimizer_seed_cand_info_t* gpu_minimizer_seed_buffer_get_candidates_(const void* const seedBuffer);
 
 /*
  * Get elements
@@ -117,6 +214,14 @@ uint32_t gpu_bpm_filter_buffer_get_max_queries_(const void* const bpmBuffer);
 uint32_t gpu_kmer_filter_buffer_get_max_qry_bases_(const void* const kmerBuffer);
 uint32_t gpu_kmer_filter_buffer_get_max_candidates_(const void* const kmerBuffer);
 uint32_t gpu_kmer_filter_buffer_get_max_queries_(const void* const kmerBuffer);
+/* Paired-end pairing get primitives */
+uint32_t gpu_pair_filter_buffer_get_max_mates_(const void* const pairBuffer);
+uint32_t gpu_pair_filter_buffer_get_max_pairs_(const void* const pairBuffer);
+uint32_t gpu_pair_filter_buffer_get_max_queries_(const void* const pairBuffer);
+/* Minimizer seeding get primitives */
+uint32_t gpu_minimizer_seed_buffer_get_max_qry_bases_(const void* const seedBuffer);
+uint32_t gpu_minimizer_seed_buffer_get_max_candidates_(const void* const seedBuffer);
+uint32_t gpu_minimizer_seed_buffer_get_max_queries_(const void* const seedBuffer);
 
 /*
  * Main functions
@@ -126,10 +231,59 @@ void gpu_bpm_filter_init_buffer_(void* const bpmBuffer, const uint32_t averageQu
 void gpu_bpm_filter_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEntries, const uint32_t numQueries, const uint32_t numCandidates, const uint32_t maxQuerySize, const uint32_t queryBinSize);
 void gpu_bpm_filter_receive_buffer_(void* const bpmBuffer);
 void gpu_bpm_filter_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t totalPEQEntries, const uint32_t totalCandidates, const uint32_t totalQueries);
-/* K-MER filter buffer primitives */
+/* K-MER filter buffer primitives (kmerLength from 4 to 7 bases, 7 only for queries up to 128 bases, 0 uses the default 6) */
 void gpu_kmer_filter_init_buffer_(void* const kmerBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery);
-void gpu_kmer_filter_send_buffer_(void* const kmerBuffer, const uint32_t numBases, const uint32_t numQueries, const uint32_t numCandidates, const uint32_t maxError);
+void gpu_kmer_filter_send_buffer_(void* const kmerBuffer, const uint32_t numBases, const uint32_t numQueries, const uint32_t numCandidates, const uint32_t maxError,
+                                  const uint32_t kmerLength);
 void gpu_kmer_filter_receive_buffer_(void* const kmerBuffer);
 void gpu_kmer_filter_init_and_realloc_buffer_(void *kmerBuffer, const uint32_t totalQueryBases, const uint32_t totalCandidates, const uint32_t totalQueries);
+/* Paired-end pairing buffer primitives (multithreaded host backend, numThreads = 0 uses a single worker per buffer) */
+void gpu_pair_filter_init_buffer_(void* const pairBuffer, const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery);
+void gpu_pair_filter_send_buffer_(void* const pairBuffer, const uint32_t numMates, const uint32_t numQueries, const uint32_t numPairs,
+                                  const uint32_t minInsertSize, const uint32_t maxInsertSize, const gpu_pair_filter_orientation_t orientation,
+                                  const uint32_t numThreads);
+void gpu_pair_filter_receive_buffer_(void* const pairBuffer);
+void gpu_pair_filter_init_and_realloc_buffer_(void *pairBuffer, const uint32_t maxPairsPerQuery, const uint32_t totalMates, const uint32_t totalQueries);
+/* Minimizer seeding buffer primitives (multithreaded host backend over the reference minimizer index, 0 selects the defaults) */
+void gpu_minimizer_seed_init_buffer_(void* const seedBuffer, const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery);
+void gpu_minimizer_seed_send_buffer_(void* const seedBuffer, const uint32_t numBases, const uint32_t numQueries, const uint32_t numCandidates,
+                                     const uint32_t maxOccurrences, const uint32_t bandWidth, const uint32_t minAnchors, const uint32_t numThreads);
+void gpu_minimizer_seed_receive_buffer_(void* const seedBuffer);
+void gpu_minimizer_seed_init_and_realloc_buffer_(void *seedBuffer, const uint32_t maxCandidatesPerQuery, const uint32_t totalQueryBases,
+                                                 const uint32_t totalQueries);
+
+/*
+ * Batch functions (caller arrays are processed in as many sub-batches as the buffer layout requires)
+ */
+/* BPM filter batch primitives (queries stored in order, the tiles of a candidate are never split) */
+void gpu_bpm_filter_send_batch_(void* const bpmBuffer, const gpu_bpm_filter_qry_entry_t* const peqEntries, const gpu_bpm_filter_qry_info_t* const qryInfo,
+                                const gpu_bpm_filter_cand_info_t* const candidates, const uint32_t numCandidates, const uint32_t maxQuerySize,
+                                const uint32_t queryBinSize, gpu_bpm_filter_alg_entry_t* const alignments);
+void gpu_bpm_filter_receive_batch_(void* const bpmBuffer);
+/* K-MER filter batch primitives (queries stored in order) */
+void gpu_kmer_filter_send_batch_(void* const kmerBuffer, const gpu_kmer_filter_qry_entry_t* const queries, const gpu_kmer_filter_qry_info_t* const queryInfo,
+                                 const gpu_kmer_filter_cand_info_t* const candidates, const uint32_t numCandidates, const uint32_t maxError,
+                                 const uint32_t kmerLength, gpu_kmer_filter_alg_entry_t* const alignments);
+void gpu_kmer_filter_receive_batch_(void* const kmerBuffer);
+/* Paired-end pairing batch primitives (mate lists stored in query order, pair slots given by results[].init_offset) */
+void gpu_pair_filter_send_batch_(void* const pairBuffer, const gpu_pair_filter_mate_entry_t* const mates, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                 gpu_pair_filter_result_t* const results, const uint32_t numQueries, const uint32_t minInsertSize,
+                                 const uint32_t maxInsertSize, const gpu_pair_filter_orientation_t orientation, const uint32_t numThreads,
+                                 gpu_pair_filter_pair_entry_t* const pairs);
+void gpu_pair_filter_receive_batch_(void* const pairBuffer);
+/* Minimizer seeding batch primitives (queries stored in order, candidate slots given by results[].init_offset) */
+void gpu_minimizer_seed_send_batch_(void* const seedBuffer, const gpu_minimizer_seed_qry_entry_t* const queries,
+                                    const gpu_minimizer_seed_qry_info_t* const queryInfo, gpu_minimizer_seed_result_t* const results,
+                                    const uint32_t numQueries, const uint32_t maxOccurrences, const uint32_t bandWidth, const uint32_t minAnchors,
+                                    const uint32_t numThreads, gpu_minimizer_seed_cand_info_t* const candidates);
+void gpu_minimizer_seed_receive_batch_(void* const seedBuffer);
+
+/*
+ * Candidate text extraction (host reference kept by gpu_buffers_dto_t.hostReferenceText, numThreads = 0 uses a single worker per buffer)
+ */
+uint64_t gpu_reference_get_text_size_(const gpu_reference_text_request_t* const requests, const uint32_t numRequests,
+                                      const gpu_reference_text_format_t format);
+void     gpu_reference_extract_text_(const void* const gpuBuffer, gpu_reference_text_request_t* const requests, const uint32_t numRequests,
+                                     const gpu_reference_text_format_t format, const uint32_t numThreads, uint8_t* const text);
 
 #endif /* GPU_FILTER_INTERFACE_H_ */
@@ -57,6 +57,9 @@ typedef struct {
   uint64_t            numEntries;
   uint32_t            samplingRate;
   gpu_index_coding_t  indexCoding;
+  float               maxMbSA;              // Memory budget to resample the SA at load time (0 keeps the stored rate)
+  uint32_t            minSamplingRate;      // Densest rate allowed when resampling (0 does not densify the stored SA)
+  bool                packedSA;             // Bit-packed samples (ceil(log2(textSize)) bits per sample)
 } gpu_sa_dto_t;
 
 /* FMI data structures */
@@ -99,6 +102,33 @@ typedef struct{
   uint64_t steps;
 } gpu_fmi_decode_end_pos_t;
 
+typedef enum
+{
+  GPU_FMI_MSEARCH_MISMATCHES,  /* Hamming distance (substitutions) */
+  GPU_FMI_MSEARCH_EDITS        /* Levenshtein distance (substitutions, insertions and deletions) */
+} gpu_fmi_msearch_error_model_t;
+
+typedef struct{
+  uint32_t init_offset;        // First interval slot of the query (maxIntervalsPerQuery slots)
+  uint32_t num_intervals;
+  uint32_t min_errors;         // Best stratum found (0xFFFFFFFF without matches)
+  uint32_t num_dropped;        // Intervals discarded when the slots are exhausted
+} gpu_fmi_msearch_result_t;
+
+typedef struct{
+  uint64_t low;                // Interval of the seed in the forward index [low, low + size)
+  uint64_t low_reverse;        // Interval of the reversed seed in the reverse index [low_reverse, low_reverse + size)
+  uint64_t size;
+  uint32_t init_offset;        // Query bases covered by the seed [init_offset, end_offset)
+  uint32_t end_offset;
+} gpu_fmi_smem_seed_t;
+
+typedef struct{
+  uint32_t init_offset;        // First seed slot of the query (maxSeedsPerQuery slots)
+  uint32_t num_seeds;
+  uint32_t num_dropped;        // SMEMs discarded when the slots are exhausted
+} gpu_fmi_smem_result_t;
+
 typedef struct {
   uint64_t*          c;                     // Occurrences of each character
   uint64_t*          C;                     // The cumulative occurrences ("ranks") of the symbols of the string
@@ -121,6 +151,8 @@ typedef struct {
   uint32_t            skipLevelsTable;
   uint32_t            numElementsTable;
   gpu_index_coding_t  indexCoding;
+  bool                hostLayout;           // Derive the host-optimized FMI layout (host backends)
+  char                *h_plainReverse;      // BWT of the reversed text (bidirectional index, ASCII coding)
 } gpu_fmi_dto_t;
 
 /*
@@ -144,10 +176,25 @@ gpu_fmi_search_query_info_t*  gpu_fmi_asearch_buffer_get_queries_info_(const voi
 gpu_fmi_search_region_t*      gpu_fmi_asearch_buffer_get_regions_(const void* const fmiBuffer);
 gpu_sa_search_inter_t*        gpu_fmi_asearch_buffer_get_regions_intervals_(const void* const fmiBuffer);
 gpu_fmi_search_region_info_t* gpu_fmi_asearch_buffer_get_regions_offsets_(const void* const fmiBuffer);
+// Approximate search
+gpu_fmi_search_query_t*       gpu_fmi_msearch_buffer_get_queries_(const void* const fmiBuffer);
+gpu_fmi_search_query_info_t*  gpu_fmi_msearch_buffer_get_queries_info_(const void* const fmiBuffer);
+gpu_fmi_msearch_result_t*     gpu_fmi_msearch_buffer_get_results_(const void* const fmiBuffer);
+gpu_sa_search_inter_t*        gpu_fmi_msearch_buffer_get_intervals_(const void* const fmiBuffer);
+// Super-maximal exact matches
+gpu_fmi_search_query_t*       gpu_fmi_smem_buffer_get_queries_(const void* const fmiBuffer);
+gpu_fmi_search_query_info_t*  gpu_fmi_smem_buffer_get_queries_info_(const void* const fmiBuffer);
+gpu_fmi_smem_result_t*        gpu_fmi_smem_buffer_get_results_(const void* const fmiBuffer);
+gpu_fmi_smem_seed_t*          gpu_fmi_smem_buffer_get_seeds_(const void* const fmiBuffer);
 // Decode
 gpu_fmi_decode_init_pos_t*    gpu_fmi_decode_buffer_get_init_pos_(const void* const fmiBuffer);
 gpu_fmi_decode_end_pos_t*     gpu_fmi_decode_buffer_get_end_pos_(const void* const fmiBuffer);
 gpu_sa_decode_text_pos_t*     gpu_sa_decode_buffer_get_ref_pos_(const void* const fmiBuffer);
+// Sampled SA (bit-packed samples are unpacked in batches)
+uint32_t                      gpu_sa_buffer_get_bits_per_sample_(const void* const saBuffer);
+uint32_t                      gpu_sa_buffer_get_sampling_rate_(const void* const saBuffer);
+void                          gpu_sa_buffer_unpack_samples_(const void* const saBuffer, const uint64_t idSample, const uint64_t numSamples,
+                                                            gpu_sa_entry_t* const samples);
 
 /*
  * Get elements
@@ -158,6 +205,14 @@ uint32_t gpu_fmi_ssearch_buffer_get_max_seeds_(const void* const fmiBuffer);
 uint32_t gpu_fmi_asearch_buffer_get_max_queries_(const void* const fmiBuffer);
 uint32_t gpu_fmi_asearch_buffer_get_max_regions_(const void* const fmiBuffer);
 uint32_t gpu_fmi_asearch_buffer_get_max_bases_(const void* const fmiBuffer);
+// Approximate search
+uint32_t gpu_fmi_msearch_buffer_get_max_queries_(const void* const fmiBuffer);
+uint32_t gpu_fmi_msearch_buffer_get_max_intervals_(const void* const fmiBuffer);
+uint32_t gpu_fmi_msearch_buffer_get_max_bases_(const void* const fmiBuffer);
+// Super-maximal exact matches
+uint32_t gpu_fmi_smem_buffer_get_max_queries_(const void* const fmiBuffer);
+uint32_t gpu_fmi_smem_buffer_get_max_seeds_(const void* const fmiBuffer);
+uint32_t gpu_fmi_smem_buffer_get_max_bases_(const void* const fmiBuffer);
 // Decode
 uint32_t gpu_fmi_decode_buffer_get_max_positions_(const void* const fmiBuffer);
 
@@ -174,11 +229,49 @@ void gpu_fmi_asearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQ
 void gpu_fmi_asearch_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numRegions, const uint32_t occMinThreshold, const uint32_t extraSteps, const uint32_t alphabetSize);
 void gpu_fmi_asearch_receive_buffer_(const void* const fmiBuffer);
 void gpu_fmi_asearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxRegionsFactor, const uint32_t totalBases,const uint32_t totalQueries, const uint32_t totalRegions);
+// Approximate search (host backend, each query fills up to maxIntervalsPerQuery slots from results[].init_offset)
+void gpu_fmi_msearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery);
+void gpu_fmi_msearch_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numIntervals, const uint32_t maxErrors, const gpu_fmi_msearch_error_model_t errorModel);
+void gpu_fmi_msearch_receive_buffer_(const void* const fmiBuffer);
+void gpu_fmi_msearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxIntervalsPerQuery, const uint32_t totalBases, const uint32_t totalQueries);
+// Super-maximal exact matches (host backend over the bidirectional index, each query fills up to maxSeedsPerQuery slots from results[].init_offset)
+void gpu_fmi_smem_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery);
+void gpu_fmi_smem_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numSeeds, const uint32_t minSeedLength);
+void gpu_fmi_smem_receive_buffer_(const void* const fmiBuffer);
+void gpu_fmi_smem_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxSeedsPerQuery, const uint32_t totalBases, const uint32_t totalQueries);
 // Decode
 void gpu_fmi_decode_init_buffer_(void* const fmiBuffer);
 void gpu_fmi_decode_send_buffer_(void* const fmiBuffer, const uint32_t numDecodings, const uint32_t samplingRate);
 void gpu_fmi_decode_receive_buffer_(const void* const fmiBuffer);
 void gpu_fmi_decode_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t numDecodings);
 
+/*
+ * Batch functions (caller arrays are processed in as many sub-batches as the buffer layout requires)
+ */
+// Static search
+void gpu_fmi_ssearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_seed_t* const seeds, const uint32_t numSeeds,
+                                 gpu_sa_search_inter_t* const saIntervals);
+void gpu_fmi_ssearch_receive_batch_(void* const fmiBuffer);
+// Adaptative search (region slots are given by regions[].init_offset, queries stored in order)
+void gpu_fmi_asearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                                 gpu_fmi_search_region_t* const regions, const uint32_t numQueries, const uint32_t occMinThreshold,
+                                 const uint32_t extraSteps, const uint32_t alphabetSize,
+                                 gpu_sa_search_inter_t* const regionsIntervals, gpu_fmi_search_region_info_t* const regionsOffsets);
+void gpu_fmi_asearch_receive_batch_(void* const fmiBuffer);
+// Approximate search (interval slots are given by results[].init_offset, queries stored in order)
+void gpu_fmi_msearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                                 gpu_fmi_msearch_result_t* const results, const uint32_t numQueries, const uint32_t maxErrors,
+                                 const gpu_fmi_msearch_error_model_t errorModel, gpu_sa_search_inter_t* const intervals);
+void gpu_fmi_msearch_receive_batch_(void* const fmiBuffer);
+// Super-maximal exact matches (seed slots are given by results[].init_offset, queries stored in order)
+void gpu_fmi_smem_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                              gpu_fmi_smem_result_t* const results, const uint32_t numQueries, const uint32_t minSeedLength,
+                              gpu_fmi_smem_seed_t* const seeds);
+void gpu_fmi_smem_receive_batch_(void* const fmiBuffer);
+// Decode (text positions are returned when the SA decode is active, BWT end positions otherwise)
+void gpu_fmi_decode_send_batch_(void* const fmiBuffer, const gpu_fmi_decode_init_pos_t* const initPos, const uint32_t numDecodings,
+                                const uint32_t samplingRate, gpu_fmi_decode_end_pos_t* const endPos, gpu_sa_decode_text_pos_t* const textPos);
+void gpu_fmi_decode_receive_batch_(void* const fmiBuffer);
+
 #endif /* GPU_FMI_INTERFACE_H_ */
 
@@ -33,6 +33,21 @@ typedef enum
   GPU_NONE_DATA             = 0
 } gpu_data_location_t;
 
+typedef enum
+{
+  GPU_HOST_PAGES_DEFAULT,      /* Default: ordinary pages */
+  GPU_HOST_PAGES_TRANSPARENT,  /* 2MB aligned mappings advised as transparent huge pages */
+  GPU_HOST_PAGES_HUGETLB_2MB,  /* Explicit 2MB hugetlb pages (falls back to transparent) */
+  GPU_HOST_PAGES_HUGETLB_1GB   /* Explicit 1GB hugetlb pages (falls back to 2MB and transparent) */
+} gpu_host_pages_t;
+
+typedef enum
+{
+  GPU_SHARED_INDEX_NONE,     /* Default: private copy of the host structures */
+  GPU_SHARED_INDEX_PUBLISH,  /* Load and publish the host structures (and device IPC handles) in a shared segment */
+  GPU_SHARED_INDEX_ATTACH    /* Map the published structures read-only (private load when not available) */
+} gpu_shared_index_t;
+
 typedef enum
 {
   /* GPU modules */
@@ -44,16 +59,21 @@ typedef enum
   GPU_KMER_FILTER       = GPU_UINT32_ONE_MASK << 5,
   GPU_BPM_ALIGN         = GPU_UINT32_ONE_MASK << 6,
   GPU_SWG_ALIGN         = GPU_UINT32_ONE_MASK << 7,
+  GPU_FMI_APPROX_SEARCH = GPU_UINT32_ONE_MASK << 8,
+  GPU_FMI_SMEM_SEARCH   = GPU_UINT32_ONE_MASK << 9,
+  GPU_PAIR_FILTER       = GPU_UINT32_ONE_MASK << 10,
+  GPU_MINIMIZER_SEED    = GPU_UINT32_ONE_MASK << 11,
   /* GPU data structures */
-  GPU_FMI               = GPU_FMI_ADAPT_SEARCH | GPU_FMI_EXACT_SEARCH | GPU_FMI_DECODE_POS,
+  GPU_FMI               = GPU_FMI_ADAPT_SEARCH | GPU_FMI_EXACT_SEARCH | GPU_FMI_DECODE_POS | GPU_FMI_APPROX_SEARCH | GPU_FMI_SMEM_SEARCH,
+  GPU_FMI_DEVICE        = GPU_FMI_ADAPT_SEARCH | GPU_FMI_EXACT_SEARCH | GPU_FMI_DECODE_POS, /* Read by the kernels (the rest search on the host) */
   GPU_SA                = GPU_SA_DECODE_POS,
   GPU_INDEX             = GPU_FMI | GPU_SA,
   GPU_REFERENCE_MASKED	= GPU_BPM_ALIGN,
-  GPU_REFERENCE_PLAIN   = GPU_BPM_FILTER | GPU_KMER_FILTER,
+  GPU_REFERENCE_PLAIN   = GPU_BPM_FILTER | GPU_KMER_FILTER | GPU_MINIMIZER_SEED,
   GPU_REFERENCE         = GPU_REFERENCE_PLAIN | GPU_REFERENCE_MASKED,
   /* GPU stages          */
-  GPU_SEEDING           = GPU_INDEX,
-  GPU_FILTERING         = GPU_REFERENCE_PLAIN,
+  GPU_SEEDING           = GPU_INDEX | GPU_MINIMIZER_SEED,
+  GPU_FILTERING         = GPU_REFERENCE_PLAIN | GPU_PAIR_FILTER,
   GPU_ALIGNMENT         = GPU_REFERENCE,
   /* General setups      */
   GPU_NONE_MODULES      = 0,
@@ -86,12 +106,37 @@ typedef enum
   GPU_ARCH_SUPPORTED  = GPU_ARCH_FERMI | GPU_ARCH_KEPLER | GPU_ARCH_MAXWELL | GPU_ARCH_PASCAL | GPU_ARCH_VOLTA | GPU_ARCH_NEWGEN
 } gpu_dev_arch_t;
 
+typedef enum
+{
+  GPU_INIT_PHASE_REFERENCE_LOAD,     /* Host: reference allocation and transform    */
+  GPU_INIT_PHASE_FMI_LOAD,           /* Host: FM-index transform and host layouts   */
+  GPU_INIT_PHASE_FMI_TABLE,          /* Host: FM-index LUT construction             */
+  GPU_INIT_PHASE_SA_LOAD,            /* Host: suffix array transform                */
+  GPU_INIT_PHASE_SA_RESAMPLE,        /* Host: suffix array resampling and packing   */
+  GPU_INIT_PHASE_SHM_PUBLISH,        /* Host: copy to the shared index segment      */
+  GPU_INIT_PHASE_REFERENCE_TRANSFER, /* Device: reference transference              */
+  GPU_INIT_PHASE_FMI_TRANSFER,       /* Device: FM-index transference               */
+  GPU_INIT_PHASE_FMI_TABLE_TRANSFER, /* Device: FM-index LUT transference           */
+  GPU_INIT_PHASE_SA_TRANSFER,        /* Device: suffix array transference           */
+  GPU_INIT_NUM_PHASES
+} gpu_init_phase_t;
+
 typedef struct {
   gpu_dev_arch_t      selectedArchitectures;
   gpu_data_location_t userAllocOption;
   gpu_module_t        activatedModules;
   gpu_module_t        allocatedStructures;
   bool                verbose;
+  bool                numaAware;  /* Place buffers, host replicas and worker threads on the device node */
+  gpu_host_pages_t    hostPages;  /* Page backing of the host index, reference and (optionally) buffers */
+  bool                hugePagesBuffers;
+  size_t              hostPageSize; /* Smallest page size obtained for the host structures (output) */
+  gpu_shared_index_t  sharedIndex;
+  const char          *sharedIndexName; /* POSIX shared memory name (i.e. "/gem-index") */
+  uint32_t            sharedIndexTimeoutMs; /* Wait of the attached processes for the publisher (0 = 5 seconds) */
+  uint32_t            numInitThreads;   /* Threads loading and transferring the structures (0 = as many as independent phases, 1 = sequential) */
+  double              timeInit;         /* Seconds to have all the structures in the devices (output) */
+  double              timeInitPhase[GPU_INIT_NUM_PHASES]; /* Seconds (output, 0 for the skipped phases) */
 } gpu_info_dto_t;
 
 typedef struct {
@@ -99,8 +144,46 @@ typedef struct {
   uint32_t            numBuffers;
   float               maxMbPerBuffer;
   gpu_module_t        activeModules;
+  uint32_t            layoutTuningPeriod;  /* Submissions observed between layout re-carvings (0 keeps the caller estimations) */
+  float               maxMbSeedCache;      /* Host cache of exact-search intervals shared by the buffers (0 disables it) */
+  bool                bpmHammingPrefilter; /* Ungapped BPM filter candidates resolved on the host (keeps the host reference) */
+  bool                dynamicBalancing;    /* Idle buffers migrate to the devices with more measured throughput */
+  bool                hostReferenceText;   /* Keeps the host reference for the candidate text extraction */
 } gpu_buffers_dto_t;
 
+typedef enum
+{
+  GPU_STATS_PHASE_LAYOUT,   /* Host: buffer layout remapping        */
+  GPU_STATS_PHASE_BINNING,  /* Host: task binning and scheduling    */
+  GPU_STATS_PHASE_TRANSFER, /* Device: Host<->Device transferences  */
+  GPU_STATS_PHASE_KERNEL,   /* Device: kernel processing            */
+  GPU_STATS_PHASE_REORDER,  /* Host: reordering of the results      */
+  GPU_STATS_NUM_PHASES
+} gpu_stats_phase_t;
+
+typedef struct {
+  uint64_t            numSubmissions;
+  uint64_t            numElements;
+  uint64_t            bytesCPUtoGPU;
+  uint64_t            bytesGPUtoCPU;
+  double              timePhase[GPU_STATS_NUM_PHASES]; /* Seconds */
+  uint64_t            numCutOffIterations;
+  uint64_t            numRescheduledTiles;
+  double              accUtilization;                  /* Sum of (elements / max elements) per submission */
+  double              maxUtilization;
+  uint64_t            numReallocations;
+  uint64_t            numOverflows;
+  uint64_t            numSplitBatches;                 /* Batch submissions processed as several sub-batches */
+  uint64_t            numSubBatches;
+  uint64_t            numLayoutTunings;                /* Layout re-carvings from the observed workload */
+  uint64_t            numCacheHits;                    /* Seeds resolved by the host interval cache */
+  uint64_t            numCacheMisses;
+  uint64_t            numPrefilterResolved;            /* Candidates resolved by the host Hamming prefilter */
+  uint64_t            numMigrations;                   /* Buffers moved to another device by the balancer */
+  uint64_t            numRegions;                      /* Seed regions returned by the adaptive search */
+  uint64_t            numRegionCandidates;             /* Candidates covered by the intervals of those regions */
+} gpu_stats_dto_t;
+
 
 /*
  * Get elements
@@ -109,6 +192,21 @@ uint32_t gpu_get_num_supported_devices_(const gpu_dev_arch_t selectedArchitectur
 uint32_t gpu_buffer_get_id_device_(const void* const gpu_buffer);
 uint32_t gpu_buffer_get_id_supported_device_(const void* const gpuBuffer);
 
+/*
+ * Performance counters (modules is a mask, GPU_ALL_MODULES aggregates all of them)
+ */
+void gpu_buffer_get_stats_(const void* const gpuBuffer, const gpu_module_t modules, gpu_stats_dto_t* const stats);
+void gpu_buffer_reset_stats_(void* const gpuBuffer);
+void gpu_get_stats_(const gpu_buffers_dto_t* const buff, const gpu_module_t modules, gpu_stats_dto_t* const stats);
+void gpu_reset_stats_(const gpu_buffers_dto_t* const buff);
+
+/*
+ * Event recorder (Chrome trace / Perfetto JSON: one track per device, buffer and stream)
+ */
+void gpu_trace_start_(const uint64_t maxEvents);
+void gpu_trace_stop_();
+void gpu_trace_dump_(const char* const fileName);
+
 
 /*
  * Main functions
@@ -0,0 +1,63 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_BALANCER_H_
+#define GPU_BALANCER_H_
+
+#include "gpu_commons.h"
+#include "gpu_stats.h"
+#include <pthread.h>
+
+/* Device returned when the buffer has to stay in its current device */
+#define GPU_BALANCER_NO_MIGRATION    GPU_UINT32_ONES
+/* Completions per device closing a throughput sample (averaged with weight ALPHA) */
+#define GPU_BALANCER_WINDOW          16
+#define GPU_BALANCER_ALPHA           0.5
+/* Buffers of margin to migrate (avoids the ping-pong of a buffer between similar devices) */
+#define GPU_BALANCER_HYSTERESIS      0.25
+#define GPU_BALANCER_MIN_BUFFERS     1
+
+typedef struct {
+  uint32_t  numBuffers;
+  /* Busy time of the device (any submission in flight) */
+  uint32_t  numInFlight;
+  double    lastEvent;
+  /* Observation window */
+  uint32_t  numCompleted;
+  double    busyTime;
+  uint64_t  numElements[GPU_STATS_NUM_MODULES];
+  /* Elements per busy second of each module (0 until the module is measured) */
+  double    throughput[GPU_STATS_NUM_MODULES];
+} gpu_balancer_device_t;
+
+typedef struct {
+  uint32_t               numDevices;
+  uint32_t               numBuffers;
+  uint32_t               cooldown;      /* Completions left to measure the last migration */
+  gpu_balancer_device_t  *devices;
+  pthread_mutex_t        lock;
+} gpu_balancer_t;
+
+/* Functions to initialize and release the balancer (devices are indexes, no CUDA calls) */
+gpu_error_t gpu_balancer_init(gpu_balancer_t** const balancer, const uint32_t numDevices, const uint32_t* const buffersPerDevice);
+gpu_error_t gpu_balancer_free(gpu_balancer_t** const balancer);
+
+/* Functions to measure the completion rates */
+void        gpu_balancer_busy_time(gpu_balancer_device_t* const device, const double time);
+void        gpu_balancer_submit(gpu_balancer_t* const balancer, const uint32_t idDevice, const uint32_t idModule, const double time);
+void        gpu_balancer_complete(gpu_balancer_t* const balancer, const uint32_t idDevice, const uint32_t idModule,
+                                  const uint32_t numElements, const double time);
+
+/* Functions to decide the buffer migrations */
+bool        gpu_balancer_get_shares(const gpu_balancer_t* const balancer, double* const shares);
+uint32_t    gpu_balancer_select_target(const gpu_balancer_t* const balancer, const uint32_t idDevice);
+uint32_t    gpu_balancer_migration(gpu_balancer_t* const balancer, const uint32_t idDevice);
+void        gpu_balancer_move(gpu_balancer_t* const balancer, const uint32_t idSourceDevice, const uint32_t idTargetDevice);
+
+#endif /* GPU_BALANCER_H_ */
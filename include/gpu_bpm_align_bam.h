@@ -0,0 +1,73 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_BPM_ALIGN_BAM_H_
+#define GPU_BPM_ALIGN_BAM_H_
+
+#include <pthread.h>
+#include "gpu_commons.h"
+#include "gpu_buffer.h"
+#include "gpu_reference_text.h"
+
+#define GPU_BPM_ALIGN_BAM_CANDIDATES_PER_TASK  64
+#define GPU_BPM_ALIGN_BAM_MAX_THREADS          64
+
+typedef struct {
+  /* Backtrace runs left between the soft-clips (text-only runs at the ends are dropped) */
+  const gpu_bpm_align_cigar_entry_t *runs;
+  uint32_t                          numRuns;
+  uint32_t                          leftClip;
+  uint32_t                          rightClip;
+  uint64_t                          position;
+  uint32_t                          textSize;
+} gpu_bpm_align_bam_alignment_t;
+
+typedef struct {
+  const gpu_reference_buffer_t       *reference;
+  const gpu_bpm_align_cand_info_t    *candidates;
+  const gpu_bpm_align_cigar_info_t   *cigarsInfo;
+  const gpu_bpm_align_cigar_entry_t  *cigars;
+  uint32_t                           numCandidates;
+  bool                               extendedCigar;
+  gpu_bpm_align_bam_info_t           *bamInfo;
+  uint32_t                           *bamCigars;
+  char                               *md;
+  /* Dynamic scheduling of the candidates */
+  uint32_t                           nextCandidate;
+} gpu_bpm_align_bam_context_t;
+
+typedef struct {
+  gpu_bpm_align_bam_context_t *context;
+  uint8_t                     *h_text;    // Scratch with the reference bases covered by an alignment
+  uint32_t                    maxText;
+  gpu_error_t                 error;
+  pthread_t                   thread;
+} gpu_bpm_align_bam_worker_t;
+
+/* Conversion of a single alignment */
+bool        gpu_bpm_align_bam_trim(const gpu_reference_buffer_t* const reference, const gpu_bpm_align_cand_info_t* const candidate,
+                                   const gpu_bpm_align_cigar_info_t* const cigarInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                                   gpu_bpm_align_bam_alignment_t* const alignment);
+uint32_t    gpu_bpm_align_bam_get_op(const char event, const bool extendedCigar);
+uint32_t    gpu_bpm_align_bam_put_number(char* const md, const uint32_t value);
+void        gpu_bpm_align_bam_convert(const gpu_bpm_align_bam_alignment_t* const alignment, const bool extendedCigar,
+                                      const uint8_t* const text, uint32_t* const bamCigars, char* const md,
+                                      gpu_bpm_align_bam_info_t* const bamInfo);
+gpu_error_t gpu_bpm_align_bam_build(gpu_bpm_align_bam_worker_t* const worker, const uint32_t idCandidate);
+
+/* Multithreaded output */
+void*       gpu_bpm_align_bam_worker(void* const threadWorker);
+uint32_t    gpu_bpm_align_bam_get_num_threads(const uint32_t numThreads, const uint32_t numCandidates);
+gpu_error_t gpu_bpm_align_bam_output(const gpu_reference_buffer_t* const reference, const gpu_bpm_align_cand_info_t* const candidates,
+                                     const gpu_bpm_align_cigar_info_t* const cigarsInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                                     const uint32_t numCandidates, const bool extendedCigar, const uint32_t numThreads,
+                                     gpu_bpm_align_bam_info_t* const bamInfo, uint32_t* const bamCigars, const uint32_t maxBamCigars,
+                                     char* const md, const uint32_t maxMdChars);
+
+#endif /* GPU_BPM_ALIGN_BAM_H_ */
@@ -100,6 +100,7 @@ float       gpu_bpm_align_size_per_candidate(const uint32_t averageQuerySize, co
 uint32_t    gpu_bpm_align_candidates_for_binning_padding();
 void        gpu_bpm_align_reallocate_host_buffer_layout(gpu_buffer_t* const mBuff);
 void        gpu_bpm_align_reallocate_device_buffer_layout(gpu_buffer_t* const mBuff);
+void        gpu_bpm_align_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery);
 /* Functions to send & process a BPM buffer to GPU */
 gpu_error_t gpu_bpm_align_reordering_buffer(gpu_buffer_t* const mBuff);
 gpu_error_t gpu_bpm_align_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff);
@@ -110,6 +111,10 @@ gpu_error_t gpu_bpm_align_reorder_process(const gpu_bpm_align_queries_buffer_t*
                                           gpu_scheduler_buffer_t* const rebuff, gpu_bpm_align_cigars_buffer_t* const res);
 /* DEVICE Kernels */
 gpu_error_t gpu_bpm_align_process_buffer(gpu_buffer_t *mBuff);
+/* Functions to split oversized submissions */
+uint32_t    gpu_bpm_align_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_bpm_align_qry_info_t* const qryInfo,
+                                           const gpu_bpm_align_cand_info_t* const candidates, const uint32_t numCandidates,
+                                           uint32_t* const idFirstQuery, uint32_t* const idLastQuery, uint32_t* const numCigarEntries);
 
 #endif /* GPU_BPM_ALIGN_PRIMITIVES_H_ */
 
@@ -39,6 +39,20 @@ Common constants for Device & Host
 #define GPU_BPM_FILTER_THREADS_PER_TILE            (GPU_BPM_FILTER_CUTOFF_MAX_TILE_LENGHT / GPU_BPM_FILTER_PEQ_LENGTH_PER_CUDA_THREAD)
 #define GPU_BPM_FILTER_MIN_TILES_PER_LAUNCH        (GPU_BPM_FILTER_MIN_THREADS_PER_LAUNCH / GPU_BPM_FILTER_THREADS_PER_TILE)
 
+/* Defines of the reference-locality ordering (LSD radix sort over the candidate positions) */
+#define GPU_BPM_FILTER_LOCALITY_ORDERING           true
+#define GPU_BPM_FILTER_LOCALITY_BASES_LOG2         8    // Candidates sharing a 64B line of the plain reference keep the caller order
+#define GPU_BPM_FILTER_LOCALITY_RADIX_BITS         8
+#define GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS      (GPU_UINT32_MASK_ONE_LOW << GPU_BPM_FILTER_LOCALITY_RADIX_BITS)
+#define GPU_BPM_FILTER_LOCALITY_MIN_CANDIDATES     1024 // Smaller batches fit in cache, the caller order is kept
+
+/* Defines of the Hamming prefilter (32 packed bases per word) */
+#define GPU_BPM_FILTER_HAMMING_BASES_PER_WORD      GPU_BPM_FILTER_PEQ_SUBENTRY_LENGTH
+#define GPU_BPM_FILTER_HAMMING_MAX_WORDS           (GPU_BPM_FILTER_CUTOFF_MAX_TILE_LENGHT / GPU_BPM_FILTER_HAMMING_BASES_PER_WORD)
+#define GPU_BPM_FILTER_HAMMING_EVEN_BITS           0x5555555555555555ULL
+#define GPU_BPM_FILTER_HAMMING_MAX_EXACT_DISTANCE  1    // Larger Hamming distances can hide a cheaper gapped alignment
+#define GPU_BPM_FILTER_HAMMING_QUERY_CACHE         32   // Packed tiles kept by query id (direct mapped)
+
 /*****************************
 Internal Object
 *****************************/
@@ -101,6 +115,18 @@ typedef struct {
   uint32_t                     *h_pendingTasks_tmpSpace[GPU_BPM_FILTER_PENDING_NUM_TASK_LIST];
 } gpu_bpm_filter_cutoff_buffer_t;
 
+typedef struct {
+  uint32_t                     numWords;
+  uint64_t                     bases[GPU_BPM_FILTER_HAMMING_MAX_WORDS];      // Tile packed as the plain reference (2 bits per base)
+  uint64_t                     mismatches[GPU_BPM_FILTER_HAMMING_MAX_WORDS]; // Positions never matching (non-ACGT query bases)
+  uint64_t                     active[GPU_BPM_FILTER_HAMMING_MAX_WORDS];     // Positions inside the tile
+} gpu_bpm_filter_hamming_query_t;
+
+typedef struct {
+  uint32_t                        idQuery[GPU_BPM_FILTER_HAMMING_QUERY_CACHE];
+  gpu_bpm_filter_hamming_query_t  query[GPU_BPM_FILTER_HAMMING_QUERY_CACHE];
+} gpu_bpm_filter_hamming_cache_t;
+
 /*****************************
 General Object
 *****************************/
@@ -118,6 +144,8 @@ typedef struct {
   uint32_t                             maxQuerySize;
   bool                        		   queryBinning;
   bool                                 activeCutOff;
+  uint32_t                             numResolvedCandidates;
+  uint32_t                             *h_localityOrder;    // Candidates sorted by reference position (NULL keeps the caller order)
   gpu_bpm_filter_queries_buffer_t      queries;
   gpu_bpm_filter_candidates_buffer_t   candidates;
   gpu_scheduler_buffer_t               reorderBuffer;
@@ -132,6 +160,7 @@ float       gpu_bpm_filter_size_per_candidate(const uint32_t averageQuerySize, c
 uint32_t    gpu_bpm_filter_candidates_for_binning_padding();
 void        gpu_bpm_filter_reallocate_host_buffer_layout(gpu_buffer_t* const mBuff);
 void        gpu_bpm_filter_reallocate_device_buffer_layout(gpu_buffer_t* const mBuff);
+void        gpu_bpm_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery);
 /* Functions to send & process a BPM buffer to GPU */
 gpu_error_t gpu_bpm_filter_reordering_buffer(gpu_buffer_t* const mBuff);
 gpu_error_t gpu_bpm_filter_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff);
@@ -145,9 +174,29 @@ gpu_error_t gpu_bpm_filter_reorder_process(const gpu_bpm_filter_queries_buffer_t
                                     	   gpu_scheduler_buffer_t* const rebuff, gpu_bpm_filter_alignments_buffer_t* const res, const uint32_t idKey);
 /* DEVICE Kernels */
 gpu_error_t gpu_bpm_filter_process_buffer(gpu_buffer_t* const mBuff);
+/* Reference-locality ordering of the candidates (host side) */
+uint64_t    gpu_bpm_filter_locality_key(const gpu_bpm_filter_cand_info_t* const candidate);
+gpu_error_t gpu_bpm_filter_locality_ordering(gpu_buffer_t* const mBuff);
 /* Cutoff primitives */
 gpu_error_t gpu_bpm_filter_device_synch(gpu_buffer_t* const mBuff);
 gpu_error_t gpu_bpm_filter_reordering_alignments_cutoff(gpu_buffer_t* const mBuff);
+/* Hamming prefilter primitives (ungapped candidates resolved on the host) */
+gpu_error_t gpu_bpm_filter_hamming_prefilter(gpu_buffer_t* const mBuff);
+const gpu_bpm_filter_hamming_query_t* gpu_bpm_filter_hamming_get_query(const gpu_bpm_filter_queries_buffer_t* const qry, const uint32_t idQuery,
+                                                                       gpu_bpm_filter_hamming_cache_t* const cache);
+uint64_t    gpu_bpm_filter_hamming_spread(const uint32_t bitmap);
+void        gpu_bpm_filter_hamming_pack_query(const gpu_bpm_filter_qry_entry_t* const peq, const uint32_t tileSize,
+                                              gpu_bpm_filter_hamming_query_t* const query);
+uint64_t    gpu_bpm_filter_hamming_text(const gpu_reference_buffer_t* const reference, const uint64_t position);
+uint32_t    gpu_bpm_filter_hamming_diagonal(const gpu_reference_buffer_t* const reference, const gpu_bpm_filter_hamming_query_t* const query,
+                                            const uint64_t position, const uint32_t maxDistance);
+bool        gpu_bpm_filter_hamming_candidate(const gpu_reference_buffer_t* const reference, const gpu_bpm_filter_hamming_query_t* const query,
+                                             const gpu_bpm_filter_cand_info_t* const candidate, const uint32_t tileSize, const uint32_t maxError,
+                                             gpu_bpm_filter_alg_entry_t* const alignment);
+/* Functions to split oversized submissions */
+uint32_t    gpu_bpm_filter_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_bpm_filter_qry_info_t* const qryInfo,
+                                            const gpu_bpm_filter_cand_info_t* const candidates, const uint32_t numCandidates,
+                                            uint32_t* const idFirstQuery, uint32_t* const idLastQuery);
 
 #endif /* GPU_BPM_PRIMITIVES_FILTER_H_ */
 
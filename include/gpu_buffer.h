@@ -13,12 +13,30 @@
 #include "gpu_devices.h"
 #include "gpu_reference.h"
 #include "gpu_index.h"
+#include "gpu_stats.h"
+#include "gpu_layout.h"
+#include "gpu_balancer.h"
+#include "gpu_fmi_cache.h"
+#include "gpu_shm.h"
+#include "gpu_init.h"
 /* Include the required modules */
 #include "gpu_buffer_modules.h"
 
 #ifndef GPU_BUFFER_H_
 #define GPU_BUFFER_H_
 
+/* Sub-batch of a split submission still in flight (results are copied out at the reception) */
+typedef struct {
+  bool                    pending;
+  uint32_t                offset;         /* First element of the caller arrays */
+  uint32_t                numElements;
+  uint32_t                offsetEntries;  /* First entry of the caller variable-length results (regions, cigars) */
+  uint32_t                numEntries;
+  void                    *h_results;     /* Caller arrays receiving the results */
+  void                    *h_entries;
+  void                    *h_entriesInfo;
+} gpu_buffer_batch_t;
+
 typedef struct {
   gpu_module_t            typeBuffer;
   uint32_t                numBuffers;
@@ -29,10 +47,17 @@ typedef struct {
   gpu_device_info_t       **device;
   gpu_reference_buffer_t  *reference;
   gpu_index_buffer_t      *index;
+  bool                    hammingPrefilter;  /* BPM filter candidates resolved on the host when ungapped */
+  gpu_balancer_t          *balancer;         /* Runtime split of the buffers among the devices (NULL when static) */
+  bool                    balancePending;
+  uint32_t                balanceElements;   /* Elements of the submission in flight */
   size_t                  sizeBuffer;
   void                    *h_rawData;
   void                    *d_rawData;
   gpu_buffer_modules_t    data;
+  gpu_buffer_batch_t      batch;
+  gpu_layout_buffer_t     layout;
+  gpu_stats_buffer_t      stats;
 } gpu_buffer_t;
 
 
@@ -46,8 +71,23 @@ gpu_error_t gpu_buffer_configuration(gpu_buffer_t* const mBuff, const uint32_t i
 gpu_error_t gpu_buffer_scheduling(gpu_buffer_t ***gpuBuffer, const uint32_t numBuffers, gpu_device_info_t** const device,
                                   gpu_reference_buffer_t *reference, gpu_index_buffer_t *index, float maxMbPerBuffer);
 
-/* Functions to free all the buffer resources (HOST & DEVICE) */
+/* Functions to balance the buffers among the devices (measured throughput) */
+gpu_error_t gpu_buffer_balancer_init(gpu_buffer_t** const buffer, const uint32_t numBuffers);
+gpu_error_t gpu_buffer_balancer_free(gpu_buffer_t** const buffer, const uint32_t numBuffers);
+void        gpu_buffer_balance_submit(gpu_buffer_t* const mBuff, const uint32_t numElements);
+void        gpu_buffer_balance_complete(gpu_buffer_t* const mBuff);
+gpu_error_t gpu_buffer_balance(gpu_buffer_t* const mBuff);
+gpu_error_t gpu_buffer_migrate(gpu_buffer_t* const mBuff, const uint32_t idTargetDevice);
+
+/* Functions to allocate and free all the buffer resources (HOST & DEVICE) */
+gpu_error_t gpu_buffer_allocate(gpu_buffer_t* const mBuff);
 gpu_error_t gpu_buffer_free(gpu_buffer_t *mBuff);
 
+/* Functions to keep the state of the split submissions */
+void        gpu_buffer_batch_reset(gpu_buffer_t* const mBuff);
+void        gpu_buffer_batch_set_pending(gpu_buffer_t* const mBuff, const uint32_t offset, const uint32_t numElements,
+                                         const uint32_t offsetEntries, const uint32_t numEntries,
+                                         void* const h_results, void* const h_entries, void* const h_entriesInfo);
+
 
 #endif /* GPU_BUFFER_H_ */
@@ -13,6 +13,8 @@
 #include "gpu_bpm_primitives_filter.h"
 #include "gpu_bpm_primitives_align.h"
 #include "gpu_kmer_primitives_filter.h"
+#include "gpu_pair_primitives_filter.h"
+#include "gpu_minimizer_primitives_seed.h"
 
 #ifndef GPU_BUFFER_MODULES_H_
 #define GPU_BUFFER_MODULES_H_
@@ -21,7 +23,11 @@ typedef union{
   gpu_bpm_align_buffer_t   abpm;
   gpu_bpm_filter_buffer_t  fbpm;
   gpu_kmer_filter_buffer_t fkmer;
+  gpu_pair_filter_buffer_t fpair;
+  gpu_minimizer_seed_buffer_t mmseed;
   gpu_fmi_asearch_buffer_t asearch;
+  gpu_fmi_msearch_buffer_t msearch;
+  gpu_fmi_smem_buffer_t    smem;
   gpu_fmi_ssearch_buffer_t ssearch;
   gpu_fmi_decode_buffer_t  decode;
 } gpu_buffer_modules_t;
@@ -15,6 +15,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -115,5 +116,6 @@ uint32_t gpu_gen_mask(const int32_t shift);
 uint32_t gpu_count_active_bits(uint32_t a);
 uint8_t  gpu_base2log(const uint16_t value);
 bool     gpu_is_pow_two(uint32_t value);
+uint32_t gpu_get_num_workers(const uint32_t numThreads, const uint32_t numTasks, const uint32_t maxThreads);
 
 #endif /* GPU_COMMONS_H_ */
@@ -11,6 +11,7 @@
 #define GPU_DEVICES_H_
 
 #include "gpu_commons.h"
+#include "gpu_numa.h"
 
 /*************************************
 GPU Interface Objects
@@ -44,6 +45,7 @@ typedef enum
   GPU_PAGE_LOCKED_WRITECOMBINED  = GPU_UINT32_ONE_MASK << 2,
   /* Types of host allocations */
   GPU_PAGE_UNLOCKED              = GPU_UINT32_ONE_MASK << 3,
+  GPU_PAGE_SHARED                = GPU_UINT32_ONE_MASK << 4,  /* Mapped from a shared memory segment (gpu_shm) */
   GPU_PAGE_LOCKED                = GPU_PAGE_LOCKED_PORTABLE | GPU_PAGE_LOCKED_MAPPED | GPU_PAGE_LOCKED_WRITECOMBINED,
   /* Types for non-allocated pages */
   GPU_PAGE_UNALLOCATED           = 0,
@@ -73,6 +75,7 @@ typedef struct {
   float           coreClockRate;        // Ghz
   uint32_t        memoryBusWidth;       // Bits
   float           memoryClockRate;      // Ghz
+  int32_t         numaNode;             // Local node of the PCI root (GPU_NUMA_NODE_ANY if unknown)
   /* Device performance metrics */
   float           absolutePerformance;  // GOps/s
   float           relativePerformance;  // Ratio
@@ -94,6 +97,7 @@ uint32_t        gpu_device_get_stream_configuration(const stream_config_t stream
 
 /* Primitives to manage device driver options */
 gpu_error_t     gpu_device_set_local_memory_all(gpu_device_info_t **devices, enum cudaFuncCache cacheConfig);
+gpu_error_t     gpu_device_set_numa_all(gpu_device_info_t **devices);
 gpu_error_t     gpu_device_fast_driver_awake();
 
 /* Primitives to schedule and manage the devices */
@@ -31,7 +31,11 @@ typedef enum
   E_OVERFLOWING_BUFFER,
   E_FMI_TABLE_INCOMPATIBLE_SIZE,
   E_USE_CASE_NOT_ALLOWED,
-  E_NOT_IMPLEMENTED
+  E_NOT_IMPLEMENTED,
+  E_SHARED_INDEX_NOT_FOUND,
+  E_SHARED_INDEX_INCOMPATIBLE,
+  E_SHARED_INDEX_IN_USE,
+  E_SAMPLING_RATE_MISMATCH
 } gpu_error_t;
 
 #define CUDA_ERROR(error)   (cudaError(error, __FILE__, __LINE__ ))
@@ -0,0 +1,79 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_CACHE_H_
+#define GPU_FMI_CACHE_H_
+
+#include "gpu_commons.h"
+#include "gpu_stats.h"
+#include <pthread.h>
+
+/* Set-associative table (the entry with the lowest estimated frequency of the set is the victim) */
+#define GPU_FMI_CACHE_WAYS            8
+#define GPU_FMI_CACHE_LOCKS           4096
+/* Frequency sketch (count-min with byte counters saturated at SKETCH_MAX, halved every AGING_FACTOR x entries samples) */
+#define GPU_FMI_CACHE_SKETCH_ROWS     4
+#define GPU_FMI_CACHE_SKETCH_MAX      15
+#define GPU_FMI_CACHE_AGING_FACTOR    10
+
+typedef struct {
+  gpu_fmi_search_seed_t   seed;      /* Key (empty entries are zeroed, seeds always encode a non-zero size) */
+  gpu_sa_search_inter_t   interval;
+} gpu_fmi_cache_entry_t;
+
+typedef struct {
+  uint32_t                position;  /* Position of the seed in the submitted buffer */
+  gpu_fmi_search_seed_t   seed;
+  gpu_sa_search_inter_t   interval;
+} gpu_fmi_cache_hit_t;
+
+typedef struct {
+  /* Submission of the buffer resolved by the cache, pending of the merge with the device results */
+  uint32_t                numSeeds;
+  uint32_t                numMisses;
+  uint32_t                numHits;
+  uint32_t                maxHits;
+  gpu_fmi_cache_hit_t     *hits;
+} gpu_fmi_cache_batch_t;
+
+typedef struct {
+  bool                    active;
+  /* Table of intervals */
+  uint64_t                numSets;
+  gpu_fmi_cache_entry_t   *entries;
+  pthread_mutex_t         locks[GPU_FMI_CACHE_LOCKS];
+  /* Admission policy */
+  uint64_t                sketchWidth;
+  volatile uint8_t        *sketch;
+  uint64_t                agingPeriod;
+  volatile uint64_t       numSamples;
+  /* Per-buffer state */
+  uint32_t                numBuffers;
+  gpu_fmi_cache_batch_t   *batches;
+} gpu_fmi_cache_t;
+
+/* Functions to initialize and release the cache */
+gpu_error_t gpu_fmi_cache_init(const float maxMbCache, const uint32_t numBuffers);
+gpu_error_t gpu_fmi_cache_free();
+bool        gpu_fmi_cache_is_active();
+
+/* Functions to look up and admit the intervals */
+uint64_t    gpu_fmi_cache_hash(const gpu_fmi_search_seed_t* const seed);
+volatile uint8_t* gpu_fmi_cache_counter(const uint64_t hash, const uint32_t idRow);
+uint32_t    gpu_fmi_cache_estimate(const uint64_t hash);
+void        gpu_fmi_cache_sample(const uint64_t hash);
+bool        gpu_fmi_cache_lookup(const gpu_fmi_search_seed_t* const seed, gpu_sa_search_inter_t* const interval);
+void        gpu_fmi_cache_admit(const gpu_fmi_search_seed_t* const seed, const gpu_sa_search_inter_t* const interval);
+
+/* Functions to resolve the submissions of a buffer */
+uint32_t    gpu_fmi_cache_filter(const uint32_t idBuffer, gpu_fmi_search_seed_t* const seeds, const uint32_t numSeeds,
+                                 gpu_stats_buffer_t* const stats);
+uint32_t    gpu_fmi_cache_merge(const uint32_t idBuffer, gpu_fmi_search_seed_t* const seeds, gpu_sa_search_inter_t* const intervals);
+
+#endif /* GPU_FMI_CACHE_H_ */
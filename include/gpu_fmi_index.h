@@ -12,6 +12,7 @@
 
 #include "gpu_commons.h"
 #include "gpu_devices.h"
+#include "gpu_hugepages.h"
 #include "gpu_fmi_structure.h"
 #include "gpu_fmi_table.h"
 
@@ -25,6 +26,10 @@ typedef struct {
   uint64_t        numEntries;
   gpu_fmi_entry_t *h_fmi;
   gpu_fmi_entry_t **d_fmi;
+  /* Host-optimized layout (single entry access per rank query) */
+  bool                 activeHostLayout;
+  gpu_fmi_host_entry_t *h_fmiHost;
+  gpu_numa_replicas_t  hostReplicas;
   memory_stats_t  hostAllocStats;
   memory_alloc_t  *memorySpace;
 } gpu_fmi_buffer_t;
@@ -58,6 +63,8 @@ gpu_error_t gpu_fmi_index_load_MFASTA_FULL(const char* const fn, gpu_fmi_buffer_
 
 /* Functions to release the index data from the DEVICE & HOST */
 gpu_error_t gpu_fmi_index_free_host(gpu_fmi_buffer_t* const fmi);
+gpu_error_t gpu_fmi_index_free_host_entries(gpu_fmi_buffer_t* const fmi);
+gpu_error_t gpu_fmi_index_free_host_layout(gpu_fmi_buffer_t* const fmi);
 gpu_error_t gpu_fmi_index_free_unused_host(gpu_fmi_buffer_t* const fmi, gpu_device_info_t** const devices);
 gpu_error_t gpu_fmi_index_free_device(gpu_fmi_buffer_t* const fmi, gpu_device_info_t** const devices);
 gpu_error_t gpu_fmi_index_free_metainfo(gpu_fmi_buffer_t* const fmi);
@@ -67,6 +74,13 @@ gpu_error_t gpu_fmi_index_build_PEQ(const gpu_fmi_buffer_t* const fmi, const cha
                                     gpu_index_bitmap_entry_t* const h_bitmap_BWT);
 gpu_error_t gpu_fmi_index_build_COUNTERS(const gpu_fmi_buffer_t* const fmi, gpu_index_counter_entry_t* const h_counters_FMI,
                                          const char* const h_ascii_BWT);
+gpu_error_t gpu_fmi_index_build_host_layout(gpu_fmi_buffer_t* const fmi);
+gpu_error_t gpu_fmi_index_build_host_replicas(gpu_fmi_buffer_t* const fmi);
+uint64_t    gpu_fmi_index_host_LF_mapping(const gpu_fmi_host_entry_t* const h_fmiHost, const uint64_t interval, const uint32_t base);
+bool        gpu_fmi_index_host_LF_step(const gpu_fmi_buffer_t* const fmi, uint64_t* const interval);
+uint64_t    gpu_fmi_index_host_LF_rank(const gpu_fmi_buffer_t* const fmi, const gpu_fmi_host_entry_t* const h_fmiHost,
+                                       const uint64_t interval, const uint32_t base);
+
 gpu_error_t gpu_fmi_index_build_FMI(gpu_fmi_buffer_t* const fmi, gpu_index_bitmap_entry_t* const h_bitmap_BWT,
                                     const gpu_index_counter_entry_t* const h_counters_FMI);
 
@@ -14,6 +14,8 @@
 
 //FMI Modules
 #include "gpu_fmi_primitives_asearch.h"
+#include "gpu_fmi_primitives_msearch.h"
+#include "gpu_fmi_primitives_smem.h"
 #include "gpu_fmi_primitives_ssearch.h"
 #include "gpu_fmi_primitives_decode.h"
 
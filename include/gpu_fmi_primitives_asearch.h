@@ -76,6 +76,7 @@ typedef struct {
 size_t      gpu_fmi_asearch_size_per_query(const uint32_t averageQuerySize, const uint32_t averageRegionsPerQuery);
 void        gpu_fmi_asearch_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
 void        gpu_fmi_asearch_reallocate_device_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_fmi_asearch_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxRegionsFactor);
 
 /* Functions to transfer data HOST <-> DEVICE (E. SEARCH) */
 gpu_error_t gpu_fmi_asearch_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff);
@@ -83,6 +84,13 @@ gpu_error_t gpu_fmi_asearch_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff);
 
 /* DEVICE Kernels */
 gpu_error_t gpu_fmi_asearch_process_buffer(gpu_buffer_t* const mBuff);
+/* Functions to account the search results */
+void        gpu_fmi_asearch_account_regions(gpu_buffer_t* const mBuff);
+
+/* Functions to split oversized submissions */
+uint32_t    gpu_fmi_asearch_batch_max_regions(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo);
+uint32_t    gpu_fmi_asearch_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                          const gpu_fmi_search_region_t* const regions, const uint32_t numQueries);
 
 
 #endif /* GPU_FMI_PRIMITIVES_ASEARCH_H_ */
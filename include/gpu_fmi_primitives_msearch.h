@@ -0,0 +1,120 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#include "gpu_index_modules.h"
+#include "gpu_commons.h"
+#include "gpu_fmi_structure.h"
+#include "gpu_sa_index.h"
+
+#ifndef GPU_FMI_PRIMITIVES_MSEARCH_H_
+#define GPU_FMI_PRIMITIVES_MSEARCH_H_
+
+/********************************
+Common constants for Device & Host
+*********************************/
+
+/* Defines related to FMI approximate BACKWARD-SEARCH primitives */
+#define GPU_FMI_MSEARCH_MAX_ERRORS          4  //The search space grows as (query size x 4)^errors
+#define GPU_FMI_MSEARCH_MIN_INTERVALS       1
+#define GPU_FMI_MSEARCH_CANDIDATES_FACTOR   4  //Scratch slots per output interval (compacted when full)
+#define GPU_FMI_MSEARCH_NO_MATCH            GPU_UINT32_ONES
+
+/*****************************
+Internal Objects (Approximate Search)
+*****************************/
+
+typedef enum
+{
+  GPU_FMI_MSEARCH_OP_MATCH,      /* Match or substitution */
+  GPU_FMI_MSEARCH_OP_INSERTION,  /* Query base absent in the text */
+  GPU_FMI_MSEARCH_OP_DELETION    /* Text base absent in the query */
+} gpu_fmi_msearch_op_t;
+
+typedef struct {
+  gpu_sa_search_inter_t        interval;
+  uint32_t                     errors;
+} gpu_fmi_msearch_candidate_t;
+
+typedef struct {
+  /* Index structures (host copies) */
+  const gpu_fmi_buffer_t*        fmi;
+  const gpu_fmi_host_entry_t*    h_fmiHost;        // Local replica of the host layout (NULL converts the entries on the fly)
+  const gpu_fmi_table_t*         table;            // NULL when the table is not available on the host
+  /* Query being searched (bases in backward processing order) */
+  const gpu_fmi_search_query_t*  query;
+  uint32_t                       querySize;
+  const uint32_t*                bounds;           // Minimum errors of the unprocessed bases
+  uint32_t                       maxErrors;
+  gpu_fmi_msearch_error_model_t  errorModel;
+  /* Intervals found */
+  gpu_fmi_msearch_candidate_t*   candidates;
+  uint32_t                       numCandidates;
+  uint32_t                       maxCandidates;
+  uint32_t                       maxIntervals;
+  uint32_t                       numDropped;
+} gpu_fmi_msearch_context_t;
+
+typedef struct {
+  uint32_t                     numBases;
+  uint32_t                     numQueries;
+  gpu_fmi_search_query_t       *h_queries;
+  gpu_fmi_search_query_info_t  *h_queryInfo;
+  gpu_fmi_msearch_result_t     *h_results;
+} gpu_fmi_msearch_queries_buffer_t;
+
+typedef struct {
+  uint32_t                     numIntervals;
+  gpu_sa_search_inter_t        *h_intervals;
+  gpu_fmi_msearch_candidate_t  *h_candidates;
+} gpu_fmi_msearch_intervals_buffer_t;
+
+
+/*****************************
+Internal Objects (General)
+*****************************/
+typedef struct {
+  uint32_t                            numMaxBases;
+  uint32_t                            numMaxQueries;
+  uint32_t                            numMaxIntervals;
+  uint32_t                            numMaxCandidates;
+  uint32_t                            maxIntervalsPerQuery;
+  uint32_t                            maxErrors;
+  gpu_fmi_msearch_error_model_t       errorModel;
+  gpu_fmi_msearch_queries_buffer_t    queries;
+  gpu_fmi_msearch_intervals_buffer_t  intervals;
+} gpu_fmi_msearch_buffer_t;
+
+#include "gpu_buffer.h"
+
+/* Functions to init the buffers (M. SEARCH) */
+size_t      gpu_fmi_msearch_size_per_query(const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery);
+size_t      gpu_fmi_msearch_size_scratch(const uint32_t maxIntervalsPerQuery);
+void        gpu_fmi_msearch_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_fmi_msearch_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery);
+
+/* HOST Kernels */
+gpu_error_t gpu_fmi_msearch_process_buffer(gpu_buffer_t* const mBuff);
+void        gpu_fmi_msearch_compute_bounds(const gpu_fmi_msearch_context_t* const search, uint32_t* const bounds);
+bool        gpu_fmi_msearch_extend(const gpu_fmi_msearch_context_t* const search, const uint32_t base, const uint32_t textLength,
+                                   uint32_t* const key, uint64_t* const L, uint64_t* const R);
+int         gpu_fmi_msearch_cmp_intervals(const void* const a, const void* const b);
+int         gpu_fmi_msearch_cmp_errors(const void* const a, const void* const b);
+void        gpu_fmi_msearch_compact_candidates(gpu_fmi_msearch_context_t* const search);
+void        gpu_fmi_msearch_add_candidate(gpu_fmi_msearch_context_t* const search, const uint64_t L, const uint64_t R, const uint32_t errors);
+void        gpu_fmi_msearch_backtrack(gpu_fmi_msearch_context_t* const search, const uint32_t idBase, const uint64_t L, const uint64_t R,
+                                      const uint32_t errors, const uint32_t key, const uint32_t textLength, const gpu_fmi_msearch_op_t lastOp);
+void        gpu_fmi_msearch_process_query(gpu_fmi_msearch_context_t* const search, gpu_fmi_msearch_result_t* const result,
+                                          gpu_sa_search_inter_t* const intervals);
+
+/* Functions to split oversized submissions */
+uint32_t    gpu_fmi_msearch_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                          const gpu_fmi_msearch_result_t* const results, const uint32_t numQueries);
+
+
+#endif /* GPU_FMI_PRIMITIVES_MSEARCH_H_ */
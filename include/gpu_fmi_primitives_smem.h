@@ -0,0 +1,101 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#include "gpu_index_modules.h"
+#include "gpu_commons.h"
+#include "gpu_fmi_structure.h"
+#include "gpu_sa_index.h"
+
+#ifndef GPU_FMI_PRIMITIVES_SMEM_H_
+#define GPU_FMI_PRIMITIVES_SMEM_H_
+
+/********************************
+Common constants for Device & Host
+*********************************/
+
+/* Defines related to FMI super-maximal exact match primitives */
+#define GPU_FMI_SMEM_MIN_SEEDS            1
+#define GPU_FMI_SMEM_MIN_SEED_LENGTH      1
+
+/*****************************
+Internal Objects (SMEM Search)
+*****************************/
+
+typedef struct {
+  /* Bidirectional index (host copies) */
+  const gpu_fmi_buffer_t*        fmi;              // Backward extensions (BWT of the text)
+  const gpu_fmi_host_entry_t*    h_fmiHost;        // Local replica of the host layout (NULL converts the entries on the fly)
+  const gpu_fmi_buffer_t*        fmiReverse;       // Forward extensions (BWT of the reversed text)
+  const gpu_fmi_host_entry_t*    h_fmiHostReverse;
+  /* Query being searched (bases in text order) */
+  const gpu_fmi_search_query_t*  query;
+  uint32_t                       querySize;
+  uint32_t                       minSeedLength;
+  /* Candidate bi-intervals of the current start position (querySize + 1 slots each) */
+  gpu_fmi_smem_seed_t*           prev;
+  gpu_fmi_smem_seed_t*           curr;
+  /* SMEMs found */
+  gpu_fmi_smem_seed_t*           seeds;
+  uint32_t                       numSeeds;
+  uint32_t                       maxSeeds;
+  uint32_t                       numDropped;
+} gpu_fmi_smem_context_t;
+
+typedef struct {
+  uint32_t                     numBases;
+  uint32_t                     numQueries;
+  gpu_fmi_search_query_t       *h_queries;
+  gpu_fmi_search_query_info_t  *h_queryInfo;
+  gpu_fmi_smem_result_t        *h_results;
+} gpu_fmi_smem_queries_buffer_t;
+
+typedef struct {
+  uint32_t                     numSeeds;
+  gpu_fmi_smem_seed_t          *h_seeds;
+} gpu_fmi_smem_seeds_buffer_t;
+
+
+/*****************************
+Internal Objects (General)
+*****************************/
+typedef struct {
+  uint32_t                       numMaxBases;
+  uint32_t                       numMaxQueries;
+  uint32_t                       numMaxSeeds;
+  uint32_t                       maxSeedsPerQuery;
+  uint32_t                       minSeedLength;
+  gpu_fmi_smem_queries_buffer_t  queries;
+  gpu_fmi_smem_seeds_buffer_t    seeds;
+} gpu_fmi_smem_buffer_t;
+
+#include "gpu_buffer.h"
+
+/* Functions to init the buffers (SMEM SEARCH) */
+size_t      gpu_fmi_smem_size_per_query(const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery);
+void        gpu_fmi_smem_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_fmi_smem_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery);
+
+/* HOST Kernels */
+gpu_error_t gpu_fmi_smem_process_buffer(gpu_buffer_t* const mBuff);
+bool        gpu_fmi_smem_extend(const gpu_fmi_buffer_t* const fmi, const gpu_fmi_host_entry_t* const h_fmiHost, const uint32_t base,
+                                uint64_t* const low, uint64_t* const lowOther, uint64_t* const size);
+bool        gpu_fmi_smem_extend_backward(const gpu_fmi_smem_context_t* const search, const uint32_t base, gpu_fmi_smem_seed_t* const seed);
+bool        gpu_fmi_smem_extend_forward(const gpu_fmi_smem_context_t* const search, const uint32_t base, gpu_fmi_smem_seed_t* const seed);
+void        gpu_fmi_smem_reverse_seeds(gpu_fmi_smem_seed_t* const seeds, const uint32_t numSeeds);
+void        gpu_fmi_smem_add_seed(gpu_fmi_smem_context_t* const search, const gpu_fmi_smem_seed_t* const seed, const uint32_t initOffset);
+uint32_t    gpu_fmi_smem_search_position(gpu_fmi_smem_context_t* const search, const uint32_t position);
+void        gpu_fmi_smem_process_query(gpu_fmi_smem_context_t* const search, gpu_fmi_smem_result_t* const result,
+                                       gpu_fmi_smem_seed_t* const seeds);
+
+/* Functions to split oversized submissions */
+uint32_t    gpu_fmi_smem_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                       const gpu_fmi_smem_result_t* const results, const uint32_t numQueries);
+
+
+#endif /* GPU_FMI_PRIMITIVES_SMEM_H_ */
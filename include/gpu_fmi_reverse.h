@@ -0,0 +1,41 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_REVERSE_H_
+#define GPU_FMI_REVERSE_H_
+
+#include "gpu_commons.h"
+#include "gpu_fmi_index.h"
+
+/* Symbols of the reversed text (N and the sentinel sort after T, 0 is the SA-IS terminator) */
+#define GPU_FMI_REVERSE_SYMBOL_TERMINATOR   0
+#define GPU_FMI_REVERSE_SYMBOL_N            5
+#define GPU_FMI_REVERSE_SYMBOL_SENTINEL     6
+#define GPU_FMI_REVERSE_ALPHABET_SIZE       7
+#define GPU_FMI_REVERSE_SA_EMPTY            (-1)
+
+/* Suffix sorting (SA-IS) over 8-bit symbols or 64-bit names (recursion levels) */
+uint64_t    gpu_fmi_reverse_get_symbol(const void* const text, const uint32_t symbolBytes, const int64_t position);
+bool        gpu_fmi_reverse_get_type(const uint8_t* const types, const int64_t position);
+void        gpu_fmi_reverse_set_type(uint8_t* const types, const int64_t position, const bool typeS);
+bool        gpu_fmi_reverse_is_LMS(const uint8_t* const types, const int64_t position);
+void        gpu_fmi_reverse_get_buckets(const void* const text, const uint32_t symbolBytes, const int64_t textSize,
+                                        int64_t* const buckets, const uint64_t alphabetSize, const bool bucketEnd);
+void        gpu_fmi_reverse_induce_L(const uint8_t* const types, int64_t* const SA, const void* const text, const uint32_t symbolBytes,
+                                     int64_t* const buckets, const int64_t textSize, const uint64_t alphabetSize);
+void        gpu_fmi_reverse_induce_S(const uint8_t* const types, int64_t* const SA, const void* const text, const uint32_t symbolBytes,
+                                     int64_t* const buckets, const int64_t textSize, const uint64_t alphabetSize);
+gpu_error_t gpu_fmi_reverse_sort_suffixes(const void* const text, const uint32_t symbolBytes, int64_t* const SA,
+                                          const int64_t textSize, const uint64_t alphabetSize);
+
+/* Construction of the BWT of the reversed text */
+gpu_error_t gpu_fmi_reverse_build_BWT(const uint8_t* const text, const uint64_t textSize, char** const h_BWT);
+gpu_error_t gpu_fmi_index_build_reverse(const uint8_t* const text, const uint64_t textSize, gpu_fmi_buffer_t* const fmiReverse);
+
+#endif /* GPU_FMI_REVERSE_H_ */
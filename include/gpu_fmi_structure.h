@@ -44,4 +44,17 @@ typedef struct {
 } gpu_index_counter_entry_t;
 
 
+/*************************************
+Specific types for the Host (CPUs)
+**************************************/
+
+#define GPU_FMI_HOST_BITMAPS_PER_SLICE  GPU_FMI_BWT_CHAR_LENGTH                       //  3 bitmaps / 32 bases
+#define GPU_FMI_HOST_SLICES_PER_ENTRY   (GPU_FMI_ENTRY_SIZE / GPU_UINT32_LENGTH)      //  4 slices of 32 bases
+
+typedef struct {                                    // Host FMI Entry (80 Bytes: 2 cache lines at most) using:
+  uint64_t counters[GPU_FMI_NUM_COUNTERS];          // 4 letters: All the counters (4 uint64_t, no alternate entries)
+  uint32_t bitmaps[GPU_FMI_BITMAPS_PER_ENTRY];      // 5 letters: 12 Bitmaps x 32 bits (slice-ordered: bit0, bit1, valid)
+} gpu_fmi_host_entry_t;
+
+
 #endif /* GPU_FMI_STRUCTURE_H_ */
@@ -12,6 +12,7 @@
 
 #include "gpu_commons.h"
 #include "gpu_devices.h"
+#include "gpu_hugepages.h"
 
 #define GPU_FMI_TABLE_ALPHABET_SIZE       4
 #define GPU_FMI_TABLE_MIN_ELEMENTS        2
@@ -0,0 +1,47 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_HUGEPAGES_H_
+#define GPU_HUGEPAGES_H_
+
+#include "gpu_commons.h"
+#include "gpu_devices.h"
+
+#define GPU_HUGEPAGES_SIZE_2MB      (1UL << 21)
+#define GPU_HUGEPAGES_SIZE_1GB      (1UL << 30)
+/* Structures smaller than a huge page keep the ordinary allocators */
+#define GPU_HUGEPAGES_MIN_SIZE      GPU_HUGEPAGES_SIZE_2MB
+#define GPU_HUGEPAGES_MAX_REGIONS   1024
+#define GPU_HUGEPAGES_SYSFS_THP     "/sys/kernel/mm/transparent_hugepage/enabled"
+
+typedef struct {
+  void      *memory;
+  size_t    size;       /* Mapped size (multiple of the page size) */
+  size_t    pageSize;
+  bool      locked;     /* Registered in the CUDA driver as page-locked memory */
+} gpu_hugepages_region_t;
+
+typedef struct {
+  gpu_host_pages_t        policy;
+  bool                    activeBuffers;
+  size_t                  minPageSize;  /* Smallest page size obtained (0 before any allocation) */
+  uint32_t                numRegions;
+  gpu_hugepages_region_t  regions[GPU_HUGEPAGES_MAX_REGIONS];
+} gpu_hugepages_t;
+
+/* Configuration functions */
+void        gpu_hugepages_set_policy(const gpu_host_pages_t policy, const bool activeBuffers);
+size_t      gpu_hugepages_get_page_size();
+
+/* Allocation functions (fall back to malloc / cudaHostAlloc) */
+gpu_error_t gpu_hugepages_alloc(void** const memory, const size_t size, const memory_stats_t hostAllocStats);
+gpu_error_t gpu_hugepages_alloc_buffer(void** const memory, const size_t size);
+gpu_error_t gpu_hugepages_free(void* const memory, const memory_stats_t hostAllocStats);
+
+#endif /* GPU_HUGEPAGES_H_ */
@@ -17,13 +17,21 @@
 
 /* Get information functions */
 gpu_error_t gpu_index_get_size(const gpu_index_buffer_t* const index, size_t *bytesPerIndex, const gpu_module_t activeModules);
+bool        gpu_index_is_bidirectional(const gpu_index_buffer_t* const index, const gpu_module_t activeModules);
+gpu_module_t gpu_index_get_stored_modules(const gpu_index_buffer_t* const index, const gpu_module_t activeModules);
 
 /* Functions to initialize the index data on the DEVICE */
 gpu_error_t gpu_index_init_dto(gpu_index_buffer_t *index, const gpu_module_t activeModules);
 gpu_error_t gpu_index_init(gpu_index_buffer_t** const index, const gpu_index_dto_t* const rawIndex, const uint32_t numSupportedDevices, const gpu_module_t activeModules);
+gpu_error_t gpu_index_select_sa_specs(gpu_index_buffer_t* const index, const gpu_module_t activeModules);
 gpu_error_t gpu_index_load(gpu_index_buffer_t* index, const gpu_index_dto_t * const rawIndex,const gpu_module_t activeModules);
+gpu_error_t gpu_index_load_fmi(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules);
+gpu_error_t gpu_index_build_fmi_table(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules);
+gpu_error_t gpu_index_load_sa(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules);
+gpu_error_t gpu_index_resample_sa(gpu_index_buffer_t* const index, const gpu_module_t activeModules);
 gpu_error_t gpu_index_set_specs(gpu_index_buffer_t* const index, const gpu_index_dto_t* const indexRaw,const gpu_index_coding_t indexCoding, const gpu_module_t activeModules);
 gpu_error_t gpu_index_allocate(gpu_index_buffer_t* index, const gpu_module_t activeModules);
+gpu_error_t gpu_index_build_numa_replicas(gpu_index_buffer_t* const index, const gpu_module_t activeModules);
 
 /* Data transfer functions */
 gpu_error_t gpu_index_transfer_CPU_to_GPUs(gpu_index_buffer_t* const index, gpu_device_info_t** const devices, const gpu_module_t activeModules);
@@ -19,6 +19,7 @@ Global Objects (General)
 
 typedef struct {
   gpu_fmi_buffer_t fmi;
+  gpu_fmi_buffer_t fmiReverse;   // BWT of the reversed text (bidirectional index, host backends)
   gpu_sa_buffer_t  sa;
   gpu_module_t     activeModules;
 } gpu_index_buffer_t;
@@ -0,0 +1,81 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_INIT_H_
+#define GPU_INIT_H_
+
+#include "gpu_commons.h"
+#include "gpu_devices.h"
+#include "gpu_reference.h"
+#include "gpu_index.h"
+#include "gpu_shm.h"
+#include "gpu_sample.h"
+#include <pthread.h>
+
+/* Phase returned when there is nothing left to launch */
+#define GPU_INIT_NO_PHASE        GPU_UINT32_ONES
+#define GPU_INIT_MAX_THREADS     GPU_INIT_NUM_PHASES
+#define GPU_INIT_PHASE_MASK(p)   (GPU_UINT32_ONE_MASK << (p))
+
+typedef struct gpu_init_graph gpu_init_graph_t;
+typedef gpu_error_t (*gpu_init_phase_fn_t)(gpu_init_graph_t* const graph);
+
+typedef struct {
+  bool                 active;
+  bool                 launched;
+  uint32_t             dependencies;  /* Mask of the phases to be completed before the launch */
+  gpu_init_phase_fn_t  run;
+  double               time;
+} gpu_init_task_t;
+
+struct gpu_init_graph {
+  /* Structures to be loaded and transferred */
+  gpu_reference_buffer_t     *reference;
+  const gpu_reference_dto_t  *rawRef;
+  gpu_index_buffer_t         *index;
+  const gpu_index_dto_t      *rawIndex;
+  gpu_device_info_t          **devices;
+  const char                 *sharedIndexName;
+  /* Dependency graph */
+  gpu_init_task_t            tasks[GPU_INIT_NUM_PHASES];
+  uint32_t                   completed;      /* Mask of the finished (or skipped) phases */
+  uint32_t                   numPending;     /* Phases not launched yet */
+  gpu_error_t                error;          /* First failure (stops the launches) */
+  pthread_mutex_t            lock;
+  pthread_cond_t             progress;
+};
+
+/* Functions to build the dependency graph */
+bool        gpu_init_shares_fmi_load(const gpu_index_coding_t indexCoding);
+void        gpu_init_graph_add(gpu_init_graph_t* const graph, const gpu_init_phase_t phase, const bool active,
+                               const uint32_t dependencies, gpu_init_phase_fn_t run);
+void        gpu_init_graph_setup(gpu_init_graph_t* const graph, gpu_reference_buffer_t* const reference, const gpu_reference_dto_t* const rawRef,
+                                 gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, gpu_device_info_t** const devices,
+                                 const bool attachedIndex, const gpu_shared_index_t sharedIndex, const char* const sharedIndexName);
+
+/* Functions to execute the graph */
+uint32_t    gpu_init_graph_next_phase(gpu_init_graph_t* const graph);
+void        gpu_init_graph_complete_phase(gpu_init_graph_t* const graph, const uint32_t idPhase, const gpu_error_t error, const double time);
+void*       gpu_init_graph_worker(void* const initGraph);
+uint32_t    gpu_init_graph_get_num_threads(const gpu_init_graph_t* const graph, const uint32_t numThreads);
+gpu_error_t gpu_init_graph_run(gpu_init_graph_t* const graph, const uint32_t numThreads, double* const timePhases);
+
+/* Phases of the initialization */
+gpu_error_t gpu_init_reference_load(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_fmi_load(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_fmi_table(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_sa_load(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_sa_resample(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_shm_publish(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_reference_transfer(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_fmi_transfer(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_fmi_table_transfer(gpu_init_graph_t* const graph);
+gpu_error_t gpu_init_sa_transfer(gpu_init_graph_t* const graph);
+
+#endif /* GPU_INIT_H_ */
@@ -27,6 +27,7 @@
 /* Include the required objects */
 #include "gpu_reference.h"
 #include "gpu_index.h"
+#include "gpu_fmi_reverse.h"
 
 /* I/O Primitives to read/write in buffered files */
 gpu_error_t gpu_io_read_buffered(int fp, void* const buffer, const size_t bytesRequest);
@@ -57,7 +58,11 @@ gpu_error_t gpu_io_load_reference_specs_GEM_FULL(const char* const fn, gpu_refer
 gpu_error_t gpu_io_load_reference_GEM_FULL(const char* const fn, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
 gpu_error_t gpu_io_save_reference_GEM_FULL(const char* const fn, const gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
 
+/* Construction of the indexed structures stored in the GEM-CUDA containers */
+gpu_error_t gpu_io_build_index_reverse_GEM_FULL(const gpu_gem_ref_dto_t* const gemRef, gpu_index_buffer_t* const index);
+
 /* Local definitions */
+gpu_error_t gpu_io_load_module_info_PROFILE(const int fp, gpu_index_buffer_t* const index, const gpu_module_t activeModules, gpu_module_t* const fileActiveModules);
 gpu_error_t gpu_io_save_module_info_GEM_FULL(const int fp, const gpu_module_t fileActiveModules);
 gpu_error_t gpu_io_load_module_info_GEM_FULL(const int fp, gpu_module_t* const fileActiveModules);
 gpu_error_t gpu_io_save_offsets_info_GEM_FULL(const int fp, const off64_t fileOffsetFMIndex, const off64_t fileOffsetSAIndex, const off64_t fileOffsetRef);
@@ -17,15 +17,8 @@ extern "C" {
 }
 #include "gpu_resources.h"
 
-// Constants
-#define GPU_KMER_FILTER_COUNTING_MASK_3                      0x0000003Fu
-#define GPU_KMER_FILTER_COUNTING_MASK_4                      0x000000FFu
-#define GPU_KMER_FILTER_COUNTING_MASK_5                      0x000003FFu
-#define GPU_KMER_FILTER_COUNTING_MASK_6                      0x00000FFFu
-#define GPU_KMER_FILTER_COUNTING_MASK_7                      0x00003FFFu
-
-#define GPU_KMER_FILTER_COUNTING_LENGTH                      6
-#define GPU_KMER_FILTER_COUNTING_MASK                        GPU_KMER_FILTER_COUNTING_MASK_6
+// Constants (the k-mer length is a runtime parameter, see GPU_KMER_FILTER_MIN/MAX_KMER_LENGTH)
+#define GPU_KMER_FILTER_COUNTING_MASK(kmerLength)            ((GPU_UINT32_MASK_ONE_LOW << ((kmerLength) << 1)) - 1)
 
 #define GPU_KMER_FILTER_BASE_QUERY_LENGTH                    8
 #define GPU_KMER_FILTER_BASE_QUERY_MASK                      (~(GPU_UINT64_ONES << GPU_KMER_FILTER_BASE_QUERY_LENGTH))
@@ -38,8 +31,7 @@ extern "C" {
 #define GPU_ALIGN_DISTANCE_ZERO                              GPU_UINT32_MASK_ONE_HIGH
 #define GPU_ALIGN_DISTANCE_INF                               GPU_UINT32_ONES
 
-#define GPU_KMER_FILTER_COUNTING_NUM_KMERS                   GPU_POW4(GPU_KMER_FILTER_COUNTING_LENGTH)
-#define GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase) kmerIdx = (((kmerIdx << GPU_REFERENCE_CHAR_LENGTH) | (encBase & GPU_REFERENCE_UINT32_MASK_BASE)) & GPU_KMER_FILTER_COUNTING_MASK)
+#define GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase, kmerMask) kmerIdx = (((kmerIdx << GPU_REFERENCE_CHAR_LENGTH) | (encBase & GPU_REFERENCE_UINT32_MASK_BASE)) & (kmerMask))
 
 #endif /* GPU_KMER_CORE_H_ */
 
@@ -18,6 +18,18 @@ Common constants for Device & Host
 
 #define GPU_KMER_FILTER_MIN_ELEMENTS       2048  // MIN elements per buffer (related to the SM -2048th-)
 
+/* Length of the counted k-mers (selectivity vs counter tables of 4^k entries per thread) */
+#define GPU_KMER_FILTER_MIN_KMER_LENGTH       4
+#define GPU_KMER_FILTER_MAX_KMER_LENGTH       7
+#define GPU_KMER_FILTER_DEFAULT_KMER_LENGTH   6
+/* Saturating counters packed in 32-bit words (the narrow ones are used while the longest query fits) */
+#define GPU_KMER_FILTER_COUNTER_LENGTH_SHORT  4
+#define GPU_KMER_FILTER_COUNTER_LENGTH_LONG   8
+#define GPU_KMER_FILTER_COUNTER_SHORT_MAX_QUERY_SIZE 128
+#define GPU_KMER_FILTER_COUNTER_WORDS(kmerLength, counterLength) (GPU_POW4(kmerLength) / (GPU_UINT32_LENGTH / (counterLength)))
+/* Per-thread local budget of each counter table (8KB, the footprint of the former fixed 4096 x uint16 tables) */
+#define GPU_KMER_FILTER_MAX_COUNTER_WORDS     2048
+
 /*****************************
 Internal Objects
 *****************************/
@@ -54,6 +66,8 @@ typedef struct {
   uint32_t                            maxQueries;
   uint32_t                            maxAlignments;
   uint32_t                            maxError;
+  uint32_t                            kmerLength;
+  uint32_t                            counterLength;
   gpu_kmer_filter_queries_buffer_t    queries;
   gpu_kmer_filter_candidates_buffer_t candidates;
   gpu_kmer_filter_alignments_buffer_t alignments;
@@ -65,11 +79,17 @@ typedef struct {
 float       gpu_kmer_filter_size_per_candidate(const uint32_t averageQuerySize, const uint32_t candidatesPerQuery);
 void        gpu_kmer_filter_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
 void        gpu_kmer_filter_reallocate_device_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_kmer_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery);
 /* Functions to send & process a KMER buffer to GPU */
+uint32_t    gpu_kmer_filter_select_counter_length(const gpu_kmer_filter_queries_buffer_t* const qry);
 gpu_error_t gpu_kmer_filter_transfer_CPU_to_GPU(gpu_buffer_t *mBuff);
 gpu_error_t gpu_kmer_filter_transfer_GPU_to_CPU(gpu_buffer_t *mBuff);
 /* DEVICE Kernels */
 gpu_error_t gpu_kmer_filter_process_buffer(gpu_buffer_t *mBuff);
+/* Functions to split oversized submissions */
+uint32_t    gpu_kmer_filter_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_kmer_filter_qry_info_t* const queryInfo,
+                                             const gpu_kmer_filter_cand_info_t* const candidates, const uint32_t numCandidates,
+                                             uint32_t* const idFirstQuery, uint32_t* const idLastQuery);
 
 #endif /* GPU_KMER_PRIMITIVES_H_ */
 
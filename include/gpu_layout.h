@@ -0,0 +1,46 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_LAYOUT_H_
+#define GPU_LAYOUT_H_
+
+#include "gpu_commons.h"
+#include "gpu_stats.h"
+
+/* Tuning period disabling the autotuner (layouts are carved from the caller estimations) */
+#define GPU_LAYOUT_TUNING_DISABLED  0
+
+typedef struct {
+  /* Workload observed since the last re-carving */
+  uint32_t  numSubmissions;
+  uint64_t  numQueries;
+  uint64_t  numBases;
+  uint64_t  numCandidates;
+  /* Layout parameters derived from the observations */
+  bool      tuned;
+  uint32_t  averageQuerySize;
+  uint32_t  candidatesPerQuery;
+} gpu_layout_module_t;
+
+typedef struct {
+  uint32_t             tuningPeriod;  /* Submissions observed between re-carvings */
+  gpu_layout_module_t  module[GPU_STATS_NUM_MODULES];
+} gpu_layout_buffer_t;
+
+/* Functions to initialize the autotuner */
+void gpu_layout_init(gpu_layout_buffer_t* const layout, const uint32_t tuningPeriod);
+void gpu_layout_reset(gpu_layout_buffer_t* const layout);
+
+/* Functions to observe the workload and tune the layouts (candidatesPerQuery may be NULL) */
+void gpu_layout_observe(gpu_layout_buffer_t* const layout, gpu_stats_buffer_t* const stats, const uint32_t numQueries,
+                        const uint64_t numBases, const uint32_t numCandidates);
+bool gpu_layout_tune(const gpu_layout_buffer_t* const layout, const gpu_stats_buffer_t* const stats,
+                     uint32_t* const averageQuerySize, uint32_t* const candidatesPerQuery);
+
+#endif /* GPU_LAYOUT_H_ */
@@ -0,0 +1,127 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_MINIMIZER_PRIMITIVES_SEED_H_
+#define GPU_MINIMIZER_PRIMITIVES_SEED_H_
+
+#include <pthread.h>
+#include "gpu_commons.h"
+#include "gpu_reference_minimizers.h"
+
+/********************************
+Common constants for Device & Host
+*********************************/
+
+#define GPU_MINIMIZER_SEED_MIN_CANDIDATES          1
+#define GPU_MINIMIZER_SEED_DEFAULT_MAX_OCCURRENCES 256   // Repetitive minimizers are not anchored
+#define GPU_MINIMIZER_SEED_DEFAULT_BAND_WIDTH      32    // Diagonal drift (indels) tolerated inside a chain
+#define GPU_MINIMIZER_SEED_DEFAULT_MIN_ANCHORS     2
+#define GPU_MINIMIZER_SEED_MIN_SCRATCH             1024
+#define GPU_MINIMIZER_SEED_QUERIES_PER_TASK        32    // Queries grabbed per worker request
+#define GPU_MINIMIZER_SEED_MAX_THREADS             64
+
+/*****************************
+Internal Objects
+*****************************/
+
+typedef struct {
+  int64_t                          diagonal;       // Text position minus query position of the hit
+  uint32_t                         queryPosition;
+} gpu_minimizer_seed_anchor_t;
+
+typedef struct {
+  int64_t                          minDiagonal;
+  int64_t                          maxDiagonal;
+  uint32_t                         numAnchors;
+  uint64_t                         position;       // Window of the chain (text coordinates)
+  uint32_t                         size;
+} gpu_minimizer_seed_chain_t;
+
+typedef struct {
+  uint32_t                         numBases;
+  gpu_minimizer_seed_qry_entry_t   *h_queries;
+  uint32_t                         numQueries;
+  gpu_minimizer_seed_qry_info_t    *h_queryInfo;
+  gpu_minimizer_seed_result_t      *h_results;
+} gpu_minimizer_seed_queries_buffer_t;
+
+typedef struct {
+  uint32_t                         numCandidates;
+  gpu_minimizer_seed_cand_info_t   *h_candidates;
+} gpu_minimizer_seed_candidates_buffer_t;
+
+typedef struct {
+  /* Index, queries and seeding parameters shared by all the workers */
+  const gpu_reference_minimizers_t*     minimizers;
+  uint64_t                              referenceSize;
+  const gpu_minimizer_seed_qry_entry_t* queries;
+  const gpu_minimizer_seed_qry_info_t*  queryInfo;
+  gpu_minimizer_seed_result_t*          results;
+  gpu_minimizer_seed_cand_info_t*       candidates;
+  uint32_t                              numQueries;
+  uint32_t                              maxCandidatesPerQuery;
+  uint32_t                              maxOccurrences;
+  uint32_t                              bandWidth;
+  uint32_t                              minAnchors;
+  /* Dynamic scheduling of the queries */
+  uint32_t                              nextQuery;
+  gpu_error_t                           error;
+} gpu_minimizer_seed_context_t;
+
+typedef struct {
+  gpu_minimizer_seed_context_t*         context;
+  gpu_minimizer_seed_anchor_t*          h_anchors;     // Scratch space growing with the hits of the queries
+  uint64_t                              maxAnchors;
+  gpu_minimizer_seed_chain_t*           h_chains;
+  uint64_t                              maxChains;
+  pthread_t                             thread;
+} gpu_minimizer_seed_worker_t;
+
+
+/*****************************
+General Object
+*****************************/
+
+typedef struct {
+  uint32_t                                maxBases;
+  uint32_t                                maxQueries;
+  uint32_t                                maxCandidates;
+  uint32_t                                maxCandidatesPerQuery;
+  uint32_t                                maxOccurrences;
+  uint32_t                                bandWidth;
+  uint32_t                                minAnchors;
+  uint32_t                                numThreads;
+  gpu_minimizer_seed_queries_buffer_t     queries;
+  gpu_minimizer_seed_candidates_buffer_t  candidates;
+} gpu_minimizer_seed_buffer_t;
+
+#include "gpu_buffer.h"
+
+/* Functions to initialize all the MINIMIZER resources */
+size_t      gpu_minimizer_seed_size_per_query(const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery);
+void        gpu_minimizer_seed_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_minimizer_seed_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery);
+/* HOST Kernels (multithreaded sketch, anchoring and chaining) */
+gpu_error_t gpu_minimizer_seed_process_buffer(gpu_buffer_t* const mBuff);
+uint32_t    gpu_minimizer_seed_get_num_threads(const uint32_t numThreads, const uint32_t numQueries);
+gpu_error_t gpu_minimizer_seed_reserve(void** const scratch, uint64_t* const maxElements, const uint64_t numElements, const size_t sizeElement);
+int         gpu_minimizer_seed_cmp_anchors(const void* const a, const void* const b);
+int         gpu_minimizer_seed_cmp_chains_score(const void* const a, const void* const b);
+int         gpu_minimizer_seed_cmp_chains_position(const void* const a, const void* const b);
+gpu_error_t gpu_minimizer_seed_anchor_query(gpu_minimizer_seed_worker_t* const worker, const gpu_minimizer_seed_qry_info_t* const queryInfo,
+                                            uint64_t* const numAnchors);
+gpu_error_t gpu_minimizer_seed_chain_anchors(gpu_minimizer_seed_worker_t* const worker, const uint64_t numAnchors, const uint32_t querySize,
+                                             uint64_t* const numChains);
+gpu_error_t gpu_minimizer_seed_process_query(gpu_minimizer_seed_worker_t* const worker, const uint32_t idQuery);
+void*       gpu_minimizer_seed_worker(void* const threadWorker);
+/* Functions to split oversized submissions */
+uint32_t    gpu_minimizer_seed_batch_queries(const gpu_buffer_t* const mBuff, const gpu_minimizer_seed_qry_info_t* const queryInfo,
+                                             const gpu_minimizer_seed_result_t* const results, const uint32_t numQueries);
+
+#endif /* GPU_MINIMIZER_PRIMITIVES_SEED_H_ */
@@ -0,0 +1,61 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_NUMA_H_
+#define GPU_NUMA_H_
+
+#include "gpu_commons.h"
+
+/* Placement without NUMA information (single node systems or unknown devices) */
+#define GPU_NUMA_NODE_ANY         -1
+#define GPU_NUMA_MAX_NODES        64
+#define GPU_NUMA_MAX_CPUS         4096
+/* Linux memory policies (used when libnuma is not available) */
+#define GPU_NUMA_MPOL_DEFAULT     0
+#define GPU_NUMA_MPOL_PREFERRED   1
+#define GPU_NUMA_MPOL_BIND        2
+/* System topology descriptions (sysfs) */
+#define GPU_NUMA_SYSFS_NODES      "/sys/devices/system/node"
+#define GPU_NUMA_SYSFS_PCI        "/sys/bus/pci/devices"
+#define GPU_NUMA_SYSFS_PATH_SIZE  256
+
+typedef struct {
+  bool      initialized;
+  uint32_t  numNodes;
+  uint32_t  numCPUs;
+  int32_t   nodeCPU[GPU_NUMA_MAX_CPUS];
+} gpu_numa_topology_t;
+
+typedef struct {
+  /* One copy per NUMA node of a read-mostly host structure (NULL when not replicated) */
+  uint32_t  numNodes;
+  size_t    size;
+  void      *h_replicas[GPU_NUMA_MAX_NODES];
+} gpu_numa_replicas_t;
+
+/* Functions to get the system topology */
+uint32_t    gpu_numa_get_num_nodes();
+int32_t     gpu_numa_get_cpu_node(const uint32_t idCPU);
+int32_t     gpu_numa_get_device_node(const uint32_t idDevice);
+int32_t     gpu_numa_get_thread_node();
+
+/* Functions to place the threads and the memory */
+gpu_error_t gpu_numa_bind_thread(const int32_t idNode);
+gpu_error_t gpu_numa_set_preferred(const int32_t idNode);
+gpu_error_t gpu_numa_set_default();
+void*       gpu_numa_alloc_onnode(const size_t size, const int32_t idNode);
+void        gpu_numa_free(void* const memory, const size_t size);
+
+/* Functions to manage the per-node replicas */
+void        gpu_numa_replicas_init_dto(gpu_numa_replicas_t* const replicas);
+gpu_error_t gpu_numa_replicas_build(gpu_numa_replicas_t* const replicas, const void* const h_data, const size_t size);
+const void* gpu_numa_replicas_get_local(const gpu_numa_replicas_t* const replicas, const void* const h_data);
+gpu_error_t gpu_numa_replicas_free(gpu_numa_replicas_t* const replicas);
+
+#endif /* GPU_NUMA_H_ */
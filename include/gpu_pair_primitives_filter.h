@@ -0,0 +1,116 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_PAIR_PRIMITIVES_FILTER_H_
+#define GPU_PAIR_PRIMITIVES_FILTER_H_
+
+#include <pthread.h>
+#include "gpu_commons.h"
+
+/********************************
+Common constants for Device & Host
+*********************************/
+
+#define GPU_PAIR_FILTER_MIN_PAIRS          1
+#define GPU_PAIR_FILTER_QUERIES_PER_TASK   64    // Read pairs grabbed per worker request (repetitive pairs are balanced dynamically)
+#define GPU_PAIR_FILTER_MAX_THREADS        64
+
+/*****************************
+Internal Objects
+*****************************/
+
+typedef struct {
+  uint64_t                       position;
+  uint32_t                       strand;
+  uint32_t                       idMate;         // Entry relative to the mate list of the read pair
+} gpu_pair_filter_sort_entry_t;
+
+typedef struct {
+  uint32_t                       numMates;
+  gpu_pair_filter_mate_entry_t   *h_mates;
+} gpu_pair_filter_mates_buffer_t;
+
+typedef struct {
+  uint32_t                       numQueries;
+  gpu_pair_filter_qry_info_t     *h_queryInfo;
+  gpu_pair_filter_result_t       *h_results;
+} gpu_pair_filter_queries_buffer_t;
+
+typedef struct {
+  uint32_t                       numPairs;
+  gpu_pair_filter_pair_entry_t   *h_pairs;
+} gpu_pair_filter_pairs_buffer_t;
+
+typedef struct {
+  /* Read pairs and pairing constraints shared by all the workers */
+  const gpu_pair_filter_mate_entry_t*  mates;
+  const gpu_pair_filter_qry_info_t*    queryInfo;
+  gpu_pair_filter_result_t*            results;
+  gpu_pair_filter_pair_entry_t*        pairs;
+  uint32_t                             numQueries;
+  uint32_t                             maxPairsPerQuery;
+  uint32_t                             minInsertSize;
+  uint32_t                             maxInsertSize;
+  gpu_pair_filter_orientation_t        orientation;
+  /* Dynamic scheduling of the read pairs */
+  uint32_t                             nextQuery;
+  uint32_t                             maxListSize;
+} gpu_pair_filter_context_t;
+
+typedef struct {
+  gpu_pair_filter_context_t*           context;
+  gpu_pair_filter_sort_entry_t*        h_sortMate1;    // Scratch sorted lists (maxListSize entries each)
+  gpu_pair_filter_sort_entry_t*        h_sortMate2;
+  pthread_t                            thread;
+} gpu_pair_filter_worker_t;
+
+
+/*****************************
+General Object
+*****************************/
+
+typedef struct {
+  uint32_t                          maxMates;
+  uint32_t                          maxQueries;
+  uint32_t                          maxPairs;
+  uint32_t                          maxPairsPerQuery;
+  uint32_t                          minInsertSize;
+  uint32_t                          maxInsertSize;
+  gpu_pair_filter_orientation_t     orientation;
+  uint32_t                          numThreads;
+  gpu_pair_filter_mates_buffer_t    mates;
+  gpu_pair_filter_queries_buffer_t  queries;
+  gpu_pair_filter_pairs_buffer_t    pairs;
+} gpu_pair_filter_buffer_t;
+
+#include "gpu_buffer.h"
+
+/* Functions to initialize all the PAIR resources */
+size_t      gpu_pair_filter_size_per_query(const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery);
+void        gpu_pair_filter_reallocate_host_buffer_layout(gpu_buffer_t* mBuff);
+void        gpu_pair_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery);
+/* HOST Kernels (multithreaded sort-merge join) */
+gpu_error_t gpu_pair_filter_process_buffer(gpu_buffer_t* const mBuff);
+uint32_t    gpu_pair_filter_get_num_threads(const uint32_t numThreads, const uint32_t numQueries);
+int         gpu_pair_filter_cmp_positions(const void* const a, const void* const b);
+void        gpu_pair_filter_sort_mates(const gpu_pair_filter_mate_entry_t* const mates, const uint32_t numMates,
+                                       gpu_pair_filter_sort_entry_t* const sortedMates);
+bool        gpu_pair_filter_is_concordant(const gpu_pair_filter_context_t* const context, const gpu_pair_filter_sort_entry_t* const mate1,
+                                          const gpu_pair_filter_sort_entry_t* const mate2, const uint32_t sizeMate1, const uint32_t sizeMate2,
+                                          uint32_t* const insertSize);
+void        gpu_pair_filter_process_query(const gpu_pair_filter_worker_t* const worker, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                          gpu_pair_filter_result_t* const result);
+void*       gpu_pair_filter_worker(void* const threadWorker);
+/* Functions to split oversized submissions */
+uint32_t    gpu_pair_filter_batch_queries(const gpu_buffer_t* const mBuff, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                          const gpu_pair_filter_result_t* const results, const uint32_t numQueries);
+uint32_t    gpu_pair_filter_query_init_mate(const gpu_pair_filter_qry_info_t* const queryInfo);
+uint32_t    gpu_pair_filter_query_end_mate(const gpu_pair_filter_qry_info_t* const queryInfo);
+
+#endif /* GPU_PAIR_PRIMITIVES_FILTER_H_ */
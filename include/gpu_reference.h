@@ -12,6 +12,9 @@
 
 #include "gpu_commons.h"
 #include "gpu_devices.h"
+#include "gpu_hugepages.h"
+#include "gpu_reference_nruns.h"
+#include "gpu_reference_minimizers.h"
 
 /* Defines of global reference representation */
 #define GPU_REFERENCE_PLAIN__CHAR_LENGTH       2
@@ -37,6 +40,10 @@
 #define GPU_REFERENCE_UINT32_MASK_BASE (GPU_UINT32_ONES >> (GPU_UINT32_LENGTH - GPU_REFERENCE_CHAR_LENGTH))
 #define GPU_REFERENCE_END_PADDING      625
 
+/* Coding flags stored with the size in the specs (files without flags store both strands) */
+#define GPU_REFERENCE_SPECS_STRAND_VIRTUAL GPU_UINT64_MASK_ONE_HIGH
+#define GPU_REFERENCE_SPECS_FLAGS          GPU_REFERENCE_SPECS_STRAND_VIRTUAL
+
 /*****************************
 Internal Objects (General)
 *****************************/
@@ -44,6 +51,7 @@ Internal Objects (General)
 typedef struct {
   /* Data types for a Global Reference */
   uint64_t        size;
+  uint64_t        forwardSize;  /* Only the forward strand is stored (0 when both strands are stored) */
   /* Data types for a Plain Reference */
   uint64_t        numEntriesPlain;
   uint64_t        *h_reference_plain;
@@ -52,6 +60,12 @@ typedef struct {
   uint64_t        numEntriesMasked;
   uint64_t		  *h_reference_masked;
   uint64_t        **d_reference_masked;
+  /* Data types for the N-run intervals (replace the masked reference when active) */
+  bool            activeNRuns;
+  gpu_reference_nruns_t nRuns;
+  /* Data types for the minimizer index (host only, sampled from the plain reference) */
+  bool            activeMinimizers;
+  gpu_reference_minimizers_t minimizers;
   /* Memory allocation configuration */
   memory_stats_t  hostAllocStats;
   memory_alloc_t  *memorySpace;
@@ -61,6 +75,14 @@ typedef struct {
 
 /* Get information functions */
 size_t		gpu_reference_get_size(gpu_reference_buffer_t* const reference, size_t* const referenceSize, const gpu_module_t activeModules);
+uint64_t    gpu_reference_get_stored_size(const gpu_reference_buffer_t* const reference);
+
+/* Host access functions (strand-virtual references are served in the complete coordinate space) */
+uint64_t    gpu_reference_get_entry_plain(const gpu_reference_buffer_t* const reference, const uint64_t idEntry);
+uint64_t    gpu_reference_get_entry_masked(const gpu_reference_buffer_t* const reference, const uint64_t idEntry);
+bool        gpu_reference_is_N(const gpu_reference_buffer_t* const reference, const uint64_t position, gpu_reference_nruns_cursor_t* const cursor);
+bool        gpu_reference_window_has_N(const gpu_reference_buffer_t* const reference, const uint64_t position, const uint64_t length,
+                                       gpu_reference_nruns_cursor_t* const cursor);
 
 /* String basic functions */
 uint64_t    gpu_char_to_bin_ASCII(const unsigned char base);
@@ -81,6 +103,8 @@ gpu_error_t gpu_reference_set_specs(gpu_reference_buffer_t* const ref, const cha
 gpu_error_t gpu_reference_init(gpu_reference_buffer_t **reference, const gpu_reference_dto_t* const referenceRaw, const uint32_t numSupportedDevices, const gpu_module_t activeModules);
 gpu_error_t gpu_reference_load(gpu_reference_buffer_t *reference, const gpu_reference_dto_t* const referenceRaw,const gpu_module_t activeModules);
 gpu_error_t gpu_reference_allocate(gpu_reference_buffer_t *reference, const gpu_module_t activeModules);
+gpu_error_t gpu_reference_replace_masked(gpu_reference_buffer_t* const reference);
+gpu_error_t gpu_reference_build_minimizers(gpu_reference_buffer_t* const reference);
 
 /* Data transfer functions */
 gpu_error_t gpu_reference_transfer_CPU_to_GPUs(gpu_reference_buffer_t* const reference, gpu_device_info_t** const devices,const gpu_module_t activeModules);
@@ -96,5 +120,6 @@ gpu_error_t gpu_reference_free(gpu_reference_buffer_t **reference, gpu_device_in
 gpu_error_t gpu_reference_transform_ASCII(const char* const referenceASCII, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
 gpu_error_t gpu_reference_transform_GEM(const gpu_gem_ref_dto_t* const gem_reference, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
 gpu_error_t gpu_reference_transform_GEM_FULL(const gpu_gem_ref_dto_t* const gem_reference, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
+gpu_error_t gpu_reference_transform_GEM_VIRTUAL(const gpu_gem_ref_dto_t* const gem_reference, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules);
 
 #endif /* GPU_REFERENCE_H_ */
@@ -0,0 +1,61 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_CORE_H_
+#define GPU_REFERENCE_CORE_H_
+
+extern "C" {
+#include "gpu_commons.h"
+#include "gpu_reference.h"
+}
+#include "gpu_text_core.h"
+
+GPU_INLINE __device__ uint8_t gpu_reference_nruns_lookup(const gpu_reference_nruns_view_t nRuns, const uint64_t position, ulong2* const cursor)
+{
+  //Cached interval around the last request (GPU_TEXT_INIT is an empty interval)
+  const uint64_t intervalStart = cursor->y & GPU_REFERENCE_NRUNS_CURSOR_START_MASK;
+  const uint64_t intervalEnd   = cursor->x;
+  if((position >= intervalStart) && (position < intervalEnd))
+    return((cursor->y & GPU_REFERENCE_NRUNS_CURSOR_N) != 0);
+  //Binary search of the first run ending after the position (bounded by the bucket)
+  const uint64_t idBucket = GPU_MIN(position >> GPU_REFERENCE_NRUNS_BUCKET_BITS, nRuns.numBuckets - 1);
+  uint64_t lo = nRuns.buckets[idBucket], hi = nRuns.buckets[idBucket + 1];
+  while(lo < hi){
+    const uint64_t idRun = lo + ((hi - lo) / 2);
+    if((nRuns.runs[idRun].start + nRuns.runs[idRun].length) <= position) lo = idRun + 1;
+    else hi = idRun;
+  }
+  //Caching the run or the gap containing the position
+  const bool isN = (lo < nRuns.numRuns) && (nRuns.runs[lo].start <= position);
+  if(isN){
+    cursor->x = nRuns.runs[lo].start + nRuns.runs[lo].length;
+    cursor->y = nRuns.runs[lo].start | GPU_REFERENCE_NRUNS_CURSOR_N;
+  }else{
+    cursor->x = (lo < nRuns.numRuns) ? nRuns.runs[lo].start : GPU_UINT64_ONES;
+    cursor->y = (lo > 0) ? nRuns.runs[lo - 1].start + nRuns.runs[lo - 1].length : 0;
+  }
+  return(isN);
+}
+
+GPU_INLINE __device__ uint8_t gpu_reference_lookup_masked(const uint64_t* const referenceMasked, const gpu_reference_nruns_view_t nRuns,
+                                                          const uint64_t position, const uint64_t forwardSize, ulong2* const globalInfo)
+{
+  uint64_t storedPosition = position;
+  //Masked bitmap representation
+  if(nRuns.runs == NULL)
+    return(gpu_text_lookup_strand(referenceMasked, position, forwardSize, globalInfo, GPU_REFERENCE_MASKED__CHAR_LENGTH, 0));
+  //N-run intervals (reverse positions of strand-virtual references are mirrored)
+  if((forwardSize != 0) && (position >= forwardSize)){
+    if((position + 2) > (2 * forwardSize)) return(0);
+    storedPosition = (2 * forwardSize) - position - 2;
+  }
+  return(gpu_reference_nruns_lookup(nRuns, storedPosition, globalInfo));
+}
+
+#endif /* GPU_REFERENCE_CORE_H_ */
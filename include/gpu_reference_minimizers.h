@@ -0,0 +1,92 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_MINIMIZERS_H_
+#define GPU_REFERENCE_MINIMIZERS_H_
+
+#include "gpu_commons.h"
+#include "gpu_devices.h"
+
+/* (w,k) setup: k bases per k-mer (2 bits per base), w consecutive k-mers per window */
+#define GPU_REFERENCE_MINIMIZERS_MIN_K            8
+#define GPU_REFERENCE_MINIMIZERS_MAX_K            28
+#define GPU_REFERENCE_MINIMIZERS_DEFAULT_K        15
+#define GPU_REFERENCE_MINIMIZERS_MIN_W            1
+#define GPU_REFERENCE_MINIMIZERS_MAX_W            255
+#define GPU_REFERENCE_MINIMIZERS_DEFAULT_W        10
+/* Search accelerator: one bucket per prefix of the hash (highest bits) */
+#define GPU_REFERENCE_MINIMIZERS_BUCKET_BITS      20
+#define GPU_REFERENCE_MINIMIZERS_MIN_ENTRIES      1024
+#define GPU_REFERENCE_MINIMIZERS_RADIX_BITS       8
+#define GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS    (1 << GPU_REFERENCE_MINIMIZERS_RADIX_BITS)
+
+typedef struct {
+  uint64_t hash;
+  uint64_t position;     /* First text position of the k-mer */
+} gpu_reference_minimizer_t;
+
+typedef struct {
+  /* Rolling k-mer and ring of the last w k-mers */
+  uint32_t                   w;
+  uint32_t                   k;
+  uint64_t                   kmerMask;
+  uint64_t                   kmer;
+  uint32_t                   numBases;   /* Consecutive bases since the last non-base */
+  uint32_t                   numKmers;   /* K-mers in the ring (up to w) */
+  uint32_t                   idRing;
+  gpu_reference_minimizer_t  ring[GPU_REFERENCE_MINIMIZERS_MAX_W];
+  gpu_reference_minimizer_t  minimum;    /* Minimizer of the current window (leftmost on ties) */
+} gpu_reference_minimizers_sketch_t;
+
+typedef struct {
+  /* Sampled k-mers of the text sorted by (hash, position) */
+  uint32_t                   w;
+  uint32_t                   k;
+  uint64_t                   size;
+  uint64_t                   numEntries;
+  gpu_reference_minimizer_t  *h_entries;
+  /* First entry of each hash prefix (numBuckets + 1 entries) */
+  uint32_t                   bucketBits;
+  uint64_t                   numBuckets;
+  uint64_t                   *h_buckets;
+} gpu_reference_minimizers_t;
+
+/* Get information functions */
+gpu_error_t gpu_reference_minimizers_get_size(const gpu_reference_minimizers_t* const minimizers, size_t* const bytesPerMinimizers);
+
+/* Sketch functions (shared by the reference and the queries) */
+uint64_t    gpu_reference_minimizers_hash(const uint64_t kmer, const uint64_t kmerMask);
+uint32_t    gpu_reference_minimizers_base_ASCII(const char base);
+void        gpu_reference_minimizers_sketch_init(gpu_reference_minimizers_sketch_t* const sketch, const uint32_t w, const uint32_t k);
+void        gpu_reference_minimizers_sketch_rescan(gpu_reference_minimizers_sketch_t* const sketch);
+bool        gpu_reference_minimizers_sketch_push(gpu_reference_minimizers_sketch_t* const sketch, const uint32_t base, const uint64_t position,
+                                                 gpu_reference_minimizer_t* const minimizer);
+
+/* Query functions (returns the number of occurrences of the hash) */
+uint64_t    gpu_reference_minimizers_search(const gpu_reference_minimizers_t* const minimizers, const uint64_t hash, uint64_t* const idFirstEntry);
+
+/* Build functions */
+gpu_error_t gpu_reference_minimizers_add(gpu_reference_minimizers_t* const minimizers, uint64_t* const maxEntries,
+                                         const gpu_reference_minimizer_t* const minimizer);
+int         gpu_reference_minimizers_cmp_entries(const void* const a, const void* const b);
+bool        gpu_reference_minimizers_sorted_positions(const gpu_reference_minimizers_t* const minimizers);
+gpu_error_t gpu_reference_minimizers_radix_sort(gpu_reference_minimizers_t* const minimizers);
+gpu_error_t gpu_reference_minimizers_sort(gpu_reference_minimizers_t* const minimizers);
+gpu_error_t gpu_reference_minimizers_build_buckets(gpu_reference_minimizers_t* const minimizers);
+
+/* Stream functions (the table is appended after the N-run intervals) */
+gpu_error_t gpu_reference_minimizers_read(int fp, gpu_reference_minimizers_t* const minimizers, const uint64_t size);
+gpu_error_t gpu_reference_minimizers_write(int fp, const gpu_reference_minimizers_t* const minimizers);
+
+/* Initialize and free functions (host only structure) */
+gpu_error_t gpu_reference_minimizers_init_dto(gpu_reference_minimizers_t* const minimizers);
+gpu_error_t gpu_reference_minimizers_init(gpu_reference_minimizers_t* const minimizers, const uint32_t w, const uint32_t k);
+gpu_error_t gpu_reference_minimizers_free_host(gpu_reference_minimizers_t* const minimizers);
+
+#endif /* GPU_REFERENCE_MINIMIZERS_H_ */
@@ -0,0 +1,87 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_NRUNS_H_
+#define GPU_REFERENCE_NRUNS_H_
+
+#include "gpu_commons.h"
+#include "gpu_devices.h"
+
+/* Search accelerator: one bucket per 1M text positions */
+#define GPU_REFERENCE_NRUNS_BUCKET_BITS       20
+#define GPU_REFERENCE_NRUNS_MIN_RUNS          1024
+#define GPU_REFERENCE_NRUNS_WRITE_ENTRIES     (1 << 16)
+/* Device cursors (ulong2): x = interval end, y = interval start | N state (MSB) */
+#define GPU_REFERENCE_NRUNS_CURSOR_N          GPU_UINT64_MASK_ONE_HIGH
+#define GPU_REFERENCE_NRUNS_CURSOR_START_MASK (~GPU_UINT64_MASK_ONE_HIGH)
+
+typedef struct {
+  uint64_t start;
+  uint64_t length;
+} gpu_reference_nrun_t;
+
+typedef struct {
+  /* Interval [start, end) around the last request sharing its N state */
+  uint64_t start;
+  uint64_t end;
+  bool     isN;
+} gpu_reference_nruns_cursor_t;
+
+typedef struct {
+  /* Kernel argument (runs == NULL when the masked bitmap is used) */
+  const gpu_reference_nrun_t *runs;
+  const uint64_t             *buckets;
+  uint64_t                   numRuns;
+  uint64_t                   numBuckets;
+} gpu_reference_nruns_view_t;
+
+typedef struct {
+  /* Sorted non-overlapping runs of non-bases (N) covering the stored text */
+  uint64_t              size;
+  uint64_t              numRuns;
+  gpu_reference_nrun_t  *h_runs;
+  gpu_reference_nrun_t  **d_runs;
+  /* First run ending after the start of each bucket (numBuckets + 1 entries) */
+  uint64_t              numBuckets;
+  uint64_t              *h_buckets;
+  uint64_t              **d_buckets;
+  /* Memory allocation configuration (shared with the reference) */
+  memory_alloc_t        *memorySpace;
+} gpu_reference_nruns_t;
+
+/* Get information functions */
+gpu_error_t gpu_reference_nruns_get_size(const gpu_reference_nruns_t* const nRuns, size_t* const bytesPerNRuns);
+gpu_reference_nruns_view_t gpu_reference_nruns_get_view(const gpu_reference_nruns_t* const nRuns, const uint32_t idSupportedDevice);
+
+/* Query functions (amortized O(1) for sequential scans using the cursor) */
+void        gpu_reference_nruns_init_cursor(gpu_reference_nruns_cursor_t* const cursor);
+uint64_t    gpu_reference_nruns_search(const gpu_reference_nruns_t* const nRuns, const uint64_t position);
+bool        gpu_reference_nruns_is_N(const gpu_reference_nruns_t* const nRuns, const uint64_t position, gpu_reference_nruns_cursor_t* const cursor);
+bool        gpu_reference_nruns_window_has_N(const gpu_reference_nruns_t* const nRuns, const uint64_t position, const uint64_t length,
+                                             gpu_reference_nruns_cursor_t* const cursor);
+uint64_t    gpu_reference_nruns_get_window(const gpu_reference_nruns_t* const nRuns, const uint64_t firstChar);
+
+/* Build functions */
+gpu_error_t gpu_reference_nruns_build(gpu_reference_nruns_t* const nRuns, const uint64_t* const h_masked, const uint64_t size);
+gpu_error_t gpu_reference_nruns_build_buckets(gpu_reference_nruns_t* const nRuns);
+
+/* Stream functions (the table is appended after the masked reference) */
+gpu_error_t gpu_reference_nruns_read(int fp, gpu_reference_nruns_t* const nRuns, const uint64_t size);
+gpu_error_t gpu_reference_nruns_skip(int fp);
+gpu_error_t gpu_reference_nruns_write(int fp, const gpu_reference_nruns_t* const nRuns);
+gpu_error_t gpu_reference_nruns_write_masked(int fp, const gpu_reference_nruns_t* const nRuns, const uint64_t numEntriesMasked);
+
+/* Initialize, transfer and free functions */
+gpu_error_t gpu_reference_nruns_init_dto(gpu_reference_nruns_t* const nRuns);
+gpu_error_t gpu_reference_nruns_init(gpu_reference_nruns_t* const nRuns, memory_alloc_t* const memorySpace, const uint32_t numSupportedDevices);
+gpu_error_t gpu_reference_nruns_transfer_CPU_to_GPUs(gpu_reference_nruns_t* const nRuns, gpu_device_info_t** const devices);
+gpu_error_t gpu_reference_nruns_free_host(gpu_reference_nruns_t* const nRuns);
+gpu_error_t gpu_reference_nruns_free_device(gpu_reference_nruns_t* const nRuns, gpu_device_info_t** const devices);
+
+#endif /* GPU_REFERENCE_NRUNS_H_ */
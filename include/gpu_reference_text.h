@@ -0,0 +1,80 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_TEXT_H_
+#define GPU_REFERENCE_TEXT_H_
+
+#include <pthread.h>
+#include "gpu_commons.h"
+#include "gpu_buffer.h"
+
+/* Bases unpacked per step (one plain reference entry) */
+#define GPU_REFERENCE_TEXT_CHARS_PER_STEP      GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY
+#define GPU_REFERENCE_TEXT_CHARS_PER_LANE      8     // Bases spread to a 64-bit word of bytes
+#define GPU_REFERENCE_TEXT_LANE_BYTES          0x0101010101010101ULL
+#define GPU_REFERENCE_TEXT_REQUESTS_PER_TASK   64
+#define GPU_REFERENCE_TEXT_MAX_THREADS         64
+
+typedef struct {
+  /* Sequential reader of the plain and masked entries (strand-virtual references are served mirrored) */
+  const gpu_reference_buffer_t *reference;
+  uint64_t                     idEntryPlain;
+  uint64_t                     plain[2];
+  uint64_t                     idEntryMasked;
+  uint64_t                     masked[2];
+} gpu_reference_text_stream_t;
+
+typedef struct {
+  const gpu_reference_buffer_t       *reference;
+  const gpu_reference_text_request_t *requests;
+  uint32_t                           numRequests;
+  gpu_reference_text_format_t        format;
+  uint8_t                            *text;
+  /* Dynamic scheduling of the requests */
+  uint32_t                           nextRequest;
+} gpu_reference_text_context_t;
+
+typedef struct {
+  gpu_reference_text_context_t *context;
+  uint8_t                      *h_codes;   // Scratch with the 8-bit codes of a 2-bit request
+  uint64_t                     maxCodes;
+  gpu_error_t                  error;
+  pthread_t                    thread;
+} gpu_reference_text_worker_t;
+
+/* Word-level primitives (8 bases per 64-bit lane, one byte per base) */
+uint64_t    gpu_reference_text_spread_bases(const uint32_t packedBases);
+uint64_t    gpu_reference_text_spread_masked(const uint32_t maskedBases);
+uint32_t    gpu_reference_text_pack_bases(const uint64_t codes);
+uint64_t    gpu_reference_text_reverse_complement(const uint64_t codes);
+
+/* Sequential access to the packed reference */
+uint64_t    gpu_reference_text_fetch_plain(const gpu_reference_buffer_t* const reference, const uint64_t idEntry);
+uint64_t    gpu_reference_text_fetch_masked(const gpu_reference_buffer_t* const reference, const uint64_t idEntry);
+void        gpu_reference_text_init_stream(gpu_reference_text_stream_t* const stream, const gpu_reference_buffer_t* const reference);
+uint64_t    gpu_reference_text_get_plain(gpu_reference_text_stream_t* const stream, const uint64_t firstChar);
+uint32_t    gpu_reference_text_get_masked(gpu_reference_text_stream_t* const stream, const uint64_t firstChar);
+
+/* Extraction of a single window */
+uint64_t    gpu_reference_text_get_bytes(const uint32_t size, const gpu_reference_text_format_t format);
+void        gpu_reference_text_extract_codes(const gpu_reference_buffer_t* const reference, const uint64_t position, const uint32_t size,
+                                             uint8_t* const codes);
+void        gpu_reference_text_reverse_codes(uint8_t* const codes, const uint32_t size);
+void        gpu_reference_text_codes_to_ASCII(uint8_t* const codes, const uint32_t size);
+void        gpu_reference_text_codes_to_2bits(const uint8_t* const codes, const uint32_t size, uint8_t* const text);
+gpu_error_t gpu_reference_text_extract(gpu_reference_text_worker_t* const worker, const gpu_reference_text_request_t* const request);
+
+/* Multithreaded extraction */
+void*       gpu_reference_text_worker(void* const threadWorker);
+uint32_t    gpu_reference_text_get_num_threads(const uint32_t numThreads, const uint32_t numRequests);
+gpu_error_t gpu_reference_text_extract_batch(const gpu_reference_buffer_t* const reference, gpu_reference_text_request_t* const requests,
+                                             const uint32_t numRequests, const gpu_reference_text_format_t format, const uint32_t numThreads,
+                                             uint8_t* const text);
+
+#endif /* GPU_REFERENCE_TEXT_H_ */
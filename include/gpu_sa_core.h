@@ -17,7 +17,21 @@ extern "C" {
 #ifndef GPU_SA_CODE_H_
 #define GPU_SA_CODE_H_
 
-
+GPU_INLINE __device__ uint64_t gpu_sa_gather_sample(const uint64_t* const d_SA, const uint32_t bitsPerSample, const uint64_t idSample)
+{
+  // Plain samples
+  if(bitsPerSample >= GPU_SA_PACKED_WORD_LENGTH) return(d_SA[idSample]);
+  // Bit-packed samples (LSB first, a sample can span 2 words)
+  const uint64_t mask        = (1ULL << bitsPerSample) - 1;
+  const uint64_t bitPosition = idSample * bitsPerSample;
+  const uint64_t idWord      = bitPosition / GPU_SA_PACKED_WORD_LENGTH;
+  const uint32_t offset      = bitPosition % GPU_SA_PACKED_WORD_LENGTH;
+        uint64_t sample      = LDG(d_SA + idWord) >> offset;
+  if((offset + bitsPerSample) > GPU_SA_PACKED_WORD_LENGTH)
+    sample |= LDG(d_SA + idWord + 1) << (GPU_SA_PACKED_WORD_LENGTH - offset);
+  sample &= mask;
+  return((sample == mask) ? GPU_UINT64_MAX_VALUE : sample);
+}
 
 
 #endif /* GPU_SA_CODE_H_ */
@@ -12,6 +12,14 @@
 
 #include "gpu_commons.h"
 #include "gpu_devices.h"
+#include "gpu_hugepages.h"
+#include "gpu_fmi_index.h"
+
+/* Bit-packed samples (the all-ones code is reserved for the invalid samples) */
+#define GPU_SA_PACKED_WORD_LENGTH     GPU_UINT64_LENGTH
+#define GPU_SA_PACKED_PADDING_WORDS   1                        // Samples are gathered with 2 words reads
+#define GPU_SA_SPECS_BITS_OFFSET      56                       // Bits per sample stored in the top byte of the rate specs
+#define GPU_SA_SPECS_RATE_MASK        (((uint64_t) GPU_UINT64_MASK_ONE_LOW << GPU_SA_SPECS_BITS_OFFSET) - 1)
 
 typedef struct {
   uint64_t        sampligRate;
@@ -20,11 +28,36 @@ typedef struct {
   gpu_sa_entry_t  **d_sa;
   memory_stats_t  hostAllocStats;
   memory_alloc_t  *memorySpace;
+  /* Resampling at load time against a memory budget */
+  uint64_t        resamplingRate;
+  uint64_t        resamplingEntries;
+  float           maxMbSA;
+  uint32_t        minSamplingRate;
+  /* Bit-packed representation (GPU_SA_PACKED_WORD_LENGTH bits means plain samples) */
+  uint32_t        bitsPerSample;
+  uint32_t        packingBits;
+  bool            activePacking;
 } gpu_sa_buffer_t;
 
 
 /* Get information functions */
 gpu_error_t gpu_sa_index_get_size(const gpu_sa_buffer_t* const sa, size_t* const bytesPerSA);
+size_t      gpu_sa_index_get_storage_size(const gpu_sa_buffer_t* const sa);
+uint64_t    gpu_sa_index_get_num_entries(const uint64_t saLength, const uint64_t samplingRate);
+
+/* Functions to resample the SA (trade memory for decode latency) */
+gpu_error_t gpu_sa_index_select_sampling_rate(gpu_sa_buffer_t* const sa, const uint64_t saLength, const bool densifyAllowed);
+gpu_error_t gpu_sa_index_resample(gpu_sa_buffer_t* const sa, const gpu_fmi_buffer_t* const fmi);
+
+/* Functions to bit-pack the SA */
+uint32_t    gpu_sa_index_get_bits_per_sample(const uint64_t saLength);
+uint64_t    gpu_sa_index_get_num_words(const uint64_t numEntries, const uint32_t bitsPerSample);
+gpu_error_t gpu_sa_index_select_packing(gpu_sa_buffer_t* const sa, const uint64_t saLength);
+gpu_error_t gpu_sa_index_pack(gpu_sa_buffer_t* const sa);
+gpu_error_t gpu_sa_index_unpack(gpu_sa_buffer_t* const sa);
+gpu_sa_entry_t gpu_sa_index_get_sample(const gpu_sa_buffer_t* const sa, const uint64_t idSample);
+void        gpu_sa_index_unpack_samples(const gpu_sa_buffer_t* const sa, const uint64_t idSample, const uint64_t numSamples,
+                                        gpu_sa_entry_t* const samples);
 
 /* Functions to initialize the index data on the DEVICE */
 gpu_error_t gpu_sa_index_init_dto(gpu_sa_buffer_t* const sa);
@@ -30,6 +30,9 @@ typedef struct {
 
 
 gpu_sa_entry_t* gpu_sa_buffer_get_index_(const void* const saBuffer);
+uint32_t        gpu_sa_buffer_get_bits_per_sample_(const void* const saBuffer);
+void            gpu_sa_buffer_unpack_samples_(const void* const saBuffer, const uint64_t idSample, const uint64_t numSamples,
+                                              gpu_sa_entry_t* const samples);
 
 /* DEVICE Kernels */
 gpu_error_t gpu_sa_decode_process_buffer(gpu_buffer_t* const saBuffer);
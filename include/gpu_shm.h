@@ -0,0 +1,102 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_SHM_H_
+#define GPU_SHM_H_
+
+#include <sys/types.h>
+#include "gpu_commons.h"
+#include "gpu_devices.h"
+#include "gpu_reference.h"
+#include "gpu_index.h"
+
+/* Segment identification ("GEMCUTSH") and layout version (increase on any descriptor change) */
+#define GPU_SHM_MAGIC             0x47454D4355545348ULL
+#define GPU_SHM_VERSION           3
+/* Sections start at huge page boundaries (shmem may be backed by transparent huge pages) */
+#define GPU_SHM_ALIGNMENT         (1UL << 21)
+#define GPU_SHM_MAX_DEVICES       16
+#define GPU_SHM_BUS_ID_SIZE       16
+#define GPU_SHM_NAME_SIZE         256
+/* Attaching processes wait for a publisher not started yet or still loading the structures (default of the system setup) */
+#define GPU_SHM_ATTACH_TIMEOUT_MS 5000
+#define GPU_SHM_ATTACH_POLL_US    10000
+
+typedef enum
+{
+  GPU_SHM_FMI,
+  GPU_SHM_FMI_HOST,
+  GPU_SHM_FMI_TABLE_OFFSETS,
+  GPU_SHM_FMI_TABLE_LUT,
+  GPU_SHM_SA,
+  GPU_SHM_REFERENCE_PLAIN,
+  GPU_SHM_REFERENCE_MASKED,
+  GPU_SHM_NRUNS_RUNS,
+  GPU_SHM_NRUNS_BUCKETS,
+  GPU_SHM_MINIMIZERS_ENTRIES,
+  GPU_SHM_MINIMIZERS_BUCKETS,
+  GPU_SHM_NUM_SECTIONS
+} gpu_shm_section_t;
+
+typedef struct {
+  uint64_t offset;  /* From the beginning of the segment (0 for empty sections) */
+  uint64_t size;
+} gpu_shm_extent_t;
+
+typedef struct {
+  /* Device copies exported by the publisher (the publisher must outlive the attached processes) */
+  char                busId[GPU_SHM_BUS_ID_SIZE];
+  bool                activeHandle[GPU_SHM_NUM_SECTIONS];
+  cudaIpcMemHandle_t  handle[GPU_SHM_NUM_SECTIONS];
+} gpu_shm_device_t;
+
+typedef struct {
+  /* Versions and layout of the segment */
+  uint64_t                magic;
+  uint32_t                version;
+  volatile uint32_t       ready;
+  pid_t                   publisherPid;  /* A dead publisher leaves a stale segment that can be replaced */
+  uint32_t                sizeofFMI;
+  uint32_t                sizeofSA;
+  uint32_t                sizeofReference;
+  uint64_t                segmentSize;
+  gpu_shm_extent_t        sections[GPU_SHM_NUM_SECTIONS];
+  /* Descriptors of the prepared structures (host and device pointers are process local) */
+  gpu_module_t            referenceModules;
+  gpu_module_t            indexModules;
+  gpu_reference_buffer_t  reference;
+  gpu_fmi_buffer_t        fmi;
+  gpu_sa_buffer_t         sa;
+  /* CUDA IPC handles */
+  uint32_t                numDevices;
+  gpu_shm_device_t        devices[GPU_SHM_MAX_DEVICES];
+} gpu_shm_header_t;
+
+typedef struct {
+  /* Mapping of the process */
+  gpu_shm_header_t  *header;
+  size_t            mappedSize;
+  bool              owner;      /* Publisher (removes the name at release) */
+  char              name[GPU_SHM_NAME_SIZE];
+  /* Device copies opened from the IPC handles */
+  uint32_t          numOpened;
+  void              *opened[GPU_SHM_MAX_DEVICES * GPU_SHM_NUM_SECTIONS];
+} gpu_shm_t;
+
+/* Functions to share the host structures */
+gpu_error_t gpu_shm_publish(const char* const name, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index);
+gpu_error_t gpu_shm_attach(const char* const name, const uint32_t timeoutMs, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index);
+gpu_error_t gpu_shm_release();
+
+/* Functions to share the device structures */
+gpu_error_t gpu_shm_publish_devices(gpu_device_info_t** const devices, const gpu_reference_buffer_t* const reference, const gpu_index_buffer_t* const index);
+bool        gpu_shm_open_device(const gpu_shm_section_t section, gpu_device_info_t* const device, void** const d_memory);
+gpu_error_t gpu_shm_free_device(void* const d_memory);
+
+#endif /* GPU_SHM_H_ */
@@ -0,0 +1,86 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_STATS_H_
+#define GPU_STATS_H_
+
+#include "gpu_commons.h"
+#include "gpu_trace.h"
+
+/* One slot per module bit in gpu_module_t */
+#define GPU_STATS_NUM_MODULES  12
+/* Event pairs per device segment (launches timed between two stream synchronizations) */
+#define GPU_STATS_SEGMENT_SLOTS 8
+
+typedef enum
+{
+  GPU_STATS_SEGMENT_CPU_TO_GPU,
+  GPU_STATS_SEGMENT_KERNEL,
+  GPU_STATS_SEGMENT_GPU_TO_CPU,
+  GPU_STATS_NUM_SEGMENTS
+} gpu_stats_segment_t;
+
+typedef struct {
+  /* Accumulated counters per module */
+  gpu_stats_dto_t     module[GPU_STATS_NUM_MODULES];
+  uint32_t            idModule;
+  /* Host phase timers */
+  double              startPhase[GPU_STATS_NUM_PHASES];
+  /* Device segment timers (harvested without blocking once the events are completed) */
+  cudaEvent_t         startSegment[GPU_STATS_NUM_SEGMENTS][GPU_STATS_SEGMENT_SLOTS];
+  cudaEvent_t         endSegment[GPU_STATS_NUM_SEGMENTS][GPU_STATS_SEGMENT_SLOTS];
+  bool                pendingSegment[GPU_STATS_NUM_SEGMENTS][GPU_STATS_SEGMENT_SLOTS];
+  uint32_t            idSlot[GPU_STATS_NUM_SEGMENTS];
+  bool                recordingSegment[GPU_STATS_NUM_SEGMENTS];
+  cudaEvent_t         lastEvent;
+  bool                activeSegments;
+  /* Track where the buffer events are traced */
+  gpu_trace_track_t   track;
+} gpu_stats_buffer_t;
+
+/* Functions to initialize and release the counters */
+gpu_error_t gpu_stats_init(gpu_stats_buffer_t* const stats);
+gpu_error_t gpu_stats_create_events(gpu_stats_buffer_t* const stats);
+gpu_error_t gpu_stats_free(gpu_stats_buffer_t* const stats);
+void        gpu_stats_reset(gpu_stats_buffer_t* const stats);
+void        gpu_stats_set_module(gpu_stats_buffer_t* const stats, const gpu_module_t module);
+void        gpu_stats_set_track(gpu_stats_buffer_t* const stats, const uint32_t idBuffer, const uint32_t idDevice, const uint32_t idStream);
+
+/* Functions to time the host phases */
+void        gpu_stats_start_phase(gpu_stats_buffer_t* const stats, const gpu_stats_phase_t phase);
+void        gpu_stats_stop_phase(gpu_stats_buffer_t* const stats, const gpu_stats_phase_t phase);
+
+/* Functions to time the device segments (asynchronous) */
+gpu_error_t gpu_stats_start_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const cudaStream_t idStream);
+gpu_error_t gpu_stats_stop_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const cudaStream_t idStream);
+gpu_error_t gpu_stats_resolve_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const uint32_t idSlot,
+                                      const cudaEvent_t anchorEvent, const double timeAnchor);
+gpu_error_t gpu_stats_harvest_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const uint32_t idSlot,
+                                      const cudaEvent_t anchorEvent, const double timeAnchor, bool* const completed);
+gpu_error_t gpu_stats_update_segments(gpu_stats_buffer_t* const stats);
+
+/* Functions to accumulate the counters */
+void        gpu_stats_add_submission(gpu_stats_buffer_t* const stats, const uint32_t numElements, const uint32_t maxElements);
+void        gpu_stats_add_transfer_CPU_to_GPU(gpu_stats_buffer_t* const stats, const size_t bytes);
+void        gpu_stats_add_transfer_GPU_to_CPU(gpu_stats_buffer_t* const stats, const size_t bytes);
+void        gpu_stats_add_cutoff_iteration(gpu_stats_buffer_t* const stats, const uint32_t numTiles);
+void        gpu_stats_add_reallocation(gpu_stats_buffer_t* const stats);
+void        gpu_stats_add_overflow(gpu_stats_buffer_t* const stats);
+void        gpu_stats_add_split(gpu_stats_buffer_t* const stats, const uint32_t numSubBatches);
+void        gpu_stats_add_layout_tuning(gpu_stats_buffer_t* const stats);
+void        gpu_stats_add_cache_lookups(gpu_stats_buffer_t* const stats, const uint32_t numHits, const uint32_t numMisses);
+void        gpu_stats_add_prefilter(gpu_stats_buffer_t* const stats, const uint32_t numResolved);
+void        gpu_stats_add_migration(gpu_stats_buffer_t* const stats);
+void        gpu_stats_add_regions(gpu_stats_buffer_t* const stats, const uint64_t numRegions, const uint64_t numCandidates);
+
+/* Functions to aggregate the counters */
+void        gpu_stats_clear_dto(gpu_stats_dto_t* const stats);
+void        gpu_stats_accumulate(const gpu_stats_buffer_t* const stats, const gpu_module_t modules, gpu_stats_dto_t* const acc);
+
+#endif /* GPU_STATS_H_ */
@@ -42,6 +42,18 @@ GPU_INLINE __device__ uint8_t gpu_text_lookup(const uint64_t* const text, const
   return(base);             //Requested base
 }
 
+GPU_INLINE __device__ uint8_t gpu_text_lookup_strand(const uint64_t* const text, const uint64_t textPosition, const uint64_t forwardSize,
+                                                     ulong2* const globalInfo, const uint32_t BASE_TEXT_LENGTH, const uint8_t complementMask)
+{
+  //Texts storing both strands and forward positions are directly requested
+  if((forwardSize == 0) || (textPosition < forwardSize))
+    return(gpu_text_lookup(text, textPosition, globalInfo, BASE_TEXT_LENGTH));
+  //Reverse positions beyond the virtual text are padding
+  if((textPosition + 2) > (2 * forwardSize)) return(0);
+  //Reverse positions are complemented reads of the mirrored forward position (cached entries are walked backwards)
+  return(gpu_text_lookup(text, (2 * forwardSize) - textPosition - 2, globalInfo, BASE_TEXT_LENGTH) ^ complementMask);
+}
+
 /*
 GPU_INLINE __device__ void gpu_text_update(uint64_t* const text, const uint8_t base, const uint64_t textPosition, ulong2* const globalInfo, const uint32_t BASE_TEXT_LENGTH)
 {
@@ -0,0 +1,64 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_TRACE_H_
+#define GPU_TRACE_H_
+
+#include <sched.h>
+#include "gpu_commons.h"
+
+/* Chrome trace thread ids for the device streams (buffers use their own id) */
+#define GPU_TRACE_STREAM_TID_BASE  100000
+#define GPU_TRACE_DEFAULT_EVENTS   (1 << 20)
+
+typedef enum
+{
+  GPU_TRACE_LANE_BUFFER,  /* Host work done by the thread owning the buffer */
+  GPU_TRACE_LANE_STREAM   /* Device work completed in the buffer stream     */
+} gpu_trace_lane_t;
+
+typedef struct {
+  uint32_t            idBuffer;
+  uint32_t            idDevice;
+  uint32_t            idStream;
+} gpu_trace_track_t;
+
+typedef struct {
+  const char*         name;
+  double              timeStart;
+  double              timeEnd;
+  gpu_trace_track_t   track;
+  gpu_trace_lane_t    lane;
+  volatile uint64_t   sequence;  /* Id of the event + 1 once it is completely written */
+} gpu_trace_event_t;
+
+typedef struct {
+  volatile bool       active;
+  double              initTime;
+  gpu_trace_event_t*  events;
+  uint64_t            maxEvents;
+  volatile uint64_t   numEvents;
+  volatile uint32_t   numWriters;  /* Threads recording an event (the ring is only replaced with no writers) */
+} gpu_trace_t;
+
+/* Functions to record the events (no-ops while the recorder is stopped) */
+bool   gpu_trace_is_active();
+double gpu_trace_sample_time();
+void   gpu_trace_set_track(gpu_trace_track_t* const track, const uint32_t idBuffer, const uint32_t idDevice, const uint32_t idStream);
+void   gpu_trace_record_span(const gpu_trace_track_t* const track, const gpu_trace_lane_t lane, const char* const name,
+                             const double timeStart, const double timeEnd);
+void   gpu_trace_record(const gpu_trace_track_t* const track, const gpu_trace_lane_t lane, const char* const name, const double timeStart);
+
+/* Functions to export the events */
+uint32_t    gpu_trace_event_tid(const gpu_trace_event_t* const event);
+int         gpu_trace_cmp_tracks(const void* const a, const void* const b);
+gpu_error_t gpu_trace_dump_tracks(FILE* const fp, const uint64_t firstEvent, const uint64_t numEvents, uint64_t* const numDumped);
+gpu_error_t gpu_trace_dump(const char* const fileName);
+
+#endif /* GPU_TRACE_H_ */
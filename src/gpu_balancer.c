@@ -0,0 +1,175 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_BALANCER_C_
+#define GPU_BALANCER_C_
+
+#include "../include/gpu_balancer.h"
+
+/************************************************************
+Functions to initialize and release the balancer
+************************************************************/
+
+gpu_error_t gpu_balancer_init(gpu_balancer_t** const balancer, const uint32_t numDevices, const uint32_t* const buffersPerDevice)
+{
+  gpu_balancer_t* const balance = (gpu_balancer_t *) malloc(sizeof(gpu_balancer_t));
+  uint32_t idDevice;
+  if(balance == NULL) return(E_ALLOCATE_MEM);
+  balance->devices = (gpu_balancer_device_t *) calloc(numDevices, sizeof(gpu_balancer_device_t));
+  if(balance->devices == NULL){
+    free(balance);
+    return(E_ALLOCATE_MEM);
+  }
+  // Initial split of the buffers (static performance of the devices)
+  balance->numDevices = numDevices;
+  balance->numBuffers = 0;
+  balance->cooldown   = 0;
+  for(idDevice = 0; idDevice < numDevices; ++idDevice){
+    balance->devices[idDevice].numBuffers = buffersPerDevice[idDevice];
+    balance->numBuffers += buffersPerDevice[idDevice];
+  }
+  pthread_mutex_init(&balance->lock, NULL);
+  (* balancer) = balance;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_balancer_free(gpu_balancer_t** const balancer)
+{
+  gpu_balancer_t* const balance = (* balancer);
+  if(balance == NULL) return(SUCCESS);
+  pthread_mutex_destroy(&balance->lock);
+  free(balance->devices);
+  free(balance);
+  (* balancer) = NULL;
+  // Succeed
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to measure the completion rates
+************************************************************/
+
+void gpu_balancer_busy_time(gpu_balancer_device_t* const device, const double time)
+{
+  // Overlapped submissions are accounted once (a saturated device is busy all the time whatever its number of buffers)
+  if(device->numInFlight != 0) device->busyTime += GPU_MAX(time - device->lastEvent, 0.0);
+  device->lastEvent = time;
+}
+
+void gpu_balancer_submit(gpu_balancer_t* const balancer, const uint32_t idDevice, const uint32_t idModule, const double time)
+{
+  gpu_balancer_device_t* const device = &balancer->devices[idDevice];
+  pthread_mutex_lock(&balancer->lock);
+  gpu_balancer_busy_time(device, time);
+  device->numInFlight++;
+  pthread_mutex_unlock(&balancer->lock);
+}
+
+void gpu_balancer_complete(gpu_balancer_t* const balancer, const uint32_t idDevice, const uint32_t idModule,
+                           const uint32_t numElements, const double time)
+{
+  gpu_balancer_device_t* const device = &balancer->devices[idDevice];
+  uint32_t idSample;
+  pthread_mutex_lock(&balancer->lock);
+  gpu_balancer_busy_time(device, time);
+  if(device->numInFlight != 0) device->numInFlight--;
+  device->numCompleted++;
+  device->numElements[idModule] += numElements;
+  // Close the window (thermal and co-tenant changes are followed by the moving average)
+  if((device->numCompleted >= GPU_BALANCER_WINDOW) && (device->busyTime > 0.0)){
+    for(idSample = 0; idSample < GPU_STATS_NUM_MODULES; ++idSample){
+      const double sample = device->numElements[idSample] / device->busyTime;
+      if(device->numElements[idSample] == 0) continue;
+      device->throughput[idSample]  = (device->throughput[idSample] == 0.0) ? sample :
+                                      (GPU_BALANCER_ALPHA * sample) + ((1.0 - GPU_BALANCER_ALPHA) * device->throughput[idSample]);
+      device->numElements[idSample] = 0;
+    }
+    device->numCompleted = 0;
+    device->busyTime     = 0.0;
+  }
+  if(balancer->cooldown != 0) balancer->cooldown--;
+  pthread_mutex_unlock(&balancer->lock);
+}
+
+/************************************************************
+Functions to decide the buffer migrations
+************************************************************/
+
+bool gpu_balancer_get_shares(const gpu_balancer_t* const balancer, double* const shares)
+{
+  const uint32_t numDevices = balancer->numDevices;
+  uint32_t idDevice, idModule, numModules = 0;
+  for(idDevice = 0; idDevice < numDevices; ++idDevice)
+    shares[idDevice] = 0.0;
+  // Elements of each module have their own cost, devices are compared module by module
+  for(idModule = 0; idModule < GPU_STATS_NUM_MODULES; ++idModule){
+    double allThroughput = 0.0;
+    bool   measured      = true;
+    for(idDevice = 0; idDevice < numDevices; ++idDevice){
+      const double throughput = balancer->devices[idDevice].throughput[idModule];
+      measured      = measured && (throughput > 0.0);
+      allThroughput += throughput;
+    }
+    if(!measured) continue;
+    for(idDevice = 0; idDevice < numDevices; ++idDevice)
+      shares[idDevice] += balancer->devices[idDevice].throughput[idModule] / allThroughput;
+    numModules++;
+  }
+  if(numModules == 0) return(false);
+  for(idDevice = 0; idDevice < numDevices; ++idDevice)
+    shares[idDevice] /= numModules;
+  return(true);
+}
+
+uint32_t gpu_balancer_select_target(const gpu_balancer_t* const balancer, const uint32_t idDevice)
+{
+  const uint32_t numDevices = balancer->numDevices;
+  const double   margin     = 0.5 + GPU_BALANCER_HYSTERESIS;
+  double   shares[numDevices], surplus, maxDeficit = 0.0;
+  uint32_t idTarget, idBestTarget = GPU_BALANCER_NO_MIGRATION;
+  if((numDevices < 2) || (balancer->cooldown != 0)) return(GPU_BALANCER_NO_MIGRATION);
+  if(balancer->devices[idDevice].numBuffers <= GPU_BALANCER_MIN_BUFFERS) return(GPU_BALANCER_NO_MIGRATION);
+  if(!gpu_balancer_get_shares(balancer, shares)) return(GPU_BALANCER_NO_MIGRATION);
+  // Buffers are owned proportionally to the measured throughput (moving one has to reduce the imbalance)
+  surplus = balancer->devices[idDevice].numBuffers - (shares[idDevice] * balancer->numBuffers);
+  if(surplus < margin) return(GPU_BALANCER_NO_MIGRATION);
+  for(idTarget = 0; idTarget < numDevices; ++idTarget){
+    const double deficit = (shares[idTarget] * balancer->numBuffers) - balancer->devices[idTarget].numBuffers;
+    if((idTarget == idDevice) || (deficit < margin) || (deficit <= maxDeficit)) continue;
+    maxDeficit   = deficit;
+    idBestTarget = idTarget;
+  }
+  return(idBestTarget);
+}
+
+void gpu_balancer_move(gpu_balancer_t* const balancer, const uint32_t idSourceDevice, const uint32_t idTargetDevice)
+{
+  pthread_mutex_lock(&balancer->lock);
+  balancer->devices[idSourceDevice].numBuffers--;
+  balancer->devices[idTargetDevice].numBuffers++;
+  pthread_mutex_unlock(&balancer->lock);
+}
+
+uint32_t gpu_balancer_migration(gpu_balancer_t* const balancer, const uint32_t idDevice)
+{
+  uint32_t idTarget;
+  pthread_mutex_lock(&balancer->lock);
+  idTarget = gpu_balancer_select_target(balancer, idDevice);
+  if(idTarget != GPU_BALANCER_NO_MIGRATION){
+    // The ownership is reserved here (concurrent buffers see the new split) and the rates re-measured before the next move
+    balancer->devices[idDevice].numBuffers--;
+    balancer->devices[idTarget].numBuffers++;
+    balancer->cooldown = balancer->numDevices * GPU_BALANCER_WINDOW;
+  }
+  pthread_mutex_unlock(&balancer->lock);
+  return(idTarget);
+}
+
+#endif /* GPU_BALANCER_C_ */
@@ -12,6 +12,7 @@
 
 #include "../include/gpu_bpm_core.h"
 #include "../include/gpu_text_core.h"
+#include "../include/gpu_reference_core.h"
 #include "../include/gpu_scheduler_core.h"
 
 #define GPU_BMP_ALIGN_CIGAR_LUT_OFFSET      8
@@ -21,7 +22,7 @@
 
 
 GPU_INLINE __device__ void gpu_bpm_align_backtrace(const uint32_t* const dpPV, const uint32_t* const dpMV, const uint64_t* const query,
-												   const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const uint64_t sizeReference, const uint64_t posCandidate,
+												   const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const gpu_reference_nruns_view_t nRunsReference, const uint64_t sizeReference, const uint64_t forwardSizeReference, const uint64_t posCandidate,
 												   gpu_bpm_align_cigar_entry_t* const dpCIGAR, const bool leftGapAlign, const uint32_t minColumn, const uint32_t sizeQuery,
 												   const uint32_t intraQueryThreadIdx, const uint32_t threadsPerQuery,
 												   gpu_bpm_align_coord_t* const initCoodRes, uint32_t* const cigarLenghtRes)
@@ -47,8 +48,9 @@ GPU_INLINE __device__ void gpu_bpm_align_backtrace(const uint32_t* const dpPV, c
     const uint32_t dpLocalThreadEntry = (y % GPU_BPM_ALIGN_PEQ_ENTRY_LENGTH) / GPU_UINT32_LENGTH;
     if(intraQueryThreadIdx == dpActiveThread){
       // Read query and candidate bases
-      const uint8_t encBaseRefPlain  = gpu_text_lookup(referencePlain, posCandidate + x, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH);
-      const uint8_t encBaseRefMasked = gpu_text_lookup(referenceMasked, posCandidate + x, &infoCandidateMasked, GPU_REFERENCE_MASKED__CHAR_LENGTH);
+      const uint8_t encBaseRefMasked = gpu_reference_lookup_masked(referenceMasked, nRunsReference, posCandidate + x, forwardSizeReference, &infoCandidateMasked);
+      const uint8_t encBaseRefPlain  = gpu_text_lookup_strand(referencePlain, posCandidate + x, forwardSizeReference, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH,
+                                                              (encBaseRefMasked) ? 0 : GPU_REFERENCE_PLAIN__MASK_BASE);
       const uint8_t encBaseCandidate = (encBaseRefMasked << GPU_REFERENCE_PLAIN__CHAR_LENGTH) | encBaseRefPlain;
       const uint8_t encBaseQuery     = gpu_text_lookup(query, y, &infoQuery, GPU_BMP_ALIGN_BASE_QUERY_LENGTH);
       // Indexation for the dpMatrix element
@@ -98,7 +100,7 @@ GPU_INLINE __device__ void gpu_bpm_align_backtrace(const uint32_t* const dpPV, c
 
 
 GPU_INLINE __device__ void gpu_bpm_align_dp_matrix(uint4* const dpPV, uint4* const dpMV, const gpu_bpm_align_device_qry_entry_t* const PEQs,
-												   const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const uint64_t sizeReference,
+												   const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const gpu_reference_nruns_view_t nRunsReference, const uint64_t sizeReference, const uint64_t forwardSizeReference,
 												   const uint32_t sizeQuery, const uint32_t sizeCandidate, const uint64_t posCandidate,
 												   const uint32_t intraQueryThreadIdx, const uint32_t threadsPerQuery,
 												   uint32_t* const endMinColumn, uint32_t* const endMinScore)
@@ -131,8 +133,9 @@ GPU_INLINE __device__ void gpu_bpm_align_dp_matrix(uint4* const dpPV, uint4* con
 
     for(idColumn = 0; idColumn < sizeCandidate; idColumn++){
       uint32_t PH, MH;
-      const uint8_t encBasePlain  = gpu_text_lookup(referencePlain, posCandidate + idColumn, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH);
-      const uint8_t encBaseMasked = gpu_text_lookup(referenceMasked, posCandidate + idColumn, &infoCandidateMasked, GPU_REFERENCE_MASKED__CHAR_LENGTH);
+      const uint8_t encBaseMasked = gpu_reference_lookup_masked(referenceMasked, nRunsReference, posCandidate + idColumn, forwardSizeReference, &infoCandidateMasked);
+      const uint8_t encBasePlain  = gpu_text_lookup_strand(referencePlain, posCandidate + idColumn, forwardSizeReference, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH,
+                                                           (encBaseMasked) ? 0 : GPU_REFERENCE_PLAIN__MASK_BASE);
       const uint8_t encBase       = (encBaseMasked << GPU_REFERENCE_PLAIN__CHAR_LENGTH) | encBasePlain;
       const uint4 Eqv4 = LDG(&PEQs->bitmap[encBase]);
       gpu_decompose_uintv4(Eq, Eqv4);
@@ -187,7 +190,7 @@ GPU_INLINE __device__ void gpu_bpm_align_dp_matrix(uint4* const dpPV, uint4* con
 }
 
 GPU_INLINE __device__ void gpu_bpm_align_local_kernel(const gpu_bpm_align_qry_entry_t* const d_queries,  const gpu_bpm_align_device_qry_entry_t* const d_PEQs, const gpu_bpm_align_qry_info_t* const d_queryInfo,
-                                                      const gpu_bpm_align_cand_info_t* const d_candidateInfo, const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const uint64_t sizeReference,
+                                                      const gpu_bpm_align_cand_info_t* const d_candidateInfo, const uint64_t* const referencePlain, const uint64_t* const referenceMasked, const gpu_reference_nruns_view_t nRunsReference, const uint64_t sizeReference, const uint64_t forwardSizeReference,
                                                       gpu_bpm_align_cigar_entry_t * const d_cigars, gpu_bpm_align_cigar_info_t* const d_cigarInfo,
                                                       const uint32_t idCandidate, const uint32_t intraQueryThreadIdx, const uint32_t threadsPerQuery)
 {
@@ -220,9 +223,9 @@ GPU_INLINE __device__ void gpu_bpm_align_local_kernel(const gpu_bpm_align_qry_en
     gpu_bpm_align_coord_t initCood = {0,0};
     uint32_t cigarLenght = 0;
 
-    gpu_bpm_align_dp_matrix(dpPV,  dpMV, PEQs, referencePlain, referenceMasked, sizeReference, sizeQuery, sizeCandidate, posCandidate,
+    gpu_bpm_align_dp_matrix(dpPV,  dpMV, PEQs, referencePlain, referenceMasked, nRunsReference, sizeReference, forwardSizeReference, sizeQuery, sizeCandidate, posCandidate,
 		                    intraQueryThreadIdx, threadsPerQuery, &minColumn, &minScore);
-    gpu_bpm_align_backtrace(dpPV4, dpMV4, query, referencePlain, referenceMasked, sizeReference, posCandidate,
+    gpu_bpm_align_backtrace(dpPV4, dpMV4, query, referencePlain, referenceMasked, nRunsReference, sizeReference, forwardSizeReference, posCandidate,
 		                    cigar, leftGapAlign, minColumn, sizeQuery,
 		                    intraQueryThreadIdx, threadsPerQuery, &initCood, &cigarLenght);
 
@@ -239,7 +242,7 @@ GPU_INLINE __device__ void gpu_bpm_align_local_kernel(const gpu_bpm_align_qry_en
 
 __global__ void gpu_bpm_align_kernel(const gpu_bpm_align_qry_entry_t* const d_queries,  const gpu_bpm_align_device_qry_entry_t * const d_PEQs, const gpu_bpm_align_qry_info_t* const d_queryInfo,
                                      const gpu_bpm_align_cand_info_t* const d_candidateInfo, const uint32_t* const d_reorderBuffer,
-                                     const uint64_t* const d_referencePlain, const uint64_t* const d_referenceMasked, const uint64_t referenceSize,
+                                     const uint64_t* const d_referencePlain, const uint64_t* const d_referenceMasked, const gpu_reference_nruns_view_t referenceNRuns, const uint64_t referenceSize, const uint64_t referenceForwardSize,
                                      gpu_bpm_align_cigar_entry_t * const d_cigars, gpu_bpm_align_cigar_info_t* const d_cigarInfo, const uint32_t numCigars,
                                      const uint32_t* const d_initPosPerBucket, const uint32_t* const d_initWarpPerBucket, const uint32_t* const d_endPosPerBucket, const bool updateScheduling)
 {
@@ -256,7 +259,7 @@ __global__ void gpu_bpm_align_kernel(const gpu_bpm_align_qry_entry_t* const d_qu
   if ((idCandidate < numCigars) && (idCandidate != GPU_SCHEDULER_DISABLED_TASK)){
     // Update the buffer input/output for the thread re-scheduling
     gpu_bpm_align_local_kernel(d_queries, d_PEQs, d_queryInfo, d_candidateInfo,
-    		                   d_referencePlain, d_referenceMasked, referenceSize,
+    		                   d_referencePlain, d_referenceMasked, referenceNRuns, referenceSize, referenceForwardSize,
     		                   d_cigars, d_cigarInfo,
                                idCandidate, intraQueryThreadIdx, threadsPerQuery);
   }
@@ -295,12 +298,14 @@ gpu_error_t gpu_bpm_align_process_buffer(gpu_buffer_t *mBuff)
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
   if((numQueries > maxQueries) || (numCandidates > maxCandidates) || (numQueryPEQs > maxQueryPEQs) ||
-     (numQueryBases > maxQueryBases) || (numCigars > maxCigars))
+     (numQueryBases > maxQueryBases) || (numCigars > maxCigars)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
+  }
   // Launching the BPM align kernel on device
   gpu_bpm_align_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>(qry->d_queries, (gpu_bpm_align_device_qry_entry_t *) qry->d_peq, qry->d_qinfo,
                                                                         cand->d_candidatesInfo, rebuff->threadMapScheduler.d_reorderBuffer,
-                                                                        ref->d_reference_plain[idSupDev], ref->d_reference_masked[idSupDev], ref->size,
+                                                                        ref->d_reference_plain[idSupDev], ref->d_reference_masked[idSupDev], gpu_reference_nruns_get_view(&ref->nRuns, idSupDev), ref->size, ref->forwardSize,
                                                                         cigar->d_cigars, cigarsInfo, numCigars,
                                                                         rebuff->d_initPosPerBucket, rebuff->d_initWarpPerBucket, rebuff->d_endPosPerBucket,
                                                                         mBuff->data.abpm.queryBinning);
@@ -0,0 +1,268 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_BPM_ALIGN_BAM_C_
+#define GPU_BPM_ALIGN_BAM_C_
+
+#include "../include/gpu_bpm_align_bam.h"
+
+/************************************************************
+Functions to convert a single alignment
+************************************************************/
+
+bool gpu_bpm_align_bam_trim(const gpu_reference_buffer_t* const reference, const gpu_bpm_align_cand_info_t* const candidate,
+                            const gpu_bpm_align_cigar_info_t* const cigarInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                            gpu_bpm_align_bam_alignment_t* const alignment)
+{
+  const gpu_bpm_align_cigar_entry_t* runs = cigars + cigarInfo->cigarStartPos;
+  uint32_t numRuns = cigarInfo->cigarLenght, idRun;
+  alignment->leftClip  = 0;
+  alignment->rightClip = 0;
+  alignment->position  = candidate->position + cigarInfo->initCood.x;
+  alignment->textSize  = 0;
+  // The kernel skips the candidates exceeding the reference (their results are stale)
+  if((candidate->position + candidate->size) >= reference->size) return(false);
+  // Query-only runs at the ends become soft-clips and text-only runs at the ends are not part of the alignment
+  while((numRuns > 0) && (runs[0].event != GPU_CIGAR_MATCH) && (runs[0].event != GPU_CIGAR_MISSMATCH)){
+    if(runs[0].event == GPU_CIGAR_DELETION)  alignment->leftClip += runs[0].occurrences;
+    if(runs[0].event == GPU_CIGAR_INSERTION) alignment->position += runs[0].occurrences;
+    runs++; numRuns--;
+  }
+  while((numRuns > 0) && (runs[numRuns - 1].event != GPU_CIGAR_MATCH) && (runs[numRuns - 1].event != GPU_CIGAR_MISSMATCH)){
+    if(runs[numRuns - 1].event == GPU_CIGAR_DELETION) alignment->rightClip += runs[numRuns - 1].occurrences;
+    numRuns--;
+  }
+  for(idRun = 0; idRun < numRuns; ++idRun)
+    if(runs[idRun].event != GPU_CIGAR_DELETION) alignment->textSize += runs[idRun].occurrences;
+  alignment->runs    = runs;
+  alignment->numRuns = numRuns;
+  return(numRuns > 0);
+}
+
+uint32_t gpu_bpm_align_bam_get_op(const char event, const bool extendedCigar)
+{
+  // The backtrace is described from the text: insertions consume text only (BAM D), deletions query only (BAM I)
+  switch(event){
+    case GPU_CIGAR_MATCH:     return(extendedCigar ? GPU_BAM_CIGAR_EQUAL : GPU_BAM_CIGAR_M);
+    case GPU_CIGAR_MISSMATCH: return(extendedCigar ? GPU_BAM_CIGAR_DIFF  : GPU_BAM_CIGAR_M);
+    case GPU_CIGAR_INSERTION: return(GPU_BAM_CIGAR_D);
+    default:                  return(GPU_BAM_CIGAR_I);
+  }
+}
+
+uint32_t gpu_bpm_align_bam_put_number(char* const md, const uint32_t value)
+{
+  char     digits[GPU_UINT32_LENGTH];
+  uint32_t numDigits = 0, number = value, idDigit;
+  do {
+    digits[numDigits++] = '0' + (number % 10);
+    number /= 10;
+  } while(number != 0);
+  // A NULL destination only measures the number
+  if(md != NULL)
+    for(idDigit = 0; idDigit < numDigits; ++idDigit)
+      md[idDigit] = digits[numDigits - idDigit - 1];
+  return(numDigits);
+}
+
+void gpu_bpm_align_bam_convert(const gpu_bpm_align_bam_alignment_t* const alignment, const bool extendedCigar,
+                               const uint8_t* const text, uint32_t* const bamCigars, char* const md,
+                               gpu_bpm_align_bam_info_t* const bamInfo)
+{
+  // Walks the runs once for both tags (NULL destinations only measure the CIGAR and MD lengths)
+  uint32_t numOps = 0, mdChars = 0, editDistance = 0, matches = 0, textPos = 0;
+  uint32_t pendingOp = GPU_BAM_CIGAR_M, pendingLength = 0, idRun, idBase;
+  if(alignment->leftClip > 0){
+    if(bamCigars != NULL) bamCigars[numOps] = (alignment->leftClip << GPU_BAM_CIGAR_SHIFT) | GPU_BAM_CIGAR_S;
+    numOps++;
+  }
+  for(idRun = 0; idRun < alignment->numRuns; ++idRun){
+    const gpu_bpm_align_cigar_entry_t* const run = &alignment->runs[idRun];
+    const uint32_t op = gpu_bpm_align_bam_get_op(run->event, extendedCigar);
+    if((run->event == GPU_CIGAR_NULL) || (run->occurrences == 0)) continue;
+    // Mismatches are stored one per run, consecutive runs of the same operation are merged
+    if((pendingLength > 0) && (op != pendingOp)){
+      if(bamCigars != NULL) bamCigars[numOps] = (pendingLength << GPU_BAM_CIGAR_SHIFT) | pendingOp;
+      numOps++;
+      pendingLength = 0;
+    }
+    pendingOp      = op;
+    pendingLength += run->occurrences;
+    switch(run->event){
+      case GPU_CIGAR_MATCH:
+        matches += run->occurrences;
+        textPos += run->occurrences;
+        break;
+      case GPU_CIGAR_MISSMATCH:
+        for(idBase = 0; idBase < run->occurrences; ++idBase){
+          mdChars += gpu_bpm_align_bam_put_number((md != NULL) ? md + mdChars : NULL, matches);
+          if(md != NULL) md[mdChars] = text[textPos];
+          mdChars++; textPos++;
+          matches = 0;
+        }
+        editDistance += run->occurrences;
+        break;
+      case GPU_CIGAR_INSERTION:
+        mdChars += gpu_bpm_align_bam_put_number((md != NULL) ? md + mdChars : NULL, matches);
+        if(md != NULL){
+          md[mdChars] = '^';
+          memcpy(md + mdChars + 1, text + textPos, run->occurrences);
+        }
+        mdChars += run->occurrences + 1;
+        textPos += run->occurrences;
+        matches  = 0;
+        editDistance += run->occurrences;
+        break;
+      default:
+        editDistance += run->occurrences;
+        break;
+    }
+  }
+  if(pendingLength > 0){
+    if(bamCigars != NULL) bamCigars[numOps] = (pendingLength << GPU_BAM_CIGAR_SHIFT) | pendingOp;
+    numOps++;
+  }
+  if(alignment->rightClip > 0){
+    if(bamCigars != NULL) bamCigars[numOps] = (alignment->rightClip << GPU_BAM_CIGAR_SHIFT) | GPU_BAM_CIGAR_S;
+    numOps++;
+  }
+  mdChars += gpu_bpm_align_bam_put_number((md != NULL) ? md + mdChars : NULL, matches);
+  if(md != NULL) md[mdChars] = '\0';
+  bamInfo->position      = alignment->position;
+  bamInfo->cigar_length  = numOps;
+  bamInfo->md_length     = mdChars;
+  bamInfo->edit_distance = editDistance;
+}
+
+gpu_error_t gpu_bpm_align_bam_build(gpu_bpm_align_bam_worker_t* const worker, const uint32_t idCandidate)
+{
+  const gpu_bpm_align_bam_context_t* const context = worker->context;
+  gpu_bpm_align_bam_info_t* const          bamInfo = &context->bamInfo[idCandidate];
+  gpu_bpm_align_bam_alignment_t alignment;
+  if(!gpu_bpm_align_bam_trim(context->reference, &context->candidates[idCandidate], &context->cigarsInfo[idCandidate],
+                             context->cigars, &alignment)){
+    context->md[bamInfo->md_offset] = '\0';
+    return(SUCCESS);
+  }
+  // Reference bases covered by the alignment (mismatched and deleted bases are printed in the MD tag)
+  if(alignment.textSize > worker->maxText){
+    uint8_t* const scratch = (uint8_t *) realloc(worker->h_text, alignment.textSize);
+    if(scratch == NULL) return(E_ALLOCATE_MEM);
+    worker->h_text  = scratch;
+    worker->maxText = alignment.textSize;
+  }
+  gpu_reference_text_extract_codes(context->reference, alignment.position, alignment.textSize, worker->h_text);
+  gpu_reference_text_codes_to_ASCII(worker->h_text, alignment.textSize);
+  gpu_bpm_align_bam_convert(&alignment, context->extendedCigar, worker->h_text,
+                            context->bamCigars + bamInfo->cigar_offset, context->md + bamInfo->md_offset, bamInfo);
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Functions to distribute the alignments among the host threads
+************************************************************/
+
+void* gpu_bpm_align_bam_worker(void* const threadWorker)
+{
+  gpu_bpm_align_bam_worker_t* const  worker  = (gpu_bpm_align_bam_worker_t *) threadWorker;
+  gpu_bpm_align_bam_context_t* const context = worker->context;
+  // Dynamic scheduling: alignments differ in the number of runs and the reference bases to fetch
+  while(worker->error == SUCCESS){
+    const uint32_t initCandidate = __sync_fetch_and_add(&context->nextCandidate, GPU_BPM_ALIGN_BAM_CANDIDATES_PER_TASK);
+    const uint32_t endCandidate  = GPU_MIN(initCandidate + GPU_BPM_ALIGN_BAM_CANDIDATES_PER_TASK, context->numCandidates);
+    uint32_t idCandidate;
+    if(initCandidate >= context->numCandidates) break;
+    for(idCandidate = initCandidate; (idCandidate < endCandidate) && (worker->error == SUCCESS); ++idCandidate)
+      worker->error = gpu_bpm_align_bam_build(worker, idCandidate);
+  }
+  return(NULL);
+}
+
+uint32_t gpu_bpm_align_bam_get_num_threads(const uint32_t numThreads, const uint32_t numCandidates)
+{
+  return(gpu_get_num_workers(numThreads, GPU_DIV_CEIL(numCandidates, GPU_BPM_ALIGN_BAM_CANDIDATES_PER_TASK), GPU_BPM_ALIGN_BAM_MAX_THREADS));
+}
+
+gpu_error_t gpu_bpm_align_bam_output(const gpu_reference_buffer_t* const reference, const gpu_bpm_align_cand_info_t* const candidates,
+                                     const gpu_bpm_align_cigar_info_t* const cigarsInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                                     const uint32_t numCandidates, const bool extendedCigar, const uint32_t numThreads,
+                                     gpu_bpm_align_bam_info_t* const bamInfo, uint32_t* const bamCigars, const uint32_t maxBamCigars,
+                                     char* const md, const uint32_t maxMdChars)
+{
+  const uint32_t threads = gpu_bpm_align_bam_get_num_threads(numThreads, numCandidates);
+  gpu_bpm_align_bam_context_t context;
+  gpu_bpm_align_bam_worker_t  workers[GPU_BPM_ALIGN_BAM_MAX_THREADS];
+  gpu_error_t error = SUCCESS;
+  uint64_t    cigarOffset = 0, mdOffset = 0;
+  uint32_t    idCandidate, idThread, numLaunched = 0;
+  if(reference->h_reference_plain == NULL) return(E_DATA_NOT_ALLOCATED);
+  // Sizes only depend on the runs: the arenas are laid out in candidate order before fetching any reference base
+  for(idCandidate = 0; idCandidate < numCandidates; ++idCandidate){
+    gpu_bpm_align_bam_info_t* const info = &bamInfo[idCandidate];
+    gpu_bpm_align_bam_alignment_t alignment;
+    info->cigar_length = 0; info->md_length = 0; info->edit_distance = 0;
+    info->position = candidates[idCandidate].position;
+    if(gpu_bpm_align_bam_trim(reference, &candidates[idCandidate], &cigarsInfo[idCandidate], cigars, &alignment))
+      gpu_bpm_align_bam_convert(&alignment, extendedCigar, NULL, NULL, NULL, info);
+    info->cigar_offset = cigarOffset;
+    info->md_offset    = mdOffset;
+    cigarOffset += info->cigar_length;
+    mdOffset    += info->md_length + 1;
+  }
+  if((cigarOffset > maxBamCigars) || (mdOffset > maxMdChars)) return(E_OVERFLOWING_BUFFER);
+  // Output setup shared by all the threads
+  context.reference     = reference;
+  context.candidates    = candidates;
+  context.cigarsInfo    = cigarsInfo;
+  context.cigars        = cigars;
+  context.numCandidates = numCandidates;
+  context.extendedCigar = extendedCigar;
+  context.bamInfo       = bamInfo;
+  context.bamCigars     = bamCigars;
+  context.md            = md;
+  context.nextCandidate = 0;
+  for(idThread = 0; idThread < threads; ++idThread){
+    workers[idThread].context = &context;
+    workers[idThread].h_text  = NULL;
+    workers[idThread].maxText = 0;
+    workers[idThread].error   = SUCCESS;
+  }
+  // The calling thread works as the first worker (a failed launch only reduces the parallelism)
+  for(idThread = 1; idThread < threads; ++idThread){
+    if(pthread_create(&workers[idThread].thread, NULL, gpu_bpm_align_bam_worker, &workers[idThread]) != 0) break;
+    numLaunched++;
+  }
+  gpu_bpm_align_bam_worker(&workers[0]);
+  for(idThread = 1; idThread <= numLaunched; ++idThread)
+    pthread_join(workers[idThread].thread, NULL);
+  for(idThread = 0; idThread < threads; ++idThread){
+    if(error == SUCCESS) error = workers[idThread].error;
+    free(workers[idThread].h_text);
+  }
+  return(error);
+}
+
+
+/************************************************************
+Functions to build the BAM output (public)
+************************************************************/
+
+void gpu_bpm_align_bam_output_(const void* const bpmBuffer, const gpu_bpm_align_cand_info_t* const candidates,
+                               const gpu_bpm_align_cigar_info_t* const cigarsInfo, const gpu_bpm_align_cigar_entry_t* const cigars,
+                               const uint32_t numCandidates, const bool extendedCigar, const uint32_t numThreads,
+                               gpu_bpm_align_bam_info_t* const bamInfo, uint32_t* const bamCigars, const uint32_t maxBamCigars,
+                               char* const md, const uint32_t maxMdChars)
+{
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) bpmBuffer;
+  GPU_ERROR(gpu_bpm_align_bam_output(mBuff->reference, candidates, cigarsInfo, cigars, numCandidates, extendedCigar, numThreads,
+                                     bamInfo, bamCigars, maxBamCigars, md, maxMdChars));
+}
+
+#endif /* GPU_BPM_ALIGN_BAM_C_ */
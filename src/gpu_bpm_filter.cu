@@ -12,6 +12,7 @@
 
 #include "../include/gpu_bpm_core.h"
 #include "../include/gpu_text_core.h"
+#include "../include/gpu_reference_core.h"
 
 
 GPU_INLINE __device__ void gpu_bpm_filter_local_kernel_4bases(const gpu_bpm_filter_device_qry_entry_t * __restrict d_queries, const uint64_t * __restrict d_reference,
@@ -125,7 +126,7 @@ GPU_INLINE __device__ void gpu_bpm_filter_local_kernel_4bases(const gpu_bpm_filt
 GPU_INLINE __device__ void gpu_bpm_filter_local_kernel(const gpu_bpm_filter_device_qry_entry_t * __restrict d_queries, const uint64_t * __restrict referencePlain,
 		                                                   const uint64_t* __restrict referenceMasked, const gpu_bpm_filter_cand_info_t *d_candidates, const uint32_t *d_reorderBuffer,
                                                        gpu_bpm_filter_alg_entry_t* const d_results, const gpu_bpm_filter_qry_info_t *d_qinfo,
-                                                       const uint32_t idCandidate, const uint64_t sizeRef, const uint32_t numResults,
+                                                       const gpu_reference_nruns_view_t nRunsRef, const uint32_t idCandidate, const uint64_t sizeRef, const uint64_t forwardSizeRef, const uint32_t numResults,
                                                        const uint32_t intraQueryThreadIdx, const uint32_t threadsPerQuery, const bool binning)
 {
   if (idCandidate < numResults){
@@ -159,8 +160,9 @@ GPU_INLINE __device__ void gpu_bpm_filter_local_kernel(const gpu_bpm_filter_devi
 
       for(idColumn = 0; idColumn < sizeCandidate; idColumn++){
         uint32_t PH, MH;
-        const uint8_t encBasePlain  = gpu_text_lookup(referencePlain, posCandidate + idColumn, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH);
-        const uint8_t encBaseMasked = gpu_text_lookup(referenceMasked, posCandidate + idColumn, &infoCandidateMasked, GPU_REFERENCE_MASKED__CHAR_LENGTH);
+        const uint8_t encBaseMasked = gpu_reference_lookup_masked(referenceMasked, nRunsRef, posCandidate + idColumn, forwardSizeRef, &infoCandidateMasked);
+        const uint8_t encBasePlain  = gpu_text_lookup_strand(referencePlain, posCandidate + idColumn, forwardSizeRef, &infoCandidatePlain, GPU_REFERENCE_PLAIN__CHAR_LENGTH,
+                                                             (encBaseMasked) ? 0 : GPU_REFERENCE_PLAIN__MASK_BASE);
         const uint8_t encBase       = (encBaseMasked << GPU_REFERENCE_PLAIN__CHAR_LENGTH) | encBasePlain;
 
         #pragma unroll
@@ -218,9 +220,10 @@ GPU_INLINE __device__ void gpu_bpm_filter_local_kernel(const gpu_bpm_filter_devi
   }
 }
 
-__global__ void gpu_bpm_filter_kernel(const gpu_bpm_filter_device_qry_entry_t* const d_queries, const uint64_t* const d_reference, const uint64_t* const d_reference_masked, const gpu_bpm_filter_cand_info_t* const d_candidates,
+__global__ void gpu_bpm_filter_kernel(const gpu_bpm_filter_device_qry_entry_t* const d_queries, const uint64_t* const d_reference, const uint64_t* const d_reference_masked,
+                                      const gpu_reference_nruns_view_t nRunsRef, const gpu_bpm_filter_cand_info_t* const d_candidates,
                                       const uint32_t* const d_reorderBuffer, gpu_bpm_filter_alg_entry_t* const d_reorderResults, const gpu_bpm_filter_qry_info_t* const d_qinfo,
-                                      const uint64_t sizeRef,  const uint32_t numResults, const uint32_t* const d_initPosPerBucket, const uint32_t* const d_initWarpPerBucket,
+                                      const uint64_t sizeRef, const uint64_t forwardSizeRef, const uint32_t numResults, const uint32_t* const d_initPosPerBucket, const uint32_t* const d_initWarpPerBucket,
                                       const uint32_t numWarps, const bool binning)
 {
   const uint32_t globalThreadIdx = gpu_get_thread_idx();
@@ -243,7 +246,7 @@ __global__ void gpu_bpm_filter_kernel(const gpu_bpm_filter_device_qry_entry_t* c
   intraQueryThreadIdx         = (threadIdx.x % GPU_WARP_SIZE) % threadsPerQuery;
 
   gpu_bpm_filter_local_kernel(d_queries, d_reference, d_reference_masked, d_candidates, d_reorderBuffer, d_reorderResults, d_qinfo,
-                              idCandidate, sizeRef, numResults, intraQueryThreadIdx, threadsPerQuery, binning);
+                              nRunsRef, idCandidate, sizeRef, forwardSizeRef, numResults, intraQueryThreadIdx, threadsPerQuery, binning);
 }
 
 extern "C"
@@ -267,12 +270,16 @@ gpu_error_t gpu_bpm_filter_process_buffer(gpu_buffer_t *mBuff)
   const uint32_t numThreads = rebuff->numWarps * GPU_WARP_SIZE;
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
-  if((numAlignments > maxCandidates) || (numAlignments > maxAlignments)) 
+  if((numAlignments > maxCandidates) || (numAlignments > maxAlignments)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
+  }
+  // Nothing left for the device (all the candidates resolved by the Hamming prefilter)
+  if(rebuff->numWarps == 0) return(SUCCESS);
   // Kernel Launcher
   gpu_bpm_filter_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>((gpu_bpm_filter_device_qry_entry_t *)qry->d_queries, ref->d_reference_plain[idSupDev], ref->d_reference_masked[idSupDev],
-                                                                          cand->d_candidates, rebuff->threadMapScheduler.d_reorderBuffer, d_results,
-                                                                          qry->d_qinfo, ref->size, numResults,
+                                                                          gpu_reference_nruns_get_view(&ref->nRuns, idSupDev), cand->d_candidates, rebuff->threadMapScheduler.d_reorderBuffer, d_results,
+                                                                          qry->d_qinfo, ref->size, ref->forwardSize, numResults,
                                                                           rebuff->d_initPosPerBucket, rebuff->d_initWarpPerBucket,
                                                                           rebuff->numWarps, mBuff->data.fbpm.queryBinning);
   return(SUCCESS);
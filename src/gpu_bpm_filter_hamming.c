@@ -0,0 +1,159 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_BPM_FILTER_HAMMING_C_
+#define GPU_BPM_FILTER_HAMMING_C_
+
+#include "../include/gpu_bpm_primitives.h"
+
+/************************************************************
+Functions to pack the tiles and the reference (2 bits per base)
+************************************************************/
+
+uint64_t gpu_bpm_filter_hamming_spread(const uint32_t bitmap)
+{
+  // Spreads 32 query positions (1 bit) to the even bits of the packed bases (2 bits)
+  uint64_t spread = bitmap;
+  spread = (spread | (spread << 16)) & 0x0000FFFF0000FFFFULL;
+  spread = (spread | (spread << 8))  & 0x00FF00FF00FF00FFULL;
+  spread = (spread | (spread << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+  spread = (spread | (spread << 2))  & 0x3333333333333333ULL;
+  spread = (spread | (spread << 1))  & GPU_BPM_FILTER_HAMMING_EVEN_BITS;
+  return(spread);
+}
+
+void gpu_bpm_filter_hamming_pack_query(const gpu_bpm_filter_qry_entry_t* const peq, const uint32_t tileSize,
+                                       gpu_bpm_filter_hamming_query_t* const query)
+{
+  const uint32_t numWords = GPU_DIV_CEIL(tileSize, GPU_BPM_FILTER_HAMMING_BASES_PER_WORD);
+  uint32_t idWord;
+  // The PEQ bitmaps are one-hot per position for the ACGT bases
+  for(idWord = 0; idWord < numWords; ++idWord){
+    const gpu_bpm_filter_qry_entry_t* const entry      = &peq[idWord / GPU_BPM_FILTER_PEQ_SUBENTRIES];
+    const uint32_t                          idSubEntry = idWord % GPU_BPM_FILTER_PEQ_SUBENTRIES;
+    const uint32_t                          bitmapA    = entry->bitmap[GPU_ENC_DNA_CHAR_A][idSubEntry];
+    const uint32_t                          bitmapC    = entry->bitmap[GPU_ENC_DNA_CHAR_C][idSubEntry];
+    const uint32_t                          bitmapG    = entry->bitmap[GPU_ENC_DNA_CHAR_G][idSubEntry];
+    const uint32_t                          bitmapT    = entry->bitmap[GPU_ENC_DNA_CHAR_T][idSubEntry];
+    const uint32_t                          anyBase    = bitmapA | bitmapC | bitmapG | bitmapT;
+    const uint32_t                          multiBase  = (bitmapA & (bitmapC | bitmapG | bitmapT)) | (bitmapC & (bitmapG | bitmapT)) | (bitmapG & bitmapT);
+    const uint32_t                          numBases   = tileSize - (idWord * GPU_BPM_FILTER_HAMMING_BASES_PER_WORD);
+    const uint32_t                          tileMask   = (numBases >= GPU_UINT32_LENGTH) ? GPU_UINT32_ONES : ((GPU_UINT32_MASK_ONE_LOW << numBases) - 1);
+    // Bases encoded as the plain reference (C = 01, G = 10, T = 11)
+    query->bases[idWord]      = gpu_bpm_filter_hamming_spread(bitmapC | bitmapT) | (gpu_bpm_filter_hamming_spread(bitmapG | bitmapT) << 1);
+    query->mismatches[idWord] = gpu_bpm_filter_hamming_spread(~(anyBase & ~multiBase) & tileMask);
+    query->active[idWord]     = gpu_bpm_filter_hamming_spread(tileMask);
+  }
+  query->numWords = numWords;
+}
+
+const gpu_bpm_filter_hamming_query_t* gpu_bpm_filter_hamming_get_query(const gpu_bpm_filter_queries_buffer_t* const qry, const uint32_t idQuery,
+                                                                       gpu_bpm_filter_hamming_cache_t* const cache)
+{
+  // Candidates walked by reference position interleave the tiles, the packed ones are kept by query id
+  const uint32_t                  idSlot = idQuery % GPU_BPM_FILTER_HAMMING_QUERY_CACHE;
+  const gpu_bpm_filter_qry_info_t* qinfo = &qry->h_qinfo[idQuery];
+  if(cache->idQuery[idSlot] != idQuery){
+    gpu_bpm_filter_hamming_pack_query(qry->h_queries + qinfo->posEntry, qinfo->tileSize, &cache->query[idSlot]);
+    cache->idQuery[idSlot] = idQuery;
+  }
+  return(&cache->query[idSlot]);
+}
+
+uint64_t gpu_bpm_filter_hamming_text(const gpu_reference_buffer_t* const reference, const uint64_t position)
+{
+  // 32 packed reference bases starting at any position (the request can span 2 entries)
+  const uint64_t idEntry   = position / GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY;
+  const uint32_t shiftBits = (position % GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) * GPU_REFERENCE_PLAIN__CHAR_LENGTH;
+  uint64_t text = gpu_reference_get_entry_plain(reference, idEntry) >> shiftBits;
+  if(shiftBits != 0) text |= gpu_reference_get_entry_plain(reference, idEntry + 1) << (GPU_REFERENCE_PLAIN__ENTRY_LENGTH - shiftBits);
+  return(text);
+}
+
+/************************************************************
+Functions to resolve the ungapped candidates
+************************************************************/
+
+uint32_t gpu_bpm_filter_hamming_diagonal(const gpu_reference_buffer_t* const reference, const gpu_bpm_filter_hamming_query_t* const query,
+                                         const uint64_t position, const uint32_t maxDistance)
+{
+  uint32_t idWord, distance = 0;
+  // Word-parallel XOR/popcount (stops as soon as the distance exceeds the bound)
+  for(idWord = 0; (idWord < query->numWords) && (distance <= maxDistance); ++idWord){
+    const uint64_t text       = gpu_bpm_filter_hamming_text(reference, position + (idWord * GPU_BPM_FILTER_HAMMING_BASES_PER_WORD));
+    const uint64_t diff       = query->bases[idWord] ^ text;
+    const uint64_t mismatches = ((diff | (diff >> 1)) & GPU_BPM_FILTER_HAMMING_EVEN_BITS) | query->mismatches[idWord];
+    distance += __builtin_popcountll(mismatches & query->active[idWord]);
+  }
+  return(distance);
+}
+
+bool gpu_bpm_filter_hamming_candidate(const gpu_reference_buffer_t* const reference, const gpu_bpm_filter_hamming_query_t* const query,
+                                      const gpu_bpm_filter_cand_info_t* const candidate, const uint32_t tileSize, const uint32_t maxError,
+                                      gpu_bpm_filter_alg_entry_t* const alignment)
+{
+  // Only the distances that no gapped alignment can improve are resolved, the rest are left to Myers
+  const uint32_t maxDistance  = GPU_MIN(maxError, GPU_BPM_FILTER_HAMMING_MAX_EXACT_DISTANCE);
+  const uint32_t numDiagonals = candidate->size - tileSize + 1;
+  uint32_t idDiagonal, minDistance = maxDistance + 1, minColumn = 0;
+  // Best diagonal of the candidate (the first one on ties, as the Myers minimum column)
+  for(idDiagonal = 0; (idDiagonal < numDiagonals) && (minDistance != 0); ++idDiagonal){
+    const uint32_t distance = gpu_bpm_filter_hamming_diagonal(reference, query, candidate->position + idDiagonal, minDistance - 1);
+    if(distance < minDistance){
+      minDistance = distance;
+      minColumn   = idDiagonal + tileSize - 1;
+    }
+  }
+  if(minDistance > maxDistance) return(false);
+  // Without an exact diagonal no gapped alignment scores below 1 (the Hamming distance is the edit distance)
+  alignment->column = minColumn;
+  alignment->score  = minDistance;
+  return(true);
+}
+
+gpu_error_t gpu_bpm_filter_hamming_prefilter(gpu_buffer_t* const mBuff)
+{
+  const gpu_reference_buffer_t* const             reference = mBuff->reference;
+  const gpu_bpm_filter_queries_buffer_t* const    qry       = &mBuff->data.fbpm.queries;
+  const gpu_bpm_filter_candidates_buffer_t* const cand      = &mBuff->data.fbpm.candidates;
+  gpu_bpm_filter_alignments_buffer_t* const       res       = &mBuff->data.fbpm.alignments;
+  const gpu_bpm_filter_alg_entry_t                pending   = {GPU_BPM_FILTER_SCORE_INF, GPU_BPM_FILTER_SCORE_INF};
+  gpu_bpm_filter_hamming_cache_t cache;
+  gpu_reference_nruns_cursor_t   cursor;
+  const uint32_t* const                           order     = mBuff->data.fbpm.h_localityOrder;
+  uint32_t idOrder, idCandidate, idSlot, numResolved = 0;
+  mBuff->data.fbpm.numResolvedCandidates = 0;
+  // The packed reference has to be kept in the host
+  if(reference->h_reference_plain == NULL) return(SUCCESS);
+  gpu_reference_nruns_init_cursor(&cursor);
+  for(idSlot = 0; idSlot < GPU_BPM_FILTER_HAMMING_QUERY_CACHE; ++idSlot)
+    cache.idQuery[idSlot] = GPU_UINT32_ONES;
+  // Nearby candidates share the reference lines (and the N runs cursor) when walked by position
+  for(idOrder = 0; idOrder < cand->numCandidates; ++idOrder){
+    const gpu_bpm_filter_cand_info_t* candidate = NULL;
+    const gpu_bpm_filter_qry_info_t*  qinfo     = NULL;
+    idCandidate = (order != NULL) ? order[idOrder] : idOrder;
+    candidate   = &cand->h_candidates[idCandidate];
+    qinfo       = &qry->h_qinfo[candidate->query];
+    res->h_alignments[idCandidate] = pending;
+    // Same bounds than the Myers kernel, windows with non-bases fall through to Myers
+    if((candidate->position >= reference->size) || ((reference->size - candidate->position) <= candidate->size)) continue;
+    if((qinfo->tileSize == 0) || (qinfo->tileSize > GPU_BPM_FILTER_CUTOFF_MAX_TILE_LENGHT) || (candidate->size < qinfo->tileSize)) continue;
+    if(gpu_reference_window_has_N(reference, candidate->position, candidate->size, &cursor)) continue;
+    if(gpu_bpm_filter_hamming_candidate(reference, gpu_bpm_filter_hamming_get_query(qry, candidate->query, &cache),
+                                        candidate, qinfo->tileSize, qinfo->tileMaxError, &res->h_alignments[idCandidate]))
+      numResolved++;
+  }
+  mBuff->data.fbpm.numResolvedCandidates = numResolved;
+  gpu_stats_add_prefilter(&mBuff->stats, numResolved);
+  // Succeed
+  return (SUCCESS);
+}
+
+#endif /* GPU_BPM_FILTER_HAMMING_C_ */
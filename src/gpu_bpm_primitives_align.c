@@ -170,9 +170,8 @@ void gpu_bpm_align_reallocate_device_buffer_layout(gpu_buffer_t* mBuff)
 }
 
 
-void gpu_bpm_align_init_buffer_(void* const bpmBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+void gpu_bpm_align_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
 {
-  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) bpmBuffer;
   const double        sizeBuff                = mBuff->sizeBuffer * 0.95;
   const uint32_t      averageNumPEQEntries    = GPU_DIV_CEIL(averageQuerySize, GPU_BPM_ALIGN_PEQ_ENTRY_LENGTH);
   const uint32_t      averageCigarSize        = averageQuerySize + 1;
@@ -181,6 +180,7 @@ void gpu_bpm_align_init_buffer_(void* const bpmBuffer, const uint32_t averageQue
   const uint32_t      maxCandidates           = numInputs;
   //set the type of the buffer
   mBuff->typeBuffer = GPU_BPM_ALIGN;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
   //Set real size of the input
   mBuff->data.abpm.maxCandidates     = maxCandidates;
   mBuff->data.abpm.maxCigars         = maxCandidates;
@@ -196,8 +196,23 @@ void gpu_bpm_align_init_buffer_(void* const bpmBuffer, const uint32_t averageQue
   mBuff->data.abpm.queryBinSize      = 0;
   mBuff->data.abpm.queryBinning      = true;
   // Set the corresponding buffer layout
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_bpm_align_reallocate_host_buffer_layout(mBuff);
   gpu_bpm_align_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_bpm_align_init_buffer_(void* const bpmBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+{
+  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) bpmBuffer;
+  uint32_t            tunedQuerySize          = averageQuerySize;
+  uint32_t            tunedCandidatesPerQuery = candidatesPerQuery;
+  // The observed workload replaces the caller estimations once the autotuner has a full window
+  mBuff->typeBuffer = GPU_BPM_ALIGN;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, &tunedCandidatesPerQuery);
+  gpu_bpm_align_set_buffer_layout(mBuff, tunedQuerySize, tunedCandidatesPerQuery);
 }
 
 void gpu_bpm_align_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t totalPEQEntries, const uint32_t totalQueryBases,
@@ -208,7 +223,7 @@ void gpu_bpm_align_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t tota
   const uint32_t averageQuerySize       = GPU_DIV_CEIL(totalQueryBases, totalQueries);
   const uint32_t candidatesPerQuery     = GPU_DIV_CEIL(totalCandidates, totalQueries);
   // Re-map the buffer layout with new information trying to fit better
-  gpu_bpm_align_init_buffer_(bpmBuffer, averageQuerySize, candidatesPerQuery);
+  gpu_bpm_align_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   // Checking if we need to reallocate a bigger buffer
   if( (totalPEQEntries     > gpu_bpm_align_buffer_get_max_peq_entries_(bpmBuffer))     ||
       (totalQueryBases     > gpu_bpm_align_buffer_get_max_query_bases_(bpmBuffer))     ||
@@ -221,6 +236,7 @@ void gpu_bpm_align_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t tota
     //printf("RESIZE[BPM_ALIGN] %d %d \n",  mBuff->sizeBuffer, bytesPerBPMBuffer * resizeFactor);
     //Recalculate the minimum buffer size
     mBuff->sizeBuffer = bytesPerBPMBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
     //FREE HOST AND DEVICE BUFFER
     GPU_ERROR(gpu_buffer_free(mBuff));
     //Select the device of the Multi-GPU platform
@@ -229,7 +245,7 @@ void gpu_bpm_align_init_and_realloc_buffer_(void *bpmBuffer, const uint32_t tota
     CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
     CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
     // Re-map the buffer layout with the new size
-    gpu_bpm_align_init_buffer_(bpmBuffer, averageQuerySize, candidatesPerQuery);
+    gpu_bpm_align_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   }
 }
 
@@ -346,35 +362,47 @@ gpu_error_t gpu_bpm_align_transfer_CPU_to_GPU(gpu_buffer_t *mBuff)
   cpySize += res->numCigars * sizeof(gpu_bpm_align_cigar_info_t);
   cpySize += res->numCigarEntries * sizeof(gpu_bpm_align_cigar_entry_t);
   bufferUtilization = (double)cpySize / (double)mBuff->sizeBuffer;
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Compacting transferences with high buffer occupation
   if(bufferUtilization > 0.15){
     cpySize  = ((void *) (res->d_cigarsInfo + res->numCigars)) - ((void *) qry->d_queries);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }else{
     // Transfer Binary Queries to GPU
     cpySize = qry->totalQueriesBases * sizeof(gpu_bpm_align_qry_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer to GPU the information associated with raw Queries
     cpySize = qry->totalQueriesPEQs * sizeof(gpu_bpm_align_peq_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_peq, qry->h_peq, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer to GPU the information associated with query information
     cpySize = qry->numQueries * sizeof(gpu_bpm_align_qry_info_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_qinfo, qry->h_qinfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer Candidates to GPU info
     cpySize = cand->numCandidates * sizeof(gpu_bpm_align_cand_info_t);
     CUDA_ERROR(cudaMemcpyAsync(cand->d_candidatesInfo, cand->h_candidatesInfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer reordered buffer to GPU
     cpySize = rebuff->threadMapScheduler.elementsPerBuffer * sizeof(uint32_t);
     CUDA_ERROR(cudaMemcpyAsync(rebuff->threadMapScheduler.d_reorderBuffer, rebuff->threadMapScheduler.h_reorderBuffer, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer bucket information to GPU
     cpySize = rebuff->numBuckets * sizeof(uint32_t);
     CUDA_ERROR(cudaMemcpyAsync(rebuff->d_initPosPerBucket, rebuff->h_initPosPerBucket, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     CUDA_ERROR(cudaMemcpyAsync(rebuff->d_initWarpPerBucket, rebuff->h_initWarpPerBucket, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     CUDA_ERROR(cudaMemcpyAsync(rebuff->d_endPosPerBucket, rebuff->h_endPosPerBucket, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer intermediate cigar info
     cpySize = res->numCigars * sizeof(gpu_bpm_align_cigar_info_t);
     CUDA_ERROR(cudaMemcpyAsync(res->d_cigarsInfo, res->h_cigarsInfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Succeed
   return (SUCCESS);
 }
@@ -387,7 +415,10 @@ gpu_error_t gpu_bpm_align_transfer_GPU_to_CPU(gpu_buffer_t *mBuff)
   size_t                          cpySize;
   // Avoiding transferences of the intermediate results (binning input work regularization)
   cpySize = ((void *) (res->d_cigars + res->numCigarEntries)) - ((void *) res->d_cigarsInfo);
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(res->h_cigarsInfo, res->d_cigarsInfo, cpySize, cudaMemcpyDeviceToHost, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
+  gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   // Succeed
   return (SUCCESS);
 }
@@ -395,6 +426,7 @@ gpu_error_t gpu_bpm_align_transfer_GPU_to_CPU(gpu_buffer_t *mBuff)
 void gpu_bpm_align_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEntries, const uint32_t numQueryBases,
                                 const uint32_t numQueries, const uint32_t numCandidates, const uint32_t queryBinSize)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff                      = (gpu_buffer_t *) bpmBuffer;
   const uint32_t    idSupDevice                  = mBuff->idSupportedDevice;
   uint32_t          idCandidate, numCigarEntries = 0;
@@ -416,15 +448,23 @@ void gpu_bpm_align_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEntr
     numCigarEntries += mBuff->data.abpm.queries.h_qinfo[idQuery].size + 1;
   }
   mBuff->data.abpm.cigars.numCigarEntries = numCigarEntries;
+  gpu_stats_add_submission(&mBuff->stats, numCandidates, mBuff->data.abpm.maxCandidates);
+  gpu_buffer_balance_submit(mBuff, numCandidates);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numQueryBases, numCandidates);
   // Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   // CPU->GPU Transfers & Process Kernel in Asynchronous way
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
   GPU_ERROR(gpu_bpm_align_reordering_buffer(mBuff));
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
   GPU_ERROR(gpu_bpm_align_transfer_CPU_to_GPU(mBuff));
   /* INCLUDED SUPPORT for future GPUs with PTX ASM code (JIT compiling) */
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_bpm_align_process_buffer(mBuff));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   // GPU->CPU Transfers
   GPU_ERROR(gpu_bpm_align_transfer_GPU_to_CPU(mBuff));
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "bpm_align send", timeSend);
 }
 
 /************************************************************
@@ -433,6 +473,7 @@ Functions to receive & process a BPM buffer from GPU
 
 void gpu_bpm_align_receive_buffer_(void* const bpmBuffer)
 {
+  const double timeReceive = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff       = (gpu_buffer_t *) bpmBuffer;
   const uint32_t      idSupDevice = mBuff->idSupportedDevice;
   const cudaStream_t  idStream    = mBuff->listStreams[mBuff->idStream];
@@ -440,6 +481,113 @@ void gpu_bpm_align_receive_buffer_(void* const bpmBuffer)
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   // Synchronize Stream (the thread wait for the commands done in the stream)
   CUDA_ERROR(cudaStreamSynchronize(idStream));
+  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "bpm_align receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_bpm_align_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_bpm_align_qry_info_t* const qryInfo,
+                                        const gpu_bpm_align_cand_info_t* const candidates, const uint32_t numCandidates,
+                                        uint32_t* const idFirstQuery, uint32_t* const idLastQuery, uint32_t* const numCigarEntries)
+{
+  const uint32_t maxCandidates   = GPU_MIN(mBuff->data.abpm.maxCandidates, mBuff->data.abpm.maxCigars);
+  const uint32_t maxQueries      = mBuff->data.abpm.maxQueries;
+  const uint32_t maxQueryBases   = mBuff->data.abpm.maxQueryBases;
+  const uint32_t maxPEQEntries   = mBuff->data.abpm.maxPEQEntries;
+  const uint32_t maxCigarEntries = mBuff->data.abpm.maxCigarEntries;
+  uint32_t idCandidate;
+  (* numCigarEntries) = 0;
+  // Greedy growth of the sub-batch (the queries referenced by the candidates are sent as a contiguous window)
+  for(idCandidate = 0; (idCandidate < numCandidates) && (idCandidate < maxCandidates); ++idCandidate){
+    const uint32_t idQuery       = candidates[idCandidate].idQuery;
+    const uint32_t firstQuery    = (idCandidate == 0) ? idQuery : GPU_MIN((* idFirstQuery), idQuery);
+    const uint32_t lastQuery     = (idCandidate == 0) ? idQuery : GPU_MAX((* idLastQuery), idQuery);
+    const uint32_t numQueryBases = qryInfo[lastQuery].posEntryBase + qryInfo[lastQuery].size - qryInfo[firstQuery].posEntryBase;
+    const uint32_t numPEQEntries = qryInfo[lastQuery].posEntryPEQ + GPU_DIV_CEIL(qryInfo[lastQuery].size, GPU_BPM_ALIGN_PEQ_ENTRY_LENGTH)
+                                   - qryInfo[firstQuery].posEntryPEQ;
+    const uint32_t numEntries    = (* numCigarEntries) + qryInfo[idQuery].size + 1;
+    if(((lastQuery - firstQuery + 1) > maxQueries) || (numQueryBases > maxQueryBases) ||
+       (numPEQEntries > maxPEQEntries) || (numEntries > maxCigarEntries)) break;
+    (* idFirstQuery)    = firstQuery;
+    (* idLastQuery)     = lastQuery;
+    (* numCigarEntries) = numEntries;
+  }
+  return(idCandidate);
+}
+
+void gpu_bpm_align_receive_batch_(void* const bpmBuffer)
+{
+  gpu_buffer_t* const                  mBuff      = (gpu_buffer_t *) bpmBuffer;
+  const gpu_buffer_batch_t*            batch      = &mBuff->batch;
+  const gpu_bpm_align_cigars_buffer_t* res        = &mBuff->data.abpm.cigars;
+  gpu_bpm_align_cigar_info_t* const    cigarsInfo = (gpu_bpm_align_cigar_info_t *) batch->h_results;
+  gpu_bpm_align_cigar_entry_t* const   cigars     = (gpu_bpm_align_cigar_entry_t *) batch->h_entries;
+  uint32_t idCandidate;
+  gpu_bpm_align_receive_buffer_(bpmBuffer);
+  if(!batch->pending) return;
+  // Concatenate the results of the sub-batch in the caller arrays (rebasing the cigar positions)
+  for(idCandidate = 0; idCandidate < batch->numElements; ++idCandidate){
+    gpu_bpm_align_cigar_info_t* const cigarInfo = &cigarsInfo[batch->offset + idCandidate];
+    (* cigarInfo)                   = res->h_cigarsInfo[idCandidate];
+    cigarInfo->offsetCigarStart    += batch->offsetEntries;
+    cigarInfo->cigarStartPos       += batch->offsetEntries;
+  }
+  memcpy(cigars + batch->offsetEntries, res->h_cigars, batch->numEntries * sizeof(gpu_bpm_align_cigar_entry_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_bpm_align_send_batch_(void* const bpmBuffer, const gpu_bpm_align_qry_entry_t* const queries, const gpu_bpm_align_peq_entry_t* const peqEntries,
+                               const gpu_bpm_align_qry_info_t* const qryInfo, const gpu_bpm_align_cand_info_t* const candidates,
+                               const uint32_t numCandidates, const uint32_t queryBinSize,
+                               gpu_bpm_align_cigar_info_t* const cigarsInfo, gpu_bpm_align_cigar_entry_t* const cigars)
+{
+  gpu_buffer_t* const                mBuff        = (gpu_buffer_t *) bpmBuffer;
+  gpu_bpm_align_queries_buffer_t*    qry          = &mBuff->data.abpm.queries;
+  gpu_bpm_align_candidates_buffer_t* cand         = &mBuff->data.abpm.candidates;
+  uint32_t                           offset       = 0, numSubBatches = 0;
+  uint32_t                           cigarOffset  = 0;
+  // All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t idFirstQuery = 0, idLastQuery = 0, numSubQueries = 0, numSubBases = 0, numSubPEQEntries = 0, numSubCigarEntries = 0;
+    uint32_t baseOffset = 0, entryOffset = 0, idQuery, idCandidate;
+    const uint32_t numSubCandidates = gpu_bpm_align_batch_candidates(mBuff, qryInfo, candidates + offset, numCandidates - offset,
+                                                                     &idFirstQuery, &idLastQuery, &numSubCigarEntries);
+    // Sanity-check (the buffer can not hold a single candidate and its query)
+    if((numSubCandidates == 0) && (offset < numCandidates)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    // Gather the sub-batch in the buffer (rebasing the query references)
+    if(numSubCandidates != 0){
+      baseOffset       = qryInfo[idFirstQuery].posEntryBase;
+      entryOffset      = qryInfo[idFirstQuery].posEntryPEQ;
+      numSubQueries    = idLastQuery - idFirstQuery + 1;
+      numSubBases      = qryInfo[idLastQuery].posEntryBase + qryInfo[idLastQuery].size - baseOffset;
+      numSubPEQEntries = qryInfo[idLastQuery].posEntryPEQ + GPU_DIV_CEIL(qryInfo[idLastQuery].size, GPU_BPM_ALIGN_PEQ_ENTRY_LENGTH) - entryOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_bpm_align_qry_entry_t));
+    memcpy(qry->h_peq, peqEntries + entryOffset, numSubPEQEntries * sizeof(gpu_bpm_align_peq_entry_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_qinfo[idQuery]               = qryInfo[idFirstQuery + idQuery];
+      qry->h_qinfo[idQuery].posEntryBase -= baseOffset;
+      qry->h_qinfo[idQuery].posEntryPEQ  -= entryOffset;
+    }
+    for(idCandidate = 0; idCandidate < numSubCandidates; ++idCandidate){
+      cand->h_candidatesInfo[idCandidate]          = candidates[offset + idCandidate];
+      cand->h_candidatesInfo[idCandidate].idQuery -= idFirstQuery;
+    }
+    gpu_bpm_align_send_buffer_(bpmBuffer, numSubPEQEntries, numSubBases, numSubQueries, numSubCandidates, queryBinSize);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubCandidates, cigarOffset, numSubCigarEntries, cigarsInfo, cigars, NULL);
+    offset      += numSubCandidates;
+    cigarOffset += numSubCigarEntries;
+    numSubBatches++;
+    if(offset < numCandidates) gpu_bpm_align_receive_batch_(bpmBuffer);
+  } while(offset < numCandidates);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
 }
 
 #endif /* GPU_BPM_PRIMITIVES_ALIGN_C_ */
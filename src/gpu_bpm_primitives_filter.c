@@ -137,9 +137,8 @@ void gpu_bpm_filter_reallocate_device_buffer_layout(gpu_buffer_t* const mBuff)
   rawAlloc = (void *) (mBuff->data.fbpm.alignments.d_alignments + mBuff->data.fbpm.maxAlignments);
 }
 
-void gpu_bpm_filter_init_buffer_(void* const bpmBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+void gpu_bpm_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
 {
-  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) bpmBuffer;
   const double        sizeBuff                = mBuff->sizeBuffer * 0.95;
   const size_t        averageNumPEQEntries    = GPU_DIV_CEIL(averageQuerySize, GPU_BPM_FILTER_PEQ_ENTRY_LENGTH);
   const uint32_t      numInputs               = (uint32_t)(sizeBuff / gpu_bpm_filter_size_per_candidate(averageQuerySize, candidatesPerQuery));
@@ -147,6 +146,7 @@ void gpu_bpm_filter_init_buffer_(void* const bpmBuffer, const uint32_t averageQu
   const uint32_t      bucketPaddingCandidates = gpu_bpm_filter_candidates_for_binning_padding();
   //set the type of the buffer
   mBuff->typeBuffer = GPU_BPM_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
   //Set real size of the input
   mBuff->data.fbpm.maxCandidates    = maxCandidates;
   mBuff->data.fbpm.maxAlignments    = maxCandidates;
@@ -157,8 +157,23 @@ void gpu_bpm_filter_init_buffer_(void* const bpmBuffer, const uint32_t averageQu
   mBuff->data.fbpm.maxPendingTasks  = maxCandidates;
   mBuff->data.fbpm.maxBuckets       = GPU_BPM_FILTER_NUM_BUCKETS_FOR_BINNING;
   // Set the corresponding buffer layout
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_bpm_filter_reallocate_host_buffer_layout(mBuff);
   gpu_bpm_filter_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_bpm_filter_init_buffer_(void* const bpmBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+{
+  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) bpmBuffer;
+  uint32_t            tunedQuerySize          = averageQuerySize;
+  uint32_t            tunedCandidatesPerQuery = candidatesPerQuery;
+  // The observed workload replaces the caller estimations once the autotuner has a full window
+  mBuff->typeBuffer = GPU_BPM_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, &tunedCandidatesPerQuery);
+  gpu_bpm_filter_set_buffer_layout(mBuff, tunedQuerySize, tunedCandidatesPerQuery);
 }
 
 void gpu_bpm_filter_init_and_realloc_buffer_(void* const bpmBuffer, const uint32_t totalPEQEntries, const uint32_t totalCandidates, const uint32_t totalQueries)
@@ -169,7 +184,7 @@ void gpu_bpm_filter_init_and_realloc_buffer_(void* const bpmBuffer, const uint32
   const uint32_t averageQuerySize       = (totalPEQEntries * GPU_BPM_FILTER_PEQ_ENTRY_LENGTH) / totalQueries;
   const uint32_t candidatesPerQuery     = totalCandidates / totalQueries;
   // Remap the buffer layout with new information trying to fit better
-  gpu_bpm_filter_init_buffer_(bpmBuffer, averageQuerySize, candidatesPerQuery);
+  gpu_bpm_filter_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   // Checking if we need to reallocate a bigger buffer
   if( (totalPEQEntries > gpu_bpm_filter_buffer_get_max_peq_entries_(bpmBuffer)) ||
       (totalCandidates > gpu_bpm_filter_buffer_get_max_candidates_(bpmBuffer))  ||
@@ -181,6 +196,7 @@ void gpu_bpm_filter_init_and_realloc_buffer_(void* const bpmBuffer, const uint32
     //Recalculate the minimum buffer size
     //printf("RESIZE[BPM_FILTER] %d %d \n",  mBuff->sizeBuffer, bytesPerBPMBuffer * resizeFactor);
     mBuff->sizeBuffer = bytesPerBPMBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
     //FREE HOST AND DEVICE BUFFER
     GPU_ERROR(gpu_buffer_free(mBuff));
     //Select the device of the Multi-GPU platform
@@ -189,7 +205,7 @@ void gpu_bpm_filter_init_and_realloc_buffer_(void* const bpmBuffer, const uint32
     CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
     CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
     // Re-map the buffer layout with the new size
-    gpu_bpm_filter_init_buffer_(bpmBuffer, averageQuerySize, candidatesPerQuery);
+    gpu_bpm_filter_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   }
 }
 
@@ -300,6 +316,58 @@ gpu_error_t gpu_bpm_filter_reorder_process_cutoff(gpu_buffer_t* const mBuff)
   return (SUCCESS);
 }
 
+uint64_t gpu_bpm_filter_locality_key(const gpu_bpm_filter_cand_info_t* const candidate)
+{
+  return(candidate->position >> GPU_BPM_FILTER_LOCALITY_BASES_LOG2);
+}
+
+gpu_error_t gpu_bpm_filter_locality_ordering(gpu_buffer_t* const mBuff)
+{
+  const gpu_bpm_filter_candidates_buffer_t* const cand   = &mBuff->data.fbpm.candidates;
+  gpu_bpm_filter_cutoff_buffer_t* const           cutoff = &mBuff->data.fbpm.cutoff;
+  uint32_t *srcOrder = cutoff->h_pendingTasks_tmpSpace[0], *dstOrder = cutoff->h_pendingTasks_tmpSpace[1], *swap = NULL;
+  uint32_t histogram[GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS];
+  uint32_t idCandidate, idBucket, shift, offset;
+  uint64_t maxKey = 0, lastKey = 0;
+  bool     sorted = true;
+  mBuff->data.fbpm.h_localityOrder = NULL;
+  // The cutoff pending task lists are free out of the cutoff strategy (ping-pong space for the radix passes)
+  if(!GPU_BPM_FILTER_LOCALITY_ORDERING || (cand->numCandidates > mBuff->data.fbpm.maxPendingTasks)) return(SUCCESS);
+  if(cand->numCandidates < GPU_BPM_FILTER_LOCALITY_MIN_CANDIDATES) return(SUCCESS);
+  for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++){
+    const uint64_t key = gpu_bpm_filter_locality_key(&cand->h_candidates[idCandidate]);
+    sorted  = sorted && (key >= lastKey);
+    lastKey = key;
+    maxKey  = GPU_MAX(maxKey, key);
+  }
+  // Batches already walking the reference forward keep the caller order
+  if(sorted) return(SUCCESS);
+  for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++)
+    srcOrder[idCandidate] = idCandidate;
+  // LSD radix sort over the reference positions (just the digits in use, stable for the same line)
+  for(shift = 0; (shift < GPU_UINT64_LENGTH) && ((maxKey >> shift) != 0); shift += GPU_BPM_FILTER_LOCALITY_RADIX_BITS){
+    for(idBucket = 0; idBucket < GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS; idBucket++)
+      histogram[idBucket] = 0;
+    for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++){
+      idBucket = (gpu_bpm_filter_locality_key(&cand->h_candidates[idCandidate]) >> shift) & (GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS - 1);
+      histogram[idBucket]++;
+    }
+    for(idBucket = 0, offset = 0; idBucket < GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS; idBucket++){
+      const uint32_t numElements = histogram[idBucket];
+      histogram[idBucket] = offset;
+      offset += numElements;
+    }
+    for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++){
+      const uint32_t idSorted = srcOrder[idCandidate];
+      idBucket = (gpu_bpm_filter_locality_key(&cand->h_candidates[idSorted]) >> shift) & (GPU_BPM_FILTER_LOCALITY_RADIX_BUCKETS - 1);
+      dstOrder[histogram[idBucket]++] = idSorted;
+    }
+    swap = srcOrder; srcOrder = dstOrder; dstOrder = swap;
+  }
+  mBuff->data.fbpm.h_localityOrder = srcOrder;
+  // Succeed
+  return (SUCCESS);
+}
 
 gpu_error_t gpu_bpm_filter_reorder_process_full(gpu_buffer_t* const mBuff)
 {
@@ -310,7 +378,9 @@ gpu_error_t gpu_bpm_filter_reorder_process_full(gpu_buffer_t* const mBuff)
   gpu_scheduler_buffer_t* const             	  rebuff         = &mBuff->data.fbpm.reorderBuffer;
   //Initializing local data structures
   const uint32_t numBuckets = GPU_BPM_FILTER_NUM_BUCKETS_FOR_BINNING;
-  uint32_t  idBucket, idCandidate, idBuff;
+  const bool     prefilter  = (mBuff->data.fbpm.numResolvedCandidates != 0);
+  const uint32_t* const localityOrder = mBuff->data.fbpm.h_localityOrder;
+  uint32_t  idBucket, idCandidate, idOrder, idBuff;
   uint32_t  numThreadsPerQuery, numQueriesPerWarp;
   uint32_t  tmpBuckets[numBuckets], numCandidatesPerBucket[numBuckets], numWarpsPerBucket[numBuckets];
   uint32_t  elementsPerBuffer = 0;
@@ -326,8 +396,9 @@ gpu_error_t gpu_bpm_filter_reorder_process_full(gpu_buffer_t* const mBuff)
     numWarpsPerBucket[idBucket]           = 0;
     tmpBuckets[idBucket]                  = 0;
   }
-  // Fill buckets with elements per bucket
+  // Fill buckets with elements per bucket (candidates resolved by the prefilter are not scheduled)
   for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++){
+    if(prefilter && (res->h_alignments[idCandidate].score != GPU_BPM_FILTER_SCORE_INF)) continue;
     idBucket = (qry->h_qinfo[cand->h_candidates[idCandidate].query].tileSize - 1) / GPU_BPM_FILTER_PEQ_LENGTH_PER_CUDA_THREAD;
     idBucket = (idBucket < (rebuff->numBuckets - 1)) ? idBucket : (rebuff->numBuckets - 1);
     numCandidatesPerBucket[idBucket]++;
@@ -348,10 +419,12 @@ gpu_error_t gpu_bpm_filter_reorder_process_full(gpu_buffer_t* const mBuff)
     reorderBuffer[idBuff] = GPU_UINT32_ONES;
   // Set the number of real results in the reorder buffer
   res->numReorderedAlignments = elementsPerBuffer;
-  // Reorder by size the candidates
+  // Reorder by size the candidates (following the reference position order inside each bucket)
   for(idBucket = 0; idBucket < rebuff->numBuckets; idBucket++)
     tmpBuckets[idBucket] = rebuff->h_initPosPerBucket[idBucket];
-  for(idCandidate = 0; idCandidate < cand->numCandidates; idCandidate++){
+  for(idOrder = 0; idOrder < cand->numCandidates; idOrder++){
+    idCandidate = (localityOrder != NULL) ? localityOrder[idOrder] : idOrder;
+    if(prefilter && (res->h_alignments[idCandidate].score != GPU_BPM_FILTER_SCORE_INF)) continue;
     idBucket = (qry->h_qinfo[cand->h_candidates[idCandidate].query].tileSize - 1) / GPU_BPM_FILTER_PEQ_LENGTH_PER_CUDA_THREAD;
     if (idBucket < (rebuff->numBuckets - 1)){
       reorderBuffer[tmpBuckets[idBucket]] = idCandidate;
@@ -450,6 +523,7 @@ gpu_error_t gpu_bpm_filter_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff)
   cpySize += res->numAlignments * sizeof(gpu_bpm_filter_alg_entry_t);
   cpySize += res->numAlignments * sizeof(gpu_bpm_filter_alg_entry_t);
   bufferUtilization = (double)cpySize / (double)mBuff->sizeBuffer;
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Compacting transferences with high buffer occupation
   if(bufferUtilization > 0.15){
     if(mBuff->data.fbpm.activeCutOff){
@@ -458,26 +532,34 @@ gpu_error_t gpu_bpm_filter_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff)
       cpySize  = ((void *) (rebuff->d_initWarpPerBucket + rebuff->numBuckets)) - ((void *) qry->d_queries);
     }
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }else{
     // Transfer Binary Queries to GPU
     cpySize = qry->totalQueriesEntries * sizeof(gpu_bpm_filter_qry_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer to GPU the information associated with Binary Queries
     cpySize = qry->numQueries * sizeof(gpu_bpm_filter_qry_info_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_qinfo, qry->h_qinfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer Candidates to GPU
     cpySize = cand->numCandidates * sizeof(gpu_bpm_filter_cand_info_t);
     CUDA_ERROR(cudaMemcpyAsync(cand->d_candidates, cand->h_candidates, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     if(!mBuff->data.fbpm.activeCutOff){
       // Transfer reordered buffer to GPU
       cpySize = rebuff->threadMapScheduler.elementsPerBuffer * sizeof(uint32_t);
       CUDA_ERROR(cudaMemcpyAsync(rebuff->threadMapScheduler.d_reorderBuffer, rebuff->threadMapScheduler.h_reorderBuffer, cpySize, cudaMemcpyHostToDevice, idStream));
+      gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
       // Transfer bucket information to GPU
       cpySize = rebuff->numBuckets * sizeof(uint32_t);
       CUDA_ERROR(cudaMemcpyAsync(rebuff->d_initPosPerBucket, rebuff->h_initPosPerBucket, cpySize, cudaMemcpyHostToDevice, idStream));
+      gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
       CUDA_ERROR(cudaMemcpyAsync(rebuff->d_initWarpPerBucket, rebuff->h_initWarpPerBucket, cpySize, cudaMemcpyHostToDevice, idStream));
+      gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     }
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Succeed
   return (SUCCESS);
 }
@@ -487,13 +569,17 @@ gpu_error_t gpu_bpm_filter_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
   const cudaStream_t                              idStream =  mBuff->listStreams[mBuff->idStream];
   const gpu_bpm_filter_alignments_buffer_t* const res      = &mBuff->data.fbpm.alignments;
   // Avoiding transferences of the intermediate results (corner case: binning input work regularization)
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   if(mBuff->data.fbpm.queryBinning){
     const size_t cpySize = res->numReorderedAlignments * sizeof(gpu_bpm_filter_alg_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(res->h_reorderAlignments, res->d_reorderAlignments, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   }else{
     const size_t cpySize = res->numAlignments * sizeof(gpu_bpm_filter_alg_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(res->h_alignments, res->d_alignments, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   // Succeed
   return (SUCCESS);
 }
@@ -504,7 +590,10 @@ gpu_error_t gpu_bpm_filter_intermediate_data_transfer_CPU_to_GPU(gpu_buffer_t* c
   const cudaStream_t                  idStream  =  mBuff->listStreams[mBuff->idStream];
   // Intermediate data transference
   const size_t cpySize  = ((void *) (rebuff->d_initWarpPerBucket + rebuff->numBuckets)) - ((void *) rebuff->threadMapScheduler.d_reorderBuffer);
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(rebuff->threadMapScheduler.d_reorderBuffer, rebuff->threadMapScheduler.h_reorderBuffer, cpySize, cudaMemcpyHostToDevice, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
+  gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   // Succeed
   return (SUCCESS);
 }
@@ -515,7 +604,10 @@ gpu_error_t gpu_bpm_filter_intermediate_data_transfer_GPU_to_CPU(gpu_buffer_t* c
   gpu_bpm_filter_alignments_buffer_t *res      = &mBuff->data.fbpm.alignments;
   // Intermediate data transference
   const size_t cpySize = res->numReorderedAlignments * sizeof(gpu_bpm_filter_alg_entry_t);
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(res->h_reorderAlignments, res->d_reorderAlignments, cpySize, cudaMemcpyDeviceToHost, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
+  gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   // Succeed
   return (SUCCESS);
 }
@@ -613,6 +705,7 @@ gpu_error_t gpu_bpm_filter_init_alignments(gpu_buffer_t* const mBuff)
 void gpu_bpm_filter_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEntries, const uint32_t numQueries,
                           	  	 const uint32_t numCandidates, const uint32_t maxQuerySize, const uint32_t queryBinSize)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff                          = (gpu_buffer_t *) bpmBuffer;
   const uint32_t      idSupDevice                    = mBuff->idSupportedDevice;
   // Set real size of the internal data
@@ -624,8 +717,13 @@ void gpu_bpm_filter_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEnt
   mBuff->data.fbpm.queries.numQueries                = numQueries;
   mBuff->data.fbpm.candidates.numCandidates          = numCandidates;
   mBuff->data.fbpm.alignments.numAlignments          = numCandidates;
+  mBuff->data.fbpm.numResolvedCandidates             = 0;
+  mBuff->data.fbpm.h_localityOrder                   = NULL;
   // ReorderAlignments elements are allocated just for divergent size queries
   mBuff->data.fbpm.alignments.numReorderedAlignments = 0;
+  gpu_stats_add_submission(&mBuff->stats, numCandidates, mBuff->data.fbpm.maxCandidates);
+  gpu_buffer_balance_submit(mBuff, numCandidates);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, (uint64_t) numPEQEntries * GPU_BPM_FILTER_PEQ_ENTRY_LENGTH, numCandidates);
   // Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   // Inspect if all queries have 1 or more tiles and initialise cutoff
@@ -656,27 +754,51 @@ void gpu_bpm_filter_send_buffer_(void* const bpmBuffer, const uint32_t numPEQEnt
 	// Iterating to reduce the amount of tiles
 	while(mBuff->data.fbpm.cutoff.pendingTasks){
 	  // Generating the amount of necessary work
+	  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
 	  GPU_ERROR(gpu_bpm_filter_reordering_buffer(mBuff));
+	  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
+	  gpu_stats_add_cutoff_iteration(&mBuff->stats, mBuff->data.fbpm.reorderBuffer.taskMapScheduler.elementsPerBuffer);
 	  // Included support for future GPUs with PTX ASM code (JIT compiling)
 	  GPU_ERROR(gpu_bpm_filter_intermediate_data_transfer_CPU_to_GPU(mBuff));
+	  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
 	  GPU_ERROR(gpu_bpm_filter_process_buffer(mBuff));
+	  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
 	  GPU_ERROR(gpu_bpm_filter_intermediate_data_transfer_GPU_to_CPU(mBuff));
 	  // Host-Device synchronization
 	  GPU_ERROR(gpu_bpm_filter_device_synch(mBuff));
+	  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
 	  // Post-processing (re-arrange output scores and cutoff the alignment work)
+	  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_REORDER);
 	  GPU_ERROR(gpu_bpm_filter_reordering_alignments_cutoff(mBuff));
+	  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_REORDER);
       // Updating the cutoff keys
 	  GPU_ERROR(gpu_bpm_filter_schedule_work(mBuff));
 	}
   }else{
 	// CPU->GPU Transfers & Process Kernel in Asynchronous way
+	gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
+	// Candidates walked by reference position (shared by the host prefilter and the binning)
+	if(mBuff->hammingPrefilter || mBuff->data.fbpm.queryBinning)
+	  GPU_ERROR(gpu_bpm_filter_locality_ordering(mBuff));
+	if(mBuff->hammingPrefilter){
+	  // Ungapped candidates are resolved in the host, the rest are scheduled by the binning
+	  GPU_ERROR(gpu_bpm_filter_hamming_prefilter(mBuff));
+	  if(mBuff->data.fbpm.numResolvedCandidates != 0){
+	    mBuff->data.fbpm.queryBinning = true;
+	    mBuff->data.fbpm.queryBinSize = 0;
+	  }
+	}
 	GPU_ERROR(gpu_bpm_filter_reordering_buffer(mBuff));
+	gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_BINNING);
 	GPU_ERROR(gpu_bpm_filter_transfer_CPU_to_GPU(mBuff));
 	// Included support for future GPUs with PTX ASM code (JIT compiling)
+	GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
 	GPU_ERROR(gpu_bpm_filter_process_buffer(mBuff));
+	GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
 	// GPU->CPU Transfers
 	GPU_ERROR(gpu_bpm_filter_transfer_GPU_to_CPU(mBuff));
   }
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "bpm_filter send", timeSend);
 }
 
 /************************************************************
@@ -796,6 +918,7 @@ gpu_error_t gpu_bpm_filter_discard_alignments(gpu_buffer_t* const mBuff)
 
 void gpu_bpm_filter_receive_buffer_(void* const bpmBuffer)
 {
+  const double timeReceive = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff       = (gpu_buffer_t *) bpmBuffer;
   const uint32_t      idSupDevice = mBuff->idSupportedDevice;
   const cudaStream_t  idStream    = mBuff->listStreams[mBuff->idStream];
@@ -804,9 +927,14 @@ void gpu_bpm_filter_receive_buffer_(void* const bpmBuffer)
   if(!mBuff->data.fbpm.activeCutOff){
     //Synchronize Stream (the thread wait for the commands done in the stream)
     CUDA_ERROR(cudaStreamSynchronize(idStream));
+    GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
     //Reorder the final results
+    gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_REORDER);
     GPU_ERROR(gpu_bpm_filter_reordering_alignments(mBuff));
+    gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_REORDER);
   }
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "bpm_filter receive", timeReceive);
 }
 
 gpu_error_t gpu_bpm_filter_device_synch(gpu_buffer_t* const mBuff)
@@ -821,4 +949,96 @@ gpu_error_t gpu_bpm_filter_device_synch(gpu_buffer_t* const mBuff)
   return (SUCCESS);
 }
 
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_bpm_filter_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_bpm_filter_qry_info_t* const qryInfo,
+                                         const gpu_bpm_filter_cand_info_t* const candidates, const uint32_t numCandidates,
+                                         uint32_t* const idFirstQuery, uint32_t* const idLastQuery)
+{
+  const uint32_t maxCandidates = GPU_MIN(mBuff->data.fbpm.maxCandidates, mBuff->data.fbpm.maxAlignments);
+  const uint32_t maxQueries    = mBuff->data.fbpm.maxQueries;
+  const uint32_t maxPEQEntries = mBuff->data.fbpm.maxPEQEntries;
+  uint32_t idCandidate, firstQuery = 0, lastQuery = 0, numChainedCandidates = 0;
+  // Greedy growth of the sub-batch (the queries referenced by the candidates are sent as a contiguous window)
+  for(idCandidate = 0; (idCandidate < numCandidates) && (idCandidate < maxCandidates); ++idCandidate){
+    const uint32_t idQuery        = candidates[idCandidate].query;
+    const uint32_t nextFirstQuery = (idCandidate == 0) ? idQuery : GPU_MIN(firstQuery, idQuery);
+    const uint32_t nextLastQuery  = (idCandidate == 0) ? idQuery : GPU_MAX(lastQuery, idQuery);
+    const uint32_t numPEQEntries  = qryInfo[nextLastQuery].posEntry + GPU_DIV_CEIL(qryInfo[nextLastQuery].tileSize, GPU_BPM_FILTER_PEQ_ENTRY_LENGTH)
+                                    - qryInfo[nextFirstQuery].posEntry;
+    if(((nextLastQuery - nextFirstQuery + 1) > maxQueries) || (numPEQEntries > maxPEQEntries)) break;
+    // The tiles of a candidate are chained by the cutoff (the sub-batches only break between whole chains)
+    if(qryInfo[idQuery].idTile == 0){
+      numChainedCandidates = idCandidate;
+      (* idFirstQuery) = firstQuery;
+      (* idLastQuery)  = lastQuery;
+    }
+    firstQuery = nextFirstQuery;
+    lastQuery  = nextLastQuery;
+  }
+  // Closing the last chain
+  if((idCandidate == numCandidates) || (qryInfo[candidates[idCandidate].query].idTile == 0)){
+    numChainedCandidates = idCandidate;
+    (* idFirstQuery) = firstQuery;
+    (* idLastQuery)  = lastQuery;
+  }
+  return(numChainedCandidates);
+}
+
+void gpu_bpm_filter_receive_batch_(void* const bpmBuffer)
+{
+  gpu_buffer_t* const               mBuff      = (gpu_buffer_t *) bpmBuffer;
+  const gpu_buffer_batch_t*         batch      = &mBuff->batch;
+  gpu_bpm_filter_alg_entry_t* const alignments = (gpu_bpm_filter_alg_entry_t *) batch->h_results;
+  gpu_bpm_filter_receive_buffer_(bpmBuffer);
+  if(!batch->pending) return;
+  // Concatenate the results of the sub-batch in the caller arrays
+  memcpy(alignments + batch->offset, mBuff->data.fbpm.alignments.h_alignments, batch->numElements * sizeof(gpu_bpm_filter_alg_entry_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_bpm_filter_send_batch_(void* const bpmBuffer, const gpu_bpm_filter_qry_entry_t* const peqEntries, const gpu_bpm_filter_qry_info_t* const qryInfo,
+                                const gpu_bpm_filter_cand_info_t* const candidates, const uint32_t numCandidates, const uint32_t maxQuerySize,
+                                const uint32_t queryBinSize, gpu_bpm_filter_alg_entry_t* const alignments)
+{
+  gpu_buffer_t* const                 mBuff  = (gpu_buffer_t *) bpmBuffer;
+  gpu_bpm_filter_queries_buffer_t*    qry    = &mBuff->data.fbpm.queries;
+  gpu_bpm_filter_candidates_buffer_t* cand   = &mBuff->data.fbpm.candidates;
+  uint32_t                            offset = 0, numSubBatches = 0;
+  // All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t idFirstQuery = 0, idLastQuery = 0, numSubQueries = 0, numSubPEQEntries = 0, entryOffset = 0, idQuery, idCandidate;
+    const uint32_t numSubCandidates = gpu_bpm_filter_batch_candidates(mBuff, qryInfo, candidates + offset, numCandidates - offset,
+                                                                      &idFirstQuery, &idLastQuery);
+    // Sanity-check (the buffer can not hold a single candidate and its query)
+    if((numSubCandidates == 0) && (offset < numCandidates)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    // Gather the sub-batch in the buffer (rebasing the query references)
+    if(numSubCandidates != 0){
+      entryOffset      = qryInfo[idFirstQuery].posEntry;
+      numSubQueries    = idLastQuery - idFirstQuery + 1;
+      numSubPEQEntries = qryInfo[idLastQuery].posEntry + GPU_DIV_CEIL(qryInfo[idLastQuery].tileSize, GPU_BPM_FILTER_PEQ_ENTRY_LENGTH) - entryOffset;
+    }
+    memcpy(qry->h_queries, peqEntries + entryOffset, numSubPEQEntries * sizeof(gpu_bpm_filter_qry_entry_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_qinfo[idQuery]           = qryInfo[idFirstQuery + idQuery];
+      qry->h_qinfo[idQuery].posEntry -= entryOffset;
+    }
+    for(idCandidate = 0; idCandidate < numSubCandidates; ++idCandidate){
+      cand->h_candidates[idCandidate]        = candidates[offset + idCandidate];
+      cand->h_candidates[idCandidate].query -= idFirstQuery;
+    }
+    gpu_bpm_filter_send_buffer_(bpmBuffer, numSubPEQEntries, numSubQueries, numSubCandidates, maxQuerySize, queryBinSize);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubCandidates, 0, 0, alignments, NULL, NULL);
+    offset += numSubCandidates;
+    numSubBatches++;
+    if(offset < numCandidates) gpu_bpm_filter_receive_batch_(bpmBuffer);
+  } while(offset < numCandidates);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+}
+
 #endif /* GPU_BPM_PRIMITIVES_FILTER_C_ */
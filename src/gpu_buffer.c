@@ -32,7 +32,7 @@ uint32_t gpu_buffer_get_id_supported_device_(const void* const gpuBuffer)
 gpu_error_t gpu_buffer_free(gpu_buffer_t *mBuff)
 {
   if(mBuff->h_rawData != NULL){
-    CUDA_ERROR(cudaFreeHost(mBuff->h_rawData));
+    GPU_ERROR(gpu_hugepages_free(mBuff->h_rawData, GPU_PAGE_LOCKED));
     mBuff->h_rawData = NULL;
   }
 
@@ -44,6 +44,147 @@ gpu_error_t gpu_buffer_free(gpu_buffer_t *mBuff)
   return(SUCCESS);
 }
 
+gpu_error_t gpu_buffer_allocate(gpu_buffer_t* const mBuff)
+{
+  const int32_t idNode = mBuff->device[mBuff->idSupportedDevice]->numaNode;
+  //Pinned host pages are placed on the node of the device (DMA without crossing sockets)
+  GPU_ERROR(gpu_numa_set_preferred(idNode));
+  GPU_ERROR(gpu_hugepages_alloc_buffer(&mBuff->h_rawData, mBuff->sizeBuffer));
+  if(idNode != GPU_NUMA_NODE_ANY) GPU_ERROR(gpu_numa_set_default());
+  CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to keep the state of the split submissions
+************************************************************/
+
+void gpu_buffer_batch_reset(gpu_buffer_t* const mBuff)
+{
+  gpu_buffer_batch_t* const batch = &mBuff->batch;
+  batch->pending       = false;
+  batch->offset        = 0;
+  batch->numElements   = 0;
+  batch->offsetEntries = 0;
+  batch->numEntries    = 0;
+  batch->h_results     = NULL;
+  batch->h_entries     = NULL;
+  batch->h_entriesInfo = NULL;
+}
+
+void gpu_buffer_batch_set_pending(gpu_buffer_t* const mBuff, const uint32_t offset, const uint32_t numElements,
+                                  const uint32_t offsetEntries, const uint32_t numEntries,
+                                  void* const h_results, void* const h_entries, void* const h_entriesInfo)
+{
+  gpu_buffer_batch_t* const batch = &mBuff->batch;
+  batch->pending       = true;
+  batch->offset        = offset;
+  batch->numElements   = numElements;
+  batch->offsetEntries = offsetEntries;
+  batch->numEntries    = numEntries;
+  batch->h_results     = h_results;
+  batch->h_entries     = h_entries;
+  batch->h_entriesInfo = h_entriesInfo;
+}
+
+/************************************************************
+Functions to balance the buffers among the devices
+************************************************************/
+
+gpu_error_t gpu_buffer_balancer_init(gpu_buffer_t** const buffer, const uint32_t numBuffers)
+{
+  const uint32_t  numSupportedDevices = buffer[0]->device[0]->numSupportedDevices;
+  gpu_balancer_t* balancer            = NULL;
+  uint32_t        buffersPerDevice[numSupportedDevices], idSupportedDevice, idBuffer;
+  // The static split (relative performance) is the starting point of the runtime balancing
+  for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice)
+    buffersPerDevice[idSupportedDevice] = 0;
+  for(idBuffer = 0; idBuffer < numBuffers; ++idBuffer)
+    buffersPerDevice[buffer[idBuffer]->idSupportedDevice]++;
+  GPU_ERROR(gpu_balancer_init(&balancer, numSupportedDevices, buffersPerDevice));
+  for(idBuffer = 0; idBuffer < numBuffers; ++idBuffer)
+    buffer[idBuffer]->balancer = balancer;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_buffer_balancer_free(gpu_buffer_t** const buffer, const uint32_t numBuffers)
+{
+  gpu_balancer_t* balancer = buffer[0]->balancer;
+  uint32_t        idBuffer;
+  for(idBuffer = 0; idBuffer < numBuffers; ++idBuffer)
+    buffer[idBuffer]->balancer = NULL;
+  return(gpu_balancer_free(&balancer));
+}
+
+void gpu_buffer_balance_submit(gpu_buffer_t* const mBuff, const uint32_t numElements)
+{
+  if(mBuff->balancer == NULL) return;
+  mBuff->balancePending  = true;
+  mBuff->balanceElements = numElements;
+  gpu_balancer_submit(mBuff->balancer, mBuff->idSupportedDevice, mBuff->stats.idModule, gpu_sample_time());
+}
+
+void gpu_buffer_balance_complete(gpu_buffer_t* const mBuff)
+{
+  if((mBuff->balancer == NULL) || !mBuff->balancePending) return;
+  mBuff->balancePending = false;
+  gpu_balancer_complete(mBuff->balancer, mBuff->idSupportedDevice, mBuff->stats.idModule, mBuff->balanceElements, gpu_sample_time());
+}
+
+gpu_error_t gpu_buffer_migrate(gpu_buffer_t* const mBuff, const uint32_t idTargetDevice)
+{
+  gpu_device_info_t* const source = mBuff->device[mBuff->idSupportedDevice];
+  gpu_device_info_t* const target = mBuff->device[idTargetDevice];
+  cudaStream_t* const      stream = &mBuff->listStreams[mBuff->idBuffer];
+  const bool               rehome = (mBuff->h_rawData != NULL) && (source->numaNode != target->numaNode);
+  // Device resources of the buffer are released (the pinned host memory is portable among devices)
+  CUDA_ERROR(cudaSetDevice(source->idDevice));
+  CUDA_ERROR(cudaStreamSynchronize(*stream));
+  if(mBuff->d_rawData != NULL){
+    CUDA_ERROR(cudaFree(mBuff->d_rawData));
+    mBuff->d_rawData = NULL;
+  }
+  // Pinned host pages on a foreign node would make every transfer cross the sockets
+  if(rehome){
+    GPU_ERROR(gpu_hugepages_free(mBuff->h_rawData, GPU_PAGE_LOCKED));
+    mBuff->h_rawData = NULL;
+  }
+  CUDA_ERROR(cudaStreamDestroy(*stream));
+  GPU_ERROR(gpu_stats_free(&mBuff->stats));
+  // Re-created in the target device (the layout is carved again by the module initialization)
+  mBuff->idSupportedDevice = idTargetDevice;
+  CUDA_ERROR(cudaSetDevice(target->idDevice));
+  CUDA_ERROR(cudaStreamCreate(stream));
+  GPU_ERROR(gpu_stats_create_events(&mBuff->stats));
+  if(rehome){
+    GPU_ERROR(gpu_numa_bind_thread(target->numaNode));
+    GPU_ERROR(gpu_buffer_allocate(mBuff));
+  }else if(mBuff->h_rawData != NULL){
+    CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
+  }
+  gpu_stats_set_track(&mBuff->stats, mBuff->idBuffer, target->idDevice, mBuff->idStream);
+  gpu_stats_add_migration(&mBuff->stats);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_buffer_balance(gpu_buffer_t* const mBuff)
+{
+  uint32_t idTargetDevice;
+  // Only idle buffers owning their stream are moved
+  if((mBuff->balancer == NULL) || mBuff->balancePending || mBuff->batch.pending) return(SUCCESS);
+  if(mBuff->idStream != mBuff->idBuffer) return(SUCCESS);
+  idTargetDevice = gpu_balancer_migration(mBuff->balancer, mBuff->idSupportedDevice);
+  if(idTargetDevice == GPU_BALANCER_NO_MIGRATION) return(SUCCESS);
+  // The ownership is given back when the target device has no room for the buffer
+  if(gpu_device_get_free_memory(mBuff->device[idTargetDevice]->idDevice) < mBuff->sizeBuffer){
+    gpu_balancer_move(mBuff->balancer, idTargetDevice, mBuff->idSupportedDevice);
+    return(SUCCESS);
+  }
+  return(gpu_buffer_migrate(mBuff, idTargetDevice));
+}
+
 gpu_error_t gpu_buffer_get_min_memory_size(size_t *bytesPerBuffer)
 {
   const uint32_t averarageNumPEQEntries = 1;
@@ -115,6 +256,7 @@ gpu_error_t gpu_buffer_configuration(gpu_buffer_t* const mBuff, const uint32_t i
   mBuff->idBuffer           = idBuffer;
   mBuff->numBuffers         = numBuffers;
   mBuff->idSupportedDevice  = idSupportedDevice;
+  mBuff->idStream           = idBuffer;
   mBuff->device             = device;
   mBuff->sizeBuffer         = bytesPerBuffer;
   mBuff->typeBuffer         = GPU_NONE_MODULES;
@@ -122,13 +264,24 @@ gpu_error_t gpu_buffer_configuration(gpu_buffer_t* const mBuff, const uint32_t i
   /* Module structures */
   mBuff->index              = index;
   mBuff->reference          = reference;
+  mBuff->hammingPrefilter   = false;
+  /* Static split of the buffers among the devices */
+  mBuff->balancer           = NULL;
+  mBuff->balancePending     = false;
+  mBuff->balanceElements    = 0;
   /* Chunk of RAW memory for the buffer */
   mBuff->h_rawData          = NULL;
   mBuff->d_rawData          = NULL;
+  /* No split submission in flight */
+  gpu_buffer_batch_reset(mBuff);
+  /* Layouts carved from the caller estimations until the autotuner is enabled */
+  gpu_layout_init(&mBuff->layout, GPU_LAYOUT_TUNING_DISABLED);
   /* Set in which Device we create and initialize the structures */
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupportedDevice]->idDevice));
   /* Create the CUDA stream per each buffer */
   CUDA_ERROR(cudaStreamCreate(&listStreams[idBuffer]));
+  /* Performance counters */
+  GPU_ERROR(gpu_stats_init(&mBuff->stats));
   /* Suceed */
   return(SUCCESS);
 }
@@ -149,6 +302,10 @@ void gpu_init_buffers_(gpu_buffers_dto_t* const buff, gpu_index_dto_t* const raw
   gpu_reference_buffer_t    *reference            = NULL;
   gpu_index_buffer_t        *index                = NULL;
   gpu_device_info_t         **devices             = NULL;
+  bool                      attachedIndex         = false;
+  gpu_init_graph_t          initGraph;
+  double                    timeInit;
+  uint32_t                  idBuffer;
 
   /* Reference and index initialization */
   GPU_ERROR(gpu_reference_init(&reference, rawRef, numSupportedDevices, activeModules));
@@ -158,22 +315,39 @@ void gpu_init_buffers_(gpu_buffers_dto_t* const buff, gpu_index_dto_t* const raw
   GPU_ERROR(gpu_module_configure_system(reference, index, &devices, numBuffers, selectedArchitectures, userAllocOption,
                                         &sys->activatedModules, &sys->allocatedStructures));
   GPU_ERROR(gpu_device_setup_system(devices));
-
-  /* Allocate, transform and send reference to corresponding DEVICES */
-  GPU_ERROR(gpu_reference_load(reference, rawRef, reference->activeModules));
-  GPU_ERROR(gpu_reference_transfer_CPU_to_GPUs(reference, devices, reference->activeModules));
-
-  /* Allocate, transform and send index to corresponding DEVICES */
-  GPU_ERROR(gpu_index_load(index, rawIndex, index->activeModules));
-  GPU_ERROR(gpu_index_transfer_CPU_to_GPUs(index, devices, index->activeModules));
+  gpu_hugepages_set_policy(sys->hostPages, sys->hugePagesBuffers);
+  if(sys->numaAware) GPU_ERROR(gpu_device_set_numa_all(devices));
+
+  /* Map the structures published by another process (skips the load and the transforms, the reverse BWT is not published) */
+  if((sys->sharedIndex == GPU_SHARED_INDEX_ATTACH) && !gpu_index_is_bidirectional(index, index->activeModules))
+    attachedIndex = (gpu_shm_attach(sys->sharedIndexName, sys->sharedIndexTimeoutMs, reference, index) == SUCCESS);
+
+  /* Allocate, transform and send the reference and the index to the DEVICES (independent structures are overlapped) */
+  timeInit = gpu_sample_time();
+  gpu_init_graph_setup(&initGraph, reference, rawRef, index, rawIndex, devices, attachedIndex, sys->sharedIndex, sys->sharedIndexName);
+  GPU_ERROR(gpu_init_graph_run(&initGraph, sys->numInitThreads, sys->timeInitPhase));
+  sys->timeInit = gpu_sample_time() - timeInit;
+  if(sys->sharedIndex == GPU_SHARED_INDEX_PUBLISH)
+    GPU_ERROR(gpu_shm_publish_devices(devices, reference, index));
+  if(sys->numaAware) GPU_ERROR(gpu_index_build_numa_replicas(index, index->activeModules));
 
   /* Characterize all the system, create the buffers and balance the work along all DEVICES */
   GPU_ERROR(gpu_buffer_scheduling(&buffer, numBuffers, devices, reference, index, maxMbPerBuffer));
-
-  /* Freeing unused host structures */
-  GPU_ERROR(gpu_reference_free_unused_host(reference, devices, reference->activeModules));
+  for(idBuffer = 0; idBuffer < numBuffers; ++idBuffer){
+    gpu_layout_init(&buffer[idBuffer]->layout, buff->layoutTuningPeriod);
+    buffer[idBuffer]->hammingPrefilter = buff->bpmHammingPrefilter && (activeModules & GPU_BPM_FILTER);
+  }
+  if(buff->dynamicBalancing && (numSupportedDevices > 1))
+    GPU_ERROR(gpu_buffer_balancer_init(buffer, numBuffers));
+  if(activeModules & GPU_FMI_EXACT_SEARCH)
+    GPU_ERROR(gpu_fmi_cache_init(buff->maxMbSeedCache, numBuffers));
+
+  /* Freeing unused host structures (the Hamming prefilter and the text extraction read the host reference) */
+  if(!(buff->bpmHammingPrefilter && (activeModules & GPU_BPM_FILTER)) && !buff->hostReferenceText)
+    GPU_ERROR(gpu_reference_free_unused_host(reference, devices, reference->activeModules));
   GPU_ERROR(gpu_index_free_unused_host(index, devices, index->activeModules));
 
+  sys->hostPageSize = gpu_hugepages_get_page_size();
   buff->buffer = (void **) buffer;
 }
 
@@ -189,11 +363,15 @@ void gpu_destroy_buffers_(gpu_buffers_dto_t* buff)
   /* Free all the references */
   GPU_ERROR(gpu_reference_free(&mBuff[0]->reference, devices, mBuff[0]->reference->activeModules));
   GPU_ERROR(gpu_index_free(&mBuff[0]->index, devices, mBuff[0]->index->activeModules));
+  GPU_ERROR(gpu_shm_release());
+  GPU_ERROR(gpu_fmi_cache_free());
+  GPU_ERROR(gpu_buffer_balancer_free(mBuff, numBuffers));
 
   for(idBuffer = 0; idBuffer < numBuffers; idBuffer++){
     const uint32_t idSupDevice = mBuff[idBuffer]->idSupportedDevice;
     CUDA_ERROR(cudaSetDevice(devices[idSupDevice]->idDevice));
     GPU_ERROR(gpu_buffer_free(mBuff[idBuffer]));
+    GPU_ERROR(gpu_stats_free(&mBuff[idBuffer]->stats));
     CUDA_ERROR(cudaStreamDestroy(mBuff[idBuffer]->listStreams[idBuffer]));
   }
 
@@ -232,13 +410,16 @@ void gpu_alloc_buffer_(void* const gpuBuffer, const uint64_t idThread)
   mBuff->h_rawData = NULL;
   mBuff->d_rawData = NULL;
   mBuff->idStream  = idStream;
+  gpu_stats_set_track(&mBuff->stats, idBuffer, mBuff->device[idSupDevice]->idDevice, idStream);
+
+  //Pin the worker thread owning the buffer on the node of its device
+  GPU_ERROR(gpu_numa_bind_thread(mBuff->device[idSupDevice]->numaNode));
 
   //Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
 
   //ALLOCATE HOST AND DEVICE BUFFER
-  CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
-  CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
+  GPU_ERROR(gpu_buffer_allocate(mBuff));
 }
 
 void gpu_realloc_buffer_(void* const gpuBuffer, const float maxMbPerBuffer)
@@ -254,8 +435,7 @@ void gpu_realloc_buffer_(void* const gpuBuffer, const float maxMbPerBuffer)
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
 
   //ALLOCATE HOST AND DEVICE BUFFER
-  CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
-  CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
+  GPU_ERROR(gpu_buffer_allocate(mBuff));
 }
 
 #endif /* GPU_BUFFER_C_ */
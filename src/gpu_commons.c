@@ -53,4 +53,14 @@ bool gpu_is_pow_two(uint32_t value)
     return ((value != 0) && ((value & (value - 1)) == 0));
 }
 
+uint32_t gpu_get_num_workers(const uint32_t numThreads, const uint32_t numTasks, const uint32_t maxThreads)
+{
+  // Each buffer is already driven by its own application thread (the default adds no extra workers)
+  uint32_t threads = (numThreads != 0) ? numThreads : 1;
+  // There is no benefit in more threads than tasks
+  threads = GPU_MIN(threads, maxThreads);
+  threads = GPU_MIN(threads, numTasks);
+  return(GPU_MAX(threads, 1));
+}
+
 #endif /* GPU_COMMONS_C_ */
@@ -219,6 +219,17 @@ gpu_error_t gpu_device_set_local_memory_all(gpu_device_info_t **devices, enum cu
   return (SUCCESS);
 }
 
+gpu_error_t gpu_device_set_numa_all(gpu_device_info_t **devices)
+{
+  uint32_t idSupportedDevice, numSupportedDevices = devices[0]->numSupportedDevices;
+
+  for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
+    devices[idSupportedDevice]->numaNode = gpu_numa_get_device_node(devices[idSupportedDevice]->idDevice);
+  }
+
+  return (SUCCESS);
+}
+
 gpu_error_t gpu_device_fast_driver_awake()
 {
   //Dummy call to the NVIDIA API to awake earlier the driver.
@@ -265,6 +276,7 @@ gpu_error_t gpu_device_init(gpu_device_info_t **device, const uint32_t idDevice,
   dev->coreClockRate        = GPU_CONVERT_KHZ_TO_GHZ((float)devProp.clockRate);
   dev->memoryBusWidth       = GPU_CONVERT_BITS_TO_BYTES((float)devProp.memoryBusWidth);
   dev->memoryClockRate      = GPU_CONVERT_KHZ_TO_GHZ((float)devProp.memoryClockRate);
+  dev->numaNode             = GPU_NUMA_NODE_ANY;
 
   dev->absolutePerformance  = dev->cudaCores * dev->coreClockRate;
   dev->absoluteBandwidth    = 2.0 * dev->memoryClockRate * dev->memoryBusWidth; // GBytes/s
@@ -40,6 +40,10 @@ const char* gpuGetErrorString(gpu_error_t error)
     case E_OVERFLOWING_BUFFER:          return "GEM GPU - Error: overflowing elements per buffer";
     case E_FMI_TABLE_INCOMPATIBLE_SIZE: return "GEM GPU - Error: fmi table number of levels incompatible";
     case E_USE_CASE_NOT_ALLOWED:        return "GEM GPU - Error: use case not considered or allowed";
+    case E_SHARED_INDEX_NOT_FOUND:      return "GEM GPU - Error: shared index segment not available";
+    case E_SHARED_INDEX_INCOMPATIBLE:   return "GEM GPU - Error: shared index segment with incompatible layout";
+    case E_SHARED_INDEX_IN_USE:         return "GEM GPU - Error: shared index name held by a live publisher or another user";
+    case E_SAMPLING_RATE_MISMATCH:      return "GEM GPU - Error: sampling rate differs from the loaded SA";
     default:                            return "GEM GPU - Unknown error";
   }
 }
@@ -479,62 +479,6 @@ void __global__ gpu_fmi_asearch_table_kernel(const gpu_fmi_device_entry_t* const
   }
 }
 
-extern "C"
-gpu_error_t gpu_fmi_asearch_launch_kernel(const gpu_fmi_device_entry_t* const d_fmi, const uint64_t bwtSize, const gpu_fmi_table_format_t formatTable,
-                                          const uint64_t* const d_fmiTable, const uint2* const d_offsetsTable, const uint32_t skipLevels, const uint32_t maxLevels,
-                                          const char* const d_queries, const uint2* const d_queryInfo, const uint32_t numQueries,
-                                          uint2* const d_regions, ulonglong2* const d_regIntervals, uint2* const d_regOffset)
-{
-  //GPU thread configuration
-  const uint32_t threads = 128;
-  const uint32_t blocks  = GPU_DIV_CEIL(numQueries * GPU_FMI_THREADS_PER_QUERY, threads);
-  const uint32_t nreps   = 10;
-  //Search configuration
-  const uint32_t occShrinkFactor  =  GPU_FMI_D;
-  const uint32_t occThreshold     =  GPU_FMI_OCC_THRESHOLD;
-  const uint32_t maxExtraSteps    =  GPU_FMI_STEPS;
-  const uint32_t maxRegionsFactor =  GPU_FMI_RATIO_REGIONS;
-
-  float elapsed_time_ms = 0.0f;
-  cudaEvent_t start, stop;
-  cudaEventCreate(&start);
-  cudaEventCreate(&stop);
-  cudaEventRecord(start, 0);
-
-    for(uint32_t iteration = 0; iteration < nreps; ++iteration){
-      switch(formatTable){
-        case GPU_FMI_TABLE_DISABLED:
-          gpu_fmi_asearch_kernel<<<blocks,threads>>>(d_fmi, bwtSize, d_queries, d_queryInfo, numQueries,
-                                                     d_regions, d_regIntervals, d_regOffset,
-                                                     maxExtraSteps, occThreshold, occShrinkFactor, maxRegionsFactor);
-          break;
-        case GPU_FMI_TABLE_MULTILEVEL:
-          gpu_fmi_asearch_table_kernel<<<blocks,threads>>>(d_fmi, bwtSize, d_fmiTable, d_offsetsTable, skipLevels, maxLevels,
-                                                           d_queries, d_queryInfo, numQueries,
-                                                           d_regions, d_regIntervals, d_regOffset,
-                                                           maxExtraSteps, occThreshold, occShrinkFactor, maxRegionsFactor);
-        break;
-        case GPU_FMI_TABLE_MULTILEVEL_LINKED:
-          gpu_fmi_asearch_table_linked_kernel<<<blocks,threads>>>(d_fmi, bwtSize, d_fmiTable, d_offsetsTable, maxLevels,
-                                                                  d_queries, d_queryInfo, numQueries,
-                                                                  d_regions, d_regIntervals, d_regOffset,
-                                                                  maxExtraSteps, occThreshold, occShrinkFactor, maxRegionsFactor);
-        break;
-      }
-    }
-
-  cudaEventRecord(stop, 0);
-  cudaThreadSynchronize();
-  cudaEventElapsedTime(&elapsed_time_ms, start, stop);
-  elapsed_time_ms /= nreps;
-
-  cudaEventDestroy(start);
-  cudaEventDestroy(stop);
-  printf("\t Time Kernel GPU:  %8.2f ms\n", elapsed_time_ms);
-
-  return(SUCCESS);
-}
-
 extern "C"
 gpu_error_t gpu_fmi_asearch_process_buffer(gpu_buffer_t* const mBuff)
 {
@@ -563,8 +507,10 @@ gpu_error_t gpu_fmi_asearch_process_buffer(gpu_buffer_t* const mBuff)
   const uint32_t numThreads = numQueries * GPU_FMI_THREADS_PER_QUERY;
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
-  if((numQueries > numMaxQueries) || (numBases > numMaxBases))
+  if((numQueries > numMaxQueries) || (numBases > numMaxBases)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
+  }
 
   switch(table->formatTableLUT){
     case GPU_FMI_TABLE_DISABLED:
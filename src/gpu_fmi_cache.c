@@ -0,0 +1,245 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_CACHE_C_
+#define GPU_FMI_CACHE_C_
+
+#include "../include/gpu_fmi_cache.h"
+
+/* Process-wide cache shared by all the buffers and threads (all of them search the same index) */
+static gpu_fmi_cache_t gpu_fmi_cache = {false, 0, NULL};
+
+/************************************************************
+Functions to initialize and release the cache
+************************************************************/
+
+bool gpu_fmi_cache_is_active()
+{
+  return(gpu_fmi_cache.active);
+}
+
+gpu_error_t gpu_fmi_cache_init(const float maxMbCache, const uint32_t numBuffers)
+{
+  const size_t   bytesCache  = GPU_CONVERT_MB_TO__B(maxMbCache);
+  const uint64_t maxEntries  = bytesCache / (sizeof(gpu_fmi_cache_entry_t) + GPU_FMI_CACHE_SKETCH_ROWS);
+  uint64_t       numSets     = 1;
+  uint32_t       idLock;
+  if(gpu_fmi_cache.active || (maxEntries < GPU_FMI_CACHE_WAYS)) return(SUCCESS);
+  // The number of sets is a power of two (the set is selected with a mask of the hash)
+  while((numSets * 2 * GPU_FMI_CACHE_WAYS) <= maxEntries) numSets *= 2;
+  gpu_fmi_cache.numSets     = numSets;
+  gpu_fmi_cache.sketchWidth = numSets * GPU_FMI_CACHE_WAYS;
+  gpu_fmi_cache.agingPeriod = gpu_fmi_cache.sketchWidth * GPU_FMI_CACHE_AGING_FACTOR;
+  gpu_fmi_cache.numSamples  = 0;
+  gpu_fmi_cache.numBuffers  = numBuffers;
+  gpu_fmi_cache.entries     = (gpu_fmi_cache_entry_t *) calloc(gpu_fmi_cache.sketchWidth, sizeof(gpu_fmi_cache_entry_t));
+  gpu_fmi_cache.sketch      = (volatile uint8_t *) calloc(gpu_fmi_cache.sketchWidth * GPU_FMI_CACHE_SKETCH_ROWS, sizeof(uint8_t));
+  gpu_fmi_cache.batches     = (gpu_fmi_cache_batch_t *) calloc(numBuffers, sizeof(gpu_fmi_cache_batch_t));
+  if((gpu_fmi_cache.entries == NULL) || (gpu_fmi_cache.sketch == NULL) || (gpu_fmi_cache.batches == NULL))
+    return(E_ALLOCATE_MEM);
+  for(idLock = 0; idLock < GPU_FMI_CACHE_LOCKS; ++idLock)
+    pthread_mutex_init(&gpu_fmi_cache.locks[idLock], NULL);
+  gpu_fmi_cache.active = true;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_fmi_cache_free()
+{
+  uint32_t idBuffer, idLock;
+  if(!gpu_fmi_cache.active) return(SUCCESS);
+  gpu_fmi_cache.active = false;
+  for(idBuffer = 0; idBuffer < gpu_fmi_cache.numBuffers; ++idBuffer)
+    free(gpu_fmi_cache.batches[idBuffer].hits);
+  for(idLock = 0; idLock < GPU_FMI_CACHE_LOCKS; ++idLock)
+    pthread_mutex_destroy(&gpu_fmi_cache.locks[idLock]);
+  free(gpu_fmi_cache.batches);
+  free((void *) gpu_fmi_cache.sketch);
+  free(gpu_fmi_cache.entries);
+  gpu_fmi_cache.batches = NULL;
+  gpu_fmi_cache.sketch  = NULL;
+  gpu_fmi_cache.entries = NULL;
+  // Succeed
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to look up and admit the intervals
+************************************************************/
+
+uint64_t gpu_fmi_cache_hash(const gpu_fmi_search_seed_t* const seed)
+{
+  // Mixing of the two words of the packed seed (splitmix64 finalizer)
+  uint64_t hash = seed->hi ^ (seed->low * 0x9E3779B97F4A7C15ULL);
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+  return(hash ^ (hash >> 31));
+}
+
+volatile uint8_t* gpu_fmi_cache_counter(const uint64_t hash, const uint32_t idRow)
+{
+  // Double hashing to select an independent counter per row
+  const uint64_t step = (hash >> 17) | 1;
+  return(&gpu_fmi_cache.sketch[idRow * gpu_fmi_cache.sketchWidth + ((hash + idRow * step) & (gpu_fmi_cache.sketchWidth - 1))]);
+}
+
+uint32_t gpu_fmi_cache_estimate(const uint64_t hash)
+{
+  uint32_t idRow, frequency = GPU_FMI_CACHE_SKETCH_MAX;
+  for(idRow = 0; idRow < GPU_FMI_CACHE_SKETCH_ROWS; ++idRow)
+    frequency = GPU_MIN(frequency, (* gpu_fmi_cache_counter(hash, idRow)));
+  return(frequency);
+}
+
+void gpu_fmi_cache_sample(const uint64_t hash)
+{
+  uint64_t idCounter;
+  uint32_t idRow;
+  for(idRow = 0; idRow < GPU_FMI_CACHE_SKETCH_ROWS; ++idRow){
+    volatile uint8_t* const counter = gpu_fmi_cache_counter(hash, idRow);
+    uint8_t frequency = (* counter);
+    // Saturated increment (a plain check and add lets racing threads overflow the maximum)
+    while(frequency < GPU_FMI_CACHE_SKETCH_MAX){
+      const uint8_t previous = __sync_val_compare_and_swap(counter, frequency, frequency + 1);
+      if(previous == frequency) break;
+      frequency = previous;
+    }
+  }
+  // Aging of the frequencies (approximate: increments racing with the halving may be lost)
+  if((__sync_add_and_fetch(&gpu_fmi_cache.numSamples, 1) % gpu_fmi_cache.agingPeriod) == 0){
+    for(idCounter = 0; idCounter < gpu_fmi_cache.sketchWidth * GPU_FMI_CACHE_SKETCH_ROWS; ++idCounter)
+      gpu_fmi_cache.sketch[idCounter] >>= 1;
+  }
+}
+
+bool gpu_fmi_cache_lookup(const gpu_fmi_search_seed_t* const seed, gpu_sa_search_inter_t* const interval)
+{
+  const uint64_t                     hash  = gpu_fmi_cache_hash(seed);
+  const uint64_t                     idSet = (hash >> 32) & (gpu_fmi_cache.numSets - 1);
+  const gpu_fmi_cache_entry_t* const set   = &gpu_fmi_cache.entries[idSet * GPU_FMI_CACHE_WAYS];
+  pthread_mutex_t* const             lock  = &gpu_fmi_cache.locks[idSet % GPU_FMI_CACHE_LOCKS];
+  bool                               found = false;
+  uint32_t                           idWay;
+  // Every request counts for the admission, also the hits
+  gpu_fmi_cache_sample(hash);
+  pthread_mutex_lock(lock);
+  for(idWay = 0; idWay < GPU_FMI_CACHE_WAYS; ++idWay){
+    if((set[idWay].seed.hi == seed->hi) && (set[idWay].seed.low == seed->low)){
+      (* interval) = set[idWay].interval;
+      found = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(lock);
+  return(found);
+}
+
+void gpu_fmi_cache_admit(const gpu_fmi_search_seed_t* const seed, const gpu_sa_search_inter_t* const interval)
+{
+  const uint64_t               hash          = gpu_fmi_cache_hash(seed);
+  const uint64_t               idSet         = (hash >> 32) & (gpu_fmi_cache.numSets - 1);
+  const uint32_t               seedFrequency = gpu_fmi_cache_estimate(hash);
+  gpu_fmi_cache_entry_t* const set           = &gpu_fmi_cache.entries[idSet * GPU_FMI_CACHE_WAYS];
+  pthread_mutex_t* const       lock          = &gpu_fmi_cache.locks[idSet % GPU_FMI_CACHE_LOCKS];
+  gpu_fmi_cache_entry_t*       victim        = NULL;
+  uint32_t                     victimFrequency = UINT32_MAX, idWay;
+  pthread_mutex_lock(lock);
+  for(idWay = 0; idWay < GPU_FMI_CACHE_WAYS; ++idWay){
+    gpu_fmi_cache_entry_t* const entry = &set[idWay];
+    uint32_t frequency;
+    // Already admitted by another buffer (entries are never emptied, so the key is before the first empty way)
+    if((entry->seed.hi == seed->hi) && (entry->seed.low == seed->low)){
+      victim = NULL;
+      break;
+    }
+    if((entry->seed.hi == 0) && (entry->seed.low == 0)){
+      victim = entry;
+      victimFrequency = 0;
+      break;
+    }
+    frequency = gpu_fmi_cache_estimate(gpu_fmi_cache_hash(&entry->seed));
+    if(frequency < victimFrequency){
+      victim = entry;
+      victimFrequency = frequency;
+    }
+  }
+  // Heavy hitters are protected: the seed only replaces a victim requested less often (TinyLFU admission)
+  if((victim != NULL) && ((victimFrequency == 0) || (seedFrequency > victimFrequency))){
+    victim->seed     = (* seed);
+    victim->interval = (* interval);
+  }
+  pthread_mutex_unlock(lock);
+}
+
+/************************************************************
+Functions to resolve the submissions of a buffer
+************************************************************/
+
+uint32_t gpu_fmi_cache_filter(const uint32_t idBuffer, gpu_fmi_search_seed_t* const seeds, const uint32_t numSeeds,
+                              gpu_stats_buffer_t* const stats)
+{
+  gpu_fmi_cache_batch_t* batch = NULL;
+  uint32_t idSeed, numMisses = 0;
+  if(!gpu_fmi_cache.active) return(numSeeds);
+  batch = &gpu_fmi_cache.batches[idBuffer];
+  if(batch->maxHits < numSeeds){
+    free(batch->hits);
+    batch->hits = (gpu_fmi_cache_hit_t *) malloc(numSeeds * sizeof(gpu_fmi_cache_hit_t));
+    if(batch->hits == NULL) GPU_ERROR(E_ALLOCATE_MEM);
+    batch->maxHits = numSeeds;
+  }
+  // Hits are kept aside and the misses are compacted (in place) at the beginning of the buffer
+  batch->numHits = 0;
+  for(idSeed = 0; idSeed < numSeeds; ++idSeed){
+    gpu_fmi_cache_hit_t* const hit = &batch->hits[batch->numHits];
+    if(gpu_fmi_cache_lookup(&seeds[idSeed], &hit->interval)){
+      hit->position = idSeed;
+      hit->seed     = seeds[idSeed];
+      batch->numHits++;
+    }else{
+      seeds[numMisses++] = seeds[idSeed];
+    }
+  }
+  batch->numSeeds  = numSeeds;
+  batch->numMisses = numMisses;
+  gpu_stats_add_cache_lookups(stats, batch->numHits, numMisses);
+  return(numMisses);
+}
+
+uint32_t gpu_fmi_cache_merge(const uint32_t idBuffer, gpu_fmi_search_seed_t* const seeds, gpu_sa_search_inter_t* const intervals)
+{
+  gpu_fmi_cache_batch_t* batch = NULL;
+  uint32_t idSeed, idMiss, idHit, numSeeds;
+  if(!gpu_fmi_cache.active) return(0);
+  batch = &gpu_fmi_cache.batches[idBuffer];
+  numSeeds = batch->numSeeds;
+  // Admission of the intervals computed by the device
+  for(idMiss = 0; idMiss < batch->numMisses; ++idMiss)
+    gpu_fmi_cache_admit(&seeds[idMiss], &intervals[idMiss]);
+  // Restore the submitted order (in place, from the end: misses never move backwards)
+  idHit  = batch->numHits;
+  idMiss = batch->numMisses;
+  for(idSeed = numSeeds; idSeed-- > 0;){
+    if((idHit > 0) && (batch->hits[idHit - 1].position == idSeed)){
+      idHit--;
+      seeds[idSeed]     = batch->hits[idHit].seed;
+      intervals[idSeed] = batch->hits[idHit].interval;
+    }else{
+      idMiss--;
+      seeds[idSeed]     = seeds[idMiss];
+      intervals[idSeed] = intervals[idMiss];
+    }
+  }
+  batch->numSeeds  = 0;
+  batch->numMisses = 0;
+  batch->numHits   = 0;
+  return(numSeeds);
+}
+
+#endif /* GPU_FMI_CACHE_C_ */
@@ -71,39 +71,6 @@ void __global__ gpu_fmi_decoding_kernel(const gpu_fmi_device_entry_t* const fmi,
   }
 }
 
-extern "C"
-gpu_error_t gpu_fmi_decoding_launch_kernel(const gpu_fmi_device_entry_t* const d_fmi, const uint64_t bwtSize,
-                                           const uint32_t numDecodings, const uint64_t* const d_initBWTPos,
-                                           ulonglong2* const d_endBWTPos)
-{
-  const uint32_t samplingRate = 4;
-  const uint32_t threads = 128;
-  const uint32_t blocks  = GPU_DIV_CEIL(numDecodings * GPU_FMI_DECODE_THREADS_PER_ENTRY, threads);
-  const uint32_t nreps   = 10;
-
-  printf("GPU numDecodings=%u \n", numDecodings);
-
-  float elapsed_time_ms = 0.0f;
-  cudaEvent_t start, stop;
-  cudaEventCreate(&start);
-  cudaEventCreate(&stop);
-  cudaEventRecord(start, 0);
-
-    for(uint32_t iteration = 0; iteration < nreps; ++iteration)
-      gpu_fmi_decoding_kernel<<<blocks,threads>>>(d_fmi, bwtSize, numDecodings, d_initBWTPos, d_endBWTPos, samplingRate);
-
-  cudaEventRecord(stop, 0);
-  cudaThreadSynchronize();
-  cudaEventElapsedTime(&elapsed_time_ms, start, stop);
-  elapsed_time_ms /= nreps;
-
-  cudaEventDestroy(start);
-  cudaEventDestroy(stop);
-  printf("\t Time Kernel GPU:  %8.2f ms\n", elapsed_time_ms);
-
-  return(SUCCESS);
-}
-
 extern "C"
 gpu_error_t gpu_fmi_decode_process_buffer(gpu_buffer_t* const mBuff)
 {
@@ -123,6 +90,7 @@ gpu_error_t gpu_fmi_decode_process_buffer(gpu_buffer_t* const mBuff)
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
   if((numDecodings > numMaxInitPositions) || (numDecodings > numMaxEndPositions)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
   }
 
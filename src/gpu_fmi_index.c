@@ -11,6 +11,7 @@
 #define GPU_FMI_INDEX_C_
 
 #include "../include/gpu_fmi_index.h"
+#include "../include/gpu_shm.h"
 
 
 /************************************************************
@@ -158,9 +159,11 @@ gpu_error_t gpu_fmi_index_transfer_CPU_to_GPUs(gpu_fmi_buffer_t* const fmi, gpu_
   for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
     if(fmi->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED){
       const size_t cpySize = fmi->numEntries * sizeof(gpu_fmi_entry_t);
+      CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
+      //Device copy exported by the publisher of a shared index
+      if(gpu_shm_open_device(GPU_SHM_FMI, devices[idSupportedDevice], (void**) &fmi->d_fmi[idSupportedDevice])) continue;
       deviceFreeMemory = gpu_device_get_free_memory(devices[idSupportedDevice]->idDevice);
       if ((GPU_CONVERT__B_TO_MB(cpySize)) > deviceFreeMemory) return(E_INSUFFICIENT_MEM_GPU);
-        CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
       //Synchronous allocate & transfer the FM-index to the GPU
       CUDA_ERROR(cudaMalloc((void**) &fmi->d_fmi[idSupportedDevice], cpySize));
       CUDA_ERROR(cudaMemcpy(fmi->d_fmi[idSupportedDevice], fmi->h_fmi, cpySize, cudaMemcpyHostToDevice));
@@ -185,7 +188,7 @@ gpu_error_t gpu_fmi_index_transform_ASCII(const char* const textBWT, gpu_fmi_buf
     const uint32_t bwtNumEntries      = fmi->numEntries * (GPU_FMI_ENTRY_SIZE / GPU_UINT32_LENGTH);
     const uint32_t countersNumEntries = fmi->numEntries * (GPU_FMI_ENTRY_SIZE / GPU_UINT32_LENGTH);
 
-    h_bitmaps_BWT = (gpu_index_bitmap_entry_t *) malloc(bwtNumEntries * sizeof(gpu_index_bitmap_entry_t));
+    h_bitmaps_BWT = (gpu_index_bitmap_entry_t *) calloc(bwtNumEntries, sizeof(gpu_index_bitmap_entry_t));
     if (h_bitmaps_BWT == NULL) return (E_ALLOCATE_MEM);
     h_counters_FMI = (gpu_index_counter_entry_t *) malloc(countersNumEntries * sizeof(gpu_index_counter_entry_t));
     if (h_counters_FMI == NULL) return (E_ALLOCATE_MEM);
@@ -341,12 +344,15 @@ gpu_error_t gpu_fmi_index_transform_MFASTA_FULL(const char* const indexRaw, gpu_
 gpu_error_t gpu_fmi_index_init_dto(gpu_fmi_buffer_t* const fmi)
 {
   //Initialize the FMI index structure
-  fmi->d_fmi          = NULL;
-  fmi->h_fmi          = NULL;
-  fmi->hostAllocStats = GPU_PAGE_UNLOCKED;
-  fmi->memorySpace    = NULL;
-  fmi->bwtSize        = 0;
-  fmi->numEntries     = 0;
+  fmi->d_fmi            = NULL;
+  fmi->h_fmi            = NULL;
+  fmi->h_fmiHost        = NULL;
+  fmi->activeHostLayout = false;
+  gpu_numa_replicas_init_dto(&fmi->hostReplicas);
+  fmi->hostAllocStats   = GPU_PAGE_UNLOCKED;
+  fmi->memorySpace      = NULL;
+  fmi->bwtSize          = 0;
+  fmi->numEntries       = 0;
 
   return (SUCCESS);
 }
@@ -375,12 +381,7 @@ gpu_error_t gpu_fmi_index_init(gpu_fmi_buffer_t* const fmi, const uint64_t bwtSi
 gpu_error_t gpu_fmi_index_allocate(gpu_fmi_buffer_t* const fmi)
 {
   fmi->numEntries = GPU_DIV_CEIL(fmi->bwtSize, GPU_FMI_ENTRY_SIZE) + 1;
-  if(fmi->hostAllocStats & GPU_PAGE_LOCKED){
-    CUDA_ERROR(cudaHostAlloc((void**) &fmi->h_fmi, fmi->numEntries * sizeof(gpu_fmi_entry_t), cudaHostAllocMapped));
-  }else{
-    fmi->h_fmi = malloc (fmi->numEntries * sizeof(gpu_fmi_entry_t));
-    if (fmi->h_fmi == NULL) return (E_ALLOCATE_MEM);
-  }
+  GPU_ERROR(gpu_hugepages_alloc((void**) &fmi->h_fmi, fmi->numEntries * sizeof(gpu_fmi_entry_t), fmi->hostAllocStats));
   return(SUCCESS);
 }
 
@@ -388,17 +389,34 @@ gpu_error_t gpu_fmi_index_allocate(gpu_fmi_buffer_t* const fmi)
  GLOBAL METHODS: Functions to release DEVICE & HOST indexes
 ************************************************************/
 
-gpu_error_t gpu_fmi_index_free_host(gpu_fmi_buffer_t* const fmi)
+gpu_error_t gpu_fmi_index_free_host_entries(gpu_fmi_buffer_t* const fmi)
 {
   if(fmi->h_fmi != NULL){
-      if(fmi->hostAllocStats == GPU_PAGE_LOCKED) CUDA_ERROR(cudaFreeHost(fmi->h_fmi));
-      else free(fmi->h_fmi);
+      GPU_ERROR(gpu_hugepages_free(fmi->h_fmi, fmi->hostAllocStats));
       fmi->h_fmi = NULL;
     }
 
     return(SUCCESS);
 }
 
+gpu_error_t gpu_fmi_index_free_host_layout(gpu_fmi_buffer_t* const fmi)
+{
+  if(fmi->h_fmiHost != NULL){
+    GPU_ERROR(gpu_hugepages_free(fmi->h_fmiHost, (fmi->hostAllocStats == GPU_PAGE_SHARED) ? GPU_PAGE_SHARED : GPU_PAGE_UNLOCKED));
+    fmi->h_fmiHost = NULL;
+  }
+  GPU_ERROR(gpu_numa_replicas_free(&fmi->hostReplicas));
+
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_fmi_index_free_host(gpu_fmi_buffer_t* const fmi)
+{
+  GPU_ERROR(gpu_fmi_index_free_host_entries(fmi));
+  GPU_ERROR(gpu_fmi_index_free_host_layout(fmi));
+  return(SUCCESS);
+}
+
 gpu_error_t gpu_fmi_index_free_unused_host(gpu_fmi_buffer_t* const fmi, gpu_device_info_t** const devices)
 {
   uint32_t idSupportedDevice, numSupportedDevices;
@@ -410,8 +428,9 @@ gpu_error_t gpu_fmi_index_free_unused_host(gpu_fmi_buffer_t* const fmi, gpu_devi
     if(fmi->memorySpace[idSupportedDevice] == GPU_HOST_MAPPED) indexInHostSideUsed = true;
   }
 
+  //The host-optimized layout is kept for the host backends
   if(!indexInHostSideUsed){
-    GPU_ERROR(gpu_fmi_index_free_host(fmi));
+    GPU_ERROR(gpu_fmi_index_free_host_entries(fmi));
   }
 
   return(SUCCESS);
@@ -427,7 +446,7 @@ gpu_error_t gpu_fmi_index_free_device(gpu_fmi_buffer_t* const fmi, gpu_device_in
     CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
     if(fmi->d_fmi[idSupportedDevice] != NULL){
       if(fmi->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED)
-        CUDA_ERROR(cudaFree(fmi->d_fmi[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(fmi->d_fmi[idSupportedDevice]));
       fmi->d_fmi[idSupportedDevice] = NULL;
     }
   }
@@ -534,7 +553,7 @@ gpu_error_t gpu_fmi_index_build_PEQ(const gpu_fmi_buffer_t* const fmi, const cha
   for(idEntry = 0; idEntry < bwtNumEntries; ++idEntry){
     for(i = 0; i < GPU_UINT32_LENGTH; ++i){
       bwtPosition = (idEntry * GPU_UINT32_LENGTH) + i;
-      if (bwtPosition < fmi->numEntries) bwtChar = h_ascii_BWT[bwtPosition];
+      if (bwtPosition < fmi->bwtSize) bwtChar = h_ascii_BWT[bwtPosition];
         else bwtChar = 'N'; //filling BWT padding
       gpu_encode_entry_BWT_to_PEQ(&h_bitmap_BWT[idEntry], bwtChar, i);
     }
@@ -606,5 +625,162 @@ gpu_error_t gpu_fmi_index_build_FMI(gpu_fmi_buffer_t* const fmi, gpu_index_bitma
   return(SUCCESS);
 }
 
+
+/************************************************************
+ GLOBAL METHODS: Host-optimized layout (host backends)
+************************************************************/
+
+uint32_t gpu_fmi_index_host_count_slice(const uint32_t* const bitmaps, const uint32_t base, const int32_t shift)
+{
+  // Bitmaps are MSB first: the first 'shift' bases of the slice are counted
+  const uint32_t bit0 =  base & 0x1L;
+  const uint32_t bit1 = (base & 0x2L) >> 1;
+  const uint32_t bmpCollapsed = (bit0 ? bitmaps[0] : ~bitmaps[0]) & (bit1 ? bitmaps[1] : ~bitmaps[1]) & bitmaps[2];
+  uint32_t mask = (shift >= GPU_UINT32_LENGTH) ? GPU_UINT32_ONES : GPU_UINT32_ONES << (GPU_UINT32_LENGTH - shift);
+           mask = (shift > 0) ? mask : GPU_UINT32_ZEROS;
+  return(__builtin_popcount(bmpCollapsed & mask));
+}
+
+uint32_t gpu_fmi_index_host_count_entry(const gpu_fmi_host_entry_t* const h_fmiHostEntry, const uint32_t base, const uint32_t bitmapPosition)
+{
+  uint32_t idSlice, numCharacters = 0;
+  for(idSlice = 0; idSlice < GPU_FMI_HOST_SLICES_PER_ENTRY; ++idSlice){
+    const int32_t shift = (int32_t) bitmapPosition - (int32_t) (idSlice * GPU_UINT32_LENGTH);
+    if(shift <= 0) break;
+    numCharacters += gpu_fmi_index_host_count_slice(&h_fmiHostEntry->bitmaps[idSlice * GPU_FMI_HOST_BITMAPS_PER_SLICE], base, shift);
+  }
+  return(numCharacters);
+}
+
+uint64_t gpu_fmi_index_host_LF_mapping(const gpu_fmi_host_entry_t* const h_fmiHost, const uint64_t interval, const uint32_t base)
+{
+  // Single entry access: no alternate counters, bitmaps in natural order
+  const uint64_t entryIdx       = interval / GPU_FMI_ENTRY_SIZE;
+  const uint32_t bitmapPosition = interval % GPU_FMI_ENTRY_SIZE;
+  return(h_fmiHost[entryIdx].counters[base] + gpu_fmi_index_host_count_entry(&h_fmiHost[entryIdx], base, bitmapPosition));
+}
+
+void gpu_fmi_index_host_set_bitmaps(const gpu_fmi_entry_t* const h_fmiEntry, gpu_fmi_host_entry_t* const h_fmiHostEntry)
+{
+  const uint32_t LUT[12] = {3,7,11,0,1,2,4,5,6,8,9,10};  // Device bitmap position for each natural slice bitmap
+  uint32_t idBitmap;
+  // Bitmaps are reordered to the natural layout (bit0, bit1, valid) x 4 slices
+  for(idBitmap = 0; idBitmap < GPU_FMI_BITMAPS_PER_ENTRY; ++idBitmap)
+    h_fmiHostEntry->bitmaps[idBitmap] = h_fmiEntry->bitmaps[LUT[idBitmap]];
+}
+
+void gpu_fmi_index_host_set_entry(const gpu_fmi_entry_t* const h_fmi, const uint64_t idEntry, gpu_fmi_host_entry_t* const h_fmiHostEntry)
+{
+  // The next entry must exist (all the entries except the last ghost entry)
+  uint32_t idBase;
+  gpu_fmi_index_host_set_bitmaps(&h_fmi[idEntry], h_fmiHostEntry);
+  // Alternate counters are completed with the next entry
+  for(idBase = 0; idBase < GPU_FMI_NUM_COUNTERS; ++idBase){
+    const uint32_t bit0 =  idBase & 0x1L;
+    const uint32_t bit1 = (idBase & 0x2L) >> 1;
+    if((idEntry % GPU_FMI_ALTERNATE_COUNTERS) == bit1){
+      h_fmiHostEntry->counters[idBase] = h_fmi[idEntry].counters[bit0];
+    }else{
+      h_fmiHostEntry->counters[idBase] = h_fmi[idEntry + 1].counters[bit0]
+                                       - gpu_fmi_index_host_count_entry(h_fmiHostEntry, idBase, GPU_FMI_ENTRY_SIZE);
+    }
+  }
+}
+
+void gpu_fmi_index_host_set_ghost_entry(const gpu_fmi_entry_t* const h_fmi, const uint64_t lastEntry, gpu_fmi_host_entry_t* const h_fmiHostEntry)
+{
+  // Alternate counters are completed with the previous entry (a single entry derives them from its own counts)
+  gpu_fmi_host_entry_t previousEntry;
+  uint32_t idBase;
+  if(lastEntry != 0) gpu_fmi_index_host_set_entry(h_fmi, lastEntry - 1, &previousEntry);
+  gpu_fmi_index_host_set_bitmaps(&h_fmi[lastEntry], h_fmiHostEntry);
+  for(idBase = 0; idBase < GPU_FMI_NUM_COUNTERS; ++idBase){
+    const uint32_t bit0 =  idBase & 0x1L;
+    const uint32_t bit1 = (idBase & 0x2L) >> 1;
+    if((lastEntry % GPU_FMI_ALTERNATE_COUNTERS) == bit1){
+      h_fmiHostEntry->counters[idBase] = h_fmi[lastEntry].counters[bit0];
+    }else if(lastEntry != 0){
+      h_fmiHostEntry->counters[idBase] = previousEntry.counters[idBase] + gpu_fmi_index_host_count_entry(&previousEntry, idBase, GPU_FMI_ENTRY_SIZE);
+    }else{
+      h_fmiHostEntry->counters[idBase] = h_fmiHostEntry->counters[idBase - 1]
+                                       + gpu_fmi_index_host_count_entry(h_fmiHostEntry, idBase - 1, GPU_FMI_ENTRY_SIZE);
+    }
+  }
+}
+
+uint32_t gpu_fmi_index_host_get_base(const gpu_fmi_host_entry_t* const h_fmiHostEntry, const uint32_t bitmapPosition)
+{
+  const uint32_t* const bitmaps  = &h_fmiHostEntry->bitmaps[(bitmapPosition / GPU_UINT32_LENGTH) * GPU_FMI_HOST_BITMAPS_PER_SLICE];
+  const uint32_t relativePosition = (GPU_UINT32_LENGTH - (bitmapPosition % GPU_UINT32_LENGTH)) - 1;
+  const uint32_t bit0 = (bitmaps[0] >> relativePosition) & 1;
+  const uint32_t bit1 = (bitmaps[1] >> relativePosition) & 1;
+  const uint32_t bit2 = (bitmaps[2] >> relativePosition) & 1;
+  // Valid bitmap is stored inverted (0 for N)
+  return((bit2 == 0) ? GPU_ENC_DNA_CHAR_N : (bit1 << 1) | bit0);
+}
+
+bool gpu_fmi_index_host_LF_step(const gpu_fmi_buffer_t* const fmi, uint64_t* const interval)
+{
+  // Backward step from a BWT position (false if the BWT base is an N)
+  const uint64_t entryIdx       = (* interval) / GPU_FMI_ENTRY_SIZE;
+  const uint32_t bitmapPosition = (* interval) % GPU_FMI_ENTRY_SIZE;
+  const gpu_fmi_host_entry_t* h_fmiHostEntry = NULL;
+  gpu_fmi_host_entry_t hostEntry;
+  uint32_t base;
+  // Uses the host layout when available (replica of the thread node), otherwise converts the device entry on the fly
+  if(fmi->h_fmiHost != NULL){
+    const gpu_fmi_host_entry_t* const h_fmiHost = gpu_numa_replicas_get_local(&fmi->hostReplicas, fmi->h_fmiHost);
+    h_fmiHostEntry = &h_fmiHost[entryIdx];
+  }else{
+    gpu_fmi_index_host_set_entry(fmi->h_fmi, entryIdx, &hostEntry);
+    h_fmiHostEntry = &hostEntry;
+  }
+  base = gpu_fmi_index_host_get_base(h_fmiHostEntry, bitmapPosition);
+  if(base == GPU_ENC_DNA_CHAR_N) return(false);
+  (* interval) = h_fmiHostEntry->counters[base] + gpu_fmi_index_host_count_entry(h_fmiHostEntry, base, bitmapPosition);
+  return(true);
+}
+
+uint64_t gpu_fmi_index_host_LF_rank(const gpu_fmi_buffer_t* const fmi, const gpu_fmi_host_entry_t* const h_fmiHost,
+                                    const uint64_t interval, const uint32_t base)
+{
+  // Backward extension of an interval bound (h_fmiHost is the local host layout or NULL)
+  const uint64_t entryIdx       = interval / GPU_FMI_ENTRY_SIZE;
+  const uint32_t bitmapPosition = interval % GPU_FMI_ENTRY_SIZE;
+  const uint64_t lastEntry      = fmi->numEntries - 1;
+  gpu_fmi_host_entry_t hostEntry;
+  if(h_fmiHost != NULL) return(gpu_fmi_index_host_LF_mapping(h_fmiHost, interval, base));
+  // The device entries are converted on the fly
+  if(entryIdx != lastEntry) gpu_fmi_index_host_set_entry(fmi->h_fmi, entryIdx, &hostEntry);
+    else gpu_fmi_index_host_set_ghost_entry(fmi->h_fmi, lastEntry, &hostEntry);
+  return(hostEntry.counters[base] + gpu_fmi_index_host_count_entry(&hostEntry, base, bitmapPosition));
+}
+
+gpu_error_t gpu_fmi_index_build_host_layout(gpu_fmi_buffer_t* const fmi)
+{
+  const uint64_t lastEntry = fmi->numEntries - 1;
+  uint64_t idEntry;
+
+  if((fmi->h_fmi == NULL) || (fmi->numEntries == 0)) return(E_DATA_NOT_ALLOCATED);
+  GPU_ERROR(gpu_fmi_index_free_host_layout(fmi));
+  GPU_ERROR(gpu_hugepages_alloc((void**) &fmi->h_fmiHost, fmi->numEntries * sizeof(gpu_fmi_host_entry_t), GPU_PAGE_UNLOCKED));
+
+  for(idEntry = 0; idEntry < lastEntry; ++idEntry)
+    gpu_fmi_index_host_set_entry(fmi->h_fmi, idEntry, &fmi->h_fmiHost[idEntry]);
+
+  // The last (ghost) entry has no next entry to complete its counters
+  gpu_fmi_index_host_set_ghost_entry(fmi->h_fmi, lastEntry, &fmi->h_fmiHost[lastEntry]);
+
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_fmi_index_build_host_replicas(gpu_fmi_buffer_t* const fmi)
+{
+  // Read-mostly host layout copied to every NUMA node (host backends read their local copy)
+  if(fmi->h_fmiHost == NULL) return(SUCCESS);
+  GPU_ERROR(gpu_numa_replicas_build(&fmi->hostReplicas, fmi->h_fmiHost, fmi->numEntries * sizeof(gpu_fmi_host_entry_t)));
+  return(SUCCESS);
+}
+
 #endif /* GPU_FMI_INDEX_C_ */
 
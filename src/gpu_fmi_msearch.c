@@ -0,0 +1,221 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_MSEARCH_C_
+#define GPU_FMI_MSEARCH_C_
+
+#include "../include/gpu_fmi_primitives.h"
+
+/************************************************************
+Functions to extend the intervals over the host index
+************************************************************/
+
+bool gpu_fmi_msearch_extend(const gpu_fmi_msearch_context_t* const search, const uint32_t base, const uint32_t textLength,
+                            uint32_t* const key, uint64_t* const L, uint64_t* const R)
+{
+  const gpu_fmi_table_t* const table   = search->table;
+  const uint32_t               idLevel = textLength + 1;
+  // The first levels are gathered from the FMI table (the key holds the text bases in processing order)
+  if((table != NULL) && (idLevel < table->maxLevelsTableLUT)){
+    uint32_t idL, idR;
+    (* key) |= base << (textLength << 1);
+    gpu_fmi_table_get_positions(idLevel, (* key), table->h_offsetsTableLUT, &idL, &idR);
+    (* L) = table->h_fmiTableLUT[idL] & GPU_FMI_TABLE_FIELD_MASK;
+    (* R) = table->h_fmiTableLUT[idR] & GPU_FMI_TABLE_FIELD_MASK;
+  }else{
+    (* L) = gpu_fmi_index_host_LF_rank(search->fmi, search->h_fmiHost, (* L), base);
+    (* R) = gpu_fmi_index_host_LF_rank(search->fmi, search->h_fmiHost, (* R), base);
+  }
+  return((* L) < (* R));
+}
+
+void gpu_fmi_msearch_compute_bounds(const gpu_fmi_msearch_context_t* const search, uint32_t* const bounds)
+{
+  // Greedy partition of the query in segments absent from the text (each one costs at least one error)
+  const uint32_t querySize = search->querySize;
+  uint64_t L = 0, R = search->fmi->bwtSize;
+  uint32_t idBase, initSegment = 0, key = 0;
+  memset(bounds, 0, (querySize + 1) * sizeof(uint32_t));
+  for(idBase = 0; idBase < querySize; ++idBase){
+    const gpu_fmi_search_query_t queryBase = search->query[querySize - idBase - 1];
+    const bool                   foundN    = (queryBase & GPU_ENC_DNA_CHAR_N) != 0;
+    if(foundN || !gpu_fmi_msearch_extend(search, queryBase, idBase - initSegment, &key, &L, &R)){
+      bounds[initSegment]++;
+      initSegment = idBase + 1;
+      L = 0; R = search->fmi->bwtSize; key = 0;
+    }
+  }
+  // Segments fully contained in the unprocessed bases [idBase, querySize)
+  for(idBase = querySize; idBase > 0; --idBase)
+    bounds[idBase - 1] += bounds[idBase];
+}
+
+/************************************************************
+Functions to gather the intervals of a query
+************************************************************/
+
+int gpu_fmi_msearch_cmp_intervals(const void* const a, const void* const b)
+{
+  // Containers first (increasing low, decreasing hi)
+  const gpu_fmi_msearch_candidate_t* const candA = (const gpu_fmi_msearch_candidate_t *) a;
+  const gpu_fmi_msearch_candidate_t* const candB = (const gpu_fmi_msearch_candidate_t *) b;
+  if(candA->interval.low != candB->interval.low) return((candA->interval.low < candB->interval.low) ? -1 : 1);
+  if(candA->interval.hi  != candB->interval.hi)  return((candA->interval.hi  > candB->interval.hi)  ? -1 : 1);
+  return(0);
+}
+
+int gpu_fmi_msearch_cmp_errors(const void* const a, const void* const b)
+{
+  // Best strata first (ties keep the interval order)
+  const gpu_fmi_msearch_candidate_t* const candA = (const gpu_fmi_msearch_candidate_t *) a;
+  const gpu_fmi_msearch_candidate_t* const candB = (const gpu_fmi_msearch_candidate_t *) b;
+  if(candA->errors != candB->errors) return((candA->errors < candB->errors) ? -1 : 1);
+  return(gpu_fmi_msearch_cmp_intervals(a, b));
+}
+
+void gpu_fmi_msearch_compact_candidates(gpu_fmi_msearch_context_t* const search)
+{
+  // SA intervals are nested or disjoint: the nested ones (longer texts) locate the same occurrences
+  gpu_fmi_msearch_candidate_t* const candidates = search->candidates;
+  uint32_t idCandidate, numCandidates = 0;
+  if(search->numCandidates == 0) return;
+  qsort(candidates, search->numCandidates, sizeof(gpu_fmi_msearch_candidate_t), gpu_fmi_msearch_cmp_intervals);
+  for(idCandidate = 1; idCandidate < search->numCandidates; ++idCandidate){
+    gpu_fmi_msearch_candidate_t* const container = &candidates[numCandidates];
+    if(candidates[idCandidate].interval.hi <= container->interval.hi){
+      container->errors = GPU_MIN(container->errors, candidates[idCandidate].errors);
+    }else{
+      candidates[++numCandidates] = candidates[idCandidate];
+    }
+  }
+  search->numCandidates = numCandidates + 1;
+}
+
+void gpu_fmi_msearch_add_candidate(gpu_fmi_msearch_context_t* const search, const uint64_t L, const uint64_t R, const uint32_t errors)
+{
+  gpu_fmi_msearch_candidate_t* candidate = NULL;
+  // The scratch is compacted when full (the intervals are dropped when it does not shrink)
+  if(search->numCandidates == search->maxCandidates) gpu_fmi_msearch_compact_candidates(search);
+  if(search->numCandidates == search->maxCandidates){
+    search->numDropped++;
+    return;
+  }
+  candidate = &search->candidates[search->numCandidates++];
+  candidate->interval.low = L;
+  candidate->interval.hi  = R;
+  candidate->errors       = errors;
+}
+
+/************************************************************
+Functions to search the queries (bounded backtracking)
+************************************************************/
+
+void gpu_fmi_msearch_backtrack(gpu_fmi_msearch_context_t* const search, const uint32_t idBase, const uint64_t L, const uint64_t R,
+                               const uint32_t errors, const uint32_t key, const uint32_t textLength, const gpu_fmi_msearch_op_t lastOp)
+{
+  const uint32_t querySize = search->querySize;
+  const uint32_t maxErrors = search->maxErrors;
+  gpu_fmi_search_query_t queryBase;
+  uint32_t idAlternative, base;
+  bool foundN;
+  // Pruning: the unprocessed bases can not be aligned with the remaining errors
+  if((errors + search->bounds[idBase]) > maxErrors) return;
+  // All the query bases are aligned (texts shorter than the query errors are not reported)
+  if(idBase == querySize){
+    if(textLength > 0) gpu_fmi_msearch_add_candidate(search, L, R, errors);
+    return;
+  }
+  queryBase = search->query[querySize - idBase - 1];
+  foundN    = (queryBase & GPU_ENC_DNA_CHAR_N) != 0;
+  // Match (explored first) or substitution of the query base
+  for(idAlternative = 0; idAlternative < GPU_FMI_TABLE_ALPHABET_SIZE; ++idAlternative){
+    const uint32_t cost   = (foundN || (idAlternative != 0)) ? 1 : 0;
+    uint64_t       childL = L, childR = R;
+    uint32_t       childKey = key;
+    base = (queryBase + idAlternative) & GPU_FMI_TABLE_KEY_MASK;
+    if((errors + cost) > maxErrors) continue;
+    if(gpu_fmi_msearch_extend(search, base, textLength, &childKey, &childL, &childR))
+      gpu_fmi_msearch_backtrack(search, idBase + 1, childL, childR, errors + cost, childKey, textLength + 1, GPU_FMI_MSEARCH_OP_MATCH);
+  }
+  if((search->errorModel != GPU_FMI_MSEARCH_EDITS) || (errors == maxErrors)) return;
+  // Insertion of the query base (an adjacent deletion would be a substitution)
+  if(lastOp != GPU_FMI_MSEARCH_OP_DELETION)
+    gpu_fmi_msearch_backtrack(search, idBase + 1, L, R, errors + 1, key, textLength, GPU_FMI_MSEARCH_OP_INSERTION);
+  // Deletion of a text base (at the query ends it only lengthens an occurrence already found)
+  if((lastOp == GPU_FMI_MSEARCH_OP_INSERTION) || (idBase == 0)) return;
+  for(base = 0; base < GPU_FMI_TABLE_ALPHABET_SIZE; ++base){
+    uint64_t childL = L, childR = R;
+    uint32_t childKey = key;
+    // Deleting the query base itself is the same text as deleting it after the match (unless that is the query end)
+    if(!foundN && (base == queryBase) && ((idBase + 1) < querySize)) continue;
+    if(gpu_fmi_msearch_extend(search, base, textLength, &childKey, &childL, &childR))
+      gpu_fmi_msearch_backtrack(search, idBase, childL, childR, errors + 1, childKey, textLength + 1, GPU_FMI_MSEARCH_OP_DELETION);
+  }
+}
+
+void gpu_fmi_msearch_process_query(gpu_fmi_msearch_context_t* const search, gpu_fmi_msearch_result_t* const result,
+                                   gpu_sa_search_inter_t* const intervals)
+{
+  uint32_t idInterval, numIntervals, minErrors = GPU_FMI_MSEARCH_NO_MATCH;
+  // Search all the texts within the error bound
+  search->numCandidates = 0;
+  search->numDropped    = 0;
+  gpu_fmi_msearch_backtrack(search, 0, 0, search->fmi->bwtSize, 0, 0, 0, GPU_FMI_MSEARCH_OP_MATCH);
+  gpu_fmi_msearch_compact_candidates(search);
+  // The best strata are kept when the interval slots are exhausted
+  if(search->numCandidates > search->maxIntervals)
+    qsort(search->candidates, search->numCandidates, sizeof(gpu_fmi_msearch_candidate_t), gpu_fmi_msearch_cmp_errors);
+  numIntervals = GPU_MIN(search->numCandidates, search->maxIntervals);
+  for(idInterval = 0; idInterval < numIntervals; ++idInterval){
+    intervals[idInterval] = search->candidates[idInterval].interval;
+    minErrors = GPU_MIN(minErrors, search->candidates[idInterval].errors);
+  }
+  result->num_intervals = numIntervals;
+  result->min_errors    = minErrors;
+  result->num_dropped   = search->numDropped + (search->numCandidates - numIntervals);
+}
+
+gpu_error_t gpu_fmi_msearch_process_buffer(gpu_buffer_t* const mBuff)
+{
+  const gpu_fmi_msearch_queries_buffer_t*   qryBuff = &mBuff->data.msearch.queries;
+  const gpu_fmi_msearch_intervals_buffer_t* intBuff = &mBuff->data.msearch.intervals;
+  const gpu_fmi_buffer_t* const             fmi     = &mBuff->index->fmi;
+  const gpu_fmi_table_t* const              table   = &fmi->table;
+  gpu_fmi_msearch_context_t search;
+  uint32_t idQuery, maxQuerySize = 0, *bounds = NULL;
+  // The host copies of the index are kept when the module is active
+  if((fmi->h_fmiHost == NULL) && (fmi->h_fmi == NULL)) return(E_DATA_NOT_ALLOCATED);
+  for(idQuery = 0; idQuery < qryBuff->numQueries; ++idQuery)
+    maxQuerySize = GPU_MAX(maxQuerySize, qryBuff->h_queryInfo[idQuery].query_size);
+  bounds = (uint32_t *) malloc((maxQuerySize + 1) * sizeof(uint32_t));
+  if(bounds == NULL) return(E_ALLOCATE_MEM);
+  // Search setup shared by all the queries of the buffer
+  search.fmi           = fmi;
+  search.h_fmiHost     = (fmi->h_fmiHost != NULL) ? (const gpu_fmi_host_entry_t *) gpu_numa_replicas_get_local(&fmi->hostReplicas, fmi->h_fmiHost) : NULL;
+  search.table         = ((table->formatTableLUT != GPU_FMI_TABLE_DISABLED) && (table->h_fmiTableLUT != NULL)) ? table : NULL;
+  search.bounds        = bounds;
+  search.maxErrors     = mBuff->data.msearch.maxErrors;
+  search.errorModel    = mBuff->data.msearch.errorModel;
+  search.candidates    = intBuff->h_candidates;
+  search.maxCandidates = mBuff->data.msearch.numMaxCandidates;
+  search.maxIntervals  = mBuff->data.msearch.maxIntervalsPerQuery;
+  // Each query fills its interval slots
+  for(idQuery = 0; idQuery < qryBuff->numQueries; ++idQuery){
+    const gpu_fmi_search_query_info_t* const queryInfo = &qryBuff->h_queryInfo[idQuery];
+    gpu_fmi_msearch_result_t* const          result    = &qryBuff->h_results[idQuery];
+    search.query     = qryBuff->h_queries + queryInfo->init_offset;
+    search.querySize = queryInfo->query_size;
+    gpu_fmi_msearch_compute_bounds(&search, bounds);
+    gpu_fmi_msearch_process_query(&search, result, intBuff->h_intervals + result->init_offset);
+  }
+  free(bounds);
+  return(SUCCESS);
+}
+
+#endif /* GPU_FMI_MSEARCH_C_ */
@@ -13,16 +13,6 @@
 #include "../include/gpu_fmi_primitives.h"
 #include "../include/gpu_sa_primitives.h"
 
-#ifdef GPU_FMI_DEBUG
-//Data classified by num of regions
-uint32_t histogram_queries[15]            = {0};
-uint32_t histogram_query_candidates[15]   = {0};
-//Data classified by region size
-uint32_t histogram_regions[110]           = {0};
-uint32_t histogram_region_candidates[110] = {0};
-uint32_t histogram_coverage[110]          = {0};
-#endif
-
 /************************************************************
 Functions to get the GPU FMI buffers
 ************************************************************/
@@ -53,40 +43,23 @@ gpu_fmi_search_region_info_t* gpu_fmi_asearch_buffer_get_regions_offsets_(const
 }
 
 /************************************************************
-Functions to debug internals
+Functions to account the search results
 ************************************************************/
 
-#ifdef GPU_FMI_DEBUG
-void gpu_buffer_fmi_asearch_process_histogram(const gpu_buffer_t* const mBuff){
-  uint32_t idQuery = 0, numBases = 0, numQueries = mBuff->data.asearch.queries.numQueries;
-  for(idQuery = 0; idQuery < numQueries; ++idQuery){
-    //Getting query stats
-    uint32_t idRegion = 0, numRegions = mBuff->data.asearch.queries.h_regions[idQuery].num_regions;
-    uint32_t offset   = mBuff->data.asearch.queries.h_regions[idQuery].init_offset;
-    for(idRegion = 0, numBases = 0; idRegion < numRegions; ++idRegion){
-      //Getting region stats
-      uint32_t hi  = mBuff->data.asearch.regions.h_intervals[offset + idRegion].hi;
-      uint32_t low = mBuff->data.asearch.regions.h_intervals[offset + idRegion].low;
-      uint32_t init_offset   = mBuff->data.asearch.regions.h_regionsOffsets[offset + idRegion].init_offset;
-      uint32_t end_offset    = mBuff->data.asearch.regions.h_regionsOffsets[offset + idRegion].end_offset;
-      //Setting region stats
-      uint32_t numCandidates = hi - low;
-      uint32_t regionSize    = end_offset - init_offset;
-      numBases += regionSize;
-      // Setting the num candidates per read
-      histogram_query_candidates[numRegions] += numCandidates;
-      // Setting the num candidates per region
-      histogram_region_candidates[regionSize] += numCandidates;
-      // Setting the region size
-      histogram_regions[regionSize]++;
-    }
-    // Setting the num reads
-    histogram_queries[numRegions]++;
-    // Setting all regions coverage over the read
-    histogram_coverage[numBases]++;
+void gpu_fmi_asearch_account_regions(gpu_buffer_t* const mBuff)
+{
+  const gpu_fmi_asearch_queries_buffer_t* const qry = &mBuff->data.asearch.queries;
+  const gpu_fmi_asearch_regions_buffer_t* const reg = &mBuff->data.asearch.regions;
+  uint64_t numRegions = 0, numCandidates = 0;
+  uint32_t idQuery, idRegion;
+  for(idQuery = 0; idQuery < qry->numQueries; ++idQuery){
+    const uint32_t offset = qry->h_regions[idQuery].init_offset;
+    numRegions += qry->h_regions[idQuery].num_regions;
+    for(idRegion = 0; idRegion < qry->h_regions[idQuery].num_regions; ++idRegion)
+      numCandidates += reg->h_intervals[offset + idRegion].hi - reg->h_intervals[offset + idRegion].low;
   }
+  gpu_stats_add_regions(&mBuff->stats, numRegions, numCandidates);
 }
-#endif  
 
 /************************************************************
 Functions to get the maximum elements of the buffers
@@ -157,15 +130,15 @@ void gpu_fmi_asearch_reallocate_device_buffer_layout(gpu_buffer_t* mBuff)
   rawAlloc = (void *) (mBuff->data.asearch.regions.d_regionsOffsets + mBuff->data.asearch.numMaxRegions);
 }
 
-void gpu_fmi_asearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxRegionsFactor)
+void gpu_fmi_asearch_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxRegionsFactor)
 {
-  gpu_buffer_t* const mBuff                  = (gpu_buffer_t *) fmiBuffer;
   const size_t        sizeBuff               = mBuff->sizeBuffer * 0.90;
   const uint32_t      averageRegionsPerQuery = GPU_MAX(GPU_DIV_CEIL(averageQuerySize, maxRegionsFactor), GPU_FMI_MIN_REGIONS);
   const size_t        bytesPerQuery          = gpu_fmi_asearch_size_per_query(averageQuerySize, averageRegionsPerQuery);
   const uint32_t      numQueries             = sizeBuff / bytesPerQuery;
   //set the type of the buffer
   mBuff->typeBuffer = GPU_FMI_ADAPT_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
   // Set real size of the input
   mBuff->data.asearch.numMaxQueries         = numQueries;
   mBuff->data.asearch.numMaxBases           = numQueries * averageQuerySize;
@@ -173,8 +146,22 @@ void gpu_fmi_asearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQ
   // Internal data information
   mBuff->data.asearch.maxRegionsFactor      = maxRegionsFactor;
   // Set the corresponding buffer layout
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_fmi_asearch_reallocate_host_buffer_layout(mBuff);
   gpu_fmi_asearch_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_fmi_asearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxRegionsFactor)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) fmiBuffer;
+  uint32_t            tunedQuerySize = averageQuerySize;
+  // The observed query sizes replace the caller estimation (the regions factor is kept)
+  mBuff->typeBuffer = GPU_FMI_ADAPT_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, NULL);
+  gpu_fmi_asearch_set_buffer_layout(mBuff, tunedQuerySize, maxRegionsFactor);
 }
 
 void gpu_fmi_asearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxRegionsFactor, const uint32_t totalBases,
@@ -185,7 +172,7 @@ void gpu_fmi_asearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint3
   const uint32_t      averageQuerySize       = GPU_DIV_CEIL(totalBases, totalQueries);
   const uint32_t      averageRegionsPerQuery = GPU_MAX(GPU_DIV_CEIL(averageQuerySize, maxRegionsFactor), GPU_FMI_MIN_REGIONS);
   // Remap the buffer layout with new information trying to fit better
-  gpu_fmi_asearch_init_buffer_(fmiBuffer, averageQuerySize, maxRegionsFactor);
+  gpu_fmi_asearch_set_buffer_layout(mBuff, averageQuerySize, maxRegionsFactor);
   // Checking if we need to reallocate a bigger buffer
   if( (totalBases   > gpu_fmi_asearch_buffer_get_max_bases_(fmiBuffer))   ||
       (totalQueries > gpu_fmi_asearch_buffer_get_max_queries_(fmiBuffer)) ||
@@ -197,6 +184,7 @@ void gpu_fmi_asearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint3
     //Recalculate the minimum buffer size
     //printf("RESIZE[FMI_SEARCH] %d %d \n",  mBuff->sizeBuffer, bytesPerSearchBuffer * resizeFactor);
     mBuff->sizeBuffer = bytesPerSearchBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
     //FREE HOST AND DEVICE BUFFER
     GPU_ERROR(gpu_buffer_free(mBuff));
     //Select the device of the Multi-GPU platform
@@ -205,7 +193,7 @@ void gpu_fmi_asearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint3
     CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
     CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
     // Remap the buffer layout with the new size
-    gpu_fmi_asearch_init_buffer_(fmiBuffer, averageQuerySize, maxRegionsFactor);
+    gpu_fmi_asearch_set_buffer_layout(mBuff, averageQuerySize, maxRegionsFactor);
   }
 }
 
@@ -227,21 +215,27 @@ gpu_error_t gpu_fmi_asearch_transfer_CPU_to_GPU(gpu_buffer_t *mBuff)
   cpySize += regBuff->numRegions * sizeof(gpu_sa_search_inter_t);
   cpySize += regBuff->numRegions * sizeof(gpu_fmi_search_region_info_t);
   bufferUtilization = (double)cpySize / (double)mBuff->sizeBuffer;
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Compacting tranferences with high buffer occupation
   if(bufferUtilization > 0.15){
     cpySize  = ((void *) (qryBuff->d_regions + qryBuff->numQueries)) - ((void *) qryBuff->d_queries);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->d_queries, qryBuff->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }else{
     //Transfer Queries to GPU
     cpySize = qryBuff->numBases * sizeof(gpu_fmi_search_query_t);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->d_queries, qryBuff->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     //Transfer to GPU the information associated with Queries
     cpySize = qryBuff->numQueries * sizeof(gpu_fmi_search_query_info_t);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->d_queryInfo, qryBuff->h_queryInfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     //Transfer Candidates to GPU
     cpySize = qryBuff->numQueries * sizeof(gpu_fmi_search_region_t);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->d_regions, qryBuff->h_regions, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Suceed
   return (SUCCESS);
 }
@@ -260,21 +254,27 @@ gpu_error_t gpu_fmi_asearch_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
   cpySize += regBuff->numRegions * sizeof(gpu_sa_search_inter_t);
   cpySize += regBuff->numRegions * sizeof(gpu_fmi_search_region_info_t);
   bufferUtilization = (double)cpySize / (double)mBuff->sizeBuffer;
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   // Compacting tranferences with high buffer occupation
   if(bufferUtilization > 0.15){
     cpySize  = ((void *) (regBuff->h_regionsOffsets + regBuff->numRegions)) - ((void *) qryBuff->h_regions);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->h_regions, qryBuff->d_regions, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   }else{
     // Transfer Candidates to GPU
     cpySize = qryBuff->numQueries * sizeof(gpu_fmi_search_region_t);
     CUDA_ERROR(cudaMemcpyAsync(qryBuff->h_regions, qryBuff->d_regions, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
     // Transfer Candidates to GPU
     cpySize = regBuff->numRegions * sizeof(gpu_sa_search_inter_t);
     CUDA_ERROR(cudaMemcpyAsync(regBuff->h_intervals, regBuff->d_intervals, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
     // Transfer Candidates to GPU
     cpySize = regBuff->numRegions * sizeof(gpu_fmi_search_region_info_t);
     CUDA_ERROR(cudaMemcpyAsync(regBuff->h_regionsOffsets, regBuff->d_regionsOffsets, cpySize, cudaMemcpyDeviceToHost, idStream));
+    gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   // Suceed
   return (SUCCESS);
 }
@@ -282,6 +282,7 @@ gpu_error_t gpu_fmi_asearch_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
 void gpu_fmi_asearch_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numRegions,
                                   const uint32_t occMinThreshold, const uint32_t extraSteps, const uint32_t alphabetSize)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff  = (gpu_buffer_t *) fmiBuffer;
   const uint32_t idSupDevice = mBuff->idSupportedDevice;
   //Set real size of the input
@@ -291,54 +292,118 @@ void gpu_fmi_asearch_send_buffer_(void* const fmiBuffer, const uint32_t numQueri
   mBuff->data.asearch.queries.numQueries = numQueries;
   mBuff->data.asearch.queries.numBases   = numBases;
   mBuff->data.asearch.regions.numRegions = numRegions;
+  gpu_stats_add_submission(&mBuff->stats, numQueries, mBuff->data.asearch.numMaxQueries);
+  gpu_buffer_balance_submit(mBuff, numQueries);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numBases, numRegions);
   //Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   GPU_ERROR(gpu_fmi_asearch_transfer_CPU_to_GPU(mBuff));
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_fmi_asearch_process_buffer(mBuff));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_fmi_asearch_transfer_GPU_to_CPU(mBuff));
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_asearch send", timeSend);
 }
 
 void gpu_fmi_asearch_receive_buffer_(const void* const fmiBuffer)
 {
-  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
-  const cudaStream_t  idStream    =  mBuff->listStreams[mBuff->idStream];
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff    = (gpu_buffer_t *) fmiBuffer;
+  const cudaStream_t  idStream =  mBuff->listStreams[mBuff->idStream];
   //Synchronize Stream (the thread wait for the commands done in the stream)
   CUDA_ERROR(cudaStreamSynchronize(idStream));
-  #ifdef GPU_FMI_DEBUG
-    gpu_buffer_fmi_asearch_process_histogram(mBuff);
-  #endif
+  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
+  gpu_fmi_asearch_account_regions(mBuff);
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_asearch receive", timeReceive);
 }
 
-#ifdef GPU_FMI_DEBUG
-void gpu_fmi_asearch_print_histograms()
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_fmi_asearch_batch_max_regions(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo)
 {
-  uint32_t i = 0;
-  printf("histogram_queries: Setting the num reads \n");
-  for(i = 0; i < 15; i++)
-    printf("%u\t%u\n", i, histogram_queries[i]);
-  printf("\n\n");
-
-  printf("histogram_query_candidates: Setting num candidates per read \n");
-  for(i = 0; i < 15; i++)
-    printf("%u\t%u\n", i, histogram_query_candidates[i]);
-  printf("\n\n");
-
-  printf("histogram_regions: Setting num region per size \n");
-  for(i = 0; i < 110; i++)
-    printf("%u\t%u\n", i, histogram_regions[i]);
-  printf("\n\n");
-
-  printf("histogram_region_candidates: Setting num candidates per size \n");
-  for(i = 0; i < 110; i++)
-    printf("%u\t%u\n", i, histogram_region_candidates[i]);
-  printf("\n\n");
-
-  printf("histogram_coverage: Setting all regions coverage over the read \n");
-  for(i = 0; i < 110; i++)
-    printf("%u\t%u\n", i, histogram_coverage[i]);
-  printf("\n\n");
+  //Region slots reserved by the kernels for each query
+  return(GPU_MAX(GPU_DIV_CEIL(queryInfo->query_size, mBuff->data.asearch.maxRegionsFactor), GPU_FMI_MIN_REGIONS));
+}
+
+uint32_t gpu_fmi_asearch_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                       const gpu_fmi_search_region_t* const regions, const uint32_t numQueries)
+{
+  const uint32_t maxQueries = mBuff->data.asearch.numMaxQueries;
+  const uint32_t maxBases   = mBuff->data.asearch.numMaxBases;
+  const uint32_t maxRegions = mBuff->data.asearch.numMaxRegions;
+  uint32_t idQuery;
+  //Greedy growth of the sub-batch (queries and region slots are contiguous windows)
+  for(idQuery = 0; (idQuery < numQueries) && (idQuery < maxQueries); ++idQuery){
+    const uint32_t numBases   = queryInfo[idQuery].init_offset + queryInfo[idQuery].query_size - queryInfo[0].init_offset;
+    const uint32_t numRegions = regions[idQuery].init_offset + gpu_fmi_asearch_batch_max_regions(mBuff, &queryInfo[idQuery]) - regions[0].init_offset;
+    if((numBases > maxBases) || (numRegions > maxRegions)) break;
+  }
+  return(idQuery);
+}
+
+void gpu_fmi_asearch_receive_batch_(void* const fmiBuffer)
+{
+  gpu_buffer_t* const                        mBuff            = (gpu_buffer_t *) fmiBuffer;
+  const gpu_buffer_batch_t*                  batch            = &mBuff->batch;
+  const gpu_fmi_asearch_queries_buffer_t*    qryBuff          = &mBuff->data.asearch.queries;
+  const gpu_fmi_asearch_regions_buffer_t*    regBuff          = &mBuff->data.asearch.regions;
+  gpu_fmi_search_region_t* const             regions          = (gpu_fmi_search_region_t *) batch->h_results;
+  gpu_sa_search_inter_t* const               regionsIntervals = (gpu_sa_search_inter_t *) batch->h_entries;
+  gpu_fmi_search_region_info_t* const        regionsOffsets   = (gpu_fmi_search_region_info_t *) batch->h_entriesInfo;
+  uint32_t idQuery;
+  gpu_fmi_asearch_receive_buffer_(fmiBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays (the region slots keep the caller offsets)
+  for(idQuery = 0; idQuery < batch->numElements; ++idQuery)
+    regions[batch->offset + idQuery].num_regions = qryBuff->h_regions[idQuery].num_regions;
+  memcpy(regionsIntervals + batch->offsetEntries, regBuff->h_intervals, batch->numEntries * sizeof(gpu_sa_search_inter_t));
+  memcpy(regionsOffsets + batch->offsetEntries, regBuff->h_regionsOffsets, batch->numEntries * sizeof(gpu_fmi_search_region_info_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_fmi_asearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                                 gpu_fmi_search_region_t* const regions, const uint32_t numQueries, const uint32_t occMinThreshold,
+                                 const uint32_t extraSteps, const uint32_t alphabetSize,
+                                 gpu_sa_search_inter_t* const regionsIntervals, gpu_fmi_search_region_info_t* const regionsOffsets)
+{
+  gpu_buffer_t* const               mBuff  = (gpu_buffer_t *) fmiBuffer;
+  gpu_fmi_asearch_queries_buffer_t* qry    = &mBuff->data.asearch.queries;
+  uint32_t                          offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t numSubBases = 0, numSubRegions = 0, baseOffset = 0, regionOffset = 0, idQuery;
+    const uint32_t numSubQueries = gpu_fmi_asearch_batch_queries(mBuff, queryInfo + offset, regions + offset, numQueries - offset);
+    //Sanity-check (the buffer can not hold a single query)
+    if((numSubQueries == 0) && (offset < numQueries)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the query and region offsets)
+    if(numSubQueries != 0){
+      const uint32_t idLastQuery = offset + numSubQueries - 1;
+      baseOffset    = queryInfo[offset].init_offset;
+      regionOffset  = regions[offset].init_offset;
+      numSubBases   = queryInfo[idLastQuery].init_offset + queryInfo[idLastQuery].query_size - baseOffset;
+      numSubRegions = regions[idLastQuery].init_offset + gpu_fmi_asearch_batch_max_regions(mBuff, &queryInfo[idLastQuery]) - regionOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_fmi_search_query_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]              = queryInfo[offset + idQuery];
+      qry->h_queryInfo[idQuery].init_offset -= baseOffset;
+      qry->h_regions[idQuery].init_offset    = regions[offset + idQuery].init_offset - regionOffset;
+      qry->h_regions[idQuery].num_regions    = 0;
+    }
+    gpu_fmi_asearch_send_buffer_(fmiBuffer, numSubQueries, numSubBases, numSubRegions, occMinThreshold, extraSteps, alphabetSize);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubQueries, regionOffset, numSubRegions, regions, regionsIntervals, regionsOffsets);
+    offset += numSubQueries;
+    numSubBatches++;
+    if(offset < numQueries) gpu_fmi_asearch_receive_batch_(fmiBuffer);
+  } while(offset < numQueries);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
 }
-#endif
 
 #endif /* GPU_FMI_PRIMITIVES_ASEARCH_C_ */
 
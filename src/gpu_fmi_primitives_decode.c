@@ -86,13 +86,17 @@ void gpu_fmi_decode_init_buffer_(void* const fmiBuffer)
 
   //set the type of the buffer
   mBuff->typeBuffer = GPU_FMI_DECODE_POS | GPU_SA_DECODE_POS;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
 
   //Set real size of the input
   mBuff->data.decode.numMaxInitPositions = numMaxPositions;
   mBuff->data.decode.numMaxEndPositions  = numMaxPositions;
   mBuff->data.decode.numMaxTextPositions = numMaxPositions;
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_fmi_decode_reallocate_host_buffer_layout(mBuff);
   gpu_fmi_decode_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
 }
 
 void gpu_fmi_decode_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t numDecodes)
@@ -105,6 +109,7 @@ void gpu_fmi_decode_init_and_realloc_buffer_(void* const fmiBuffer, const uint32
   //printf("RESIZE[FMI_DECODE] %d %d \n",  mBuff->sizeBuffer, bytesPerDecodeBuffer * resizeFactor);
   //Recalculate the minimum buffer size
   mBuff->sizeBuffer = bytesPerDecodeBuffer * resizeFactor;
+  gpu_stats_add_reallocation(&mBuff->stats);
 
   //FREE HOST AND DEVICE BUFFER
   GPU_ERROR(gpu_buffer_free(mBuff));
@@ -131,7 +136,10 @@ gpu_error_t gpu_fmi_decode_transfer_CPU_to_GPU(gpu_buffer_t* const mBuff)
   const size_t                            cpySize     =  initPosBuff->numDecodings * sizeof(gpu_fmi_decode_init_pos_t);
 
   //Transfer seeds from CPU to the GPU
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(initPosBuff->d_initBWTPos, initPosBuff->h_initBWTPos, cpySize, cudaMemcpyHostToDevice, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
+  gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
 
   return (SUCCESS);
 }
@@ -144,6 +152,7 @@ gpu_error_t gpu_fmi_decode_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
         size_t                            cpySize      =  0;
 
   //Transfer SA intervals (occurrence results) from CPU to the GPU
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   if(mBuff->index->activeModules & GPU_SA_DECODE_POS){
     cpySize = endPosBuff->numDecodings * sizeof(gpu_fmi_decode_text_pos_t);
     CUDA_ERROR(cudaMemcpyAsync(textPosBuff->h_textPos, textPosBuff->d_textPos, cpySize, cudaMemcpyDeviceToHost, idStream));
@@ -151,12 +160,15 @@ gpu_error_t gpu_fmi_decode_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
     cpySize = endPosBuff->numDecodings * sizeof(gpu_fmi_decode_end_pos_t);
     CUDA_ERROR(cudaMemcpyAsync(endPosBuff->h_endBWTPos, endPosBuff->d_endBWTPos, cpySize, cudaMemcpyDeviceToHost, idStream));
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
+  gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
 
   return (SUCCESS);
 }
 
 void gpu_fmi_decode_send_buffer_(void* const fmiBuffer, const uint32_t numDecodings, const uint32_t samplingRate)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff  = (gpu_buffer_t *) fmiBuffer;
   const uint32_t idSupDevice = mBuff->idSupportedDevice;
 
@@ -164,24 +176,81 @@ void gpu_fmi_decode_send_buffer_(void* const fmiBuffer, const uint32_t numDecodi
   mBuff->data.decode.initPositions.numDecodings = numDecodings;
   mBuff->data.decode.endPositions.numDecodings  = numDecodings;
   mBuff->data.decode.textPositions.numDecodings = numDecodings;
+  //The SA resident in the device fixes the sampling rate (resampled at load time, see gpu_sa_buffer_get_sampling_rate_)
+  if((mBuff->index->activeModules & GPU_SA_DECODE_POS) && (samplingRate != mBuff->index->sa.sampligRate))
+    GPU_ERROR(E_SAMPLING_RATE_MISMATCH);
   mBuff->data.decode.samplingRate               = samplingRate;
+  gpu_stats_add_submission(&mBuff->stats, numDecodings, mBuff->data.decode.numMaxInitPositions);
+  gpu_buffer_balance_submit(mBuff, numDecodings);
 
   //Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
 
   GPU_ERROR(gpu_fmi_decode_transfer_CPU_to_GPU(mBuff));
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_fmi_decode_process_buffer(mBuff));
   if(mBuff->index->activeModules & GPU_SA_DECODE_POS)
     GPU_ERROR(gpu_sa_decode_process_buffer(mBuff));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_fmi_decode_transfer_GPU_to_CPU(mBuff));
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_decode send", timeSend);
 }
 
 void gpu_fmi_decode_receive_buffer_(const void* const fmiBuffer)
 {
-  const gpu_buffer_t* const mBuff    = (gpu_buffer_t *) fmiBuffer;
-  const cudaStream_t        idStream =  mBuff->listStreams[mBuff->idStream];
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff    = (gpu_buffer_t *) fmiBuffer;
+  const cudaStream_t  idStream =  mBuff->listStreams[mBuff->idStream];
   //Synchronize Stream (the thread wait for the commands done in the stream)
   CUDA_ERROR(cudaStreamSynchronize(idStream));
+  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_decode receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+void gpu_fmi_decode_receive_batch_(void* const fmiBuffer)
+{
+  gpu_buffer_t* const       mBuff = (gpu_buffer_t *) fmiBuffer;
+  const gpu_buffer_batch_t* batch = &mBuff->batch;
+  gpu_fmi_decode_receive_buffer_(fmiBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays
+  if(mBuff->index->activeModules & GPU_SA_DECODE_POS){
+    gpu_sa_decode_text_pos_t* const textPos = (gpu_sa_decode_text_pos_t *) batch->h_entries;
+    memcpy(textPos + batch->offset, mBuff->data.decode.textPositions.h_textPos, batch->numElements * sizeof(gpu_sa_decode_text_pos_t));
+  }else{
+    gpu_fmi_decode_end_pos_t* const endPos = (gpu_fmi_decode_end_pos_t *) batch->h_results;
+    memcpy(endPos + batch->offset, mBuff->data.decode.endPositions.h_endBWTPos, batch->numElements * sizeof(gpu_fmi_decode_end_pos_t));
+  }
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_fmi_decode_send_batch_(void* const fmiBuffer, const gpu_fmi_decode_init_pos_t* const initPos, const uint32_t numDecodings,
+                                const uint32_t samplingRate, gpu_fmi_decode_end_pos_t* const endPos, gpu_sa_decode_text_pos_t* const textPos)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) fmiBuffer;
+  const uint32_t      maxDecodings   = GPU_MIN(mBuff->data.decode.numMaxInitPositions, mBuff->data.decode.numMaxEndPositions);
+  const uint32_t      numSubBatches  = (maxDecodings == 0) ? 0 : GPU_DIV_CEIL(numDecodings, maxDecodings);
+  uint32_t            offset         = 0;
+  //Sanity-check (the buffer can not hold a single element)
+  if((maxDecodings == 0) && (numDecodings != 0)){
+    gpu_stats_add_overflow(&mBuff->stats);
+    GPU_ERROR(E_OVERFLOWING_BUFFER);
+  }
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    const uint32_t numSubDecodings = GPU_MIN(numDecodings - offset, maxDecodings);
+    memcpy(mBuff->data.decode.initPositions.h_initBWTPos, initPos + offset, numSubDecodings * sizeof(gpu_fmi_decode_init_pos_t));
+    gpu_fmi_decode_send_buffer_(fmiBuffer, numSubDecodings, samplingRate);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubDecodings, 0, 0, endPos, textPos, NULL);
+    offset += numSubDecodings;
+    if(offset < numDecodings) gpu_fmi_decode_receive_batch_(fmiBuffer);
+  } while(offset < numDecodings);
 }
 
 #endif /* GPU_FMI_PRIMITIVES_DECODE_C_ */
@@ -0,0 +1,275 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_PRIMITIVES_MSEARCH_C_
+#define GPU_FMI_PRIMITIVES_MSEARCH_C_
+
+#include "../include/gpu_fmi_primitives.h"
+
+/************************************************************
+Functions to get the GPU FMI buffers
+************************************************************/
+
+gpu_fmi_search_query_t* gpu_fmi_msearch_buffer_get_queries_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.queries.h_queries);
+}
+
+gpu_fmi_search_query_info_t* gpu_fmi_msearch_buffer_get_queries_info_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.queries.h_queryInfo);
+}
+
+gpu_fmi_msearch_result_t* gpu_fmi_msearch_buffer_get_results_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.queries.h_results);
+}
+
+gpu_sa_search_inter_t* gpu_fmi_msearch_buffer_get_intervals_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.intervals.h_intervals);
+}
+
+/************************************************************
+Functions to get the maximum elements of the buffers
+************************************************************/
+
+uint32_t gpu_fmi_msearch_buffer_get_max_queries_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.numMaxQueries);
+}
+
+uint32_t gpu_fmi_msearch_buffer_get_max_intervals_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.numMaxIntervals);
+}
+
+uint32_t gpu_fmi_msearch_buffer_get_max_bases_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.msearch.numMaxBases);
+}
+
+/************************************************************
+Functions to initialize the buffers (M. SEARCH)
+************************************************************/
+
+size_t gpu_fmi_msearch_size_per_query(const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery)
+{
+  //Memory size dedicated to each query
+  const size_t bytesPerQueryRAW  = averageQuerySize * sizeof(gpu_fmi_search_query_t);
+  const size_t bytesPerQueryInfo = sizeof(gpu_fmi_search_query_info_t) + sizeof(gpu_fmi_msearch_result_t);
+  const size_t bytesPerQuery     = bytesPerQueryRAW + bytesPerQueryInfo;
+  //Return maximum memory size required per each query (all the interval slots are reserved)
+  return((maxIntervalsPerQuery * sizeof(gpu_sa_search_inter_t)) + bytesPerQuery);
+}
+
+size_t gpu_fmi_msearch_size_scratch(const uint32_t maxIntervalsPerQuery)
+{
+  //Candidate intervals of the query being searched (host backend)
+  return(maxIntervalsPerQuery * GPU_FMI_MSEARCH_CANDIDATES_FACTOR * sizeof(gpu_fmi_msearch_candidate_t));
+}
+
+void gpu_fmi_msearch_reallocate_host_buffer_layout(gpu_buffer_t* mBuff)
+{
+  const void* rawAlloc = mBuff->h_rawData;
+  //Adjust the host buffer layout (input)
+  mBuff->data.msearch.queries.h_queries = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.msearch.queries.h_queries + mBuff->data.msearch.numMaxBases);
+  mBuff->data.msearch.queries.h_queryInfo = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.msearch.queries.h_queryInfo + mBuff->data.msearch.numMaxQueries);
+  //Adjust the host buffer layout (output)
+  mBuff->data.msearch.queries.h_results = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.msearch.queries.h_results + mBuff->data.msearch.numMaxQueries);
+  mBuff->data.msearch.intervals.h_intervals = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.msearch.intervals.h_intervals + mBuff->data.msearch.numMaxIntervals);
+  //Adjust the host buffer layout (scratch)
+  mBuff->data.msearch.intervals.h_candidates = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.msearch.intervals.h_candidates + mBuff->data.msearch.numMaxCandidates);
+}
+
+void gpu_fmi_msearch_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery)
+{
+  const uint32_t      intervalsPerQuery = GPU_MAX(maxIntervalsPerQuery, GPU_FMI_MSEARCH_MIN_INTERVALS);
+  const size_t        sizeScratch       = gpu_fmi_msearch_size_scratch(intervalsPerQuery);
+  const size_t        sizeBuff          = (mBuff->sizeBuffer * 0.90) - GPU_MIN(sizeScratch, mBuff->sizeBuffer * 0.90);
+  const size_t        bytesPerQuery     = gpu_fmi_msearch_size_per_query(averageQuerySize, intervalsPerQuery);
+  const uint32_t      numQueries        = sizeBuff / bytesPerQuery;
+  //set the type of the buffer
+  mBuff->typeBuffer = GPU_FMI_APPROX_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  // Set real size of the input
+  mBuff->data.msearch.numMaxQueries         = numQueries;
+  mBuff->data.msearch.numMaxBases           = numQueries * averageQuerySize;
+  mBuff->data.msearch.numMaxIntervals       = numQueries * intervalsPerQuery;
+  mBuff->data.msearch.numMaxCandidates      = intervalsPerQuery * GPU_FMI_MSEARCH_CANDIDATES_FACTOR;
+  // Internal data information
+  mBuff->data.msearch.maxIntervalsPerQuery  = intervalsPerQuery;
+  // Set the corresponding buffer layout (the search runs over the host copies)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+  gpu_fmi_msearch_reallocate_host_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_fmi_msearch_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxIntervalsPerQuery)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) fmiBuffer;
+  uint32_t            tunedQuerySize = averageQuerySize;
+  // The observed query sizes replace the caller estimation (the interval slots are kept)
+  mBuff->typeBuffer = GPU_FMI_APPROX_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, NULL);
+  gpu_fmi_msearch_set_buffer_layout(mBuff, tunedQuerySize, maxIntervalsPerQuery);
+}
+
+void gpu_fmi_msearch_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxIntervalsPerQuery, const uint32_t totalBases,
+                                              const uint32_t totalQueries)
+{
+  // Buffer reinitialization
+  gpu_buffer_t* const mBuff            = (gpu_buffer_t *) fmiBuffer;
+  const uint32_t      averageQuerySize = GPU_DIV_CEIL(totalBases, totalQueries);
+  const uint32_t      totalIntervals   = totalQueries * GPU_MAX(maxIntervalsPerQuery, GPU_FMI_MSEARCH_MIN_INTERVALS);
+  // Remap the buffer layout with new information trying to fit better
+  gpu_fmi_msearch_set_buffer_layout(mBuff, averageQuerySize, maxIntervalsPerQuery);
+  // Checking if we need to reallocate a bigger buffer
+  if( (totalBases     > gpu_fmi_msearch_buffer_get_max_bases_(fmiBuffer))   ||
+      (totalQueries   > gpu_fmi_msearch_buffer_get_max_queries_(fmiBuffer)) ||
+      (totalIntervals > gpu_fmi_msearch_buffer_get_max_intervals_(fmiBuffer))){
+    // Resize the GPU buffer to fit the required input
+    const uint32_t      idSupDevice             = mBuff->idSupportedDevice;
+    const float         resizeFactor            = 2.0;
+    const size_t        bytesPerSearchBuffer    = totalQueries * gpu_fmi_msearch_size_per_query(averageQuerySize, maxIntervalsPerQuery)
+                                                + gpu_fmi_msearch_size_scratch(maxIntervalsPerQuery);
+    //Recalculate the minimum buffer size
+    mBuff->sizeBuffer = bytesPerSearchBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
+    //FREE HOST AND DEVICE BUFFER
+    GPU_ERROR(gpu_buffer_free(mBuff));
+    //Select the device of the Multi-GPU platform
+    CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
+    //ALLOCATE HOST BUFFER (the search runs on the host)
+    CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
+    // Remap the buffer layout with the new size
+    gpu_fmi_msearch_set_buffer_layout(mBuff, averageQuerySize, maxIntervalsPerQuery);
+  }
+}
+
+/************************************************************
+Functions to process the buffers (M. SEARCH)
+************************************************************/
+
+void gpu_fmi_msearch_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numIntervals,
+                                  const uint32_t maxErrors, const gpu_fmi_msearch_error_model_t errorModel)
+{
+  const double timeSend = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  //Set real size of the input
+  mBuff->data.msearch.maxErrors                = GPU_MIN(maxErrors, GPU_FMI_MSEARCH_MAX_ERRORS);
+  mBuff->data.msearch.errorModel               = errorModel;
+  mBuff->data.msearch.queries.numQueries       = numQueries;
+  mBuff->data.msearch.queries.numBases         = numBases;
+  mBuff->data.msearch.intervals.numIntervals   = numIntervals;
+  gpu_stats_add_submission(&mBuff->stats, numQueries, mBuff->data.msearch.numMaxQueries);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numBases, numIntervals);
+  //The backtracking runs on the host over the host index (results are ready at the reception)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  GPU_ERROR(gpu_fmi_msearch_process_buffer(mBuff));
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_msearch send", timeSend);
+}
+
+void gpu_fmi_msearch_receive_buffer_(const void* const fmiBuffer)
+{
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_msearch receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_fmi_msearch_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                       const gpu_fmi_msearch_result_t* const results, const uint32_t numQueries)
+{
+  const uint32_t maxQueries        = mBuff->data.msearch.numMaxQueries;
+  const uint32_t maxBases          = mBuff->data.msearch.numMaxBases;
+  const uint32_t maxIntervals      = mBuff->data.msearch.numMaxIntervals;
+  const uint32_t intervalsPerQuery = mBuff->data.msearch.maxIntervalsPerQuery;
+  uint32_t idQuery;
+  //Greedy growth of the sub-batch (queries and interval slots are contiguous windows)
+  for(idQuery = 0; (idQuery < numQueries) && (idQuery < maxQueries); ++idQuery){
+    const uint32_t numBases     = queryInfo[idQuery].init_offset + queryInfo[idQuery].query_size - queryInfo[0].init_offset;
+    const uint32_t numIntervals = results[idQuery].init_offset + intervalsPerQuery - results[0].init_offset;
+    if((numBases > maxBases) || (numIntervals > maxIntervals)) break;
+  }
+  return(idQuery);
+}
+
+void gpu_fmi_msearch_receive_batch_(void* const fmiBuffer)
+{
+  gpu_buffer_t* const                     mBuff     = (gpu_buffer_t *) fmiBuffer;
+  const gpu_buffer_batch_t*               batch     = &mBuff->batch;
+  const gpu_fmi_msearch_queries_buffer_t* qryBuff   = &mBuff->data.msearch.queries;
+  const gpu_fmi_msearch_intervals_buffer_t* intBuff = &mBuff->data.msearch.intervals;
+  gpu_fmi_msearch_result_t* const         results   = (gpu_fmi_msearch_result_t *) batch->h_results;
+  gpu_sa_search_inter_t* const            intervals = (gpu_sa_search_inter_t *) batch->h_entries;
+  uint32_t idQuery;
+  gpu_fmi_msearch_receive_buffer_(fmiBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays (the interval slots keep the caller offsets)
+  for(idQuery = 0; idQuery < batch->numElements; ++idQuery){
+    gpu_fmi_msearch_result_t* const result = &results[batch->offset + idQuery];
+    result->num_intervals = qryBuff->h_results[idQuery].num_intervals;
+    result->min_errors    = qryBuff->h_results[idQuery].min_errors;
+    result->num_dropped   = qryBuff->h_results[idQuery].num_dropped;
+  }
+  memcpy(intervals + batch->offsetEntries, intBuff->h_intervals, batch->numEntries * sizeof(gpu_sa_search_inter_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_fmi_msearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                                 gpu_fmi_msearch_result_t* const results, const uint32_t numQueries, const uint32_t maxErrors,
+                                 const gpu_fmi_msearch_error_model_t errorModel, gpu_sa_search_inter_t* const intervals)
+{
+  gpu_buffer_t* const               mBuff  = (gpu_buffer_t *) fmiBuffer;
+  gpu_fmi_msearch_queries_buffer_t* qry    = &mBuff->data.msearch.queries;
+  uint32_t                          offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t numSubBases = 0, numSubIntervals = 0, baseOffset = 0, intervalOffset = 0, idQuery;
+    const uint32_t numSubQueries = gpu_fmi_msearch_batch_queries(mBuff, queryInfo + offset, results + offset, numQueries - offset);
+    //Sanity-check (the buffer can not hold a single query)
+    if((numSubQueries == 0) && (offset < numQueries)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the query and interval offsets)
+    if(numSubQueries != 0){
+      const uint32_t idLastQuery = offset + numSubQueries - 1;
+      baseOffset      = queryInfo[offset].init_offset;
+      intervalOffset  = results[offset].init_offset;
+      numSubBases     = queryInfo[idLastQuery].init_offset + queryInfo[idLastQuery].query_size - baseOffset;
+      numSubIntervals = results[idLastQuery].init_offset + mBuff->data.msearch.maxIntervalsPerQuery - intervalOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_fmi_search_query_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]              = queryInfo[offset + idQuery];
+      qry->h_queryInfo[idQuery].init_offset -= baseOffset;
+      qry->h_results[idQuery].init_offset    = results[offset + idQuery].init_offset - intervalOffset;
+    }
+    gpu_fmi_msearch_send_buffer_(fmiBuffer, numSubQueries, numSubBases, numSubIntervals, maxErrors, errorModel);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubQueries, intervalOffset, numSubIntervals, results, intervals, NULL);
+    offset += numSubQueries;
+    numSubBatches++;
+    if(offset < numQueries) gpu_fmi_msearch_receive_batch_(fmiBuffer);
+  } while(offset < numQueries);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+}
+
+#endif /* GPU_FMI_PRIMITIVES_MSEARCH_C_ */
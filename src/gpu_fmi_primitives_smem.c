@@ -0,0 +1,261 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_PRIMITIVES_SMEM_C_
+#define GPU_FMI_PRIMITIVES_SMEM_C_
+
+#include "../include/gpu_fmi_primitives.h"
+
+/************************************************************
+Functions to get the GPU FMI buffers
+************************************************************/
+
+gpu_fmi_search_query_t* gpu_fmi_smem_buffer_get_queries_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.queries.h_queries);
+}
+
+gpu_fmi_search_query_info_t* gpu_fmi_smem_buffer_get_queries_info_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.queries.h_queryInfo);
+}
+
+gpu_fmi_smem_result_t* gpu_fmi_smem_buffer_get_results_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.queries.h_results);
+}
+
+gpu_fmi_smem_seed_t* gpu_fmi_smem_buffer_get_seeds_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.seeds.h_seeds);
+}
+
+/************************************************************
+Functions to get the maximum elements of the buffers
+************************************************************/
+
+uint32_t gpu_fmi_smem_buffer_get_max_queries_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.numMaxQueries);
+}
+
+uint32_t gpu_fmi_smem_buffer_get_max_seeds_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.numMaxSeeds);
+}
+
+uint32_t gpu_fmi_smem_buffer_get_max_bases_(const void* const fmiBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  return(mBuff->data.smem.numMaxBases);
+}
+
+/************************************************************
+Functions to initialize the buffers (SMEM SEARCH)
+************************************************************/
+
+size_t gpu_fmi_smem_size_per_query(const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery)
+{
+  //Memory size dedicated to each query
+  const size_t bytesPerQueryRAW  = averageQuerySize * sizeof(gpu_fmi_search_query_t);
+  const size_t bytesPerQueryInfo = sizeof(gpu_fmi_search_query_info_t) + sizeof(gpu_fmi_smem_result_t);
+  const size_t bytesPerQuery     = bytesPerQueryRAW + bytesPerQueryInfo;
+  //Return maximum memory size required per each query (all the seed slots are reserved)
+  return((maxSeedsPerQuery * sizeof(gpu_fmi_smem_seed_t)) + bytesPerQuery);
+}
+
+void gpu_fmi_smem_reallocate_host_buffer_layout(gpu_buffer_t* mBuff)
+{
+  const void* rawAlloc = mBuff->h_rawData;
+  //Adjust the host buffer layout (input)
+  mBuff->data.smem.queries.h_queries = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.smem.queries.h_queries + mBuff->data.smem.numMaxBases);
+  mBuff->data.smem.queries.h_queryInfo = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.smem.queries.h_queryInfo + mBuff->data.smem.numMaxQueries);
+  //Adjust the host buffer layout (output)
+  mBuff->data.smem.queries.h_results = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.smem.queries.h_results + mBuff->data.smem.numMaxQueries);
+  mBuff->data.smem.seeds.h_seeds = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.smem.seeds.h_seeds + mBuff->data.smem.numMaxSeeds);
+}
+
+void gpu_fmi_smem_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery)
+{
+  const uint32_t      seedsPerQuery = GPU_MAX(maxSeedsPerQuery, GPU_FMI_SMEM_MIN_SEEDS);
+  const size_t        sizeBuff      = mBuff->sizeBuffer * 0.95;
+  const size_t        bytesPerQuery = gpu_fmi_smem_size_per_query(averageQuerySize, seedsPerQuery);
+  const uint32_t      numQueries    = sizeBuff / bytesPerQuery;
+  //set the type of the buffer
+  mBuff->typeBuffer = GPU_FMI_SMEM_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  // Set real size of the input
+  mBuff->data.smem.numMaxQueries    = numQueries;
+  mBuff->data.smem.numMaxBases      = numQueries * averageQuerySize;
+  mBuff->data.smem.numMaxSeeds      = numQueries * seedsPerQuery;
+  // Internal data information
+  mBuff->data.smem.maxSeedsPerQuery = seedsPerQuery;
+  // Set the corresponding buffer layout (the search runs over the host copies)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+  gpu_fmi_smem_reallocate_host_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_fmi_smem_init_buffer_(void* const fmiBuffer, const uint32_t averageQuerySize, const uint32_t maxSeedsPerQuery)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) fmiBuffer;
+  uint32_t            tunedQuerySize = averageQuerySize;
+  // The observed query sizes replace the caller estimation (the seed slots are kept)
+  mBuff->typeBuffer = GPU_FMI_SMEM_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, NULL);
+  gpu_fmi_smem_set_buffer_layout(mBuff, tunedQuerySize, maxSeedsPerQuery);
+}
+
+void gpu_fmi_smem_init_and_realloc_buffer_(void* const fmiBuffer, const uint32_t maxSeedsPerQuery, const uint32_t totalBases,
+                                           const uint32_t totalQueries)
+{
+  // Buffer reinitialization
+  gpu_buffer_t* const mBuff            = (gpu_buffer_t *) fmiBuffer;
+  const uint32_t      averageQuerySize = GPU_DIV_CEIL(totalBases, totalQueries);
+  const uint32_t      totalSeeds       = totalQueries * GPU_MAX(maxSeedsPerQuery, GPU_FMI_SMEM_MIN_SEEDS);
+  // Remap the buffer layout with new information trying to fit better
+  gpu_fmi_smem_set_buffer_layout(mBuff, averageQuerySize, maxSeedsPerQuery);
+  // Checking if we need to reallocate a bigger buffer
+  if( (totalBases   > gpu_fmi_smem_buffer_get_max_bases_(fmiBuffer))   ||
+      (totalQueries > gpu_fmi_smem_buffer_get_max_queries_(fmiBuffer)) ||
+      (totalSeeds   > gpu_fmi_smem_buffer_get_max_seeds_(fmiBuffer))){
+    // Resize the GPU buffer to fit the required input
+    const uint32_t      idSupDevice          = mBuff->idSupportedDevice;
+    const float         resizeFactor         = 2.0;
+    const size_t        bytesPerSearchBuffer = totalQueries * gpu_fmi_smem_size_per_query(averageQuerySize, maxSeedsPerQuery);
+    //Recalculate the minimum buffer size
+    mBuff->sizeBuffer = bytesPerSearchBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
+    //FREE HOST AND DEVICE BUFFER
+    GPU_ERROR(gpu_buffer_free(mBuff));
+    //Select the device of the Multi-GPU platform
+    CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
+    //ALLOCATE HOST BUFFER (the search runs on the host)
+    CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
+    // Remap the buffer layout with the new size
+    gpu_fmi_smem_set_buffer_layout(mBuff, averageQuerySize, maxSeedsPerQuery);
+  }
+}
+
+/************************************************************
+Functions to process the buffers (SMEM SEARCH)
+************************************************************/
+
+void gpu_fmi_smem_send_buffer_(void* const fmiBuffer, const uint32_t numQueries, const uint32_t numBases, const uint32_t numSeeds,
+                               const uint32_t minSeedLength)
+{
+  const double timeSend = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  //Set real size of the input
+  mBuff->data.smem.minSeedLength      = GPU_MAX(minSeedLength, GPU_FMI_SMEM_MIN_SEED_LENGTH);
+  mBuff->data.smem.queries.numQueries = numQueries;
+  mBuff->data.smem.queries.numBases   = numBases;
+  mBuff->data.smem.seeds.numSeeds     = numSeeds;
+  gpu_stats_add_submission(&mBuff->stats, numQueries, mBuff->data.smem.numMaxQueries);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numBases, numSeeds);
+  //The bidirectional search runs on the host over the host index (results are ready at the reception)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  GPU_ERROR(gpu_fmi_smem_process_buffer(mBuff));
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_smem send", timeSend);
+}
+
+void gpu_fmi_smem_receive_buffer_(const void* const fmiBuffer)
+{
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) fmiBuffer;
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_smem receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_fmi_smem_batch_queries(const gpu_buffer_t* const mBuff, const gpu_fmi_search_query_info_t* const queryInfo,
+                                    const gpu_fmi_smem_result_t* const results, const uint32_t numQueries)
+{
+  const uint32_t maxQueries    = mBuff->data.smem.numMaxQueries;
+  const uint32_t maxBases      = mBuff->data.smem.numMaxBases;
+  const uint32_t maxSeeds      = mBuff->data.smem.numMaxSeeds;
+  const uint32_t seedsPerQuery = mBuff->data.smem.maxSeedsPerQuery;
+  uint32_t idQuery;
+  //Greedy growth of the sub-batch (queries and seed slots are contiguous windows)
+  for(idQuery = 0; (idQuery < numQueries) && (idQuery < maxQueries); ++idQuery){
+    const uint32_t numBases = queryInfo[idQuery].init_offset + queryInfo[idQuery].query_size - queryInfo[0].init_offset;
+    const uint32_t numSeeds = results[idQuery].init_offset + seedsPerQuery - results[0].init_offset;
+    if((numBases > maxBases) || (numSeeds > maxSeeds)) break;
+  }
+  return(idQuery);
+}
+
+void gpu_fmi_smem_receive_batch_(void* const fmiBuffer)
+{
+  gpu_buffer_t* const                  mBuff    = (gpu_buffer_t *) fmiBuffer;
+  const gpu_buffer_batch_t*            batch    = &mBuff->batch;
+  const gpu_fmi_smem_queries_buffer_t* qryBuff  = &mBuff->data.smem.queries;
+  const gpu_fmi_smem_seeds_buffer_t*   seedBuff = &mBuff->data.smem.seeds;
+  gpu_fmi_smem_result_t* const         results  = (gpu_fmi_smem_result_t *) batch->h_results;
+  gpu_fmi_smem_seed_t* const           seeds    = (gpu_fmi_smem_seed_t *) batch->h_entries;
+  uint32_t idQuery;
+  gpu_fmi_smem_receive_buffer_(fmiBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays (the seed slots keep the caller offsets)
+  for(idQuery = 0; idQuery < batch->numElements; ++idQuery){
+    gpu_fmi_smem_result_t* const result = &results[batch->offset + idQuery];
+    result->num_seeds   = qryBuff->h_results[idQuery].num_seeds;
+    result->num_dropped = qryBuff->h_results[idQuery].num_dropped;
+  }
+  memcpy(seeds + batch->offsetEntries, seedBuff->h_seeds, batch->numEntries * sizeof(gpu_fmi_smem_seed_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_fmi_smem_send_batch_(void* const fmiBuffer, const gpu_fmi_search_query_t* const queries, const gpu_fmi_search_query_info_t* const queryInfo,
+                              gpu_fmi_smem_result_t* const results, const uint32_t numQueries, const uint32_t minSeedLength,
+                              gpu_fmi_smem_seed_t* const seeds)
+{
+  gpu_buffer_t* const            mBuff  = (gpu_buffer_t *) fmiBuffer;
+  gpu_fmi_smem_queries_buffer_t* qry    = &mBuff->data.smem.queries;
+  uint32_t                       offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t numSubBases = 0, numSubSeeds = 0, baseOffset = 0, seedOffset = 0, idQuery;
+    const uint32_t numSubQueries = gpu_fmi_smem_batch_queries(mBuff, queryInfo + offset, results + offset, numQueries - offset);
+    //Sanity-check (the buffer can not hold a single query)
+    if((numSubQueries == 0) && (offset < numQueries)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the query and seed offsets)
+    if(numSubQueries != 0){
+      const uint32_t idLastQuery = offset + numSubQueries - 1;
+      baseOffset  = queryInfo[offset].init_offset;
+      seedOffset  = results[offset].init_offset;
+      numSubBases = queryInfo[idLastQuery].init_offset + queryInfo[idLastQuery].query_size - baseOffset;
+      numSubSeeds = results[idLastQuery].init_offset + mBuff->data.smem.maxSeedsPerQuery - seedOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_fmi_search_query_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]              = queryInfo[offset + idQuery];
+      qry->h_queryInfo[idQuery].init_offset -= baseOffset;
+      qry->h_results[idQuery].init_offset    = results[offset + idQuery].init_offset - seedOffset;
+    }
+    gpu_fmi_smem_send_buffer_(fmiBuffer, numSubQueries, numSubBases, numSubSeeds, minSeedLength);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubQueries, seedOffset, numSubSeeds, results, seeds, NULL);
+    offset += numSubQueries;
+    numSubBatches++;
+    if(offset < numQueries) gpu_fmi_smem_receive_batch_(fmiBuffer);
+  } while(offset < numQueries);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+}
+
+#endif /* GPU_FMI_PRIMITIVES_SMEM_C_ */
@@ -75,12 +75,16 @@ void gpu_fmi_ssearch_init_buffer_(void* const fmiBuffer)
 
   //set the type of the buffer
   mBuff->typeBuffer = GPU_FMI_EXACT_SEARCH;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
 
   //set real size of the input
   mBuff->data.ssearch.numMaxSeeds     = numInputs;
   mBuff->data.ssearch.numMaxIntervals = numInputs;
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_fmi_ssearch_reallocate_host_buffer_layout(mBuff);
   gpu_fmi_ssearch_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
 }
 
 void gpu_fmi_ssearch_init_and_realloc_buffer_(void *fmiBuffer, const uint32_t numSeeds)
@@ -92,6 +96,7 @@ void gpu_fmi_ssearch_init_and_realloc_buffer_(void *fmiBuffer, const uint32_t nu
 
   //Recalculate the minimum buffer size
   mBuff->sizeBuffer = bytesPerSearchBuffer * resizeFactor;
+  gpu_stats_add_reallocation(&mBuff->stats);
 
   //FREE HOST AND DEVICE BUFFER
   GPU_ERROR(gpu_buffer_free(mBuff));
@@ -184,7 +189,10 @@ gpu_error_t gpu_fmi_ssearch_transfer_CPU_to_GPU(gpu_buffer_t *mBuff)
   const size_t                          cpySize  =  seedBuff->numSeeds * sizeof(gpu_fmi_search_seed_t);
 
   //Transfer seeds from CPU to the GPU
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(seedBuff->d_seeds, seedBuff->h_seeds, cpySize, cudaMemcpyHostToDevice, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
+  gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
 
   return (SUCCESS);
 }
@@ -196,34 +204,100 @@ gpu_error_t gpu_fmi_ssearch_transfer_GPU_to_CPU(gpu_buffer_t* const mBuff)
   const size_t                            cpySize   =  interBuff->numIntervals * sizeof(gpu_sa_search_inter_t);
 
   //Transfer SA intervals (occurrence results) from CPU to the GPU
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(interBuff->h_intervals, interBuff->d_intervals, cpySize, cudaMemcpyDeviceToHost, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
+  gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
 
   return (SUCCESS);
 }
 
 void gpu_fmi_ssearch_send_buffer_(void* const fmiBuffer, const uint32_t numSeeds)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff  = (gpu_buffer_t *) fmiBuffer;
   const uint32_t idSupDevice = mBuff->idSupportedDevice;
+  uint32_t       numMisses;
 
-  //Set real size of the input
-  mBuff->data.ssearch.seeds.numSeeds = numSeeds;
-  mBuff->data.ssearch.saIntervals.numIntervals = numSeeds;
+  //Resolve the seeds already cached (only the misses are sent to the device)
+  gpu_stats_add_submission(&mBuff->stats, numSeeds, mBuff->data.ssearch.numMaxSeeds);
+  gpu_buffer_balance_submit(mBuff, numSeeds);
+  numMisses = gpu_fmi_cache_filter(mBuff->idBuffer, mBuff->data.ssearch.seeds.h_seeds, numSeeds, &mBuff->stats);
 
-  //Select the device of the Multi-GPU platform
-  CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
-  GPU_ERROR(gpu_fmi_ssearch_transfer_CPU_to_GPU(mBuff));
-  GPU_ERROR(gpu_fmi_ssearch_process_buffer(mBuff));
-  GPU_ERROR(gpu_fmi_ssearch_transfer_GPU_to_CPU(mBuff));
+  //Set real size of the input
+  mBuff->data.ssearch.seeds.numSeeds = numMisses;
+  mBuff->data.ssearch.saIntervals.numIntervals = numMisses;
+
+  if(numMisses > 0){
+    //Select the device of the Multi-GPU platform
+    CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
+    GPU_ERROR(gpu_fmi_ssearch_transfer_CPU_to_GPU(mBuff));
+    GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
+    GPU_ERROR(gpu_fmi_ssearch_process_buffer(mBuff));
+    GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
+    GPU_ERROR(gpu_fmi_ssearch_transfer_GPU_to_CPU(mBuff));
+  }
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_ssearch send", timeSend);
 }
 
 void gpu_fmi_ssearch_receive_buffer_(const void* const fmiBuffer)
 {
-  const gpu_buffer_t* const mBuff    = (gpu_buffer_t *) fmiBuffer;
-  const cudaStream_t        idStream =  mBuff->listStreams[mBuff->idStream];
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff    = (gpu_buffer_t *) fmiBuffer;
+  const cudaStream_t  idStream =  mBuff->listStreams[mBuff->idStream];
+  uint32_t            numSeeds;
 
   //Synchronize Stream (the thread wait for the commands done in the stream)
   CUDA_ERROR(cudaStreamSynchronize(idStream));
+  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
+  //Place the cached intervals back among the device results (in the submitted order)
+  numSeeds = gpu_fmi_cache_merge(mBuff->idBuffer, mBuff->data.ssearch.seeds.h_seeds, mBuff->data.ssearch.saIntervals.h_intervals);
+  if(numSeeds > 0){
+    mBuff->data.ssearch.seeds.numSeeds           = numSeeds;
+    mBuff->data.ssearch.saIntervals.numIntervals = numSeeds;
+  }
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "fmi_ssearch receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+void gpu_fmi_ssearch_receive_batch_(void* const fmiBuffer)
+{
+  gpu_buffer_t* const          mBuff       = (gpu_buffer_t *) fmiBuffer;
+  const gpu_buffer_batch_t*    batch       = &mBuff->batch;
+  gpu_sa_search_inter_t* const saIntervals = (gpu_sa_search_inter_t *) batch->h_results;
+  gpu_fmi_ssearch_receive_buffer_(fmiBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays
+  memcpy(saIntervals + batch->offset, mBuff->data.ssearch.saIntervals.h_intervals, batch->numElements * sizeof(gpu_sa_search_inter_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_fmi_ssearch_send_batch_(void* const fmiBuffer, const gpu_fmi_search_seed_t* const seeds, const uint32_t numSeeds,
+                                 gpu_sa_search_inter_t* const saIntervals)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) fmiBuffer;
+  const uint32_t      maxSeeds       = GPU_MIN(mBuff->data.ssearch.numMaxSeeds, mBuff->data.ssearch.numMaxIntervals);
+  const uint32_t      numSubBatches  = (maxSeeds == 0) ? 0 : GPU_DIV_CEIL(numSeeds, maxSeeds);
+  uint32_t            offset         = 0;
+  //Sanity-check (the buffer can not hold a single element)
+  if((maxSeeds == 0) && (numSeeds != 0)){
+    gpu_stats_add_overflow(&mBuff->stats);
+    GPU_ERROR(E_OVERFLOWING_BUFFER);
+  }
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    const uint32_t numSubSeeds = GPU_MIN(numSeeds - offset, maxSeeds);
+    memcpy(mBuff->data.ssearch.seeds.h_seeds, seeds + offset, numSubSeeds * sizeof(gpu_fmi_search_seed_t));
+    gpu_fmi_ssearch_send_buffer_(fmiBuffer, numSubSeeds);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubSeeds, 0, 0, saIntervals, NULL, NULL);
+    offset += numSubSeeds;
+    if(offset < numSeeds) gpu_fmi_ssearch_receive_batch_(fmiBuffer);
+  } while(offset < numSeeds);
 }
 
 #endif /* GPU_FMI_PRIMITIVES_C_ */
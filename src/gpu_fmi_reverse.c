@@ -0,0 +1,205 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_REVERSE_C_
+#define GPU_FMI_REVERSE_C_
+
+#include "../include/gpu_fmi_reverse.h"
+
+
+/************************************************************
+ LOCAL METHODS: Suffix sorting primitives (SA-IS)
+************************************************************/
+
+uint64_t gpu_fmi_reverse_get_symbol(const void* const text, const uint32_t symbolBytes, const int64_t position)
+{
+  // The first level sorts 8-bit symbols, the recursion levels sort the 64-bit names of the LMS substrings
+  return((symbolBytes == sizeof(uint8_t)) ? ((const uint8_t*) text)[position] : (uint64_t)((const int64_t*) text)[position]);
+}
+
+bool gpu_fmi_reverse_get_type(const uint8_t* const types, const int64_t position)
+{
+  return((types[position / GPU_UINT8_LENGTH] >> (position % GPU_UINT8_LENGTH)) & 0x1);
+}
+
+void gpu_fmi_reverse_set_type(uint8_t* const types, const int64_t position, const bool typeS)
+{
+  const uint8_t mask = GPU_UINT32_ONE_MASK << (position % GPU_UINT8_LENGTH);
+  if(typeS) types[position / GPU_UINT8_LENGTH] |= mask;
+    else types[position / GPU_UINT8_LENGTH] &= ~mask;
+}
+
+bool gpu_fmi_reverse_is_LMS(const uint8_t* const types, const int64_t position)
+{
+  // Leftmost S-type position (S-type preceded by an L-type)
+  return((position > 0) && gpu_fmi_reverse_get_type(types, position) && !gpu_fmi_reverse_get_type(types, position - 1));
+}
+
+void gpu_fmi_reverse_get_buckets(const void* const text, const uint32_t symbolBytes, const int64_t textSize,
+                                 int64_t* const buckets, const uint64_t alphabetSize, const bool bucketEnd)
+{
+  int64_t position, sum = 0;
+  uint64_t idSymbol;
+  for(idSymbol = 0; idSymbol < alphabetSize; ++idSymbol) buckets[idSymbol] = 0;
+  for(position = 0; position < textSize; ++position) buckets[gpu_fmi_reverse_get_symbol(text, symbolBytes, position)]++;
+  for(idSymbol = 0; idSymbol < alphabetSize; ++idSymbol){
+    sum += buckets[idSymbol];
+    buckets[idSymbol] = bucketEnd ? sum : sum - buckets[idSymbol];
+  }
+}
+
+void gpu_fmi_reverse_induce_L(const uint8_t* const types, int64_t* const SA, const void* const text, const uint32_t symbolBytes,
+                              int64_t* const buckets, const int64_t textSize, const uint64_t alphabetSize)
+{
+  int64_t idSuffix;
+  gpu_fmi_reverse_get_buckets(text, symbolBytes, textSize, buckets, alphabetSize, false);
+  for(idSuffix = 0; idSuffix < textSize; ++idSuffix){
+    const int64_t position = SA[idSuffix] - 1;
+    if((position >= 0) && !gpu_fmi_reverse_get_type(types, position))
+      SA[buckets[gpu_fmi_reverse_get_symbol(text, symbolBytes, position)]++] = position;
+  }
+}
+
+void gpu_fmi_reverse_induce_S(const uint8_t* const types, int64_t* const SA, const void* const text, const uint32_t symbolBytes,
+                              int64_t* const buckets, const int64_t textSize, const uint64_t alphabetSize)
+{
+  int64_t idSuffix;
+  gpu_fmi_reverse_get_buckets(text, symbolBytes, textSize, buckets, alphabetSize, true);
+  for(idSuffix = textSize - 1; idSuffix >= 0; --idSuffix){
+    const int64_t position = SA[idSuffix] - 1;
+    if((position >= 0) && gpu_fmi_reverse_get_type(types, position))
+      SA[--buckets[gpu_fmi_reverse_get_symbol(text, symbolBytes, position)]] = position;
+  }
+}
+
+gpu_error_t gpu_fmi_reverse_sort_suffixes(const void* const text, const uint32_t symbolBytes, int64_t* const SA,
+                                          const int64_t textSize, const uint64_t alphabetSize)
+{
+  // The text ends with a unique terminator (the smallest symbol)
+  uint8_t *types   = (uint8_t *) calloc(GPU_DIV_CEIL(textSize, GPU_UINT8_LENGTH), sizeof(uint8_t));
+  int64_t *buckets = (int64_t *) malloc(alphabetSize * sizeof(int64_t));
+  int64_t idSuffix, position, numLMS = 0, numNames = 0, previous = GPU_FMI_REVERSE_SA_EMPTY;
+  int64_t *reducedSA = SA, *reducedText = NULL;
+  if((types == NULL) || (buckets == NULL)){
+    free(types);
+    free(buckets);
+    return(E_ALLOCATE_MEM);
+  }
+  // Classify the suffixes (S-type / L-type)
+  gpu_fmi_reverse_set_type(types, textSize - 1, true);
+  if(textSize > 1) gpu_fmi_reverse_set_type(types, textSize - 2, false);
+  for(position = textSize - 3; position >= 0; --position){
+    const uint64_t symbol = gpu_fmi_reverse_get_symbol(text, symbolBytes, position);
+    const uint64_t next   = gpu_fmi_reverse_get_symbol(text, symbolBytes, position + 1);
+    gpu_fmi_reverse_set_type(types, position, (symbol < next) || ((symbol == next) && gpu_fmi_reverse_get_type(types, position + 1)));
+  }
+  // Stage 1: sort the LMS substrings
+  gpu_fmi_reverse_get_buckets(text, symbolBytes, textSize, buckets, alphabetSize, true);
+  for(idSuffix = 0; idSuffix < textSize; ++idSuffix) SA[idSuffix] = GPU_FMI_REVERSE_SA_EMPTY;
+  for(position = 1; position < textSize; ++position)
+    if(gpu_fmi_reverse_is_LMS(types, position)) SA[--buckets[gpu_fmi_reverse_get_symbol(text, symbolBytes, position)]] = position;
+  gpu_fmi_reverse_induce_L(types, SA, text, symbolBytes, buckets, textSize, alphabetSize);
+  gpu_fmi_reverse_induce_S(types, SA, text, symbolBytes, buckets, textSize, alphabetSize);
+  // Compact the sorted LMS substrings and name them (equal substrings share the name)
+  for(idSuffix = 0; idSuffix < textSize; ++idSuffix)
+    if(gpu_fmi_reverse_is_LMS(types, SA[idSuffix])) SA[numLMS++] = SA[idSuffix];
+  for(idSuffix = numLMS; idSuffix < textSize; ++idSuffix) SA[idSuffix] = GPU_FMI_REVERSE_SA_EMPTY;
+  for(idSuffix = 0; idSuffix < numLMS; ++idSuffix){
+    const int64_t current = SA[idSuffix];
+    bool diff = false;
+    int64_t offset;
+    for(offset = 0; offset < textSize; ++offset){
+      if((previous == GPU_FMI_REVERSE_SA_EMPTY) ||
+         (gpu_fmi_reverse_get_symbol(text, symbolBytes, current + offset) != gpu_fmi_reverse_get_symbol(text, symbolBytes, previous + offset)) ||
+         (gpu_fmi_reverse_get_type(types, current + offset) != gpu_fmi_reverse_get_type(types, previous + offset))){
+        diff = true;
+        break;
+      }else if((offset > 0) && (gpu_fmi_reverse_is_LMS(types, current + offset) || gpu_fmi_reverse_is_LMS(types, previous + offset))){
+        break;
+      }
+    }
+    if(diff){
+      numNames++;
+      previous = current;
+    }
+    SA[numLMS + (current / 2)] = numNames - 1;
+  }
+  for(idSuffix = textSize - 1, position = textSize - 1; idSuffix >= numLMS; --idSuffix)
+    if(SA[idSuffix] >= 0) SA[position--] = SA[idSuffix];
+  // Stage 2: sort the reduced text (recursing while the names are not unique)
+  reducedText = SA + textSize - numLMS;
+  if(numNames < numLMS){
+    GPU_ERROR(gpu_fmi_reverse_sort_suffixes(reducedText, sizeof(int64_t), reducedSA, numLMS, numNames));
+  }else{
+    for(idSuffix = 0; idSuffix < numLMS; ++idSuffix) reducedSA[reducedText[idSuffix]] = idSuffix;
+  }
+  // Stage 3: induce the SA from the sorted LMS suffixes
+  gpu_fmi_reverse_get_buckets(text, symbolBytes, textSize, buckets, alphabetSize, true);
+  for(position = 1, idSuffix = 0; position < textSize; ++position)
+    if(gpu_fmi_reverse_is_LMS(types, position)) reducedText[idSuffix++] = position;
+  for(idSuffix = 0; idSuffix < numLMS; ++idSuffix) reducedSA[idSuffix] = reducedText[reducedSA[idSuffix]];
+  for(idSuffix = numLMS; idSuffix < textSize; ++idSuffix) SA[idSuffix] = GPU_FMI_REVERSE_SA_EMPTY;
+  for(idSuffix = numLMS - 1; idSuffix >= 0; --idSuffix){
+    position = SA[idSuffix];
+    SA[idSuffix] = GPU_FMI_REVERSE_SA_EMPTY;
+    SA[--buckets[gpu_fmi_reverse_get_symbol(text, symbolBytes, position)]] = position;
+  }
+  gpu_fmi_reverse_induce_L(types, SA, text, symbolBytes, buckets, textSize, alphabetSize);
+  gpu_fmi_reverse_induce_S(types, SA, text, symbolBytes, buckets, textSize, alphabetSize);
+  free(buckets);
+  free(types);
+  return(SUCCESS);
+}
+
+
+/************************************************************
+ GLOBAL METHODS: Construction of the reverse BWT
+************************************************************/
+
+gpu_error_t gpu_fmi_reverse_build_BWT(const uint8_t* const text, const uint64_t textSize, char** const h_BWT)
+{
+  // Reversed text + sentinel + terminator (N and the sentinel sort after T as in the forward FM-index)
+  const char     LUT[GPU_FMI_REVERSE_ALPHABET_SIZE] = {'N', 'A', 'C', 'G', 'T', 'N', 'N'};
+  const uint64_t bwtSize = textSize + 1, sortSize = textSize + 2;
+  uint8_t *reverseText = (uint8_t *) malloc(sortSize * sizeof(uint8_t));
+  int64_t *SA          = (int64_t *) malloc(sortSize * sizeof(int64_t));
+  char    *bwt         = (char *) malloc(bwtSize * sizeof(char));
+  uint64_t position;
+  if((reverseText == NULL) || (SA == NULL) || (bwt == NULL)) return(E_ALLOCATE_MEM);
+  for(position = 0; position < textSize; ++position){
+    const uint8_t base = text[textSize - position - 1];
+    reverseText[position] = (base < GPU_FMI_NUM_COUNTERS) ? base + 1 : GPU_FMI_REVERSE_SYMBOL_N;
+  }
+  reverseText[textSize]     = GPU_FMI_REVERSE_SYMBOL_SENTINEL;
+  reverseText[textSize + 1] = GPU_FMI_REVERSE_SYMBOL_TERMINATOR;
+  GPU_ERROR(gpu_fmi_reverse_sort_suffixes(reverseText, sizeof(uint8_t), SA, sortSize, GPU_FMI_REVERSE_ALPHABET_SIZE));
+  // The terminator suffix is the first one (its row is not part of the BWT)
+  for(position = 0; position < bwtSize; ++position){
+    const int64_t suffix = SA[position + 1];
+    bwt[position] = LUT[(suffix == 0) ? GPU_FMI_REVERSE_SYMBOL_SENTINEL : reverseText[suffix - 1]];
+  }
+  free(reverseText);
+  free(SA);
+  (* h_BWT) = bwt;
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_fmi_index_build_reverse(const uint8_t* const text, const uint64_t textSize, gpu_fmi_buffer_t* const fmiReverse)
+{
+  // Text encoded with 2 bits per base (non-bases as N) covered by the forward FM-index
+  char* h_BWT = NULL;
+  GPU_ERROR(gpu_fmi_reverse_build_BWT(text, textSize, &h_BWT));
+  fmiReverse->bwtSize = textSize + 1;
+  if(fmiReverse->h_fmi == NULL) GPU_ERROR(gpu_fmi_index_allocate(fmiReverse));
+  GPU_ERROR(gpu_fmi_index_transform_ASCII(h_BWT, fmiReverse));
+  free(h_BWT);
+  return(SUCCESS);
+}
+
+#endif /* GPU_FMI_REVERSE_C_ */
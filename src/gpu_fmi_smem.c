@@ -0,0 +1,189 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_FMI_SMEM_C_
+#define GPU_FMI_SMEM_C_
+
+#include "../include/gpu_fmi_primitives.h"
+
+/************************************************************
+Functions to extend the bi-intervals over the host index
+************************************************************/
+
+bool gpu_fmi_smem_extend(const gpu_fmi_buffer_t* const fmi, const gpu_fmi_host_entry_t* const h_fmiHost, const uint32_t base,
+                         uint64_t* const low, uint64_t* const lowOther, uint64_t* const size)
+{
+  // Backward extension over 'fmi', the interval of the other BWT is ordered by the extension base
+  // (N and the sentinel sort after T, the counters start the A bucket at 0)
+  const uint64_t hi = (* low) + (* size);
+  uint64_t lowBase = 0, sizeBase = 0, offsetOther = 0;
+  uint32_t idBase;
+  for(idBase = 0; idBase <= base; ++idBase){
+    lowBase  = gpu_fmi_index_host_LF_rank(fmi, h_fmiHost, (* low), idBase);
+    sizeBase = gpu_fmi_index_host_LF_rank(fmi, h_fmiHost, hi, idBase) - lowBase;
+    if(idBase < base) offsetOther += sizeBase;
+  }
+  (* low)       = lowBase;
+  (* lowOther) += offsetOther;
+  (* size)      = sizeBase;
+  return(sizeBase != 0);
+}
+
+bool gpu_fmi_smem_extend_backward(const gpu_fmi_smem_context_t* const search, const uint32_t base, gpu_fmi_smem_seed_t* const seed)
+{
+  // Prepends the base to the seed (rank over the BWT of the text)
+  return(gpu_fmi_smem_extend(search->fmi, search->h_fmiHost, base, &seed->low, &seed->low_reverse, &seed->size));
+}
+
+bool gpu_fmi_smem_extend_forward(const gpu_fmi_smem_context_t* const search, const uint32_t base, gpu_fmi_smem_seed_t* const seed)
+{
+  // Appends the base to the seed (rank over the BWT of the reversed text)
+  return(gpu_fmi_smem_extend(search->fmiReverse, search->h_fmiHostReverse, base, &seed->low_reverse, &seed->low, &seed->size));
+}
+
+/************************************************************
+Functions to gather the SMEMs of a query
+************************************************************/
+
+void gpu_fmi_smem_reverse_seeds(gpu_fmi_smem_seed_t* const seeds, const uint32_t numSeeds)
+{
+  uint32_t idSeed;
+  for(idSeed = 0; idSeed < (numSeeds >> 1); ++idSeed){
+    const gpu_fmi_smem_seed_t seed   = seeds[idSeed];
+    seeds[idSeed]                    = seeds[numSeeds - idSeed - 1];
+    seeds[numSeeds - idSeed - 1]     = seed;
+  }
+}
+
+void gpu_fmi_smem_add_seed(gpu_fmi_smem_context_t* const search, const gpu_fmi_smem_seed_t* const seed, const uint32_t initOffset)
+{
+  // Short SMEMs are discarded, the rest are kept while there are free slots
+  if((seed->end_offset - initOffset) < search->minSeedLength) return;
+  if(search->numSeeds < search->maxSeeds){
+    gpu_fmi_smem_seed_t* const slot = &search->seeds[search->numSeeds];
+    (* slot)          = (* seed);
+    slot->init_offset = initOffset;
+    search->numSeeds++;
+  }else{
+    search->numDropped++;
+  }
+}
+
+uint32_t gpu_fmi_smem_search_position(gpu_fmi_smem_context_t* const search, const uint32_t position)
+{
+  // SMEMs covering the query position (returns the next position to be covered)
+  const gpu_fmi_search_query_t* const query     = search->query;
+  const uint32_t                      querySize = search->querySize;
+  const uint32_t                      firstSeed = search->numSeeds;
+  gpu_fmi_smem_seed_t *prev = search->prev, *curr = search->curr, *swap = NULL, seed;
+  uint32_t numPrev = 0, numCurr = 0, idBase, idCandidate, nextPosition, lastInitOffset = GPU_UINT32_ONES;
+  int32_t  idPrevBase;
+  if(query[position] & GPU_ENC_DNA_CHAR_N) return(position + 1);
+  seed.low  = 0; seed.low_reverse = 0; seed.size = search->fmi->bwtSize;
+  if(!gpu_fmi_smem_extend_forward(search, query[position], &seed)) return(position + 1);
+  seed.end_offset = position + 1;
+  // Forward extension: the candidates are the prefixes where the interval shrinks
+  for(idBase = position + 1; idBase < querySize; ++idBase){
+    gpu_fmi_smem_seed_t extended = seed;
+    if(query[idBase] & GPU_ENC_DNA_CHAR_N){
+      curr[numCurr++] = seed;
+      break;
+    }
+    gpu_fmi_smem_extend_forward(search, query[idBase], &extended);
+    if(extended.size != seed.size){
+      curr[numCurr++] = seed;
+      if(extended.size == 0) break;
+    }
+    seed = extended;
+    seed.end_offset = idBase + 1;
+  }
+  if(idBase == querySize) curr[numCurr++] = seed;
+  // Longest candidates first (smallest intervals)
+  gpu_fmi_smem_reverse_seeds(curr, numCurr);
+  nextPosition = curr[0].end_offset;
+  swap = curr; curr = prev; prev = swap;
+  numPrev = numCurr;
+  // Backward extension of all the candidates at once (one base per step)
+  for(idPrevBase = (int32_t) position - 1; idPrevBase >= -1; --idPrevBase){
+    const bool stopExtension = (idPrevBase < 0) || (query[idPrevBase] & GPU_ENC_DNA_CHAR_N);
+    numCurr = 0;
+    for(idCandidate = 0; idCandidate < numPrev; ++idCandidate){
+      gpu_fmi_smem_seed_t extended = prev[idCandidate];
+      const bool extensionFound = !stopExtension && gpu_fmi_smem_extend_backward(search, query[idPrevBase], &extended);
+      if(!extensionFound){
+        // Maximal candidate: reported unless a longer one keeps extending or the last SMEM contains it
+        if((numCurr == 0) && ((uint32_t)(idPrevBase + 1) < lastInitOffset)){
+          gpu_fmi_smem_add_seed(search, &prev[idCandidate], idPrevBase + 1);
+          lastInitOffset = idPrevBase + 1;
+        }
+      }else if((numCurr == 0) || (extended.size != curr[numCurr - 1].size)){
+        curr[numCurr++] = extended;
+      }
+    }
+    if(numCurr == 0) break;
+    swap = curr; curr = prev; prev = swap;
+    numPrev = numCurr;
+  }
+  // SMEMs sorted by their query position
+  gpu_fmi_smem_reverse_seeds(search->seeds + firstSeed, search->numSeeds - firstSeed);
+  return(nextPosition);
+}
+
+void gpu_fmi_smem_process_query(gpu_fmi_smem_context_t* const search, gpu_fmi_smem_result_t* const result,
+                                gpu_fmi_smem_seed_t* const seeds)
+{
+  uint32_t position = 0;
+  search->seeds      = seeds;
+  search->numSeeds   = 0;
+  search->numDropped = 0;
+  // Each pass covers the query up to the end of its longest forward match
+  while(position < search->querySize)
+    position = gpu_fmi_smem_search_position(search, position);
+  result->num_seeds   = search->numSeeds;
+  result->num_dropped = search->numDropped;
+}
+
+gpu_error_t gpu_fmi_smem_process_buffer(gpu_buffer_t* const mBuff)
+{
+  const gpu_fmi_smem_queries_buffer_t* qryBuff    = &mBuff->data.smem.queries;
+  const gpu_fmi_smem_seeds_buffer_t*   seedBuff   = &mBuff->data.smem.seeds;
+  const gpu_fmi_buffer_t* const        fmi        = &mBuff->index->fmi;
+  const gpu_fmi_buffer_t* const        fmiReverse = &mBuff->index->fmiReverse;
+  gpu_fmi_smem_context_t search;
+  gpu_fmi_smem_seed_t *candidates = NULL;
+  uint32_t idQuery, maxQuerySize = 0;
+  // Both BWTs of the bidirectional index are kept in the host when the module is active
+  if((fmi->h_fmiHost == NULL) && (fmi->h_fmi == NULL)) return(E_DATA_NOT_ALLOCATED);
+  if((fmiReverse->h_fmiHost == NULL) && (fmiReverse->h_fmi == NULL)) return(E_DATA_NOT_ALLOCATED);
+  for(idQuery = 0; idQuery < qryBuff->numQueries; ++idQuery)
+    maxQuerySize = GPU_MAX(maxQuerySize, qryBuff->h_queryInfo[idQuery].query_size);
+  candidates = (gpu_fmi_smem_seed_t *) malloc(2 * (maxQuerySize + 1) * sizeof(gpu_fmi_smem_seed_t));
+  if(candidates == NULL) return(E_ALLOCATE_MEM);
+  // Search setup shared by all the queries of the buffer
+  search.fmi              = fmi;
+  search.h_fmiHost        = (fmi->h_fmiHost != NULL) ? (const gpu_fmi_host_entry_t *) gpu_numa_replicas_get_local(&fmi->hostReplicas, fmi->h_fmiHost) : NULL;
+  search.fmiReverse       = fmiReverse;
+  search.h_fmiHostReverse = (fmiReverse->h_fmiHost != NULL) ? (const gpu_fmi_host_entry_t *) gpu_numa_replicas_get_local(&fmiReverse->hostReplicas, fmiReverse->h_fmiHost) : NULL;
+  search.minSeedLength    = mBuff->data.smem.minSeedLength;
+  search.prev             = candidates;
+  search.curr             = candidates + maxQuerySize + 1;
+  search.maxSeeds         = mBuff->data.smem.maxSeedsPerQuery;
+  // Each query fills its seed slots
+  for(idQuery = 0; idQuery < qryBuff->numQueries; ++idQuery){
+    const gpu_fmi_search_query_info_t* const queryInfo = &qryBuff->h_queryInfo[idQuery];
+    gpu_fmi_smem_result_t* const             result    = &qryBuff->h_results[idQuery];
+    search.query     = qryBuff->h_queries + queryInfo->init_offset;
+    search.querySize = queryInfo->query_size;
+    gpu_fmi_smem_process_query(&search, result, seedBuff->h_seeds + result->init_offset);
+  }
+  free(candidates);
+  return(SUCCESS);
+}
+
+#endif /* GPU_FMI_SMEM_C_ */
@@ -69,35 +69,6 @@ void __global__ gpu_fmi_ssearch_kernel(const gpu_fmi_device_entry_t* const fmi,
   }
 }
 
-extern "C"
-gpu_error_t gpu_fmi_ssearch_launch_kernel(const gpu_fmi_device_entry_t* const d_fmi, const uint64_t bwtSize, const uint32_t numSeeds,
-                                          const ulonglong2* const d_seeds, ulonglong2* const d_intervals)
-{
-  const uint32_t threads = 128;
-  const uint32_t blocks  = GPU_DIV_CEIL(numSeeds * GPU_FMI_SEED_THREADS_PER_ENTRY, threads);
-  const uint32_t nreps   = 10;
-
-  float elapsed_time_ms = 0.0f;
-  cudaEvent_t start, stop;
-  cudaEventCreate(&start);
-  cudaEventCreate(&stop);
-  cudaEventRecord(start, 0);
-
-    for(uint32_t iteration = 0; iteration < nreps; ++iteration)
-      gpu_fmi_ssearch_kernel<<<blocks,threads>>>(d_fmi, bwtSize, numSeeds, d_seeds, d_intervals);
-
-  cudaEventRecord(stop, 0);
-  cudaThreadSynchronize();
-  cudaEventElapsedTime(&elapsed_time_ms, start, stop);
-  elapsed_time_ms /= nreps;
-
-  cudaEventDestroy(start);
-  cudaEventDestroy(stop);
-  printf("\t Time Kernel GPU:  %8.2f ms\n", elapsed_time_ms);
-
-  return(SUCCESS);
-}
-
 extern "C"
 gpu_error_t gpu_fmi_ssearch_process_buffer(gpu_buffer_t* const mBuff)
 {
@@ -115,8 +86,10 @@ gpu_error_t gpu_fmi_ssearch_process_buffer(gpu_buffer_t* const mBuff)
   const uint32_t numThreads = numSeeds * GPU_FMI_SEED_THREADS_PER_ENTRY;
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
-  if((numSeeds > numMaxSeeds) || (numSeeds > numMaxIntervals)) 
+  if((numSeeds > numMaxSeeds) || (numSeeds > numMaxIntervals)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
+  }
 
   gpu_fmi_ssearch_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>((gpu_fmi_device_entry_t*) index->fmi.d_fmi[idSupDev], index->fmi.bwtSize,
                                                                          numSeeds, (ulonglong2*) seeds->d_seeds, (ulonglong2*) saIntervals->d_intervals);
@@ -11,6 +11,7 @@
 #define GPU_FMI_TABLE_C_
 
 #include "../include/gpu_fmi_table.h"
+#include "../include/gpu_shm.h"
 
 /* Local function for fmi-table rank queries */
 uint32_t countBitmapCPU(const uint32_t bitmap, const int32_t shift, const uint32_t idxCounterGroup)
@@ -295,19 +296,10 @@ gpu_error_t gpu_fmi_table_allocate(gpu_fmi_table_t* const fmiTable)
 {
   // Init the fmi-table specifications
   GPU_ERROR(gpu_fmi_table_get_num_elements(fmiTable->maxLevelsTableLUT, &fmiTable->totalElemTableLUT));
-  if(fmiTable->hostAllocStats & GPU_PAGE_LOCKED){
-    // Allocate the metadata used in the LUT fmi-table
-    CUDA_ERROR(cudaHostAlloc((void**) &fmiTable->h_offsetsTableLUT, fmiTable->maxLevelsTableLUT * sizeof(offset_table_t), cudaHostAllocMapped));
-    // Allocate the space used for the LUT fmi-table
-    CUDA_ERROR(cudaHostAlloc((void**) &fmiTable->h_fmiTableLUT, fmiTable->totalElemTableLUT * sizeof(gpu_sa_entry_t), cudaHostAllocMapped));
-  }else{
-    // Allocate the metadata used in the LUT fmi-table
-    fmiTable->h_offsetsTableLUT = (offset_table_t*) malloc(fmiTable->maxLevelsTableLUT * sizeof(offset_table_t));
-    if (fmiTable->h_offsetsTableLUT == NULL) return (E_ALLOCATE_MEM);
-    // Allocate the space used for the LUT fmi-table
-    fmiTable->h_fmiTableLUT = (gpu_sa_entry_t*) malloc(fmiTable->totalElemTableLUT * sizeof(gpu_sa_entry_t));
-    if (fmiTable->h_fmiTableLUT == NULL) return (E_ALLOCATE_MEM);
-  }
+  // Allocate the metadata used in the LUT fmi-table
+  GPU_ERROR(gpu_hugepages_alloc((void**) &fmiTable->h_offsetsTableLUT, fmiTable->maxLevelsTableLUT * sizeof(offset_table_t), fmiTable->hostAllocStats));
+  // Allocate the space used for the LUT fmi-table (huge pages when enabled)
+  GPU_ERROR(gpu_hugepages_alloc((void**) &fmiTable->h_fmiTableLUT, fmiTable->totalElemTableLUT * sizeof(gpu_sa_entry_t), fmiTable->hostAllocStats));
   // Succeed
   return(SUCCESS);
 }
@@ -409,12 +401,16 @@ gpu_error_t gpu_fmi_table_transfer_CPU_to_GPUs(gpu_fmi_table_t* const fmiTable,
       if ((GPU_CONVERT__B_TO_MB(cpySizeMeta + cpySizeLUT)) > deviceFreeMemory)
         return(E_INSUFFICIENT_MEM_GPU);
       CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
-      //Synchronous allocate & transfer the FM-index to the GPU
-      CUDA_ERROR(cudaMalloc((void**) &fmiTable->d_offsetsTableLUT[idSupportedDevice], cpySizeMeta));
-      CUDA_ERROR(cudaMemcpy(fmiTable->d_offsetsTableLUT[idSupportedDevice], fmiTable->h_offsetsTableLUT, cpySizeMeta, cudaMemcpyHostToDevice));
-      //Synchronous allocate & transfer the FM-index to the GPU
-      CUDA_ERROR(cudaMalloc((void**) &fmiTable->d_fmiTableLUT[idSupportedDevice], cpySizeLUT));
-      CUDA_ERROR(cudaMemcpy(fmiTable->d_fmiTableLUT[idSupportedDevice], fmiTable->h_fmiTableLUT, cpySizeLUT, cudaMemcpyHostToDevice));
+      //Synchronous allocate & transfer the FM-index to the GPU (or import the copy of a shared index)
+      if(!gpu_shm_open_device(GPU_SHM_FMI_TABLE_OFFSETS, devices[idSupportedDevice], (void**) &fmiTable->d_offsetsTableLUT[idSupportedDevice])){
+        CUDA_ERROR(cudaMalloc((void**) &fmiTable->d_offsetsTableLUT[idSupportedDevice], cpySizeMeta));
+        CUDA_ERROR(cudaMemcpy(fmiTable->d_offsetsTableLUT[idSupportedDevice], fmiTable->h_offsetsTableLUT, cpySizeMeta, cudaMemcpyHostToDevice));
+      }
+      //Synchronous allocate & transfer the FM-index to the GPU (or import the copy of a shared index)
+      if(!gpu_shm_open_device(GPU_SHM_FMI_TABLE_LUT, devices[idSupportedDevice], (void**) &fmiTable->d_fmiTableLUT[idSupportedDevice])){
+        CUDA_ERROR(cudaMalloc((void**) &fmiTable->d_fmiTableLUT[idSupportedDevice], cpySizeLUT));
+        CUDA_ERROR(cudaMemcpy(fmiTable->d_fmiTableLUT[idSupportedDevice], fmiTable->h_fmiTableLUT, cpySizeLUT, cudaMemcpyHostToDevice));
+      }
     }else{
       fmiTable->d_offsetsTableLUT[idSupportedDevice] = fmiTable->h_offsetsTableLUT;
       fmiTable->d_fmiTableLUT[idSupportedDevice]     = fmiTable->h_fmiTableLUT;
@@ -508,18 +504,12 @@ gpu_error_t gpu_fmi_table_get_size(const gpu_fmi_table_t* const fmiTable, size_t
 gpu_error_t gpu_fmi_table_free_host(gpu_fmi_table_t* const fmiTable)
 {
   if(fmiTable->h_offsetsTableLUT != NULL){
-    if(fmiTable->hostAllocStats == GPU_PAGE_LOCKED)
-      CUDA_ERROR(cudaFreeHost(fmiTable->h_offsetsTableLUT));
-    else
-      free(fmiTable->h_offsetsTableLUT);
+    GPU_ERROR(gpu_hugepages_free(fmiTable->h_offsetsTableLUT, fmiTable->hostAllocStats));
     fmiTable->h_offsetsTableLUT = NULL;
   }
 
   if(fmiTable->h_fmiTableLUT != NULL){
-    if(fmiTable->hostAllocStats == GPU_PAGE_LOCKED)
-      CUDA_ERROR(cudaFreeHost(fmiTable->h_fmiTableLUT));
-    else
-      free(fmiTable->h_fmiTableLUT);
+    GPU_ERROR(gpu_hugepages_free(fmiTable->h_fmiTableLUT, fmiTable->hostAllocStats));
     fmiTable->h_fmiTableLUT = NULL;
   }
   // Succeed
@@ -554,12 +544,12 @@ gpu_error_t gpu_fmi_table_free_device(gpu_fmi_table_t* const fmiTable, gpu_devic
     CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
     if(fmiTable->d_offsetsTableLUT[idSupportedDevice] != NULL){
       if(fmiTable->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED)
-        CUDA_ERROR(cudaFree(fmiTable->d_offsetsTableLUT[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(fmiTable->d_offsetsTableLUT[idSupportedDevice]));
       fmiTable->d_offsetsTableLUT[idSupportedDevice] = NULL;
     }
     if(fmiTable->d_fmiTableLUT[idSupportedDevice] != NULL){
       if(fmiTable->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED)
-        CUDA_ERROR(cudaFree(fmiTable->d_fmiTableLUT[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(fmiTable->d_fmiTableLUT[idSupportedDevice]));
       fmiTable->d_fmiTableLUT[idSupportedDevice] = NULL;
     }
   }
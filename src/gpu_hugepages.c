@@ -0,0 +1,226 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_HUGEPAGES_C_
+#define GPU_HUGEPAGES_C_
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/gpu_hugepages.h"
+#include <pthread.h>
+#include <sys/mman.h>
+
+/* Page size selectors of MAP_HUGETLB (not exported by old C libraries) */
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB   (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB   (30 << MAP_HUGE_SHIFT)
+#endif
+
+/* Process-wide policy and list of mapped regions (buffers are allocated concurrently by the threads) */
+static gpu_hugepages_t gpu_hugepages = {GPU_HOST_PAGES_DEFAULT, false, 0, 0};
+static pthread_mutex_t gpu_hugepages_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************************
+Configuration functions
+************************************************************/
+
+void gpu_hugepages_set_policy(const gpu_host_pages_t policy, const bool activeBuffers)
+{
+  gpu_hugepages.policy        = policy;
+  gpu_hugepages.activeBuffers = activeBuffers && (policy != GPU_HOST_PAGES_DEFAULT);
+}
+
+size_t gpu_hugepages_get_page_size()
+{
+  if(gpu_hugepages.minPageSize == 0) return(sysconf(_SC_PAGESIZE));
+  return(gpu_hugepages.minPageSize);
+}
+
+/************************************************************
+Functions to map the huge pages
+************************************************************/
+
+bool gpu_hugepages_transparent_enabled()
+{
+  // The active mode is enclosed in brackets (i.e. "always [madvise] never")
+  char line[GPU_NUMA_SYSFS_PATH_SIZE];
+  FILE* fp = fopen(GPU_HUGEPAGES_SYSFS_THP, "r");
+  bool  enabled = false;
+  if(fp == NULL) return(false);
+  if(fgets(line, sizeof(line), fp) != NULL) enabled = (strstr(line, "[never]") == NULL);
+  fclose(fp);
+  return(enabled);
+}
+
+void* gpu_hugepages_map_hugetlb(const size_t size, const int pageFlag)
+{
+  void* const memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageFlag, -1, 0);
+  return((memory == MAP_FAILED) ? NULL : memory);
+}
+
+void* gpu_hugepages_map_transparent(const size_t size, size_t* const pageSize)
+{
+  // Over-mapping to trim an aligned window (the kernel only collapses aligned 2MB extents)
+  const size_t mapSize = size + GPU_HUGEPAGES_SIZE_2MB;
+  uint8_t* const rawMemory = (uint8_t *) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  uint8_t* memory = NULL;
+  size_t   headSize, tailSize;
+  if(rawMemory == MAP_FAILED) return(NULL);
+  memory   = (uint8_t *) GPU_ROUND_TO((uintptr_t) rawMemory, GPU_HUGEPAGES_SIZE_2MB);
+  headSize = memory - rawMemory;
+  tailSize = mapSize - headSize - size;
+  if(headSize != 0) munmap(rawMemory, headSize);
+  if(tailSize != 0) munmap(memory + size, tailSize);
+  // Advice is only a hint: the obtained pages are ordinary ones when THP is disabled
+  if((madvise(memory, size, MADV_HUGEPAGE) == 0) && gpu_hugepages_transparent_enabled())
+    (* pageSize) = GPU_HUGEPAGES_SIZE_2MB;
+  else
+    (* pageSize) = sysconf(_SC_PAGESIZE);
+  return(memory);
+}
+
+void* gpu_hugepages_map(const size_t size, size_t* const mappedSize, size_t* const pageSize)
+{
+  void* memory = NULL;
+  // Explicit pages require a reserved pool (nr_hugepages), each failure falls to the next smaller page
+  switch(gpu_hugepages.policy){
+    case GPU_HOST_PAGES_HUGETLB_1GB:
+      (* mappedSize) = GPU_ROUND_TO(size, GPU_HUGEPAGES_SIZE_1GB);
+      (* pageSize)   = GPU_HUGEPAGES_SIZE_1GB;
+      memory = gpu_hugepages_map_hugetlb((* mappedSize), MAP_HUGE_1GB);
+      if(memory != NULL) break;
+      /* fall through */
+    case GPU_HOST_PAGES_HUGETLB_2MB:
+      (* mappedSize) = GPU_ROUND_TO(size, GPU_HUGEPAGES_SIZE_2MB);
+      (* pageSize)   = GPU_HUGEPAGES_SIZE_2MB;
+      memory = gpu_hugepages_map_hugetlb((* mappedSize), MAP_HUGE_2MB);
+      if(memory != NULL) break;
+      /* fall through */
+    case GPU_HOST_PAGES_TRANSPARENT:
+      (* mappedSize) = GPU_ROUND_TO(size, GPU_HUGEPAGES_SIZE_2MB);
+      memory = gpu_hugepages_map_transparent((* mappedSize), pageSize);
+      break;
+    default:
+      break;
+  }
+  return(memory);
+}
+
+/************************************************************
+Functions to keep track of the mapped regions
+************************************************************/
+
+void gpu_hugepages_update_page_size(const size_t pageSize)
+{
+  pthread_mutex_lock(&gpu_hugepages_mutex);
+  if((gpu_hugepages.minPageSize == 0) || (pageSize < gpu_hugepages.minPageSize))
+    gpu_hugepages.minPageSize = pageSize;
+  pthread_mutex_unlock(&gpu_hugepages_mutex);
+}
+
+bool gpu_hugepages_insert_region(const gpu_hugepages_region_t* const region)
+{
+  bool inserted = false;
+  pthread_mutex_lock(&gpu_hugepages_mutex);
+  if(gpu_hugepages.numRegions < GPU_HUGEPAGES_MAX_REGIONS){
+    gpu_hugepages.regions[gpu_hugepages.numRegions++] = (* region);
+    inserted = true;
+  }
+  pthread_mutex_unlock(&gpu_hugepages_mutex);
+  return(inserted);
+}
+
+bool gpu_hugepages_remove_region(void* const memory, gpu_hugepages_region_t* const region)
+{
+  bool removed = false;
+  uint32_t idRegion;
+  pthread_mutex_lock(&gpu_hugepages_mutex);
+  for(idRegion = 0; idRegion < gpu_hugepages.numRegions; ++idRegion){
+    if(gpu_hugepages.regions[idRegion].memory == memory){
+      (* region) = gpu_hugepages.regions[idRegion];
+      gpu_hugepages.regions[idRegion] = gpu_hugepages.regions[--gpu_hugepages.numRegions];
+      removed = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&gpu_hugepages_mutex);
+  return(removed);
+}
+
+/************************************************************
+Allocation functions
+************************************************************/
+
+gpu_error_t gpu_hugepages_alloc(void** const memory, const size_t size, const memory_stats_t hostAllocStats)
+{
+  const bool locked = (hostAllocStats & GPU_PAGE_LOCKED) != 0;
+  gpu_hugepages_region_t region = {NULL, 0, 0, locked};
+  // Huge page backing (page-locked regions are registered in the driver as mapped memory)
+  if((gpu_hugepages.policy != GPU_HOST_PAGES_DEFAULT) && (size >= GPU_HUGEPAGES_MIN_SIZE)){
+    region.memory = gpu_hugepages_map(size, &region.size, &region.pageSize);
+    if((region.memory != NULL) && locked && (cudaHostRegister(region.memory, region.size, cudaHostRegisterMapped) != cudaSuccess)){
+      cudaGetLastError();
+      munmap(region.memory, region.size);
+      region.memory = NULL;
+    }
+    if((region.memory != NULL) && !gpu_hugepages_insert_region(&region)){
+      if(locked) CUDA_ERROR(cudaHostUnregister(region.memory));
+      munmap(region.memory, region.size);
+      region.memory = NULL;
+    }
+    if(region.memory != NULL){
+      gpu_hugepages_update_page_size(region.pageSize);
+      (* memory) = region.memory;
+      return(SUCCESS);
+    }
+    gpu_hugepages_update_page_size(sysconf(_SC_PAGESIZE));
+  }
+  // Fall back to the ordinary allocators
+  if(locked){
+    CUDA_ERROR(cudaHostAlloc(memory, size, cudaHostAllocMapped));
+  }else{
+    (* memory) = malloc(size);
+    if((* memory) == NULL) return(E_ALLOCATE_MEM);
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_hugepages_alloc_buffer(void** const memory, const size_t size)
+{
+  if(gpu_hugepages.activeBuffers) return(gpu_hugepages_alloc(memory, size, GPU_PAGE_LOCKED));
+  CUDA_ERROR(cudaHostAlloc(memory, size, cudaHostAllocMapped));
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_hugepages_free(void* const memory, const memory_stats_t hostAllocStats)
+{
+  gpu_hugepages_region_t region;
+  // Shared segments are unmapped as a whole when released
+  if((memory == NULL) || (hostAllocStats == GPU_PAGE_SHARED)) return(SUCCESS);
+  if(gpu_hugepages_remove_region(memory, &region)){
+    if(region.locked) CUDA_ERROR(cudaHostUnregister(region.memory));
+    munmap(region.memory, region.size);
+  }else{
+    if(hostAllocStats == GPU_PAGE_LOCKED) CUDA_ERROR(cudaFreeHost(memory));
+    else free(memory);
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+#endif /* GPU_HUGEPAGES_C_ */
@@ -18,6 +18,19 @@
 Get information functions
 ************************************************************/
 
+bool gpu_index_is_bidirectional(const gpu_index_buffer_t* const index, const gpu_module_t activeModules)
+{
+  //The reverse BWT is only built and stored for the SMEM search
+  return((activeModules & index->activeModules & GPU_FMI_SMEM_SEARCH) != 0);
+}
+
+gpu_module_t gpu_index_get_stored_modules(const gpu_index_buffer_t* const index, const gpu_module_t activeModules)
+{
+  //The SMEM bit records in the containers that the reverse BWT follows the forward FM-index
+  const bool reverseStored = (activeModules & GPU_FMI) && (index->fmiReverse.h_fmi != NULL);
+  return(reverseStored ? activeModules : activeModules & ~GPU_FMI_SMEM_SEARCH);
+}
+
 gpu_error_t gpu_index_get_size(const gpu_index_buffer_t* const index, size_t *bytesPerIndex, const gpu_module_t activeModules)
 {
   (* bytesPerIndex) = 0;
@@ -28,6 +41,11 @@ gpu_error_t gpu_index_get_size(const gpu_index_buffer_t* const index, size_t *by
     (* bytesPerIndex) += bytesPerFMI;
     GPU_ERROR(gpu_fmi_table_get_size(&index->fmi.table, &bytesPerFmiTable));
     (* bytesPerIndex) += bytesPerFmiTable;
+    if(gpu_index_is_bidirectional(index, activeModules)){
+      size_t bytesPerReverseFMI = 0;
+      GPU_ERROR(gpu_fmi_index_get_size(&index->fmiReverse, &bytesPerReverseFMI));
+      (* bytesPerIndex) += bytesPerReverseFMI;
+    }
   }
 
   if(activeModules & GPU_SA){
@@ -63,6 +81,14 @@ gpu_error_t gpu_index_read(int fp, gpu_index_buffer_t* const index, const gpu_mo
     GPU_ERROR(gpu_fmi_table_read_specs(fp, &index->fmi.table));
     GPU_ERROR(gpu_fmi_index_read(fp, &index->fmi));
     GPU_ERROR(gpu_fmi_table_read(fp, &index->fmi.table));
+    if(index->fmi.activeHostLayout) GPU_ERROR(gpu_fmi_index_build_host_layout(&index->fmi));
+    //The modules describe the stream content, the reverse BWT is only loaded when allocated for the SMEM search
+    if(index->fmiReverse.h_fmi != NULL){
+      if((activeModules & GPU_FMI_SMEM_SEARCH) == 0) return(E_MODULE_NOT_FOUND);
+      GPU_ERROR(gpu_fmi_index_read_specs(fp, &index->fmiReverse));
+      GPU_ERROR(gpu_fmi_index_read(fp, &index->fmiReverse));
+      if(index->fmiReverse.activeHostLayout) GPU_ERROR(gpu_fmi_index_build_host_layout(&index->fmiReverse));
+    }
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_read_specs(fp, &index->sa));
@@ -90,6 +116,11 @@ gpu_error_t gpu_index_write(int fp, const gpu_index_buffer_t* const index, const
     GPU_ERROR(gpu_fmi_table_write_specs(fp, &index->fmi.table));
     GPU_ERROR(gpu_fmi_index_write(fp, &index->fmi));
     GPU_ERROR(gpu_fmi_table_write(fp, &index->fmi.table));
+    if(activeModules & GPU_FMI_SMEM_SEARCH){
+      if(index->fmiReverse.h_fmi == NULL) return(E_DATA_NOT_ALLOCATED);
+      GPU_ERROR(gpu_fmi_index_write_specs(fp, &index->fmiReverse));
+      GPU_ERROR(gpu_fmi_index_write(fp, &index->fmiReverse));
+    }
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_write_specs(fp, &index->sa));
@@ -124,7 +155,10 @@ gpu_error_t gpu_index_transform_ASCII(const gpu_index_dto_t* const textRaw, gpu_
 {
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_transform_ASCII(textRaw->fmi.h_plain, &index->fmi));
-    GPU_ERROR(gpu_fmi_table_construction(&index->fmi.table, index->fmi.h_fmi, index->fmi.bwtSize));
+    if(gpu_index_is_bidirectional(index, activeModules)){
+      if(textRaw->fmi.h_plainReverse == NULL) return(E_DATA_NOT_ALLOCATED);
+      GPU_ERROR(gpu_fmi_index_transform_ASCII(textRaw->fmi.h_plainReverse, &index->fmiReverse));
+    }
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_transform_ASCII(textRaw->sa.h_plain, &index->sa));
@@ -135,8 +169,9 @@ gpu_error_t gpu_index_transform_ASCII(const gpu_index_dto_t* const textRaw, gpu_
 gpu_error_t gpu_index_transform_GEM_FULL(const gpu_index_dto_t* const indexRaw, gpu_index_buffer_t* const index, const gpu_module_t activeModules)
 {
   if(activeModules & GPU_FMI){
+    //The GEM index only provides the backward BWT (the GEM containers store the reverse one)
+    if(gpu_index_is_bidirectional(index, activeModules)) return(E_MODULE_NOT_FOUND);
     GPU_ERROR(gpu_fmi_index_transform_GEM_FULL((gpu_gem_fmi_dto_t*)indexRaw, &index->fmi));
-    GPU_ERROR(gpu_fmi_table_construction(&index->fmi.table, index->fmi.h_fmi, index->fmi.bwtSize));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_transform_GEM_FULL((gpu_gem_sa_dto_t*)indexRaw, &index->sa));
@@ -164,8 +199,9 @@ gpu_error_t gpu_index_transform_MFASTA_FULL(const gpu_index_dto_t* const indexRa
   const char* const filename = indexRaw->filename;
 
   if(activeModules & GPU_FMI){
+    //The MFASTA file only provides the backward BWT (the GEM containers store the reverse one)
+    if(gpu_index_is_bidirectional(index, activeModules)) return(E_MODULE_NOT_FOUND);
     GPU_ERROR(gpu_fmi_index_transform_MFASTA_FULL(filename, &index->fmi));
-    GPU_ERROR(gpu_fmi_table_construction(&index->fmi.table, index->fmi.h_fmi, index->fmi.bwtSize));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_transform_MFASTA_FULL(filename, &index->sa));
@@ -238,11 +274,29 @@ gpu_error_t gpu_index_transform(gpu_index_buffer_t* const index, const gpu_index
 Index initialization functions
 ************************************************************/
 
+gpu_error_t gpu_index_select_sa_specs(gpu_index_buffer_t* const index, const gpu_module_t activeModules)
+{
+  const gpu_sa_buffer_t* const sa = &index->sa;
+  bool     densifyAllowed = false;
+  uint64_t saLength;
+  // Specifications not available yet
+  if((sa->sampligRate == 0) || (sa->numEntries == 0)) return (SUCCESS);
+  // Densify needs the FM-index covering the same text than the sampled SA
+  if((activeModules & GPU_FMI) && (index->fmi.bwtSize != 0))
+    densifyAllowed = (gpu_sa_index_get_num_entries(index->fmi.bwtSize, sa->sampligRate) == sa->numEntries);
+  saLength = densifyAllowed ? index->fmi.bwtSize : sa->numEntries * sa->sampligRate;
+  GPU_ERROR(gpu_sa_index_select_sampling_rate(&index->sa, saLength, densifyAllowed));
+  GPU_ERROR(gpu_sa_index_select_packing(&index->sa, saLength));
+  // Succeed
+  return (SUCCESS);
+}
+
 gpu_error_t gpu_index_init_dto(gpu_index_buffer_t *index, const gpu_module_t activeModules)
 {
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_init_dto(&index->fmi));
     GPU_ERROR(gpu_fmi_table_init_dto(&index->fmi.table));
+    GPU_ERROR(gpu_fmi_index_init_dto(&index->fmiReverse));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_init_dto(&index->sa));
@@ -263,10 +317,24 @@ gpu_error_t gpu_index_init(gpu_index_buffer_t** const index, const gpu_index_dto
   GPU_ERROR(gpu_fmi_table_init_dto(&iBuff->fmi.table));
   GPU_ERROR(gpu_fmi_index_init(&iBuff->fmi, iBuff->fmi.bwtSize, numSupportedDevices));
   GPU_ERROR(gpu_fmi_table_init(&iBuff->fmi.table, iBuff->fmi.table.maxLevelsTableLUT, numSupportedDevices));
+  GPU_ERROR(gpu_fmi_index_init(&iBuff->fmiReverse, 0, numSupportedDevices));
   GPU_ERROR(gpu_sa_index_init(&iBuff->sa, iBuff->sa.numEntries, iBuff->sa.sampligRate, numSupportedDevices));
 
   if(activeModules & GPU_FMI) GPU_ERROR(gpu_index_set_specs(iBuff, rawIndex, rawIndex->fmi.indexCoding, GPU_FMI));
   if(activeModules & GPU_SA)  GPU_ERROR(gpu_index_set_specs(iBuff, rawIndex, rawIndex->sa.indexCoding, GPU_SA));
+  if(activeModules & GPU_FMI) iBuff->fmi.activeHostLayout = rawIndex->fmi.hostLayout;
+  if(gpu_index_is_bidirectional(iBuff, activeModules)){
+    //Both BWTs index the same text
+    iBuff->fmiReverse.bwtSize          = iBuff->fmi.bwtSize;
+    iBuff->fmiReverse.numEntries       = iBuff->fmi.numEntries;
+    iBuff->fmiReverse.activeHostLayout = iBuff->fmi.activeHostLayout;
+  }
+  if(activeModules & GPU_SA){
+    iBuff->sa.maxMbSA         = rawIndex->sa.maxMbSA;
+    iBuff->sa.minSamplingRate = rawIndex->sa.minSamplingRate;
+    iBuff->sa.activePacking   = rawIndex->sa.packedSA;
+    GPU_ERROR(gpu_index_select_sa_specs(iBuff, activeModules));
+  }
 
   (* index) = iBuff;
   return (SUCCESS);
@@ -277,6 +345,10 @@ gpu_error_t gpu_index_allocate(gpu_index_buffer_t *index, const gpu_module_t act
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_allocate(&index->fmi));
     GPU_ERROR(gpu_fmi_table_allocate(&index->fmi.table));
+    if(gpu_index_is_bidirectional(index, activeModules)){
+      index->fmiReverse.bwtSize = index->fmi.bwtSize;
+      GPU_ERROR(gpu_fmi_index_allocate(&index->fmiReverse));
+    }
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_allocate(&index->sa));
@@ -285,18 +357,63 @@ gpu_error_t gpu_index_allocate(gpu_index_buffer_t *index, const gpu_module_t act
   return (SUCCESS);
 }
 
+gpu_error_t gpu_index_load_fmi(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules)
+{
+  if((activeModules & GPU_FMI) == 0) return (SUCCESS);
+  GPU_ERROR(gpu_fmi_index_allocate(&index->fmi));
+  GPU_ERROR(gpu_fmi_table_allocate(&index->fmi.table));
+  if(gpu_index_is_bidirectional(index, activeModules)) GPU_ERROR(gpu_fmi_index_allocate(&index->fmiReverse));
+  GPU_ERROR(gpu_index_transform(index, rawIndex, rawIndex->fmi.indexCoding, GPU_FMI));
+  if(index->fmi.activeHostLayout) GPU_ERROR(gpu_fmi_index_build_host_layout(&index->fmi));
+  if(gpu_index_is_bidirectional(index, activeModules) && index->fmiReverse.activeHostLayout)
+    GPU_ERROR(gpu_fmi_index_build_host_layout(&index->fmiReverse));
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_index_build_fmi_table(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules)
+{
+  const gpu_index_coding_t indexCoding = rawIndex->fmi.indexCoding;
+  if((activeModules & GPU_FMI) == 0) return (SUCCESS);
+  //The index files already store the table, the raw BWTs only provide the FM-index entries
+  if((indexCoding == GPU_INDEX_ASCII) || (indexCoding == GPU_INDEX_GEM_FULL) || (indexCoding == GPU_INDEX_MFASTA_FILE))
+    GPU_ERROR(gpu_fmi_table_construction(&index->fmi.table, index->fmi.h_fmi, index->fmi.bwtSize));
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_index_load_sa(gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, const gpu_module_t activeModules)
+{
+  if((activeModules & GPU_SA) == 0) return (SUCCESS);
+  GPU_ERROR(gpu_sa_index_allocate(&index->sa));
+  GPU_ERROR(gpu_index_transform(index, rawIndex, rawIndex->sa.indexCoding, GPU_SA));
+  GPU_ERROR(gpu_index_select_sa_specs(index, activeModules));
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_index_resample_sa(gpu_index_buffer_t* const index, const gpu_module_t activeModules)
+{
+  if((activeModules & GPU_SA) == 0) return (SUCCESS);
+  //Densifying the SA walks the FM-index (it has to be already transformed)
+  GPU_ERROR(gpu_sa_index_resample(&index->sa, (activeModules & GPU_FMI) ? &index->fmi : NULL));
+  GPU_ERROR(gpu_sa_index_pack(&index->sa));
+  return (SUCCESS);
+}
+
 gpu_error_t gpu_index_load(gpu_index_buffer_t *index, const gpu_index_dto_t * const rawIndex,
                            const gpu_module_t activeModules)
 {
-  if(activeModules & GPU_FMI){
-    GPU_ERROR(gpu_fmi_index_allocate(&index->fmi));
-    GPU_ERROR(gpu_fmi_table_allocate(&index->fmi.table));
-    GPU_ERROR(gpu_index_transform(index, rawIndex, rawIndex->fmi.indexCoding, GPU_FMI));
-  }
+  GPU_ERROR(gpu_index_load_fmi(index, rawIndex, activeModules));
+  GPU_ERROR(gpu_index_build_fmi_table(index, rawIndex, activeModules));
+  GPU_ERROR(gpu_index_load_sa(index, rawIndex, activeModules));
+  GPU_ERROR(gpu_index_resample_sa(index, activeModules));
+  return (SUCCESS);
+}
 
-  if(activeModules & GPU_SA){
-    GPU_ERROR(gpu_sa_index_allocate(&index->sa));
-    GPU_ERROR(gpu_index_transform(index, rawIndex, rawIndex->sa.indexCoding, GPU_SA));
+gpu_error_t gpu_index_build_numa_replicas(gpu_index_buffer_t* const index, const gpu_module_t activeModules)
+{
+  //Only the host-optimized FMI layout is read by host backends
+  if(activeModules & GPU_FMI){
+    GPU_ERROR(gpu_fmi_index_build_host_replicas(&index->fmi));
+    GPU_ERROR(gpu_fmi_index_build_host_replicas(&index->fmiReverse));
   }
 
   return (SUCCESS);
@@ -312,6 +429,7 @@ gpu_error_t gpu_index_free_host(gpu_index_buffer_t* const index, const gpu_modul
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_free_host(&index->fmi));
     GPU_ERROR(gpu_fmi_table_free_host(&index->fmi.table));
+    GPU_ERROR(gpu_fmi_index_free_host(&index->fmiReverse));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_free_host(&index->sa));
@@ -322,8 +440,19 @@ gpu_error_t gpu_index_free_host(gpu_index_buffer_t* const index, const gpu_modul
 gpu_error_t gpu_index_free_unused_host(gpu_index_buffer_t* index, gpu_device_info_t** const devices, const gpu_module_t activeModules)
 {
   if(activeModules & GPU_FMI){
-    GPU_ERROR(gpu_fmi_index_free_unused_host(&index->fmi, devices));
-    GPU_ERROR(gpu_fmi_table_free_unused_host(&index->fmi.table, devices));
+    //The approximate and SMEM searches run on the host (the FMI entries are kept without the host-optimized layout)
+    const bool hostSearch  = (activeModules & (GPU_FMI_APPROX_SEARCH | GPU_FMI_SMEM_SEARCH)) != 0;
+    const bool tableSearch = (activeModules & GPU_FMI_APPROX_SEARCH) != 0;
+    if(!hostSearch || (index->fmi.h_fmiHost != NULL)){
+      GPU_ERROR(gpu_fmi_index_free_unused_host(&index->fmi, devices));
+    }
+    if(!tableSearch){
+      GPU_ERROR(gpu_fmi_table_free_unused_host(&index->fmi.table, devices));
+    }
+    //The reverse BWT never leaves the host
+    if(index->fmiReverse.h_fmiHost != NULL){
+      GPU_ERROR(gpu_fmi_index_free_host_entries(&index->fmiReverse));
+    }
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_free_unused_host(&index->sa, devices));
@@ -336,6 +465,7 @@ gpu_error_t gpu_index_free_device(gpu_index_buffer_t* index, gpu_device_info_t**
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_free_device(&index->fmi, devices));
     GPU_ERROR(gpu_fmi_table_free_device(&index->fmi.table, devices));
+    GPU_ERROR(gpu_fmi_index_free_device(&index->fmiReverse, devices));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_free_device(&index->sa, devices));
@@ -348,6 +478,7 @@ gpu_error_t gpu_index_free_metainfo(gpu_index_buffer_t* index, const gpu_module_
   if(activeModules & GPU_FMI){
     GPU_ERROR(gpu_fmi_index_free_metainfo(&index->fmi));
     GPU_ERROR(gpu_fmi_table_free_metainfo(&index->fmi.table));
+    GPU_ERROR(gpu_fmi_index_free_metainfo(&index->fmiReverse));
   }
   if(activeModules & GPU_SA){
     GPU_ERROR(gpu_sa_index_free_metainfo(&index->sa));
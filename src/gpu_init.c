@@ -0,0 +1,220 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_INIT_C_
+#define GPU_INIT_C_
+
+#include "../include/gpu_init.h"
+
+/************************************************************
+Phases of the initialization
+************************************************************/
+
+gpu_error_t gpu_init_reference_load(gpu_init_graph_t* const graph)
+{
+  return(gpu_reference_load(graph->reference, graph->rawRef, graph->reference->activeModules));
+}
+
+gpu_error_t gpu_init_fmi_load(gpu_init_graph_t* const graph)
+{
+  return(gpu_index_load_fmi(graph->index, graph->rawIndex, graph->index->activeModules));
+}
+
+gpu_error_t gpu_init_fmi_table(gpu_init_graph_t* const graph)
+{
+  return(gpu_index_build_fmi_table(graph->index, graph->rawIndex, graph->index->activeModules));
+}
+
+gpu_error_t gpu_init_sa_load(gpu_init_graph_t* const graph)
+{
+  return(gpu_index_load_sa(graph->index, graph->rawIndex, graph->index->activeModules));
+}
+
+gpu_error_t gpu_init_sa_resample(gpu_init_graph_t* const graph)
+{
+  return(gpu_index_resample_sa(graph->index, graph->index->activeModules));
+}
+
+gpu_error_t gpu_init_shm_publish(gpu_init_graph_t* const graph)
+{
+  return(gpu_shm_publish(graph->sharedIndexName, graph->reference, graph->index));
+}
+
+gpu_error_t gpu_init_reference_transfer(gpu_init_graph_t* const graph)
+{
+  return(gpu_reference_transfer_CPU_to_GPUs(graph->reference, graph->devices, graph->reference->activeModules));
+}
+
+gpu_error_t gpu_init_fmi_transfer(gpu_init_graph_t* const graph)
+{
+  return(gpu_fmi_index_transfer_CPU_to_GPUs(&graph->index->fmi, graph->devices));
+}
+
+gpu_error_t gpu_init_fmi_table_transfer(gpu_init_graph_t* const graph)
+{
+  return(gpu_fmi_table_transfer_CPU_to_GPUs(&graph->index->fmi.table, graph->devices));
+}
+
+gpu_error_t gpu_init_sa_transfer(gpu_init_graph_t* const graph)
+{
+  return(gpu_sa_index_transfer_CPU_to_GPUs(&graph->index->sa, graph->devices));
+}
+
+
+/************************************************************
+Functions to build the dependency graph
+************************************************************/
+
+bool gpu_init_shares_fmi_load(const gpu_index_coding_t indexCoding)
+{
+  // Index containers and MFASTA files are parsed by the FM-index load before the SA
+  return((indexCoding == GPU_INDEX_GEM_FILE) || (indexCoding == GPU_INDEX_PROFILE_FILE) || (indexCoding == GPU_INDEX_MFASTA_FILE));
+}
+
+void gpu_init_graph_add(gpu_init_graph_t* const graph, const gpu_init_phase_t phase, const bool active,
+                        const uint32_t dependencies, gpu_init_phase_fn_t run)
+{
+  gpu_init_task_t* const task = &graph->tasks[phase];
+  task->active       = active;
+  task->launched     = !active;
+  task->dependencies = dependencies;
+  task->run          = run;
+  task->time         = 0.0;
+  // Skipped phases are completed from the beginning (their dependants are not blocked)
+  if(active) graph->numPending++;
+  else graph->completed |= GPU_INIT_PHASE_MASK(phase);
+}
+
+void gpu_init_graph_setup(gpu_init_graph_t* const graph, gpu_reference_buffer_t* const reference, const gpu_reference_dto_t* const rawRef,
+                          gpu_index_buffer_t* const index, const gpu_index_dto_t* const rawIndex, gpu_device_info_t** const devices,
+                          const bool attachedIndex, const gpu_shared_index_t sharedIndex, const char* const sharedIndexName)
+{
+  const gpu_module_t activeModules = index->activeModules;
+  const bool         loadIndex     = !attachedIndex;
+  const bool         publish       = (sharedIndex == GPU_SHARED_INDEX_PUBLISH);
+  const bool         activeFMI     = (activeModules & GPU_FMI) != 0;
+  const bool         activeSA      = (activeModules & GPU_SA) != 0;
+  const uint32_t     loaded        = GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_REFERENCE_LOAD) | GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_LOAD)
+                                   | GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_TABLE) | GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_SA_LOAD)
+                                   | GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_SA_RESAMPLE);
+  const uint32_t     published     = GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_SHM_PUBLISH);
+  uint32_t           saDependencies = 0;
+  graph->reference       = reference;
+  graph->rawRef          = rawRef;
+  graph->index           = index;
+  graph->rawIndex        = rawIndex;
+  graph->devices         = devices;
+  graph->sharedIndexName = sharedIndexName;
+  graph->completed       = 0;
+  graph->numPending      = 0;
+  graph->error           = SUCCESS;
+  // The index containers and MFASTA files re-read the FM-index specs and update the index modules (the SA waits for the FM-index)
+  if(activeFMI && (gpu_init_shares_fmi_load(rawIndex->fmi.indexCoding) || gpu_init_shares_fmi_load(rawIndex->sa.indexCoding)))
+    saDependencies = GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_LOAD);
+  // Host loads (the reference, the FM-index and the SA are independent until the SA resampling)
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_REFERENCE_LOAD, loadIndex, 0, gpu_init_reference_load);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_FMI_LOAD, loadIndex && activeFMI, 0, gpu_init_fmi_load);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_FMI_TABLE, loadIndex && activeFMI, GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_LOAD), gpu_init_fmi_table);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_SA_LOAD, loadIndex && activeSA, saDependencies, gpu_init_sa_load);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_SA_RESAMPLE, loadIndex && activeSA,
+                     GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_SA_LOAD) | GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_LOAD), gpu_init_sa_resample);
+  // The publisher replaces the host copies by the segment ones (nothing is transferred before)
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_SHM_PUBLISH, publish, loaded, gpu_init_shm_publish);
+  // Each device transfer starts as soon as its structure is ready
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_REFERENCE_TRANSFER, true,
+                     GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_REFERENCE_LOAD) | published, gpu_init_reference_transfer);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_FMI_TRANSFER, activeFMI,
+                     GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_LOAD) | published, gpu_init_fmi_transfer);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_FMI_TABLE_TRANSFER, activeFMI,
+                     GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_FMI_TABLE) | published, gpu_init_fmi_table_transfer);
+  gpu_init_graph_add(graph, GPU_INIT_PHASE_SA_TRANSFER, activeSA,
+                     GPU_INIT_PHASE_MASK(GPU_INIT_PHASE_SA_RESAMPLE) | published, gpu_init_sa_transfer);
+}
+
+
+/************************************************************
+Functions to execute the graph
+************************************************************/
+
+uint32_t gpu_init_graph_next_phase(gpu_init_graph_t* const graph)
+{
+  uint32_t idPhase, idReady = GPU_INIT_NO_PHASE;
+  pthread_mutex_lock(&graph->lock);
+  while((graph->numPending != 0) && (graph->error == SUCCESS)){
+    // Phases are launched in the enum order among the ready ones
+    for(idPhase = 0; (idPhase < GPU_INIT_NUM_PHASES) && (idReady == GPU_INIT_NO_PHASE); ++idPhase){
+      const gpu_init_task_t* const task = &graph->tasks[idPhase];
+      if(!task->launched && ((task->dependencies & ~graph->completed) == 0)) idReady = idPhase;
+    }
+    if(idReady != GPU_INIT_NO_PHASE){
+      graph->tasks[idReady].launched = true;
+      graph->numPending--;
+      break;
+    }
+    // Some running phase will unlock the rest
+    pthread_cond_wait(&graph->progress, &graph->lock);
+  }
+  pthread_mutex_unlock(&graph->lock);
+  return(idReady);
+}
+
+void gpu_init_graph_complete_phase(gpu_init_graph_t* const graph, const uint32_t idPhase, const gpu_error_t error, const double time)
+{
+  pthread_mutex_lock(&graph->lock);
+  graph->tasks[idPhase].time = time;
+  graph->completed |= GPU_INIT_PHASE_MASK(idPhase);
+  if((error != SUCCESS) && (graph->error == SUCCESS)) graph->error = error;
+  pthread_cond_broadcast(&graph->progress);
+  pthread_mutex_unlock(&graph->lock);
+}
+
+void* gpu_init_graph_worker(void* const initGraph)
+{
+  gpu_init_graph_t* const graph = (gpu_init_graph_t *) initGraph;
+  uint32_t idPhase;
+  while((idPhase = gpu_init_graph_next_phase(graph)) != GPU_INIT_NO_PHASE){
+    const double      timeStart = gpu_sample_time();
+    const gpu_error_t error     = graph->tasks[idPhase].run(graph);
+    gpu_init_graph_complete_phase(graph, idPhase, error, gpu_sample_time() - timeStart);
+  }
+  return(NULL);
+}
+
+uint32_t gpu_init_graph_get_num_threads(const gpu_init_graph_t* const graph, const uint32_t numThreads)
+{
+  // There is no benefit in more threads than phases
+  uint32_t threads = (numThreads != 0) ? numThreads : graph->numPending;
+  threads = GPU_MIN(threads, GPU_INIT_MAX_THREADS);
+  threads = GPU_MIN(threads, graph->numPending);
+  return(GPU_MAX(threads, 1));
+}
+
+gpu_error_t gpu_init_graph_run(gpu_init_graph_t* const graph, const uint32_t numThreads, double* const timePhases)
+{
+  const uint32_t threads = gpu_init_graph_get_num_threads(graph, numThreads);
+  pthread_t      workers[GPU_INIT_MAX_THREADS];
+  uint32_t       idThread, idPhase, numLaunched = 0;
+  pthread_mutex_init(&graph->lock, NULL);
+  pthread_cond_init(&graph->progress, NULL);
+  // The calling thread works as the first worker (a single thread runs the phases in a sequential topological order)
+  for(idThread = 1; idThread < threads; ++idThread){
+    if(pthread_create(&workers[idThread], NULL, gpu_init_graph_worker, graph) != 0) break;
+    numLaunched++;
+  }
+  gpu_init_graph_worker(graph);
+  for(idThread = 1; idThread <= numLaunched; ++idThread)
+    pthread_join(workers[idThread], NULL);
+  pthread_cond_destroy(&graph->progress);
+  pthread_mutex_destroy(&graph->lock);
+  for(idPhase = 0; idPhase < GPU_INIT_NUM_PHASES; ++idPhase)
+    timePhases[idPhase] = graph->tasks[idPhase].time;
+  return(graph->error);
+}
+
+#endif /* GPU_INIT_C_ */
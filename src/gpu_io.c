@@ -133,7 +133,7 @@ gpu_error_t gpu_io_save_index_PROFILE(const char* const fn, const gpu_index_buff
     sprintf(fileName, "%s.%lu.%u.fmi", fn, index->fmi.bwtSize, GPU_FMI_ENTRY_SIZE);
     fp = open(fileName, openMode, GPU_FILE_PERMISIONS);
     if (fp < 0) return (E_WRITING_FILE);
-    GPU_ERROR(gpu_index_write(fp, index, GPU_FMI));
+    GPU_ERROR(gpu_index_write(fp, index, gpu_index_get_stored_modules(index, GPU_FMI)));
     close(fp);
   }
 
@@ -161,6 +161,7 @@ gpu_error_t gpu_io_load_index_PROFILE(const char* const fn, gpu_index_buffer_t*
 									  const gpu_module_t activeModules)
 {
   int fp = 0, openMode = GPU_FILE_BASIC_MODE | O_RDONLY;
+  gpu_module_t fileActiveModules = GPU_NONE_MODULES;
 
   if((activeModules & GPU_INDEX) == 0)
     return(E_MODULE_NOT_FOUND);
@@ -168,7 +169,8 @@ gpu_error_t gpu_io_load_index_PROFILE(const char* const fn, gpu_index_buffer_t*
   fp = open(fn, openMode, GPU_FILE_PERMISIONS);
   if (fp < 0) return (E_OPENING_FILE);
 
-  GPU_ERROR(gpu_index_read(fp, index, activeModules));
+  GPU_ERROR(gpu_io_load_module_info_PROFILE(fp, index, activeModules, &fileActiveModules));
+  GPU_ERROR(gpu_index_read(fp, index, fileActiveModules));
 
   close(fp);
   return (SUCCESS);
@@ -339,7 +341,7 @@ gpu_error_t gpu_io_load_index_GEM_FULL(const char* const fn, gpu_index_buffer_t*
   if(activeModules & GPU_FMI){
     currentOffset = lseek64(fp, fileOffsetFMIndex, SEEK_SET);
     if (currentOffset < 0) return (E_READING_FILE);
-    GPU_ERROR(gpu_index_read(fp, index, GPU_FMI));
+    GPU_ERROR(gpu_index_read(fp, index, fileActiveModules & GPU_FMI));
   }
 
   if(activeModules & GPU_SA){
@@ -359,7 +361,7 @@ gpu_error_t gpu_io_save_index_GEM_FULL(const char* const fn, const gpu_index_buf
 									   const gpu_module_t activeModules)
 {
   int fp = 0, openMode = GPU_FILE_BASIC_MODE | O_WRONLY;
-  gpu_module_t storedModules = index->activeModules & activeModules;
+  gpu_module_t storedModules = gpu_index_get_stored_modules(index, index->activeModules & activeModules);
   off64_t currentOffset = 0, fileOffsetFMIndex = 0, fileOffsetSAIndex = 0, fileOffsetRef = 0;
 
   if((index->activeModules & activeModules) == 0)
@@ -479,6 +481,27 @@ gpu_error_t gpu_io_save_reference_GEM_FULL(const char* const fn, const gpu_refer
   return (SUCCESS);
 }
 
+gpu_error_t gpu_io_load_module_info_PROFILE(const int fp, gpu_index_buffer_t* const index, const gpu_module_t activeModules,
+                                            gpu_module_t* const fileActiveModules)
+{
+  // The profile FMI files have no module header, the reverse BWT is appended after the FM-index and its table
+  size_t bytesPerFMI = 0, bytesPerFmiTable = 0;
+  off64_t fileSize = 0, currentOffset = 0;
+  (* fileActiveModules) = activeModules & ~GPU_FMI_SMEM_SEARCH;
+  if((activeModules & GPU_FMI) == 0) return(SUCCESS);
+  GPU_ERROR(gpu_index_read_specs(fp, index, GPU_FMI));
+  GPU_ERROR(gpu_fmi_index_get_size(&index->fmi, &bytesPerFMI));
+  GPU_ERROR(gpu_fmi_table_get_size(&index->fmi.table, &bytesPerFmiTable));
+  currentOffset = lseek64(fp, 0, SEEK_CUR);
+  fileSize      = lseek64(fp, 0, SEEK_END);
+  if((currentOffset < 0) || (fileSize < 0)) return(E_READING_FILE);
+  if(fileSize > (currentOffset + bytesPerFMI + bytesPerFmiTable)) (* fileActiveModules) |= GPU_FMI_SMEM_SEARCH;
+  //Rewind the file
+  currentOffset = lseek64(fp, 0, SEEK_SET);
+  if(currentOffset < 0) return(E_READING_FILE);
+  return(SUCCESS);
+}
+
 gpu_error_t gpu_io_save_module_info_GEM_FULL(const int fp, const gpu_module_t fileActiveModules)
 {
   size_t result, bytesRequest;
@@ -529,12 +552,37 @@ gpu_error_t gpu_io_load_offsets_info_GEM_FULL(const int fp, off64_t* const fileO
   return(SUCCESS);
 }
 
+gpu_error_t gpu_io_build_index_reverse_GEM_FULL(const gpu_gem_ref_dto_t* const gemRef, gpu_index_buffer_t* const index)
+{
+  // Rebuilds the text covered by the GEM FM-index (forward + reverse-complement) to sort its reverse
+  const char* const h_gem_reference = gemRef->reference;
+  const uint64_t    forwardSize     = gemRef->ref_length;
+  const uint64_t    textSize        = index->fmi.bwtSize - 1;
+  const uint64_t    maxTextSize     = (gemRef->ref_coding == GPU_REF_GEM_ONLY_FORWARD) ? forwardSize : 2 * forwardSize;
+  uint8_t* h_text = NULL;
+  uint64_t position;
+  if((index->fmi.bwtSize == 0) || (textSize > maxTextSize)) return(E_REFERENCE_CODING);
+  h_text = (uint8_t*) malloc(textSize * sizeof(uint8_t));
+  if(h_text == NULL) return(E_ALLOCATE_MEM);
+  for(position = 0; position < textSize; ++position){
+    const uint64_t rcPosition = (2 * forwardSize) - position - 2;
+    char base = GPU_ENC_DNA_CHAR_N;
+    if(position < forwardSize) base = h_gem_reference[position];
+      else if(rcPosition < forwardSize) base = gpu_complement_base(h_gem_reference[rcPosition]);
+    h_text[position] = (uint8_t) base;
+  }
+  GPU_ERROR(gpu_fmi_index_build_reverse(h_text, textSize, &index->fmiReverse));
+  free(h_text);
+  return(SUCCESS);
+}
+
 void gpu_io_save_indexed_structures_GEM_(const char* const fn, const gpu_gem_fmi_dto_t* const gemFMindex,
                                          const gpu_gem_ref_dto_t* const gemRef, const gpu_gem_sa_dto_t* const gemSAindex,
                                          const gpu_module_t activeModules)
 {
   int fp = 0, openMode = GPU_FILE_BASIC_MODE | O_WRONLY;
   off64_t currentOffset = 0, fileOffsetFMIndex = 0, fileOffsetSAIndex = 0, fileOffsetRef = 0;
+  gpu_module_t storedModules = activeModules;
 
   /* Objects to initialize */
   gpu_reference_buffer_t ref;
@@ -544,8 +592,10 @@ void gpu_io_save_indexed_structures_GEM_(const char* const fn, const gpu_gem_fmi
   GPU_ERROR(gpu_reference_init_dto(&ref));
   ref.activeModules 	= activeModules & GPU_REFERENCE;
   ref.size          	= gemRef->ref_length * 2; //Forward & reverse genomes
-  ref.numEntriesPlain   = GPU_DIV_CEIL(ref.size, GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
-  ref.numEntriesMasked  = GPU_DIV_CEIL(ref.size, GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  ref.forwardSize       = (gemRef->ref_coding == GPU_REF_GEM_VIRTUAL_FULL) ? gemRef->ref_length : 0;
+  ref.numEntriesPlain   = GPU_DIV_CEIL(gpu_reference_get_stored_size(&ref), GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  ref.numEntriesMasked  = GPU_DIV_CEIL(gpu_reference_get_stored_size(&ref), GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  ref.activeMinimizers  = (activeModules & GPU_MINIMIZER_SEED) != 0; //Default (w,k) sampling
 
   // Initialize the index (SA & FMI) structure
   GPU_ERROR(gpu_index_init_dto(&index, activeModules & GPU_INDEX));
@@ -579,8 +629,10 @@ void gpu_io_save_indexed_structures_GEM_(const char* const fn, const gpu_gem_fmi
   if(index.activeModules & GPU_INDEX){
     if(index.activeModules & GPU_FMI){
       GPU_ERROR(gpu_index_allocate(&index, GPU_FMI));
-      GPU_ERROR(gpu_index_transform(&index, (gpu_index_dto_t*)gemFMindex, gemFMindex->index_coding, GPU_FMI));
-      GPU_ERROR(gpu_index_write(fp, &index, GPU_FMI));
+      GPU_ERROR(gpu_index_transform(&index, (gpu_index_dto_t*)gemFMindex, gemFMindex->index_coding, GPU_FMI & ~GPU_FMI_SMEM_SEARCH));
+      if(index.activeModules & GPU_FMI_SMEM_SEARCH) GPU_ERROR(gpu_io_build_index_reverse_GEM_FULL(gemRef, &index));
+      storedModules = gpu_index_get_stored_modules(&index, storedModules);
+      GPU_ERROR(gpu_index_write(fp, &index, storedModules & GPU_FMI));
       GPU_ERROR(gpu_index_free_host(&index,GPU_FMI));
       //GPU_ERROR(gpu_save_index_PROFILE("internalIndexGEM", fmi)); // Dumping the index
       fileOffsetSAIndex = lseek64(fp, 0, SEEK_CUR);
@@ -598,6 +650,7 @@ void gpu_io_save_indexed_structures_GEM_(const char* const fn, const gpu_gem_fmi
   if(ref.activeModules & GPU_REFERENCE){
     GPU_ERROR(gpu_reference_allocate(&ref, GPU_REFERENCE));
     GPU_ERROR(gpu_reference_transform(&ref, (char*)gemRef, gemRef->ref_coding, GPU_REFERENCE));
+    if(ref.activeMinimizers) GPU_ERROR(gpu_reference_build_minimizers(&ref));
     GPU_ERROR(gpu_reference_write(fp, &ref, GPU_REFERENCE));
     GPU_ERROR(gpu_reference_free_host(&ref));
   }
@@ -606,7 +659,7 @@ void gpu_io_save_indexed_structures_GEM_(const char* const fn, const gpu_gem_fmi
   currentOffset = lseek64(fp, 0, SEEK_SET);
   if(currentOffset < 0) GPU_ERROR(E_WRITING_FILE);
 
-  GPU_ERROR(gpu_io_save_module_info_GEM_FULL(fp, activeModules));
+  GPU_ERROR(gpu_io_save_module_info_GEM_FULL(fp, storedModules));
   GPU_ERROR(gpu_io_save_offsets_info_GEM_FULL(fp, fileOffsetFMIndex, fileOffsetSAIndex, fileOffsetRef));
 
   close(fp);
@@ -14,53 +14,97 @@
 #include "../include/gpu_text_core.h"
 
 
+// Packed saturating counters (a saturated counter is sticky and stands for "as many as needed")
+GPU_INLINE __device__ uint32_t gpu_kmer_filter_counter_mask(const uint32_t counterLength)
+{
+  return((GPU_UINT32_MASK_ONE_LOW << counterLength) - 1);
+}
+
+GPU_INLINE __device__ uint32_t gpu_kmer_filter_counter_get(const uint32_t* const counters, const uint32_t kmerIdx, const uint32_t counterLength)
+{
+  const uint32_t countersPerWord = GPU_UINT32_LENGTH / counterLength;
+  const uint32_t shift           = (kmerIdx % countersPerWord) * counterLength;
+  return((counters[kmerIdx / countersPerWord] >> shift) & gpu_kmer_filter_counter_mask(counterLength));
+}
+
+GPU_INLINE __device__ uint32_t gpu_kmer_filter_counter_inc(uint32_t* const counters, const uint32_t kmerIdx, const uint32_t counterLength)
+{
+  const uint32_t countersPerWord = GPU_UINT32_LENGTH / counterLength;
+  const uint32_t shift           = (kmerIdx % countersPerWord) * counterLength;
+  const uint32_t count           = (counters[kmerIdx / countersPerWord] >> shift) & gpu_kmer_filter_counter_mask(counterLength);
+  if(count != gpu_kmer_filter_counter_mask(counterLength)) counters[kmerIdx / countersPerWord] += (GPU_UINT32_MASK_ONE_LOW << shift);
+  return(count);
+}
+
+GPU_INLINE __device__ uint32_t gpu_kmer_filter_counter_dec(uint32_t* const counters, const uint32_t kmerIdx, const uint32_t counterLength)
+{
+  const uint32_t countersPerWord = GPU_UINT32_LENGTH / counterLength;
+  const uint32_t shift           = (kmerIdx % countersPerWord) * counterLength;
+  const uint32_t count           = (counters[kmerIdx / countersPerWord] >> shift) & gpu_kmer_filter_counter_mask(counterLength);
+  if((count != 0) && (count != gpu_kmer_filter_counter_mask(counterLength))) counters[kmerIdx / countersPerWord] -= (GPU_UINT32_MASK_ONE_LOW << shift);
+  return(count);
+}
+
+GPU_INLINE __device__ bool gpu_kmer_filter_counter_is_saturated(const uint32_t count, const uint32_t counterLength)
+{
+  // Saturated query k-mers never limit the shared count (the filter stays conservative)
+  return(count == gpu_kmer_filter_counter_mask(counterLength));
+}
+
 // Compile Pattern
-GPU_INLINE __device__ void gpu_kmer_filter_compile_pattern(uint16_t* const kmerCountQuery, const uint64_t* const query, const uint32_t queryLength)
+GPU_INLINE __device__ void gpu_kmer_filter_compile_pattern(uint32_t* const kmerCountQuery, const uint64_t* const query, const uint32_t queryLength,
+                                                           const uint32_t kmerLength, const uint32_t counterLength)
 {
   // Count kmers in query
   const uint32_t baseQueryLength = GPU_KMER_FILTER_BASE_QUERY_LENGTH;
+  const uint32_t kmerMask        = GPU_KMER_FILTER_COUNTING_MASK(kmerLength);
   uint32_t pos = 0, kmerIdx = 0;
   ulong2   infoQuery = GPU_TEXT_INIT;
   // Compose the first k-mer
-  for (pos = 0; pos < (GPU_KMER_FILTER_COUNTING_LENGTH - 1); ++pos) {
+  for (pos = 0; pos < (kmerLength - 1); ++pos) {
     const uint8_t encBase = gpu_text_lookup(query, pos, &infoQuery, baseQueryLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase); // Update kmer-index
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase, kmerMask);           // Update kmer-index
   }
   // Compile all k-mers
-  for (pos = (GPU_KMER_FILTER_COUNTING_LENGTH - 1); pos < queryLength; ++pos) {
+  for (pos = (kmerLength - 1); pos < queryLength; ++pos) {
     const uint8_t encBase = gpu_text_lookup(query, pos, &infoQuery, baseQueryLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase); // Update kmer-index
-    kmerCountQuery[kmerIdx]++;                            // Increment kmer-count
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdx, encBase, kmerMask);           // Update kmer-index
+    gpu_kmer_filter_counter_inc(kmerCountQuery, kmerIdx, counterLength);      // Increment kmer-count
   }
 }
 
 // Filter text region
-GPU_INLINE __device__ void gpu_kmer_filter_candidate_cutoff(const uint16_t* const kmerCountQuery, uint16_t* const kmerCountCandidate,
+GPU_INLINE __device__ void gpu_kmer_filter_candidate_cutoff(const uint32_t* const kmerCountQuery, uint32_t* const kmerCountCandidate,
                                                             const uint32_t queryLength, const uint32_t candidateLength,
                                                             const uint64_t* const candidates, const uint64_t offsetCandPos,
-                                                            const uint32_t maxErrorRatio, uint32_t* const filterDistance)
+                                                            const uint32_t maxErrorRatio, const uint32_t kmerLength, const uint32_t counterLength,
+                                                            uint32_t* const filterDistance)
 {
   // Prepare filter
   const uint32_t baseCandidateLength = GPU_KMER_FILTER_BASE_CANDIDATE_LENGTH;
+  const uint32_t kmerMask = GPU_KMER_FILTER_COUNTING_MASK(kmerLength);
   const uint32_t maxError = queryLength * (maxErrorRatio / 100);
-  const uint32_t kmersRequired = queryLength - (GPU_KMER_FILTER_COUNTING_LENGTH - 1) - GPU_KMER_FILTER_COUNTING_LENGTH * maxError;
+  const uint32_t kmersRequired = queryLength - (kmerLength - 1) - kmerLength * maxError;
   const uint32_t totalKmersCandidate = GPU_MAX(candidateLength, queryLength);
   const uint32_t initChunk = GPU_MIN(candidateLength, queryLength);
   uint32_t kmersLeft = totalKmersCandidate, kmersInCandidate = 0;
   uint32_t beginPos = 0, kmerIdxBegin = 0, endPos = 0, kmerIdxEnd = 0, cutOffResult = GPU_UINT32_ZEROS;
   ulong2   infoCandidate = GPU_TEXT_INIT;
   // Initial window fill (Composing the first k-mer)
-  while (endPos < (GPU_KMER_FILTER_COUNTING_LENGTH - 1)){
+  while (endPos < (kmerLength - 1)){
     const uint8_t encChar = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidate, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar); // Update kmer-index
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar, kmerMask); // Update kmer-index
     ++endPos;
   }
   // Initial window fill
   while ((endPos < initChunk) && !cutOffResult) {
       const uint8_t encBaseEnd = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidate, baseCandidateLength);
-      GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd); // Update kmer-index
-      const uint16_t countQuery = kmerCountQuery[kmerIdxEnd];
-      if (countQuery > 0 && kmerCountCandidate[kmerIdxEnd]++ < countQuery) ++kmersInCandidate;
+      GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd, kmerMask); // Update kmer-index
+      const uint32_t countQuery = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxEnd, counterLength);
+      if (countQuery > 0){
+        const uint32_t countCandidate = gpu_kmer_filter_counter_inc(kmerCountCandidate, kmerIdxEnd, counterLength);
+        if ((countCandidate < countQuery) || gpu_kmer_filter_counter_is_saturated(countQuery, counterLength)) ++kmersInCandidate;
+      }
       // Check filter condition
       if (kmersInCandidate >= kmersRequired)
         cutOffResult = GPU_ALIGN_DISTANCE_ZERO; // Don't filter
@@ -69,23 +113,29 @@ GPU_INLINE __device__ void gpu_kmer_filter_candidate_cutoff(const uint16_t* cons
       ++endPos, --kmersLeft;
   }
   // Sliding window count (Composing the first k-mer)
-  while (beginPos < (GPU_KMER_FILTER_COUNTING_LENGTH - 1) && !cutOffResult) {
+  while (beginPos < (kmerLength - 1) && !cutOffResult) {
     const uint8_t encBaseBegin = gpu_text_lookup(candidates, offsetCandPos + beginPos, &infoCandidate, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin);
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin, kmerMask);
     ++beginPos;
   }
   // Sliding window count (End processing)
   while ((endPos < candidateLength) && !cutOffResult) {
     // Begin (Decrement kmer-count)
     const uint8_t encBaseBegin = gpu_text_lookup(candidates, offsetCandPos + beginPos, &infoCandidate, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin);
-    const uint16_t countQueryBegin = kmerCountQuery[kmerIdxBegin];
-    if (countQueryBegin > 0 && kmerCountCandidate[kmerIdxBegin]-- <= countQueryBegin) --kmersInCandidate;
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin, kmerMask);
+    const uint32_t countQueryBegin = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxBegin, counterLength);
+    if (countQueryBegin > 0){
+      const uint32_t countCandidateBegin = gpu_kmer_filter_counter_dec(kmerCountCandidate, kmerIdxBegin, counterLength);
+      if ((countCandidateBegin <= countQueryBegin) && !gpu_kmer_filter_counter_is_saturated(countQueryBegin, counterLength)) --kmersInCandidate;
+    }
     // End (Increment kmer-count)
     const uint8_t encBaseEnd = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidate, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd);
-    const uint16_t countQueryEnd = kmerCountQuery[kmerIdxEnd];
-    if (countQueryEnd > 0 && kmerCountCandidate[kmerIdxEnd]++ < countQueryEnd) ++kmersInCandidate;
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd, kmerMask);
+    const uint32_t countQueryEnd = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxEnd, counterLength);
+    if (countQueryEnd > 0){
+      const uint32_t countCandidateEnd = gpu_kmer_filter_counter_inc(kmerCountCandidate, kmerIdxEnd, counterLength);
+      if ((countCandidateEnd < countQueryEnd) || gpu_kmer_filter_counter_is_saturated(countQueryEnd, counterLength)) ++kmersInCandidate;
+    }
     // Check filter condition
     if (kmersInCandidate >= kmersRequired)
       cutOffResult = GPU_ALIGN_DISTANCE_ZERO; // Don't filter
@@ -99,31 +149,33 @@ GPU_INLINE __device__ void gpu_kmer_filter_candidate_cutoff(const uint16_t* cons
 }
 
 // Filter text region
-GPU_INLINE __device__ void gpu_kmer_filter_candidate_sliding_window(const uint16_t* const kmerCountQuery, uint16_t* const kmerCountCandidate,
+GPU_INLINE __device__ void gpu_kmer_filter_candidate_sliding_window(const uint32_t* const kmerCountQuery, uint32_t* const kmerCountCandidate,
                                                                     const uint32_t queryLength, const uint32_t candidateLength,
                                                                     const uint64_t* const candidates, const uint64_t offsetCandPos,
+                                                                    const uint32_t kmerLength, const uint32_t counterLength,
                                                                     uint32_t* const filterDistance)
 {
   // Prepare filter
   const uint32_t baseCandidateLength = GPU_KMER_FILTER_BASE_CANDIDATE_LENGTH;
+  const uint32_t kmerMask  = GPU_KMER_FILTER_COUNTING_MASK(kmerLength);
   const uint32_t initChunk = GPU_MIN(candidateLength, queryLength);
-  const uint32_t maxKmers  = GPU_MIN(candidateLength, queryLength) - (GPU_KMER_FILTER_COUNTING_LENGTH - 1);
+  const int32_t  maxKmers  = GPU_MIN(candidateLength, queryLength) - (kmerLength - 1);
   uint32_t beginPos = 0, kmerIdxBegin = 0, endPos = 0, kmerIdxEnd = 0;
   ulong2   infoCandidateBegin = GPU_TEXT_INIT, infoCandidateEnd = GPU_TEXT_INIT;
   int32_t  kmersInCandidate = 0, kmerDistance = 0;
   // Initial window fill (Composing the first k-mer)
-  while (endPos < (GPU_KMER_FILTER_COUNTING_LENGTH - 1)){
+  while (endPos < (kmerLength - 1)){
     const uint8_t encChar = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidateEnd, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar); // Update kmer-index
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar, kmerMask); // Update kmer-index
     ++endPos;
   }
   beginPos = endPos; kmerIdxBegin = kmerIdxEnd;
   // Initial window fill
   while (endPos < initChunk) {
       const uint8_t encBaseEnd = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidateEnd, baseCandidateLength);
-      GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd); // Update kmer-index
-      const uint16_t countQuery = kmerCountQuery[kmerIdxEnd];
-      if ((countQuery > 0) && (kmerCountCandidate[kmerIdxEnd]++ <= countQuery)) ++kmersInCandidate;
+      GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd, kmerMask); // Update kmer-index
+      const uint32_t countQuery = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxEnd, counterLength);
+      if ((countQuery > 0) && (gpu_kmer_filter_counter_inc(kmerCountCandidate, kmerIdxEnd, counterLength) <= countQuery)) ++kmersInCandidate;
       ++endPos;
   }
   // Sliding window count (End processing)
@@ -131,83 +183,112 @@ GPU_INLINE __device__ void gpu_kmer_filter_candidate_sliding_window(const uint16
   while (endPos < candidateLength) {
     // Begin (Decrement kmer-count)
     const uint8_t encBaseBegin = gpu_text_lookup(candidates, offsetCandPos + beginPos, &infoCandidateBegin, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin);
-    const uint16_t countQueryBegin = kmerCountQuery[kmerIdxBegin];
-    if ((countQueryBegin > 0) && ((kmerCountCandidate[kmerIdxBegin]--) <= countQueryBegin)) --kmersInCandidate;
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxBegin, encBaseBegin, kmerMask);
+    const uint32_t countQueryBegin = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxBegin, counterLength);
+    if ((countQueryBegin > 0) && (gpu_kmer_filter_counter_dec(kmerCountCandidate, kmerIdxBegin, counterLength) <= countQueryBegin) &&
+        !gpu_kmer_filter_counter_is_saturated(countQueryBegin, counterLength)) --kmersInCandidate;
     // End (Increment kmer-count)
     const uint8_t encBaseEnd = gpu_text_lookup(candidates, offsetCandPos + endPos, &infoCandidateEnd, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd);
-    const uint16_t countQueryEnd = kmerCountQuery[kmerIdxEnd];
-    if ((countQueryEnd > 0) && (kmerCountCandidate[kmerIdxEnd]++ <= countQueryEnd)) ++kmersInCandidate;
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd, kmerMask);
+    const uint32_t countQueryEnd = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxEnd, counterLength);
+    if ((countQueryEnd > 0) && (gpu_kmer_filter_counter_inc(kmerCountCandidate, kmerIdxEnd, counterLength) <= countQueryEnd)) ++kmersInCandidate;
     kmerDistance = GPU_MAX(kmerDistance, kmersInCandidate);
     // Advance sliding window
     ++endPos;
     ++beginPos;
   }
   // kmer filtering distance
-  (* filterDistance) = (maxKmers - kmerDistance) / GPU_KMER_FILTER_COUNTING_LENGTH;
+  (* filterDistance) = (maxKmers - GPU_MIN(kmerDistance, maxKmers)) / kmerLength;
 }
 
 
 // Filter text region
-GPU_INLINE __device__ void gpu_kmer_filter_candidate(const uint16_t* const kmerCountQuery, uint16_t* const kmerCountCandidate,
+GPU_INLINE __device__ void gpu_kmer_filter_candidate(const uint32_t* const kmerCountQuery, uint32_t* const kmerCountCandidate,
                                                      const uint32_t queryLength, const uint32_t candidateLength,
-                                                     const uint64_t* const candidate, const uint64_t offsetCandPos,
-                                                     uint32_t* const filterDistance)
+                                                     const uint64_t* const candidate, const uint64_t offsetCandPos, const uint64_t forwardSizeRef,
+                                                     const uint32_t kmerLength, const uint32_t counterLength, uint32_t* const filterDistance)
 {
   // Prepare filter
   const uint32_t baseCandidateLength = GPU_KMER_FILTER_BASE_CANDIDATE_LENGTH;
-  const uint32_t maxKmers = GPU_MIN(candidateLength, queryLength) - (GPU_KMER_FILTER_COUNTING_LENGTH - 1);
+  const uint32_t kmerMask = GPU_KMER_FILTER_COUNTING_MASK(kmerLength);
+  const int32_t  maxKmers = GPU_MIN(candidateLength, queryLength) - (kmerLength - 1);
   uint32_t endPos = 0, kmerIdxEnd = 0;
   ulong2   infoCandidateEnd = GPU_TEXT_INIT;
   int32_t  kmersInCandidate = 0, kmerDistance = 0;
   // Initial window fill (Composing the first k-mer)
-  while (endPos < (GPU_KMER_FILTER_COUNTING_LENGTH - 1)){
-    const uint8_t encChar = gpu_text_lookup(candidate, offsetCandPos + endPos, &infoCandidateEnd, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar); // Update kmer-index
+  while (endPos < (kmerLength - 1)){
+    const uint8_t encChar = gpu_text_lookup_strand(candidate, offsetCandPos + endPos, forwardSizeRef, &infoCandidateEnd, baseCandidateLength, GPU_KMER_FILTER_BASE_CANDIDATE_MASK);
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encChar, kmerMask); // Update kmer-index
     endPos++;
   }
   // Sliding window count (End processing)
   while (endPos < candidateLength) {
-    const uint8_t encBaseEnd = gpu_text_lookup(candidate, offsetCandPos + endPos, &infoCandidateEnd, baseCandidateLength);
-    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd);
-    const uint16_t countQueryEnd     = kmerCountQuery[kmerIdxEnd];
-    const uint16_t countCandidateEnd = kmerCountCandidate[kmerIdxEnd];
-    if ((countQueryEnd > 0) && (countCandidateEnd < countQueryEnd)){
+    const uint8_t encBaseEnd = gpu_text_lookup_strand(candidate, offsetCandPos + endPos, forwardSizeRef, &infoCandidateEnd, baseCandidateLength, GPU_KMER_FILTER_BASE_CANDIDATE_MASK);
+    GPU_KMER_FILTER_COUNTING_ADD_INDEX(kmerIdxEnd, encBaseEnd, kmerMask);
+    const uint32_t countQueryEnd     = gpu_kmer_filter_counter_get(kmerCountQuery, kmerIdxEnd, counterLength);
+    const uint32_t countCandidateEnd = gpu_kmer_filter_counter_inc(kmerCountCandidate, kmerIdxEnd, counterLength);
+    if ((countQueryEnd > 0) && ((countCandidateEnd < countQueryEnd) || gpu_kmer_filter_counter_is_saturated(countQueryEnd, counterLength))){
       kmersInCandidate++;
       kmerDistance = GPU_MAX(kmerDistance, kmersInCandidate);
     }
     // Advance sliding window and increment tiling
-    kmerCountCandidate[kmerIdxEnd]++;
     endPos++;
   }
-  // kmer filtering distance
-  (* filterDistance) = (maxKmers - kmerDistance) / GPU_KMER_FILTER_COUNTING_LENGTH;
+  // kmer filtering distance (saturated k-mers can exceed the shared k-mers bound)
+  (* filterDistance) = (maxKmers - GPU_MIN(kmerDistance, maxKmers)) / kmerLength;
 }
 
-//k-mer filter device kernel
-__global__ void gpu_kmer_filter_kernel(const gpu_kmer_filter_qry_entry_t* const d_queries, const gpu_kmer_filter_qry_info_t* const d_qinfo,
-                                       const uint64_t* const reference, const gpu_kmer_filter_cand_info_t* const d_candidates, const uint64_t sizeRef,
-                                       gpu_kmer_filter_alg_entry_t* const d_filterResult, const uint32_t maxError,  const uint32_t numAlignments)
+//k-mer filter device kernel (the counter tables are carved by each kernel size, the k-mer length and the counter width are runtime)
+GPU_INLINE __device__ void gpu_kmer_filter_kernel_candidate(const gpu_kmer_filter_qry_entry_t* const d_queries, const gpu_kmer_filter_qry_info_t* const d_qinfo,
+                                                            const uint64_t* const reference, const gpu_kmer_filter_cand_info_t* const d_candidates, const uint64_t forwardSizeRef,
+                                                            gpu_kmer_filter_alg_entry_t* const d_filterResult, const uint32_t kmerLength, const uint32_t counterLength,
+                                                            const uint32_t idAlignment, uint32_t* const kmerCountQuery, uint32_t* const kmerCountCandidate)
 {
-  const uint32_t idAlignment = gpu_get_thread_idx();
-  if(idAlignment < numAlignments){
-    const uint64_t positionRef     = d_candidates[idAlignment].position;
-    const uint32_t sizeCandidate   = d_candidates[idAlignment].size;
-    const uint32_t sizeQuery       = d_qinfo[d_candidates[idAlignment].query].query_size;
-    const uint64_t* const query    = (uint64_t*) (d_queries + d_qinfo[d_candidates[idAlignment].query].init_offset);
-    // Filter initialization
-    uint32_t filterDistance = 0;
-    uint16_t kmerCountCandidate[GPU_KMER_FILTER_COUNTING_NUM_KMERS] = {0};
-    uint16_t kmerCountQuery[GPU_KMER_FILTER_COUNTING_NUM_KMERS]     = {0};
-    // Compile all k-mers from pattern
-    gpu_kmer_filter_compile_pattern(kmerCountQuery, query, sizeQuery);
-    // Compile all k-mers from text
-    gpu_kmer_filter_candidate(kmerCountQuery, kmerCountCandidate, sizeQuery, sizeCandidate, reference, positionRef, &filterDistance);
-    d_filterResult[idAlignment] = filterDistance;
-  }
+  const uint64_t positionRef     = d_candidates[idAlignment].position;
+  const uint32_t sizeCandidate   = d_candidates[idAlignment].size;
+  const uint32_t sizeQuery       = d_qinfo[d_candidates[idAlignment].query].query_size;
+  const uint64_t* const query    = (uint64_t*) (d_queries + d_qinfo[d_candidates[idAlignment].query].init_offset);
+  // Filter initialization
+  uint32_t filterDistance = 0;
+  // Compile all k-mers from pattern
+  gpu_kmer_filter_compile_pattern(kmerCountQuery, query, sizeQuery, kmerLength, counterLength);
+  // Compile all k-mers from text
+  gpu_kmer_filter_candidate(kmerCountQuery, kmerCountCandidate, sizeQuery, sizeCandidate, reference, positionRef, forwardSizeRef,
+                            kmerLength, counterLength, &filterDistance);
+  d_filterResult[idAlignment] = filterDistance;
 }
 
+#define GPU_KMER_FILTER_KERNEL(NUM_WORDS)                                                                                                                  \
+__global__ void gpu_kmer_filter_kernel_##NUM_WORDS(const gpu_kmer_filter_qry_entry_t* const d_queries, const gpu_kmer_filter_qry_info_t* const d_qinfo,    \
+                                                   const uint64_t* const reference, const gpu_kmer_filter_cand_info_t* const d_candidates,                 \
+                                                   const uint64_t forwardSizeRef, gpu_kmer_filter_alg_entry_t* const d_filterResult,                      \
+                                                   const uint32_t kmerLength, const uint32_t counterLength, const uint32_t numAlignments)                 \
+{                                                                                                                                                          \
+  const uint32_t idAlignment = gpu_get_thread_idx();                                                                                                       \
+  if(idAlignment < numAlignments){                                                                                                                         \
+    uint32_t kmerCountCandidate[NUM_WORDS] = {0};                                                                                                          \
+    uint32_t kmerCountQuery[NUM_WORDS]     = {0};                                                                                                          \
+    gpu_kmer_filter_kernel_candidate(d_queries, d_qinfo, reference, d_candidates, forwardSizeRef, d_filterResult, kmerLength, counterLength,             \
+                                     idAlignment, kmerCountQuery, kmerCountCandidate);                                                                     \
+  }                                                                                                                                                        \
+}
+
+// Kernels per counter table size (4^k counters of 4 or 8 bits, up to GPU_KMER_FILTER_MAX_COUNTER_WORDS per table)
+GPU_KMER_FILTER_KERNEL(32)
+GPU_KMER_FILTER_KERNEL(64)
+GPU_KMER_FILTER_KERNEL(128)
+GPU_KMER_FILTER_KERNEL(256)
+GPU_KMER_FILTER_KERNEL(512)
+GPU_KMER_FILTER_KERNEL(1024)
+GPU_KMER_FILTER_KERNEL(2048)
+
+#define GPU_KMER_FILTER_LAUNCH_KERNEL(NUM_WORDS)                                                                                                           \
+  case NUM_WORDS:                                                                                                                                          \
+    gpu_kmer_filter_kernel_##NUM_WORDS<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>(qry->d_queries, qry->d_queryInfo, ref->d_reference_plain[idSupDev], \
+                                                                                        cand->d_candidates, ref->forwardSize, res->d_alignments,           \
+                                                                                        kmerLength, counterLength, res->numAlignments);                    \
+    break;
+
 
 extern "C"
 gpu_error_t gpu_kmer_filter_process_buffer(gpu_buffer_t *mBuff)
@@ -223,18 +304,29 @@ gpu_error_t gpu_kmer_filter_process_buffer(gpu_buffer_t *mBuff)
   const uint32_t                                   maxQueries    =  mBuff->data.fkmer.maxQueries;
   const uint32_t                                   maxCandidates =  mBuff->data.fkmer.maxCandidates;
   const uint32_t                                   maxAlignments =  mBuff->data.fkmer.maxAlignments;
-  const uint32_t                                   maxError      =  mBuff->data.fkmer.maxError;
+  const uint32_t                                   kmerLength    =  mBuff->data.fkmer.kmerLength;
+  const uint32_t                                   counterLength =  mBuff->data.fkmer.counterLength;
 
   dim3 blocksPerGrid, threadsPerBlock;
   const uint32_t numThreads = res->numAlignments;
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
-  if((qry->numBases > maxBases) || (qry->numQueries > maxQueries) || (res->numAlignments > maxCandidates) || (res->numAlignments > maxAlignments))
+  if((qry->numBases > maxBases) || (qry->numQueries > maxQueries) || (res->numAlignments > maxCandidates) || (res->numAlignments > maxAlignments)){
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
+  }
 
-  gpu_kmer_filter_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>(qry->d_queries, qry->d_queryInfo, ref->d_reference_plain[idSupDev],
-                                                                          cand->d_candidates, ref->size, res->d_alignments,
-                                                                          maxError, res->numAlignments);
+  switch(GPU_KMER_FILTER_COUNTER_WORDS(kmerLength, counterLength)){
+    GPU_KMER_FILTER_LAUNCH_KERNEL(32)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(64)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(128)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(256)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(512)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(1024)
+    GPU_KMER_FILTER_LAUNCH_KERNEL(2048)
+    default:
+      return(E_USE_CASE_NOT_ALLOWED);
+  }
   return(SUCCESS);
 }
 
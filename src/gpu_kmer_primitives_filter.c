@@ -95,22 +95,37 @@ void gpu_kmer_filter_reallocate_device_buffer_layout(gpu_buffer_t* mBuff)
   rawAlloc = (void *) (mBuff->data.fkmer.alignments.d_alignments + mBuff->data.fkmer.maxAlignments);
 }
 
-void gpu_kmer_filter_init_buffer_(void* const kmerBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+void gpu_kmer_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
 {
-  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) kmerBuffer;
   const double        sizeBuff                = mBuff->sizeBuffer * 0.95;
   const uint32_t      numInputs               = (uint32_t)(sizeBuff / gpu_kmer_filter_size_per_candidate(averageQuerySize, candidatesPerQuery));
   const uint32_t      maxCandidates           = numInputs;
   // Set the type of the buffer
   mBuff->typeBuffer = GPU_KMER_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
   // Set real size of the input
   mBuff->data.fkmer.maxCandidates    = maxCandidates;
   mBuff->data.fkmer.maxAlignments    = maxCandidates;
   mBuff->data.fkmer.maxBases         = (maxCandidates / candidatesPerQuery) * averageQuerySize;
   mBuff->data.fkmer.maxQueries       = (maxCandidates / candidatesPerQuery);
   // Set the corresponding buffer layout
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
   gpu_kmer_filter_reallocate_host_buffer_layout(mBuff);
   gpu_kmer_filter_reallocate_device_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_kmer_filter_init_buffer_(void* const kmerBuffer, const uint32_t averageQuerySize, const uint32_t candidatesPerQuery)
+{
+  gpu_buffer_t* const mBuff                   = (gpu_buffer_t *) kmerBuffer;
+  uint32_t            tunedQuerySize          = averageQuerySize;
+  uint32_t            tunedCandidatesPerQuery = candidatesPerQuery;
+  // The observed workload replaces the caller estimations once the autotuner has a full window
+  mBuff->typeBuffer = GPU_KMER_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  GPU_ERROR(gpu_buffer_balance(mBuff));
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, &tunedCandidatesPerQuery);
+  gpu_kmer_filter_set_buffer_layout(mBuff, tunedQuerySize, tunedCandidatesPerQuery);
 }
 
 void gpu_kmer_filter_init_and_realloc_buffer_(void *kmerBuffer, const uint32_t totalBases, const uint32_t totalCandidates, const uint32_t totalQueries)
@@ -120,7 +135,7 @@ void gpu_kmer_filter_init_and_realloc_buffer_(void *kmerBuffer, const uint32_t t
   const uint32_t averageQuerySize       = totalBases / totalQueries;
   const uint32_t candidatesPerQuery     = totalCandidates / totalQueries;
   // Re-map the buffer layout with new information trying to fit better
-  gpu_kmer_filter_init_buffer_(kmerBuffer, averageQuerySize, candidatesPerQuery);
+  gpu_kmer_filter_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   // Checking if we need to reallocate a bigger buffer
   if( (totalBases      > gpu_kmer_filter_buffer_get_max_qry_bases_(kmerBuffer))   ||
       (totalCandidates > gpu_kmer_filter_buffer_get_max_candidates_(kmerBuffer))  ||
@@ -132,6 +147,7 @@ void gpu_kmer_filter_init_and_realloc_buffer_(void *kmerBuffer, const uint32_t t
     //printf("RESIZE[KMER_FILTER] %d %d \n",  mBuff->sizeBuffer, bytesPerKmerBuffer * resizeFactor);
     //Recalculate the minimum buffer size
     mBuff->sizeBuffer = bytesPerKmerBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
     //FREE HOST AND DEVICE BUFFER
     GPU_ERROR(gpu_buffer_free(mBuff));
     //Select the device of the Multi-GPU platform
@@ -140,7 +156,7 @@ void gpu_kmer_filter_init_and_realloc_buffer_(void *kmerBuffer, const uint32_t t
     CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
     CUDA_ERROR(cudaMalloc((void**) &mBuff->d_rawData, mBuff->sizeBuffer));
     // Re-map the buffer layout with the new size
-    gpu_kmer_filter_init_buffer_(kmerBuffer, averageQuerySize, candidatesPerQuery);
+    gpu_kmer_filter_set_buffer_layout(mBuff, averageQuerySize, candidatesPerQuery);
   }
 }
 
@@ -162,21 +178,27 @@ gpu_error_t gpu_kmer_filter_transfer_CPU_to_GPU(gpu_buffer_t *mBuff)
   cpySize += cand->numCandidates * sizeof(gpu_kmer_filter_cand_info_t);
   cpySize += res->numAlignments * sizeof(gpu_kmer_filter_alg_entry_t);
   bufferUtilization = (double)cpySize / (double)mBuff->sizeBuffer;
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Compacting transference with high buffer occupation
   if(bufferUtilization > 0.15){
     cpySize  = ((void *) (cand->d_candidates + cand->numCandidates)) - ((void *) qry->d_queries);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }else{
     // Transfer Binary Queries to GPU
     cpySize = qry->numBases * sizeof(gpu_kmer_filter_qry_entry_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queries, qry->h_queries, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer to GPU the information associated with Binary Queries
     cpySize = qry->numQueries * sizeof(gpu_kmer_filter_qry_info_t);
     CUDA_ERROR(cudaMemcpyAsync(qry->d_queryInfo, qry->h_queryInfo, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
     // Transfer Candidates to GPU
     cpySize = cand->numCandidates * sizeof(gpu_kmer_filter_cand_info_t);
     CUDA_ERROR(cudaMemcpyAsync(cand->d_candidates, cand->h_candidates, cpySize, cudaMemcpyHostToDevice, idStream));
+    gpu_stats_add_transfer_CPU_to_GPU(&mBuff->stats, cpySize);
   }
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_CPU_TO_GPU, idStream));
   // Succeed
   return (SUCCESS);
 }
@@ -188,30 +210,58 @@ gpu_error_t gpu_kmer_filter_transfer_GPU_to_CPU(gpu_buffer_t *mBuff)
   size_t                              cpySize;
   // Transfer Candidates to CPU
   cpySize = res->numAlignments * sizeof(gpu_kmer_filter_alg_entry_t);
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
   CUDA_ERROR(cudaMemcpyAsync(res->h_alignments, res->d_alignments, cpySize, cudaMemcpyDeviceToHost, idStream));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_GPU_TO_CPU, idStream));
+  gpu_stats_add_transfer_GPU_to_CPU(&mBuff->stats, cpySize);
   // Succeed
   return (SUCCESS);
 }
 
+uint32_t gpu_kmer_filter_select_counter_length(const gpu_kmer_filter_queries_buffer_t* const qry)
+{
+  uint32_t idQuery, maxQuerySize = 0;
+  for(idQuery = 0; idQuery < qry->numQueries; ++idQuery)
+    maxQuerySize = GPU_MAX(maxQuerySize, qry->h_queryInfo[idQuery].query_size);
+  // Repetitions of a k-mer are bounded by the query length (counters saturate beyond it)
+  return((maxQuerySize <= GPU_KMER_FILTER_COUNTER_SHORT_MAX_QUERY_SIZE) ? GPU_KMER_FILTER_COUNTER_LENGTH_SHORT : GPU_KMER_FILTER_COUNTER_LENGTH_LONG);
+}
+
 void gpu_kmer_filter_send_buffer_(void* const kmerBuffer, const uint32_t numBases, const uint32_t numQueries,
-                                  const uint32_t numCandidates, const uint32_t maxError)
+                                  const uint32_t numCandidates, const uint32_t maxError, const uint32_t kmerLength)
 {
+  const double timeSend = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff       = (gpu_buffer_t *) kmerBuffer;
   const uint32_t      idSupDevice = mBuff->idSupportedDevice;
+  const uint32_t      lengthKmer  = (kmerLength == 0) ? GPU_KMER_FILTER_DEFAULT_KMER_LENGTH : kmerLength;
+  //Sanity-check (the counter tables are sized per k-mer length)
+  if((lengthKmer < GPU_KMER_FILTER_MIN_KMER_LENGTH) || (lengthKmer > GPU_KMER_FILTER_MAX_KMER_LENGTH))
+    GPU_ERROR(E_USE_CASE_NOT_ALLOWED);
   //Set real size of the things
   mBuff->data.fkmer.queries.numBases            = numBases;
   mBuff->data.fkmer.queries.numQueries          = numQueries;
   mBuff->data.fkmer.candidates.numCandidates    = numCandidates;
   mBuff->data.fkmer.alignments.numAlignments    = numCandidates;
   mBuff->data.fkmer.maxError                    = maxError;
+  mBuff->data.fkmer.kmerLength                  = lengthKmer;
+  mBuff->data.fkmer.counterLength               = gpu_kmer_filter_select_counter_length(&mBuff->data.fkmer.queries);
+  //Sanity-check (the counter tables live in the thread local memory, long queries need wider counters)
+  if(GPU_KMER_FILTER_COUNTER_WORDS(lengthKmer, mBuff->data.fkmer.counterLength) > GPU_KMER_FILTER_MAX_COUNTER_WORDS)
+    GPU_ERROR(E_USE_CASE_NOT_ALLOWED);
+  gpu_stats_add_submission(&mBuff->stats, numCandidates, mBuff->data.fkmer.maxCandidates);
+  gpu_buffer_balance_submit(mBuff, numCandidates);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numBases, numCandidates);
   //Select the device of the Multi-GPU platform
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   //CPU->GPU Transfers & Process Kernel in Asynchronous way
   GPU_ERROR(gpu_kmer_filter_transfer_CPU_to_GPU(mBuff));
   /* INCLUDED SUPPORT for future GPUs with PTX ASM code (JIT compiling) */
+  GPU_ERROR(gpu_stats_start_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   GPU_ERROR(gpu_kmer_filter_process_buffer(mBuff));
+  GPU_ERROR(gpu_stats_stop_segment(&mBuff->stats, GPU_STATS_SEGMENT_KERNEL, mBuff->listStreams[mBuff->idStream]));
   //GPU->CPU Transfers
   GPU_ERROR(gpu_kmer_filter_transfer_GPU_to_CPU(mBuff));
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "kmer_filter send", timeSend);
 }
 
 /************************************************************
@@ -220,6 +270,7 @@ Functions to receive & process a K-MER buffer from GPU
 
 void gpu_kmer_filter_receive_buffer_(void* const kmerBuffer)
 {
+  const double timeReceive = gpu_trace_sample_time();
   gpu_buffer_t* const mBuff       = (gpu_buffer_t *) kmerBuffer;
   const uint32_t      idSupDevice =  mBuff->idSupportedDevice;
   const cudaStream_t  idStream    =  mBuff->listStreams[mBuff->idStream];
@@ -227,6 +278,88 @@ void gpu_kmer_filter_receive_buffer_(void* const kmerBuffer)
   CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
   //Synchronize Stream (the thread wait for the commands done in the stream)
   CUDA_ERROR(cudaStreamSynchronize(idStream));
+  GPU_ERROR(gpu_stats_update_segments(&mBuff->stats));
+  gpu_buffer_balance_complete(mBuff);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "kmer_filter receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_kmer_filter_batch_candidates(const gpu_buffer_t* const mBuff, const gpu_kmer_filter_qry_info_t* const queryInfo,
+                                          const gpu_kmer_filter_cand_info_t* const candidates, const uint32_t numCandidates,
+                                          uint32_t* const idFirstQuery, uint32_t* const idLastQuery)
+{
+  const uint32_t maxCandidates = GPU_MIN(mBuff->data.fkmer.maxCandidates, mBuff->data.fkmer.maxAlignments);
+  const uint32_t maxQueries    = mBuff->data.fkmer.maxQueries;
+  const uint32_t maxBases      = mBuff->data.fkmer.maxBases;
+  uint32_t idCandidate;
+  //Greedy growth of the sub-batch (the queries referenced by the candidates are sent as a contiguous window)
+  for(idCandidate = 0; (idCandidate < numCandidates) && (idCandidate < maxCandidates); ++idCandidate){
+    const uint32_t idQuery    = candidates[idCandidate].query;
+    const uint32_t firstQuery = (idCandidate == 0) ? idQuery : GPU_MIN((* idFirstQuery), idQuery);
+    const uint32_t lastQuery  = (idCandidate == 0) ? idQuery : GPU_MAX((* idLastQuery), idQuery);
+    const uint32_t numBases   = queryInfo[lastQuery].init_offset + queryInfo[lastQuery].query_size - queryInfo[firstQuery].init_offset;
+    if(((lastQuery - firstQuery + 1) > maxQueries) || (numBases > maxBases)) break;
+    (* idFirstQuery) = firstQuery;
+    (* idLastQuery)  = lastQuery;
+  }
+  return(idCandidate);
+}
+
+void gpu_kmer_filter_receive_batch_(void* const kmerBuffer)
+{
+  gpu_buffer_t* const                mBuff      = (gpu_buffer_t *) kmerBuffer;
+  const gpu_buffer_batch_t*          batch      = &mBuff->batch;
+  gpu_kmer_filter_alg_entry_t* const alignments = (gpu_kmer_filter_alg_entry_t *) batch->h_results;
+  gpu_kmer_filter_receive_buffer_(kmerBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays
+  memcpy(alignments + batch->offset, mBuff->data.fkmer.alignments.h_alignments, batch->numElements * sizeof(gpu_kmer_filter_alg_entry_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_kmer_filter_send_batch_(void* const kmerBuffer, const gpu_kmer_filter_qry_entry_t* const queries, const gpu_kmer_filter_qry_info_t* const queryInfo,
+                                 const gpu_kmer_filter_cand_info_t* const candidates, const uint32_t numCandidates, const uint32_t maxError,
+                                 const uint32_t kmerLength, gpu_kmer_filter_alg_entry_t* const alignments)
+{
+  gpu_buffer_t* const                  mBuff  = (gpu_buffer_t *) kmerBuffer;
+  gpu_kmer_filter_queries_buffer_t*    qry    = &mBuff->data.fkmer.queries;
+  gpu_kmer_filter_candidates_buffer_t* cand   = &mBuff->data.fkmer.candidates;
+  uint32_t                             offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t idFirstQuery = 0, idLastQuery = 0, numSubQueries = 0, numSubBases = 0, baseOffset = 0, idQuery, idCandidate;
+    const uint32_t numSubCandidates = gpu_kmer_filter_batch_candidates(mBuff, queryInfo, candidates + offset, numCandidates - offset,
+                                                                       &idFirstQuery, &idLastQuery);
+    //Sanity-check (the buffer can not hold a single candidate and its query)
+    if((numSubCandidates == 0) && (offset < numCandidates)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the query references)
+    if(numSubCandidates != 0){
+      baseOffset    = queryInfo[idFirstQuery].init_offset;
+      numSubQueries = idLastQuery - idFirstQuery + 1;
+      numSubBases   = queryInfo[idLastQuery].init_offset + queryInfo[idLastQuery].query_size - baseOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_kmer_filter_qry_entry_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]              = queryInfo[idFirstQuery + idQuery];
+      qry->h_queryInfo[idQuery].init_offset -= baseOffset;
+    }
+    for(idCandidate = 0; idCandidate < numSubCandidates; ++idCandidate){
+      cand->h_candidates[idCandidate]        = candidates[offset + idCandidate];
+      cand->h_candidates[idCandidate].query -= idFirstQuery;
+    }
+    gpu_kmer_filter_send_buffer_(kmerBuffer, numSubBases, numSubQueries, numSubCandidates, maxError, kmerLength);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubCandidates, 0, 0, alignments, NULL, NULL);
+    offset += numSubCandidates;
+    numSubBatches++;
+    if(offset < numCandidates) gpu_kmer_filter_receive_batch_(kmerBuffer);
+  } while(offset < numCandidates);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
 }
 
 #endif /* GPU_KMER_PRIMITIVES_FILTER_C_ */
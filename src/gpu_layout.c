@@ -0,0 +1,68 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_LAYOUT_C_
+#define GPU_LAYOUT_C_
+
+#include "../include/gpu_layout.h"
+
+/************************************************************
+Functions to initialize the autotuner
+************************************************************/
+
+void gpu_layout_reset(gpu_layout_buffer_t* const layout)
+{
+  memset(layout->module, 0, sizeof(layout->module));
+}
+
+void gpu_layout_init(gpu_layout_buffer_t* const layout, const uint32_t tuningPeriod)
+{
+  layout->tuningPeriod = tuningPeriod;
+  gpu_layout_reset(layout);
+}
+
+/************************************************************
+Functions to observe the workload and tune the layouts
+************************************************************/
+
+void gpu_layout_observe(gpu_layout_buffer_t* const layout, gpu_stats_buffer_t* const stats, const uint32_t numQueries,
+                        const uint64_t numBases, const uint32_t numCandidates)
+{
+  gpu_layout_module_t* const module = &layout->module[stats->idModule];
+  if((layout->tuningPeriod == GPU_LAYOUT_TUNING_DISABLED) || (numQueries == 0)) return;
+  // Accumulate the submission (the caller fills the buffer until any region is full)
+  module->numSubmissions++;
+  module->numQueries    += numQueries;
+  module->numBases      += numBases;
+  module->numCandidates += numCandidates;
+  if(module->numSubmissions < layout->tuningPeriod) return;
+  // Ratios of the observed workload for the next carvings of the same allocation
+  module->averageQuerySize   = GPU_MAX(GPU_DIV_CEIL(module->numBases, module->numQueries), 1);
+  module->candidatesPerQuery = GPU_MAX(GPU_DIV_CEIL(module->numCandidates, module->numQueries), 1);
+  module->tuned              = true;
+  gpu_stats_add_layout_tuning(stats);
+  // Start the next observation window
+  module->numSubmissions = 0;
+  module->numQueries     = 0;
+  module->numBases       = 0;
+  module->numCandidates  = 0;
+}
+
+bool gpu_layout_tune(const gpu_layout_buffer_t* const layout, const gpu_stats_buffer_t* const stats,
+                     uint32_t* const averageQuerySize, uint32_t* const candidatesPerQuery)
+{
+  const gpu_layout_module_t* const module = &layout->module[stats->idModule];
+  // Caller estimations are kept until a full window has been observed
+  if((layout->tuningPeriod == GPU_LAYOUT_TUNING_DISABLED) || !module->tuned) return(false);
+  (* averageQuerySize)   = module->averageQuerySize;
+  if(candidatesPerQuery != NULL) (* candidatesPerQuery) = module->candidatesPerQuery;
+  return(true);
+}
+
+#endif /* GPU_LAYOUT_C_ */
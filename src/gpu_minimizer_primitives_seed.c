@@ -0,0 +1,272 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_MINIMIZER_PRIMITIVES_SEED_C_
+#define GPU_MINIMIZER_PRIMITIVES_SEED_C_
+
+#include "../include/gpu_minimizer_primitives_seed.h"
+
+/************************************************************
+Functions to get the MINIMIZER buffers
+************************************************************/
+
+gpu_minimizer_seed_qry_entry_t* gpu_minimizer_seed_buffer_get_queries_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.queries.h_queries);
+}
+
+gpu_minimizer_seed_qry_info_t* gpu_minimizer_seed_buffer_get_qry_info_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.queries.h_queryInfo);
+}
+
+gpu_minimizer_seed_result_t* gpu_minimizer_seed_buffer_get_results_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.queries.h_results);
+}
+
+gpu_minimizer_seed_cand_info_t* gpu_minimizer_seed_buffer_get_candidates_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.candidates.h_candidates);
+}
+
+/************************************************************
+Functions to get the maximum elements of the buffers
+************************************************************/
+
+uint32_t gpu_minimizer_seed_buffer_get_max_qry_bases_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.maxBases);
+}
+
+uint32_t gpu_minimizer_seed_buffer_get_max_candidates_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.maxCandidates);
+}
+
+uint32_t gpu_minimizer_seed_buffer_get_max_queries_(const void* const seedBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  return(mBuff->data.mmseed.maxQueries);
+}
+
+/************************************************************
+Functions to initialize the buffers (MINIMIZER SEED)
+************************************************************/
+
+size_t gpu_minimizer_seed_size_per_query(const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery)
+{
+  //Memory size dedicated to each query
+  const size_t bytesPerBases     = averageQuerySize * sizeof(gpu_minimizer_seed_qry_entry_t);
+  const size_t bytesPerQueryInfo = sizeof(gpu_minimizer_seed_qry_info_t) + sizeof(gpu_minimizer_seed_result_t);
+  const size_t bytesPerQuery     = bytesPerBases + bytesPerQueryInfo;
+  //Return maximum memory size required per each query (all the candidate slots are reserved)
+  return((maxCandidatesPerQuery * sizeof(gpu_minimizer_seed_cand_info_t)) + bytesPerQuery);
+}
+
+void gpu_minimizer_seed_reallocate_host_buffer_layout(gpu_buffer_t* mBuff)
+{
+  const void* rawAlloc = mBuff->h_rawData;
+  //Adjust the host buffer layout (input)
+  mBuff->data.mmseed.queries.h_queries = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.mmseed.queries.h_queries + mBuff->data.mmseed.maxBases);
+  mBuff->data.mmseed.queries.h_queryInfo = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.mmseed.queries.h_queryInfo + mBuff->data.mmseed.maxQueries);
+  //Adjust the host buffer layout (output)
+  mBuff->data.mmseed.queries.h_results = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.mmseed.queries.h_results + mBuff->data.mmseed.maxQueries);
+  mBuff->data.mmseed.candidates.h_candidates = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.mmseed.candidates.h_candidates + mBuff->data.mmseed.maxCandidates);
+}
+
+void gpu_minimizer_seed_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery)
+{
+  const uint32_t      candidatesPerQuery = GPU_MAX(maxCandidatesPerQuery, GPU_MINIMIZER_SEED_MIN_CANDIDATES);
+  const size_t        sizeBuff           = mBuff->sizeBuffer * 0.95;
+  const size_t        bytesPerQuery      = gpu_minimizer_seed_size_per_query(averageQuerySize, candidatesPerQuery);
+  const uint32_t      numQueries         = sizeBuff / bytesPerQuery;
+  //set the type of the buffer
+  mBuff->typeBuffer = GPU_MINIMIZER_SEED;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  // Set real size of the input
+  mBuff->data.mmseed.maxQueries            = numQueries;
+  mBuff->data.mmseed.maxBases              = numQueries * averageQuerySize;
+  mBuff->data.mmseed.maxCandidates         = numQueries * candidatesPerQuery;
+  // Internal data information
+  mBuff->data.mmseed.maxCandidatesPerQuery = candidatesPerQuery;
+  // Set the corresponding buffer layout (the seeding runs over the host copies)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+  gpu_minimizer_seed_reallocate_host_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_minimizer_seed_init_buffer_(void* const seedBuffer, const uint32_t averageQuerySize, const uint32_t maxCandidatesPerQuery)
+{
+  gpu_buffer_t* const mBuff          = (gpu_buffer_t *) seedBuffer;
+  uint32_t            tunedQuerySize = averageQuerySize;
+  // The observed query sizes replace the caller estimation (the candidate slots are kept)
+  mBuff->typeBuffer = GPU_MINIMIZER_SEED;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedQuerySize, NULL);
+  gpu_minimizer_seed_set_buffer_layout(mBuff, tunedQuerySize, maxCandidatesPerQuery);
+}
+
+void gpu_minimizer_seed_init_and_realloc_buffer_(void *seedBuffer, const uint32_t maxCandidatesPerQuery, const uint32_t totalQueryBases,
+                                                 const uint32_t totalQueries)
+{
+  // Buffer reinitialization
+  gpu_buffer_t* const mBuff            = (gpu_buffer_t *) seedBuffer;
+  const uint32_t      averageQuerySize = GPU_DIV_CEIL(totalQueryBases, totalQueries);
+  const uint32_t      totalCandidates  = totalQueries * GPU_MAX(maxCandidatesPerQuery, GPU_MINIMIZER_SEED_MIN_CANDIDATES);
+  // Remap the buffer layout with new information trying to fit better
+  gpu_minimizer_seed_set_buffer_layout(mBuff, averageQuerySize, maxCandidatesPerQuery);
+  // Checking if we need to reallocate a bigger buffer
+  if( (totalQueryBases > gpu_minimizer_seed_buffer_get_max_qry_bases_(seedBuffer)) ||
+      (totalQueries    > gpu_minimizer_seed_buffer_get_max_queries_(seedBuffer))   ||
+      (totalCandidates > gpu_minimizer_seed_buffer_get_max_candidates_(seedBuffer))){
+    // Resize the GPU buffer to fit the required input
+    const uint32_t      idSupDevice        = mBuff->idSupportedDevice;
+    const float         resizeFactor       = 2.0;
+    const size_t        bytesPerSeedBuffer = totalQueries * gpu_minimizer_seed_size_per_query(averageQuerySize, maxCandidatesPerQuery);
+    //Recalculate the minimum buffer size
+    mBuff->sizeBuffer = bytesPerSeedBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
+    //FREE HOST AND DEVICE BUFFER
+    GPU_ERROR(gpu_buffer_free(mBuff));
+    //Select the device of the Multi-GPU platform
+    CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
+    //ALLOCATE HOST BUFFER (the seeding runs on the host)
+    CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
+    // Remap the buffer layout with the new size
+    gpu_minimizer_seed_set_buffer_layout(mBuff, averageQuerySize, maxCandidatesPerQuery);
+  }
+}
+
+/************************************************************
+Functions to process the buffers (MINIMIZER SEED)
+************************************************************/
+
+void gpu_minimizer_seed_send_buffer_(void* const seedBuffer, const uint32_t numBases, const uint32_t numQueries, const uint32_t numCandidates,
+                                     const uint32_t maxOccurrences, const uint32_t bandWidth, const uint32_t minAnchors, const uint32_t numThreads)
+{
+  const double timeSend = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  //Set real size of the input (zero selects the default seeding parameters)
+  mBuff->data.mmseed.maxOccurrences           = (maxOccurrences != 0) ? maxOccurrences : GPU_MINIMIZER_SEED_DEFAULT_MAX_OCCURRENCES;
+  mBuff->data.mmseed.bandWidth                = (bandWidth != 0) ? bandWidth : GPU_MINIMIZER_SEED_DEFAULT_BAND_WIDTH;
+  mBuff->data.mmseed.minAnchors               = (minAnchors != 0) ? minAnchors : GPU_MINIMIZER_SEED_DEFAULT_MIN_ANCHORS;
+  mBuff->data.mmseed.numThreads               = gpu_minimizer_seed_get_num_threads(numThreads, numQueries);
+  mBuff->data.mmseed.queries.numBases         = numBases;
+  mBuff->data.mmseed.queries.numQueries       = numQueries;
+  mBuff->data.mmseed.candidates.numCandidates = numCandidates;
+  gpu_stats_add_submission(&mBuff->stats, numQueries, mBuff->data.mmseed.maxQueries);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numBases, numCandidates);
+  //The seeding runs on the host threads (results are ready at the reception)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  GPU_ERROR(gpu_minimizer_seed_process_buffer(mBuff));
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "minimizer_seed send", timeSend);
+}
+
+void gpu_minimizer_seed_receive_buffer_(void* const seedBuffer)
+{
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) seedBuffer;
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "minimizer_seed receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_minimizer_seed_batch_queries(const gpu_buffer_t* const mBuff, const gpu_minimizer_seed_qry_info_t* const queryInfo,
+                                          const gpu_minimizer_seed_result_t* const results, const uint32_t numQueries)
+{
+  const uint32_t maxQueries         = mBuff->data.mmseed.maxQueries;
+  const uint32_t maxBases           = mBuff->data.mmseed.maxBases;
+  const uint32_t maxCandidates      = mBuff->data.mmseed.maxCandidates;
+  const uint32_t candidatesPerQuery = mBuff->data.mmseed.maxCandidatesPerQuery;
+  uint32_t idQuery;
+  //Greedy growth of the sub-batch (query bases and candidate slots are contiguous windows)
+  for(idQuery = 0; (idQuery < numQueries) && (idQuery < maxQueries); ++idQuery){
+    const uint32_t numBases      = queryInfo[idQuery].init_offset + queryInfo[idQuery].query_size - queryInfo[0].init_offset;
+    const uint32_t numCandidates = results[idQuery].init_offset + candidatesPerQuery - results[0].init_offset;
+    if((numBases > maxBases) || (numCandidates > maxCandidates)) break;
+  }
+  return(idQuery);
+}
+
+void gpu_minimizer_seed_receive_batch_(void* const seedBuffer)
+{
+  gpu_buffer_t* const                          mBuff      = (gpu_buffer_t *) seedBuffer;
+  const gpu_buffer_batch_t*                    batch      = &mBuff->batch;
+  const gpu_minimizer_seed_queries_buffer_t*   qryBuff    = &mBuff->data.mmseed.queries;
+  const gpu_minimizer_seed_candidates_buffer_t* candBuff  = &mBuff->data.mmseed.candidates;
+  gpu_minimizer_seed_result_t* const           results    = (gpu_minimizer_seed_result_t *) batch->h_results;
+  gpu_minimizer_seed_cand_info_t* const        candidates = (gpu_minimizer_seed_cand_info_t *) batch->h_entries;
+  uint32_t idQuery, idCandidate;
+  gpu_minimizer_seed_receive_buffer_(seedBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays (the candidate slots keep the caller offsets)
+  for(idQuery = 0; idQuery < batch->numElements; ++idQuery){
+    const gpu_minimizer_seed_result_t* const subResult = &qryBuff->h_results[idQuery];
+    gpu_minimizer_seed_result_t* const       result    = &results[batch->offset + idQuery];
+    gpu_minimizer_seed_cand_info_t* const    slots     = candidates + result->init_offset;
+    result->num_candidates = subResult->num_candidates;
+    result->num_dropped    = subResult->num_dropped;
+    result->num_anchors    = subResult->num_anchors;
+    //Candidates refer to the caller queries
+    for(idCandidate = 0; idCandidate < subResult->num_candidates; ++idCandidate){
+      slots[idCandidate]        = candBuff->h_candidates[subResult->init_offset + idCandidate];
+      slots[idCandidate].query += batch->offset;
+    }
+  }
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_minimizer_seed_send_batch_(void* const seedBuffer, const gpu_minimizer_seed_qry_entry_t* const queries,
+                                    const gpu_minimizer_seed_qry_info_t* const queryInfo, gpu_minimizer_seed_result_t* const results,
+                                    const uint32_t numQueries, const uint32_t maxOccurrences, const uint32_t bandWidth, const uint32_t minAnchors,
+                                    const uint32_t numThreads, gpu_minimizer_seed_cand_info_t* const candidates)
+{
+  gpu_buffer_t* const                  mBuff  = (gpu_buffer_t *) seedBuffer;
+  gpu_minimizer_seed_queries_buffer_t* qry    = &mBuff->data.mmseed.queries;
+  uint32_t                             offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t numSubBases = 0, numSubCandidates = 0, baseOffset = 0, candidateOffset = 0, idQuery;
+    const uint32_t numSubQueries = gpu_minimizer_seed_batch_queries(mBuff, queryInfo + offset, results + offset, numQueries - offset);
+    //Sanity-check (the buffer can not hold a single query)
+    if((numSubQueries == 0) && (offset < numQueries)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the base and candidate offsets)
+    if(numSubQueries != 0){
+      const uint32_t idLastQuery = offset + numSubQueries - 1;
+      baseOffset       = queryInfo[offset].init_offset;
+      candidateOffset  = results[offset].init_offset;
+      numSubBases      = queryInfo[idLastQuery].init_offset + queryInfo[idLastQuery].query_size - baseOffset;
+      numSubCandidates = results[idLastQuery].init_offset + mBuff->data.mmseed.maxCandidatesPerQuery - candidateOffset;
+    }
+    memcpy(qry->h_queries, queries + baseOffset, numSubBases * sizeof(gpu_minimizer_seed_qry_entry_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]              = queryInfo[offset + idQuery];
+      qry->h_queryInfo[idQuery].init_offset -= baseOffset;
+      qry->h_results[idQuery].init_offset    = results[offset + idQuery].init_offset - candidateOffset;
+    }
+    gpu_minimizer_seed_send_buffer_(seedBuffer, numSubBases, numSubQueries, numSubCandidates, maxOccurrences, bandWidth, minAnchors, numThreads);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubQueries, candidateOffset, numSubCandidates, results, candidates, NULL);
+    offset += numSubQueries;
+    numSubBatches++;
+    if(offset < numQueries) gpu_minimizer_seed_receive_batch_(seedBuffer);
+  } while(offset < numQueries);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+}
+
+#endif /* GPU_MINIMIZER_PRIMITIVES_SEED_C_ */
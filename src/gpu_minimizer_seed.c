@@ -0,0 +1,236 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_MINIMIZER_SEED_C_
+#define GPU_MINIMIZER_SEED_C_
+
+#include "../include/gpu_minimizer_primitives_seed.h"
+
+/************************************************************
+Functions to manage the scratch space of the workers
+************************************************************/
+
+gpu_error_t gpu_minimizer_seed_reserve(void** const scratch, uint64_t* const maxElements, const uint64_t numElements, const size_t sizeElement)
+{
+  uint64_t newMaxElements = GPU_MAX((* maxElements), GPU_MINIMIZER_SEED_MIN_SCRATCH);
+  void*    newScratch     = NULL;
+  if(numElements <= (* maxElements)) return(SUCCESS);
+  // Geometric growth (the scratch is reused by all the queries of the worker)
+  while(newMaxElements < numElements) newMaxElements *= 2;
+  newScratch = realloc((* scratch), newMaxElements * sizeElement);
+  if(newScratch == NULL) return(E_ALLOCATE_MEM);
+  (* scratch)     = newScratch;
+  (* maxElements) = newMaxElements;
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to sort the anchors and the chains
+************************************************************/
+
+int gpu_minimizer_seed_cmp_anchors(const void* const a, const void* const b)
+{
+  const gpu_minimizer_seed_anchor_t* const anchorA = (const gpu_minimizer_seed_anchor_t *) a;
+  const gpu_minimizer_seed_anchor_t* const anchorB = (const gpu_minimizer_seed_anchor_t *) b;
+  if(anchorA->diagonal != anchorB->diagonal) return((anchorA->diagonal < anchorB->diagonal) ? -1 : 1);
+  return((anchorA->queryPosition < anchorB->queryPosition) ? -1 : (anchorA->queryPosition > anchorB->queryPosition));
+}
+
+int gpu_minimizer_seed_cmp_chains_score(const void* const a, const void* const b)
+{
+  const gpu_minimizer_seed_chain_t* const chainA = (const gpu_minimizer_seed_chain_t *) a;
+  const gpu_minimizer_seed_chain_t* const chainB = (const gpu_minimizer_seed_chain_t *) b;
+  // Best supported chains first (ties are resolved by position to keep the selection deterministic)
+  if(chainA->numAnchors != chainB->numAnchors) return((chainA->numAnchors > chainB->numAnchors) ? -1 : 1);
+  return((chainA->position < chainB->position) ? -1 : (chainA->position > chainB->position));
+}
+
+int gpu_minimizer_seed_cmp_chains_position(const void* const a, const void* const b)
+{
+  const gpu_minimizer_seed_chain_t* const chainA = (const gpu_minimizer_seed_chain_t *) a;
+  const gpu_minimizer_seed_chain_t* const chainB = (const gpu_minimizer_seed_chain_t *) b;
+  return((chainA->position < chainB->position) ? -1 : (chainA->position > chainB->position));
+}
+
+/************************************************************
+Functions to seed a query (sketch, anchor and chain)
+************************************************************/
+
+gpu_error_t gpu_minimizer_seed_anchor_query(gpu_minimizer_seed_worker_t* const worker, const gpu_minimizer_seed_qry_info_t* const queryInfo,
+                                            uint64_t* const numAnchors)
+{
+  const gpu_minimizer_seed_context_t* const   context    = worker->context;
+  const gpu_reference_minimizers_t* const     minimizers = context->minimizers;
+  const gpu_minimizer_seed_qry_entry_t* const query      = context->queries + queryInfo->init_offset;
+  gpu_reference_minimizers_sketch_t sketch;
+  gpu_reference_minimizer_t         minimizer;
+  gpu_error_t error;
+  uint64_t anchors = 0;
+  uint32_t idBase;
+  // The query is sketched with the same (w,k) setup as the reference
+  gpu_reference_minimizers_sketch_init(&sketch, minimizers->w, minimizers->k);
+  for(idBase = 0; idBase < queryInfo->query_size; ++idBase){
+    const uint32_t base = gpu_reference_minimizers_base_ASCII(query[idBase]);
+    uint64_t idEntry, idFirstEntry, numOccurrences;
+    if(!gpu_reference_minimizers_sketch_push(&sketch, base, idBase, &minimizer)) continue;
+    numOccurrences = gpu_reference_minimizers_search(minimizers, minimizer.hash, &idFirstEntry);
+    // Repetitive minimizers are discarded (they only add noise to the chains)
+    if((numOccurrences == 0) || (numOccurrences > context->maxOccurrences)) continue;
+    error = gpu_minimizer_seed_reserve((void **) &worker->h_anchors, &worker->maxAnchors, anchors + numOccurrences,
+                                       sizeof(gpu_minimizer_seed_anchor_t));
+    if(error != SUCCESS) return(error);
+    for(idEntry = idFirstEntry; idEntry < idFirstEntry + numOccurrences; ++idEntry){
+      worker->h_anchors[anchors].diagonal      = (int64_t) minimizers->h_entries[idEntry].position - (int64_t) minimizer.position;
+      worker->h_anchors[anchors].queryPosition = (uint32_t) minimizer.position;
+      anchors++;
+    }
+  }
+  (* numAnchors) = anchors;
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_minimizer_seed_chain_anchors(gpu_minimizer_seed_worker_t* const worker, const uint64_t numAnchors, const uint32_t querySize,
+                                             uint64_t* const numChains)
+{
+  const gpu_minimizer_seed_context_t* const context   = worker->context;
+  const gpu_minimizer_seed_anchor_t* const  anchors   = worker->h_anchors;
+  const int64_t                             bandWidth = context->bandWidth;
+  uint64_t idAnchor = 0, chains = 0;
+  // Anchors of the same alignment share the diagonal (up to the indels inside the band)
+  qsort(worker->h_anchors, numAnchors, sizeof(gpu_minimizer_seed_anchor_t), gpu_minimizer_seed_cmp_anchors);
+  while(idAnchor < numAnchors){
+    const int64_t minDiagonal = anchors[idAnchor].diagonal;
+    uint64_t      idLastAnchor = idAnchor;
+    int64_t       initWindow, endWindow;
+    while((idLastAnchor + 1 < numAnchors) && (anchors[idLastAnchor + 1].diagonal - minDiagonal <= bandWidth)) idLastAnchor++;
+    // The window covers the full query around the diagonals of the chain
+    initWindow = GPU_MAX(minDiagonal - bandWidth, 0);
+    endWindow  = GPU_MIN(anchors[idLastAnchor].diagonal + querySize + bandWidth, (int64_t) context->referenceSize);
+    if(((idLastAnchor - idAnchor + 1) >= context->minAnchors) && (initWindow < endWindow)){
+      gpu_minimizer_seed_chain_t* chain = NULL;
+      const gpu_error_t error = gpu_minimizer_seed_reserve((void **) &worker->h_chains, &worker->maxChains, chains + 1,
+                                                           sizeof(gpu_minimizer_seed_chain_t));
+      if(error != SUCCESS) return(error);
+      chain = &worker->h_chains[chains++];
+      chain->minDiagonal = minDiagonal;
+      chain->maxDiagonal = anchors[idLastAnchor].diagonal;
+      chain->numAnchors  = (uint32_t) (idLastAnchor - idAnchor + 1);
+      chain->position    = (uint64_t) initWindow;
+      chain->size        = (uint32_t) (endWindow - initWindow);
+    }
+    idAnchor = idLastAnchor + 1;
+  }
+  (* numChains) = chains;
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_minimizer_seed_process_query(gpu_minimizer_seed_worker_t* const worker, const uint32_t idQuery)
+{
+  const gpu_minimizer_seed_context_t* const  context    = worker->context;
+  const gpu_minimizer_seed_qry_info_t* const queryInfo  = &context->queryInfo[idQuery];
+  gpu_minimizer_seed_result_t* const         result     = &context->results[idQuery];
+  gpu_minimizer_seed_cand_info_t* const      candidates = context->candidates + result->init_offset;
+  uint64_t numAnchors = 0, numChains = 0, numKept, idChain;
+  gpu_error_t error = gpu_minimizer_seed_anchor_query(worker, queryInfo, &numAnchors);
+  if(error != SUCCESS) return(error);
+  error = gpu_minimizer_seed_chain_anchors(worker, numAnchors, queryInfo->query_size, &numChains);
+  if(error != SUCCESS) return(error);
+  // Only the best supported chains fit in the candidate slots of the query
+  numKept = GPU_MIN(numChains, context->maxCandidatesPerQuery);
+  if(numChains > numKept)
+    qsort(worker->h_chains, numChains, sizeof(gpu_minimizer_seed_chain_t), gpu_minimizer_seed_cmp_chains_score);
+  qsort(worker->h_chains, numKept, sizeof(gpu_minimizer_seed_chain_t), gpu_minimizer_seed_cmp_chains_position);
+  for(idChain = 0; idChain < numKept; ++idChain){
+    candidates[idChain].position = worker->h_chains[idChain].position;
+    candidates[idChain].query    = idQuery;
+    candidates[idChain].size     = worker->h_chains[idChain].size;
+  }
+  result->num_candidates = (uint32_t) numKept;
+  result->num_dropped    = (uint32_t) (numChains - numKept);
+  result->num_anchors    = (uint32_t) GPU_MIN(numAnchors, GPU_UINT32_ONES);
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to distribute the queries among the host threads
+************************************************************/
+
+void* gpu_minimizer_seed_worker(void* const threadWorker)
+{
+  gpu_minimizer_seed_worker_t* const  worker  = (gpu_minimizer_seed_worker_t *) threadWorker;
+  gpu_minimizer_seed_context_t* const context = worker->context;
+  // Dynamic scheduling: the number of hits per query is irregular
+  while(context->error == SUCCESS){
+    const uint32_t initQuery = __sync_fetch_and_add(&context->nextQuery, GPU_MINIMIZER_SEED_QUERIES_PER_TASK);
+    const uint32_t endQuery  = GPU_MIN(initQuery + GPU_MINIMIZER_SEED_QUERIES_PER_TASK, context->numQueries);
+    uint32_t idQuery;
+    if(initQuery >= context->numQueries) break;
+    for(idQuery = initQuery; idQuery < endQuery; ++idQuery){
+      const gpu_error_t error = gpu_minimizer_seed_process_query(worker, idQuery);
+      if(error != SUCCESS){
+        __sync_bool_compare_and_swap(&context->error, SUCCESS, error);
+        break;
+      }
+    }
+  }
+  return(NULL);
+}
+
+uint32_t gpu_minimizer_seed_get_num_threads(const uint32_t numThreads, const uint32_t numQueries)
+{
+  return(gpu_get_num_workers(numThreads, GPU_DIV_CEIL(numQueries, GPU_MINIMIZER_SEED_QUERIES_PER_TASK), GPU_MINIMIZER_SEED_MAX_THREADS));
+}
+
+gpu_error_t gpu_minimizer_seed_process_buffer(gpu_buffer_t* const mBuff)
+{
+  const gpu_minimizer_seed_queries_buffer_t* qryBuff    = &mBuff->data.mmseed.queries;
+  const uint32_t                             numThreads = GPU_MAX(mBuff->data.mmseed.numThreads, 1);
+  gpu_minimizer_seed_context_t context;
+  gpu_minimizer_seed_worker_t  workers[GPU_MINIMIZER_SEED_MAX_THREADS];
+  uint32_t idThread, numLaunched = 0;
+  // The index is built (or read) at the reference load of the GPU_MINIMIZER_SEED module
+  if(mBuff->reference->minimizers.h_entries == NULL) return(E_DATA_NOT_ALLOCATED);
+  // Seeding setup shared by all the threads
+  context.minimizers            = &mBuff->reference->minimizers;
+  context.referenceSize         = mBuff->reference->size;
+  context.queries               = qryBuff->h_queries;
+  context.queryInfo             = qryBuff->h_queryInfo;
+  context.results               = qryBuff->h_results;
+  context.candidates            = mBuff->data.mmseed.candidates.h_candidates;
+  context.numQueries            = qryBuff->numQueries;
+  context.maxCandidatesPerQuery = mBuff->data.mmseed.maxCandidatesPerQuery;
+  context.maxOccurrences        = mBuff->data.mmseed.maxOccurrences;
+  context.bandWidth             = mBuff->data.mmseed.bandWidth;
+  context.minAnchors            = mBuff->data.mmseed.minAnchors;
+  context.nextQuery             = 0;
+  context.error                 = SUCCESS;
+  // Each thread grows its own anchor and chain scratch space
+  for(idThread = 0; idThread < numThreads; ++idThread){
+    workers[idThread].context    = &context;
+    workers[idThread].h_anchors  = NULL;
+    workers[idThread].maxAnchors = 0;
+    workers[idThread].h_chains   = NULL;
+    workers[idThread].maxChains  = 0;
+  }
+  // The calling thread works as the first worker (a failed launch only reduces the parallelism)
+  for(idThread = 1; idThread < numThreads; ++idThread){
+    if(pthread_create(&workers[idThread].thread, NULL, gpu_minimizer_seed_worker, &workers[idThread]) != 0) break;
+    numLaunched++;
+  }
+  gpu_minimizer_seed_worker(&workers[0]);
+  for(idThread = 1; idThread <= numLaunched; ++idThread)
+    pthread_join(workers[idThread].thread, NULL);
+  for(idThread = 0; idThread < numThreads; ++idThread){
+    free(workers[idThread].h_anchors);
+    free(workers[idThread].h_chains);
+  }
+  return(context.error);
+}
+
+#endif /* GPU_MINIMIZER_SEED_C_ */
@@ -13,7 +13,7 @@
 #include "../include/gpu_module.h"
 
 // Sorted by allocation priority
-gpu_module_t structureList[] = {GPU_REFERENCE, GPU_FMI, GPU_SA};
+gpu_module_t structureList[] = {GPU_REFERENCE, GPU_FMI_DEVICE, GPU_SA};
 
 uint32_t gpu_module_get_num_allocated(const gpu_module_t activeModules)
 {
@@ -38,12 +38,13 @@ gpu_error_t gpu_module_get_min_memory(gpu_reference_buffer_t* const reference, c
 
   GPU_ERROR(gpu_buffer_get_min_memory_size(&bytesPerBuffer));
   GPU_ERROR(gpu_reference_get_size(reference, &bytesPerReference, GPU_REFERENCE));
-  GPU_ERROR(gpu_index_get_size(index, &bytesPerFMIndex, GPU_FMI));
+  //The reverse BWT (SMEM search) never leaves the host
+  GPU_ERROR(gpu_index_get_size(index, &bytesPerFMIndex, GPU_FMI & ~GPU_FMI_SMEM_SEARCH));
   GPU_ERROR(gpu_index_get_size(index, &bytesPerSAIndex, GPU_SA));
 
   memorySize = numBuffers * bytesPerBuffer;
   if(activeModules & GPU_REFERENCE) memorySize += bytesPerReference;
-  if(activeModules & GPU_FMI) memorySize += bytesPerFMIndex;
+  if(activeModules & GPU_FMI_DEVICE) memorySize += bytesPerFMIndex;
   if(activeModules & GPU_SA) memorySize += bytesPerSAIndex;
 
   (* minimumMemorySize) = memorySize;
@@ -60,7 +61,7 @@ gpu_error_t gpu_module_set_device_allocation(gpu_reference_buffer_t* const refer
   reference->memorySpace[idSupDevice] = moduleMemorySpace;
 
   moduleMemorySpace = GPU_HOST_MAPPED;
-  if(allocatedModules & GPU_FMI) moduleMemorySpace = GPU_DEVICE_MAPPED;
+  if(allocatedModules & GPU_FMI_DEVICE) moduleMemorySpace = GPU_DEVICE_MAPPED;
   index->fmi.memorySpace[idSupDevice] = moduleMemorySpace;
   index->fmi.table.memorySpace[idSupDevice] = moduleMemorySpace;
 
@@ -76,7 +77,7 @@ gpu_error_t gpu_module_get_device_allocation(gpu_reference_buffer_t* const refer
 {
   (* allocatedModules) = GPU_NONE_MODULES;
   if (reference->memorySpace[idSupDevice] == GPU_DEVICE_MAPPED) (* allocatedModules) |= GPU_REFERENCE;
-  if (index->fmi.memorySpace[idSupDevice] == GPU_DEVICE_MAPPED) (* allocatedModules) |= GPU_FMI;
+  if (index->fmi.memorySpace[idSupDevice] == GPU_DEVICE_MAPPED) (* allocatedModules) |= GPU_FMI_DEVICE;
   if (index->sa.memorySpace[idSupDevice]  == GPU_DEVICE_MAPPED) (* allocatedModules) |= GPU_SA;
   return (SUCCESS);
 }
@@ -126,6 +127,7 @@ gpu_error_t gpu_module_manager_per_device(gpu_reference_buffer_t* const referenc
     case GPU_GEM_POLICY:           // (GEM Default Allocation)
       GPU_ERROR(gpu_module_allocator_per_device(reference, index, idDevice, numBuffers, userSelectedModules, &tmpAllocatedModules));
       (* activatedModules) = tmpAllocatedModules | GPU_REFERENCE | GPU_BPM_ALIGN; // Reference is the minimum required module to be execute
+      (* activatedModules) |= userSelectedModules & GPU_FMI & ~GPU_FMI_DEVICE; // Host searches never need device room
       (* allocatedModules) = tmpAllocatedModules;
       break;
     default:
@@ -0,0 +1,271 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_NUMA_C_
+#define GPU_NUMA_C_
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/gpu_numa.h"
+#include <ctype.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef GPU_NUMA_LIBNUMA
+#include <numa.h>
+#endif
+
+/* Process-wide topology (resolved once, before the worker threads are launched) */
+static gpu_numa_topology_t gpu_numa_topology = {false, 1, 0};
+/* Node where the calling thread is bound (selects the local replicas) */
+static __thread int32_t gpu_numa_thread_node = GPU_NUMA_NODE_ANY;
+
+/************************************************************
+Functions to discover the system topology
+************************************************************/
+
+bool gpu_numa_read_line(const char* const fileName, char* const line, const size_t maxSize)
+{
+  FILE* fp = fopen(fileName, "r");
+  bool  succeed = false;
+  if(fp == NULL) return(false);
+  succeed = (fgets(line, maxSize, fp) != NULL);
+  fclose(fp);
+  return(succeed);
+}
+
+void gpu_numa_parse_cpulist(const char* const cpuList, const int32_t idNode)
+{
+  // CPU lists are ranges separated by commas (i.e. "0-15,32-47")
+  const char* list = cpuList;
+  while(isdigit(*list)){
+    char* endList = NULL;
+    const uint32_t firstCPU = strtoul(list, &endList, 10);
+    uint32_t lastCPU = firstCPU, idCPU;
+    if(*endList == '-') lastCPU = strtoul(endList + 1, &endList, 10);
+    for(idCPU = firstCPU; (idCPU <= lastCPU) && (idCPU < GPU_NUMA_MAX_CPUS); ++idCPU){
+      gpu_numa_topology.nodeCPU[idCPU] = idNode;
+      gpu_numa_topology.numCPUs = GPU_MAX(gpu_numa_topology.numCPUs, idCPU + 1);
+    }
+    list = (*endList == ',') ? endList + 1 : endList;
+  }
+}
+
+void gpu_numa_init_topology()
+{
+  uint32_t idCPU;
+  int32_t  idNode;
+  if(gpu_numa_topology.initialized) return;
+  for(idCPU = 0; idCPU < GPU_NUMA_MAX_CPUS; ++idCPU)
+    gpu_numa_topology.nodeCPU[idCPU] = GPU_NUMA_NODE_ANY;
+  gpu_numa_topology.numNodes = 1;
+  gpu_numa_topology.numCPUs  = 0;
+  #ifdef GPU_NUMA_LIBNUMA
+  if(numa_available() != -1){
+    gpu_numa_topology.numNodes = GPU_MIN(numa_max_node() + 1, GPU_NUMA_MAX_NODES);
+    gpu_numa_topology.numCPUs  = GPU_MIN(numa_num_configured_cpus(), GPU_NUMA_MAX_CPUS);
+    for(idCPU = 0; idCPU < gpu_numa_topology.numCPUs; ++idCPU)
+      gpu_numa_topology.nodeCPU[idCPU] = numa_node_of_cpu(idCPU);
+    gpu_numa_topology.initialized = true;
+    return;
+  }
+  #endif
+  // Fallback: node descriptions exported by the kernel (nodes can be sparse)
+  for(idNode = 0; idNode < GPU_NUMA_MAX_NODES; ++idNode){
+    char fileName[GPU_NUMA_SYSFS_PATH_SIZE], cpuList[GPU_NUMA_SYSFS_PATH_SIZE * 4];
+    snprintf(fileName, GPU_NUMA_SYSFS_PATH_SIZE, "%s/node%d/cpulist", GPU_NUMA_SYSFS_NODES, idNode);
+    if(!gpu_numa_read_line(fileName, cpuList, sizeof(cpuList))) continue;
+    gpu_numa_parse_cpulist(cpuList, idNode);
+    gpu_numa_topology.numNodes = idNode + 1;
+  }
+  gpu_numa_topology.initialized = true;
+}
+
+uint32_t gpu_numa_get_num_nodes()
+{
+  gpu_numa_init_topology();
+  return(gpu_numa_topology.numNodes);
+}
+
+int32_t gpu_numa_get_cpu_node(const uint32_t idCPU)
+{
+  gpu_numa_init_topology();
+  if(idCPU >= gpu_numa_topology.numCPUs) return(GPU_NUMA_NODE_ANY);
+  return(gpu_numa_topology.nodeCPU[idCPU]);
+}
+
+int32_t gpu_numa_get_device_node(const uint32_t idDevice)
+{
+  char busId[GPU_NUMA_SYSFS_PATH_SIZE], line[GPU_NUMA_SYSFS_PATH_SIZE];
+  char fileName[sizeof(GPU_NUMA_SYSFS_PCI) + GPU_NUMA_SYSFS_PATH_SIZE + sizeof("/numa_node")];
+  uint32_t idChar;
+  int32_t  idNode;
+  if(gpu_numa_get_num_nodes() <= 1) return(GPU_NUMA_NODE_ANY);
+  // The PCI root complex of the device defines its local node (sysfs uses lowercase ids)
+  if(cudaDeviceGetPCIBusId(busId, GPU_NUMA_SYSFS_PATH_SIZE, idDevice) != cudaSuccess) return(GPU_NUMA_NODE_ANY);
+  for(idChar = 0; busId[idChar] != '\0'; ++idChar)
+    busId[idChar] = tolower(busId[idChar]);
+  // A truncated path would read the node of other device
+  if(snprintf(fileName, sizeof(fileName), "%s/%s/numa_node", GPU_NUMA_SYSFS_PCI, busId) >= (int) sizeof(fileName)) return(GPU_NUMA_NODE_ANY);
+  if(!gpu_numa_read_line(fileName, line, GPU_NUMA_SYSFS_PATH_SIZE)) return(GPU_NUMA_NODE_ANY);
+  idNode = atoi(line);
+  // Firmware without affinity information reports -1
+  if((idNode < 0) || ((uint32_t) idNode >= gpu_numa_topology.numNodes)) return(GPU_NUMA_NODE_ANY);
+  return(idNode);
+}
+
+int32_t gpu_numa_get_thread_node()
+{
+  return(gpu_numa_thread_node);
+}
+
+/************************************************************
+Functions to place the threads and the memory
+************************************************************/
+
+void gpu_numa_set_node_mask(unsigned long* const nodeMask, const int32_t idNode)
+{
+  memset(nodeMask, 0, GPU_DIV_CEIL(GPU_NUMA_MAX_NODES, GPU_UINT64_LENGTH) * sizeof(unsigned long));
+  nodeMask[idNode / GPU_UINT64_LENGTH] = 1UL << (idNode % GPU_UINT64_LENGTH);
+}
+
+gpu_error_t gpu_numa_bind_thread(const int32_t idNode)
+{
+  // Best effort: threads keep running wherever they are if the binding is not allowed
+  if(idNode == GPU_NUMA_NODE_ANY) return(SUCCESS);
+  #ifdef GPU_NUMA_LIBNUMA
+  if(numa_available() != -1){
+    if(numa_run_on_node(idNode) == 0) gpu_numa_thread_node = idNode;
+    return(SUCCESS);
+  }
+  #endif
+  {
+    cpu_set_t cpuSet;
+    uint32_t  idCPU;
+    gpu_numa_init_topology();
+    CPU_ZERO(&cpuSet);
+    for(idCPU = 0; (idCPU < gpu_numa_topology.numCPUs) && (idCPU < CPU_SETSIZE); ++idCPU)
+      if(gpu_numa_topology.nodeCPU[idCPU] == idNode) CPU_SET(idCPU, &cpuSet);
+    if((CPU_COUNT(&cpuSet) != 0) && (sched_setaffinity(0, sizeof(cpu_set_t), &cpuSet) == 0))
+      gpu_numa_thread_node = idNode;
+  }
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_numa_set_preferred(const int32_t idNode)
+{
+  // Following allocations of the calling thread are placed on the node (while it has free pages)
+  if(idNode == GPU_NUMA_NODE_ANY) return(SUCCESS);
+  #ifdef GPU_NUMA_LIBNUMA
+  if(numa_available() != -1){
+    numa_set_preferred(idNode);
+    return(SUCCESS);
+  }
+  #endif
+  {
+    unsigned long nodeMask[GPU_DIV_CEIL(GPU_NUMA_MAX_NODES, GPU_UINT64_LENGTH)];
+    gpu_numa_set_node_mask(nodeMask, idNode);
+    syscall(SYS_set_mempolicy, GPU_NUMA_MPOL_PREFERRED, nodeMask, GPU_NUMA_MAX_NODES + 1);
+  }
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_numa_set_default()
+{
+  #ifdef GPU_NUMA_LIBNUMA
+  if(numa_available() != -1){
+    numa_set_localalloc();
+    return(SUCCESS);
+  }
+  #endif
+  syscall(SYS_set_mempolicy, GPU_NUMA_MPOL_DEFAULT, NULL, 0);
+  return(SUCCESS);
+}
+
+void* gpu_numa_alloc_onnode(const size_t size, const int32_t idNode)
+{
+  // Pages are bound before the first touch, so the writer thread does not decide the placement
+  void* const memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(memory == MAP_FAILED) return(NULL);
+  if(idNode == GPU_NUMA_NODE_ANY) return(memory);
+  #ifdef GPU_NUMA_LIBNUMA
+  if(numa_available() != -1){
+    numa_tonode_memory(memory, size, idNode);
+    return(memory);
+  }
+  #endif
+  {
+    unsigned long nodeMask[GPU_DIV_CEIL(GPU_NUMA_MAX_NODES, GPU_UINT64_LENGTH)];
+    gpu_numa_set_node_mask(nodeMask, idNode);
+    syscall(SYS_mbind, memory, size, GPU_NUMA_MPOL_PREFERRED, nodeMask, GPU_NUMA_MAX_NODES + 1, 0);
+  }
+  return(memory);
+}
+
+void gpu_numa_free(void* const memory, const size_t size)
+{
+  if(memory != NULL) munmap(memory, size);
+}
+
+/************************************************************
+Functions to manage the per-node replicas
+************************************************************/
+
+void gpu_numa_replicas_init_dto(gpu_numa_replicas_t* const replicas)
+{
+  uint32_t idNode;
+  replicas->numNodes = 0;
+  replicas->size     = 0;
+  for(idNode = 0; idNode < GPU_NUMA_MAX_NODES; ++idNode)
+    replicas->h_replicas[idNode] = NULL;
+}
+
+gpu_error_t gpu_numa_replicas_build(gpu_numa_replicas_t* const replicas, const void* const h_data, const size_t size)
+{
+  const uint32_t numNodes = gpu_numa_get_num_nodes();
+  uint32_t idNode;
+  GPU_ERROR(gpu_numa_replicas_free(replicas));
+  // Single node systems use the original copy
+  if((numNodes <= 1) || (h_data == NULL)) return(SUCCESS);
+  replicas->numNodes = numNodes;
+  replicas->size     = size;
+  for(idNode = 0; idNode < numNodes; ++idNode){
+    replicas->h_replicas[idNode] = gpu_numa_alloc_onnode(size, idNode);
+    if(replicas->h_replicas[idNode] == NULL) return(E_ALLOCATE_MEM);
+    memcpy(replicas->h_replicas[idNode], h_data, size);
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+const void* gpu_numa_replicas_get_local(const gpu_numa_replicas_t* const replicas, const void* const h_data)
+{
+  // Unbound threads (or nodes without replica) read the original copy
+  const int32_t idNode = gpu_numa_thread_node;
+  if((idNode == GPU_NUMA_NODE_ANY) || ((uint32_t) idNode >= replicas->numNodes)) return(h_data);
+  if(replicas->h_replicas[idNode] == NULL) return(h_data);
+  return(replicas->h_replicas[idNode]);
+}
+
+gpu_error_t gpu_numa_replicas_free(gpu_numa_replicas_t* const replicas)
+{
+  uint32_t idNode;
+  for(idNode = 0; idNode < replicas->numNodes; ++idNode){
+    gpu_numa_free(replicas->h_replicas[idNode], replicas->size);
+    replicas->h_replicas[idNode] = NULL;
+  }
+  replicas->numNodes = 0;
+  replicas->size     = 0;
+  // Succeed
+  return(SUCCESS);
+}
+
+#endif /* GPU_NUMA_C_ */
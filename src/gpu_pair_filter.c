@@ -0,0 +1,186 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_PAIR_FILTER_C_
+#define GPU_PAIR_FILTER_C_
+
+#include "../include/gpu_pair_primitives_filter.h"
+
+/************************************************************
+Functions to sort the mate lists
+************************************************************/
+
+int gpu_pair_filter_cmp_positions(const void* const a, const void* const b)
+{
+  const gpu_pair_filter_sort_entry_t* const mateA = (const gpu_pair_filter_sort_entry_t *) a;
+  const gpu_pair_filter_sort_entry_t* const mateB = (const gpu_pair_filter_sort_entry_t *) b;
+  if(mateA->position != mateB->position) return((mateA->position < mateB->position) ? -1 : 1);
+  // Ties keep the caller order (qsort is not stable)
+  return((mateA->idMate < mateB->idMate) ? -1 : (mateA->idMate > mateB->idMate));
+}
+
+void gpu_pair_filter_sort_mates(const gpu_pair_filter_mate_entry_t* const mates, const uint32_t numMates,
+                                gpu_pair_filter_sort_entry_t* const sortedMates)
+{
+  uint32_t idMate;
+  for(idMate = 0; idMate < numMates; ++idMate){
+    sortedMates[idMate].position = mates[idMate].position;
+    sortedMates[idMate].strand   = mates[idMate].strand;
+    sortedMates[idMate].idMate   = idMate;
+  }
+  qsort(sortedMates, numMates, sizeof(gpu_pair_filter_sort_entry_t), gpu_pair_filter_cmp_positions);
+}
+
+/************************************************************
+Functions to pair the mates of a read pair (sort-merge join)
+************************************************************/
+
+bool gpu_pair_filter_is_concordant(const gpu_pair_filter_context_t* const context, const gpu_pair_filter_sort_entry_t* const mate1,
+                                   const gpu_pair_filter_sort_entry_t* const mate2, const uint32_t sizeMate1, const uint32_t sizeMate2,
+                                   uint32_t* const insertSize)
+{
+  const bool mate1Forward = (mate1->strand == GPU_PAIR_FILTER_STRAND_FORWARD);
+  const bool mate2Forward = (mate2->strand == GPU_PAIR_FILTER_STRAND_FORWARD);
+  const gpu_pair_filter_sort_entry_t *upstream = NULL, *downstream = NULL;
+  uint32_t sizeDownstream = 0;
+  uint64_t insert;
+  bool     mate1Upstream;
+  // The orientation selects which mate has to be placed first
+  switch(context->orientation){
+    case GPU_PAIR_FILTER_ORIENTATION_FR:
+      if(mate1Forward == mate2Forward) return(false);
+      mate1Upstream = mate1Forward;
+      break;
+    case GPU_PAIR_FILTER_ORIENTATION_RF:
+      if(mate1Forward == mate2Forward) return(false);
+      mate1Upstream = !mate1Forward;
+      break;
+    case GPU_PAIR_FILTER_ORIENTATION_FF:
+      if(mate1Forward != mate2Forward) return(false);
+      mate1Upstream = mate1Forward;
+      break;
+    default:
+      return(false);
+  }
+  upstream       = mate1Upstream ? mate1 : mate2;
+  downstream     = mate1Upstream ? mate2 : mate1;
+  sizeDownstream = mate1Upstream ? sizeMate2 : sizeMate1;
+  if(upstream->position > downstream->position) return(false);
+  // Insert size from the upstream start to the downstream end
+  insert = downstream->position + sizeDownstream - upstream->position;
+  if((insert < context->minInsertSize) || (insert > context->maxInsertSize)) return(false);
+  (* insertSize) = (uint32_t) insert;
+  return(true);
+}
+
+void gpu_pair_filter_process_query(const gpu_pair_filter_worker_t* const worker, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                   gpu_pair_filter_result_t* const result)
+{
+  const gpu_pair_filter_context_t* const context     = worker->context;
+  gpu_pair_filter_sort_entry_t* const    sortedMate1 = worker->h_sortMate1;
+  gpu_pair_filter_sort_entry_t* const    sortedMate2 = worker->h_sortMate2;
+  gpu_pair_filter_pair_entry_t* const    pairs       = context->pairs + result->init_offset;
+  const uint64_t                         maxDistance = context->maxInsertSize;
+  uint32_t idMate1, idMate2, idLowMate2 = 0, numPairs = 0, numDropped = 0;
+  gpu_pair_filter_sort_mates(context->mates + queryInfo->init_offset_mate1, queryInfo->num_mate1, sortedMate1);
+  gpu_pair_filter_sort_mates(context->mates + queryInfo->init_offset_mate2, queryInfo->num_mate2, sortedMate2);
+  // Both lists are walked in position order, mate 2 candidates lay inside a sliding window of the max insert size
+  for(idMate1 = 0; idMate1 < queryInfo->num_mate1; ++idMate1){
+    const gpu_pair_filter_sort_entry_t* const mate1      = &sortedMate1[idMate1];
+    const uint64_t                            initWindow = (mate1->position > maxDistance) ? mate1->position - maxDistance : 0;
+    const uint64_t                            endWindow  = mate1->position + maxDistance;
+    while((idLowMate2 < queryInfo->num_mate2) && (sortedMate2[idLowMate2].position < initWindow)) idLowMate2++;
+    for(idMate2 = idLowMate2; (idMate2 < queryInfo->num_mate2) && (sortedMate2[idMate2].position <= endWindow); ++idMate2){
+      const gpu_pair_filter_sort_entry_t* const mate2 = &sortedMate2[idMate2];
+      uint32_t insertSize;
+      if(!gpu_pair_filter_is_concordant(context, mate1, mate2, queryInfo->size_mate1, queryInfo->size_mate2, &insertSize)) continue;
+      if(numPairs < context->maxPairsPerQuery){
+        pairs[numPairs].id_mate1    = mate1->idMate;
+        pairs[numPairs].id_mate2    = mate2->idMate;
+        pairs[numPairs].insert_size = insertSize;
+        numPairs++;
+      }else{
+        numDropped++;
+      }
+    }
+  }
+  result->num_pairs   = numPairs;
+  result->num_dropped = numDropped;
+}
+
+/************************************************************
+Functions to distribute the read pairs among the host threads
+************************************************************/
+
+void* gpu_pair_filter_worker(void* const threadWorker)
+{
+  const gpu_pair_filter_worker_t* const worker  = (gpu_pair_filter_worker_t *) threadWorker;
+  gpu_pair_filter_context_t* const      context = worker->context;
+  // Dynamic scheduling: the read pairs are grabbed in small tasks (repetitive mates make the cost irregular)
+  while(true){
+    const uint32_t initQuery = __sync_fetch_and_add(&context->nextQuery, GPU_PAIR_FILTER_QUERIES_PER_TASK);
+    const uint32_t endQuery  = GPU_MIN(initQuery + GPU_PAIR_FILTER_QUERIES_PER_TASK, context->numQueries);
+    uint32_t idQuery;
+    if(initQuery >= context->numQueries) break;
+    for(idQuery = initQuery; idQuery < endQuery; ++idQuery)
+      gpu_pair_filter_process_query(worker, &context->queryInfo[idQuery], &context->results[idQuery]);
+  }
+  return(NULL);
+}
+
+uint32_t gpu_pair_filter_get_num_threads(const uint32_t numThreads, const uint32_t numQueries)
+{
+  return(gpu_get_num_workers(numThreads, GPU_DIV_CEIL(numQueries, GPU_PAIR_FILTER_QUERIES_PER_TASK), GPU_PAIR_FILTER_MAX_THREADS));
+}
+
+gpu_error_t gpu_pair_filter_process_buffer(gpu_buffer_t* const mBuff)
+{
+  const gpu_pair_filter_queries_buffer_t* qryBuff    = &mBuff->data.fpair.queries;
+  const uint32_t                          numThreads = GPU_MAX(mBuff->data.fpair.numThreads, 1);
+  gpu_pair_filter_context_t context;
+  gpu_pair_filter_worker_t  workers[GPU_PAIR_FILTER_MAX_THREADS];
+  gpu_pair_filter_sort_entry_t *scratch = NULL;
+  uint32_t idQuery, idThread, numLaunched = 0, maxListSize = 1;
+  for(idQuery = 0; idQuery < qryBuff->numQueries; ++idQuery){
+    maxListSize = GPU_MAX(maxListSize, qryBuff->h_queryInfo[idQuery].num_mate1);
+    maxListSize = GPU_MAX(maxListSize, qryBuff->h_queryInfo[idQuery].num_mate2);
+  }
+  // Each thread sorts the mate lists of its read pairs in private scratch space
+  scratch = (gpu_pair_filter_sort_entry_t *) malloc(2 * numThreads * (size_t) maxListSize * sizeof(gpu_pair_filter_sort_entry_t));
+  if(scratch == NULL) return(E_ALLOCATE_MEM);
+  // Pairing setup shared by all the threads
+  context.mates            = mBuff->data.fpair.mates.h_mates;
+  context.queryInfo        = qryBuff->h_queryInfo;
+  context.results          = qryBuff->h_results;
+  context.pairs            = mBuff->data.fpair.pairs.h_pairs;
+  context.numQueries       = qryBuff->numQueries;
+  context.maxPairsPerQuery = mBuff->data.fpair.maxPairsPerQuery;
+  context.minInsertSize    = mBuff->data.fpair.minInsertSize;
+  context.maxInsertSize    = mBuff->data.fpair.maxInsertSize;
+  context.orientation      = mBuff->data.fpair.orientation;
+  context.nextQuery        = 0;
+  context.maxListSize      = maxListSize;
+  for(idThread = 0; idThread < numThreads; ++idThread){
+    workers[idThread].context     = &context;
+    workers[idThread].h_sortMate1 = scratch + (2 * idThread * (size_t) maxListSize);
+    workers[idThread].h_sortMate2 = workers[idThread].h_sortMate1 + maxListSize;
+  }
+  // The calling thread works as the first worker (a failed launch only reduces the parallelism)
+  for(idThread = 1; idThread < numThreads; ++idThread){
+    if(pthread_create(&workers[idThread].thread, NULL, gpu_pair_filter_worker, &workers[idThread]) != 0) break;
+    numLaunched++;
+  }
+  gpu_pair_filter_worker(&workers[0]);
+  for(idThread = 1; idThread <= numLaunched; ++idThread)
+    pthread_join(workers[idThread].thread, NULL);
+  free(scratch);
+  return(SUCCESS);
+}
+
+#endif /* GPU_PAIR_FILTER_C_ */
@@ -0,0 +1,278 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_PAIR_PRIMITIVES_FILTER_C_
+#define GPU_PAIR_PRIMITIVES_FILTER_C_
+
+#include "../include/gpu_pair_primitives_filter.h"
+
+/************************************************************
+Functions to get the PAIR buffers
+************************************************************/
+
+gpu_pair_filter_mate_entry_t* gpu_pair_filter_buffer_get_mates_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.mates.h_mates);
+}
+
+gpu_pair_filter_qry_info_t* gpu_pair_filter_buffer_get_qry_info_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.queries.h_queryInfo);
+}
+
+gpu_pair_filter_result_t* gpu_pair_filter_buffer_get_results_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.queries.h_results);
+}
+
+gpu_pair_filter_pair_entry_t* gpu_pair_filter_buffer_get_pairs_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.pairs.h_pairs);
+}
+
+/************************************************************
+Functions to get the maximum elements of the buffers
+************************************************************/
+
+uint32_t gpu_pair_filter_buffer_get_max_mates_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.maxMates);
+}
+
+uint32_t gpu_pair_filter_buffer_get_max_pairs_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.maxPairs);
+}
+
+uint32_t gpu_pair_filter_buffer_get_max_queries_(const void* const pairBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  return(mBuff->data.fpair.maxQueries);
+}
+
+/************************************************************
+Functions to initialize the buffers (PAIR FILTER)
+************************************************************/
+
+size_t gpu_pair_filter_size_per_query(const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery)
+{
+  //Memory size dedicated to each read pair
+  const size_t bytesPerMates     = averageMatesPerQuery * sizeof(gpu_pair_filter_mate_entry_t);
+  const size_t bytesPerQueryInfo = sizeof(gpu_pair_filter_qry_info_t) + sizeof(gpu_pair_filter_result_t);
+  const size_t bytesPerQuery     = bytesPerMates + bytesPerQueryInfo;
+  //Return maximum memory size required per each read pair (all the pair slots are reserved)
+  return((maxPairsPerQuery * sizeof(gpu_pair_filter_pair_entry_t)) + bytesPerQuery);
+}
+
+void gpu_pair_filter_reallocate_host_buffer_layout(gpu_buffer_t* mBuff)
+{
+  const void* rawAlloc = mBuff->h_rawData;
+  //Adjust the host buffer layout (input)
+  mBuff->data.fpair.mates.h_mates = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.fpair.mates.h_mates + mBuff->data.fpair.maxMates);
+  mBuff->data.fpair.queries.h_queryInfo = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.fpair.queries.h_queryInfo + mBuff->data.fpair.maxQueries);
+  //Adjust the host buffer layout (output)
+  mBuff->data.fpair.queries.h_results = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.fpair.queries.h_results + mBuff->data.fpair.maxQueries);
+  mBuff->data.fpair.pairs.h_pairs = GPU_ALIGN_TO(rawAlloc,16);
+  rawAlloc = (void *) (mBuff->data.fpair.pairs.h_pairs + mBuff->data.fpair.maxPairs);
+}
+
+void gpu_pair_filter_set_buffer_layout(gpu_buffer_t* const mBuff, const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery)
+{
+  const uint32_t      pairsPerQuery = GPU_MAX(maxPairsPerQuery, GPU_PAIR_FILTER_MIN_PAIRS);
+  const size_t        sizeBuff      = mBuff->sizeBuffer * 0.95;
+  const size_t        bytesPerQuery = gpu_pair_filter_size_per_query(averageMatesPerQuery, pairsPerQuery);
+  const uint32_t      numQueries    = sizeBuff / bytesPerQuery;
+  //set the type of the buffer
+  mBuff->typeBuffer = GPU_PAIR_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  // Set real size of the input
+  mBuff->data.fpair.maxQueries       = numQueries;
+  mBuff->data.fpair.maxMates         = numQueries * averageMatesPerQuery;
+  mBuff->data.fpair.maxPairs         = numQueries * pairsPerQuery;
+  // Internal data information
+  mBuff->data.fpair.maxPairsPerQuery = pairsPerQuery;
+  // Set the corresponding buffer layout (the pairing runs over the host copies)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+  gpu_pair_filter_reallocate_host_buffer_layout(mBuff);
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_LAYOUT);
+}
+
+void gpu_pair_filter_init_buffer_(void* const pairBuffer, const uint32_t averageMatesPerQuery, const uint32_t maxPairsPerQuery)
+{
+  gpu_buffer_t* const mBuff           = (gpu_buffer_t *) pairBuffer;
+  uint32_t            tunedMatesQuery = averageMatesPerQuery;
+  // The observed mate lists replace the caller estimation (the pair slots are kept)
+  mBuff->typeBuffer = GPU_PAIR_FILTER;
+  gpu_stats_set_module(&mBuff->stats, mBuff->typeBuffer);
+  gpu_layout_tune(&mBuff->layout, &mBuff->stats, &tunedMatesQuery, NULL);
+  gpu_pair_filter_set_buffer_layout(mBuff, tunedMatesQuery, maxPairsPerQuery);
+}
+
+void gpu_pair_filter_init_and_realloc_buffer_(void *pairBuffer, const uint32_t maxPairsPerQuery, const uint32_t totalMates,
+                                              const uint32_t totalQueries)
+{
+  // Buffer reinitialization
+  gpu_buffer_t* const mBuff                = (gpu_buffer_t *) pairBuffer;
+  const uint32_t      averageMatesPerQuery = GPU_DIV_CEIL(totalMates, totalQueries);
+  const uint32_t      totalPairs           = totalQueries * GPU_MAX(maxPairsPerQuery, GPU_PAIR_FILTER_MIN_PAIRS);
+  // Remap the buffer layout with new information trying to fit better
+  gpu_pair_filter_set_buffer_layout(mBuff, averageMatesPerQuery, maxPairsPerQuery);
+  // Checking if we need to reallocate a bigger buffer
+  if( (totalMates   > gpu_pair_filter_buffer_get_max_mates_(pairBuffer))   ||
+      (totalQueries > gpu_pair_filter_buffer_get_max_queries_(pairBuffer)) ||
+      (totalPairs   > gpu_pair_filter_buffer_get_max_pairs_(pairBuffer))){
+    // Resize the GPU buffer to fit the required input
+    const uint32_t      idSupDevice        = mBuff->idSupportedDevice;
+    const float         resizeFactor       = 2.0;
+    const size_t        bytesPerPairBuffer = totalQueries * gpu_pair_filter_size_per_query(averageMatesPerQuery, maxPairsPerQuery);
+    //Recalculate the minimum buffer size
+    mBuff->sizeBuffer = bytesPerPairBuffer * resizeFactor;
+    gpu_stats_add_reallocation(&mBuff->stats);
+    //FREE HOST AND DEVICE BUFFER
+    GPU_ERROR(gpu_buffer_free(mBuff));
+    //Select the device of the Multi-GPU platform
+    CUDA_ERROR(cudaSetDevice(mBuff->device[idSupDevice]->idDevice));
+    //ALLOCATE HOST BUFFER (the pairing runs on the host)
+    CUDA_ERROR(cudaHostAlloc((void**) &mBuff->h_rawData, mBuff->sizeBuffer, cudaHostAllocMapped));
+    // Remap the buffer layout with the new size
+    gpu_pair_filter_set_buffer_layout(mBuff, averageMatesPerQuery, maxPairsPerQuery);
+  }
+}
+
+/************************************************************
+Functions to process the buffers (PAIR FILTER)
+************************************************************/
+
+void gpu_pair_filter_send_buffer_(void* const pairBuffer, const uint32_t numMates, const uint32_t numQueries, const uint32_t numPairs,
+                                  const uint32_t minInsertSize, const uint32_t maxInsertSize, const gpu_pair_filter_orientation_t orientation,
+                                  const uint32_t numThreads)
+{
+  const double timeSend = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  //Set real size of the input
+  mBuff->data.fpair.minInsertSize      = minInsertSize;
+  mBuff->data.fpair.maxInsertSize      = maxInsertSize;
+  mBuff->data.fpair.orientation        = orientation;
+  mBuff->data.fpair.numThreads         = gpu_pair_filter_get_num_threads(numThreads, numQueries);
+  mBuff->data.fpair.mates.numMates     = numMates;
+  mBuff->data.fpair.queries.numQueries = numQueries;
+  mBuff->data.fpair.pairs.numPairs     = numPairs;
+  gpu_stats_add_submission(&mBuff->stats, numQueries, mBuff->data.fpair.maxQueries);
+  gpu_layout_observe(&mBuff->layout, &mBuff->stats, numQueries, numMates, numPairs);
+  //The sort-merge join runs on the host threads (results are ready at the reception)
+  gpu_stats_start_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  GPU_ERROR(gpu_pair_filter_process_buffer(mBuff));
+  gpu_stats_stop_phase(&mBuff->stats, GPU_STATS_PHASE_KERNEL);
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "pair_filter send", timeSend);
+}
+
+void gpu_pair_filter_receive_buffer_(void* const pairBuffer)
+{
+  const double timeReceive = gpu_trace_sample_time();
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) pairBuffer;
+  gpu_trace_record(&mBuff->stats.track, GPU_TRACE_LANE_BUFFER, "pair_filter receive", timeReceive);
+}
+
+/************************************************************
+Functions to process oversized submissions (split in sub-batches)
+************************************************************/
+
+uint32_t gpu_pair_filter_query_init_mate(const gpu_pair_filter_qry_info_t* const queryInfo)
+{
+  return(GPU_MIN(queryInfo->init_offset_mate1, queryInfo->init_offset_mate2));
+}
+
+uint32_t gpu_pair_filter_query_end_mate(const gpu_pair_filter_qry_info_t* const queryInfo)
+{
+  return(GPU_MAX(queryInfo->init_offset_mate1 + queryInfo->num_mate1, queryInfo->init_offset_mate2 + queryInfo->num_mate2));
+}
+
+uint32_t gpu_pair_filter_batch_queries(const gpu_buffer_t* const mBuff, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                       const gpu_pair_filter_result_t* const results, const uint32_t numQueries)
+{
+  const uint32_t maxQueries    = mBuff->data.fpair.maxQueries;
+  const uint32_t maxMates      = mBuff->data.fpair.maxMates;
+  const uint32_t maxPairs      = mBuff->data.fpair.maxPairs;
+  const uint32_t pairsPerQuery = mBuff->data.fpair.maxPairsPerQuery;
+  const uint32_t initMate      = (numQueries != 0) ? gpu_pair_filter_query_init_mate(&queryInfo[0]) : 0;
+  uint32_t idQuery;
+  //Greedy growth of the sub-batch (mate lists and pair slots are contiguous windows)
+  for(idQuery = 0; (idQuery < numQueries) && (idQuery < maxQueries); ++idQuery){
+    const uint32_t numMates = gpu_pair_filter_query_end_mate(&queryInfo[idQuery]) - initMate;
+    const uint32_t numPairs = results[idQuery].init_offset + pairsPerQuery - results[0].init_offset;
+    if((numMates > maxMates) || (numPairs > maxPairs)) break;
+  }
+  return(idQuery);
+}
+
+void gpu_pair_filter_receive_batch_(void* const pairBuffer)
+{
+  gpu_buffer_t* const                     mBuff    = (gpu_buffer_t *) pairBuffer;
+  const gpu_buffer_batch_t*               batch    = &mBuff->batch;
+  const gpu_pair_filter_queries_buffer_t* qryBuff  = &mBuff->data.fpair.queries;
+  const gpu_pair_filter_pairs_buffer_t*   pairBuff = &mBuff->data.fpair.pairs;
+  gpu_pair_filter_result_t* const         results  = (gpu_pair_filter_result_t *) batch->h_results;
+  gpu_pair_filter_pair_entry_t* const     pairs    = (gpu_pair_filter_pair_entry_t *) batch->h_entries;
+  uint32_t idQuery;
+  gpu_pair_filter_receive_buffer_(pairBuffer);
+  if(!batch->pending) return;
+  //Concatenate the results of the sub-batch in the caller arrays (the pair slots keep the caller offsets)
+  for(idQuery = 0; idQuery < batch->numElements; ++idQuery){
+    gpu_pair_filter_result_t* const result = &results[batch->offset + idQuery];
+    result->num_pairs   = qryBuff->h_results[idQuery].num_pairs;
+    result->num_dropped = qryBuff->h_results[idQuery].num_dropped;
+  }
+  memcpy(pairs + batch->offsetEntries, pairBuff->h_pairs, batch->numEntries * sizeof(gpu_pair_filter_pair_entry_t));
+  gpu_buffer_batch_reset(mBuff);
+}
+
+void gpu_pair_filter_send_batch_(void* const pairBuffer, const gpu_pair_filter_mate_entry_t* const mates, const gpu_pair_filter_qry_info_t* const queryInfo,
+                                 gpu_pair_filter_result_t* const results, const uint32_t numQueries, const uint32_t minInsertSize,
+                                 const uint32_t maxInsertSize, const gpu_pair_filter_orientation_t orientation, const uint32_t numThreads,
+                                 gpu_pair_filter_pair_entry_t* const pairs)
+{
+  gpu_buffer_t* const               mBuff  = (gpu_buffer_t *) pairBuffer;
+  gpu_pair_filter_queries_buffer_t* qry    = &mBuff->data.fpair.queries;
+  uint32_t                          offset = 0, numSubBatches = 0;
+  //All the sub-batches except the last one are received here (the last one overlaps with the caller)
+  do{
+    uint32_t numSubMates = 0, numSubPairs = 0, mateOffset = 0, pairOffset = 0, idQuery;
+    const uint32_t numSubQueries = gpu_pair_filter_batch_queries(mBuff, queryInfo + offset, results + offset, numQueries - offset);
+    //Sanity-check (the buffer can not hold a single read pair)
+    if((numSubQueries == 0) && (offset < numQueries)){
+      gpu_stats_add_overflow(&mBuff->stats);
+      GPU_ERROR(E_OVERFLOWING_BUFFER);
+    }
+    //Gather the sub-batch in the buffer (rebasing the mate and pair offsets)
+    if(numSubQueries != 0){
+      const uint32_t idLastQuery = offset + numSubQueries - 1;
+      mateOffset  = gpu_pair_filter_query_init_mate(&queryInfo[offset]);
+      pairOffset  = results[offset].init_offset;
+      numSubMates = gpu_pair_filter_query_end_mate(&queryInfo[idLastQuery]) - mateOffset;
+      numSubPairs = results[idLastQuery].init_offset + mBuff->data.fpair.maxPairsPerQuery - pairOffset;
+    }
+    memcpy(mBuff->data.fpair.mates.h_mates, mates + mateOffset, numSubMates * sizeof(gpu_pair_filter_mate_entry_t));
+    for(idQuery = 0; idQuery < numSubQueries; ++idQuery){
+      qry->h_queryInfo[idQuery]                    = queryInfo[offset + idQuery];
+      qry->h_queryInfo[idQuery].init_offset_mate1 -= mateOffset;
+      qry->h_queryInfo[idQuery].init_offset_mate2 -= mateOffset;
+      qry->h_results[idQuery].init_offset          = results[offset + idQuery].init_offset - pairOffset;
+    }
+    gpu_pair_filter_send_buffer_(pairBuffer, numSubMates, numSubQueries, numSubPairs, minInsertSize, maxInsertSize, orientation, numThreads);
+    gpu_buffer_batch_set_pending(mBuff, offset, numSubQueries, pairOffset, numSubPairs, results, pairs, NULL);
+    offset += numSubQueries;
+    numSubBatches++;
+    if(offset < numQueries) gpu_pair_filter_receive_batch_(pairBuffer);
+  } while(offset < numQueries);
+  if(numSubBatches > 1) gpu_stats_add_split(&mBuff->stats, numSubBatches);
+}
+
+#endif /* GPU_PAIR_PRIMITIVES_FILTER_C_ */
@@ -12,6 +12,7 @@
 
 #include "../include/gpu_reference.h"
 #include "../include/gpu_io.h"
+#include "../include/gpu_shm.h"
 
 /************************************************************
 Get information functions
@@ -19,15 +20,22 @@ Get information functions
 
 size_t gpu_reference_get_size(gpu_reference_buffer_t* const reference, size_t* const referenceSize, const gpu_module_t activeModules)
 {
-  size_t bytesPerReference = 0;
+  size_t bytesPerReference = 0, bytesPerReferenceMasked = reference->numEntriesMasked * GPU_REFERENCE_MASKED__ENTRY_SIZE;
   const size_t bytesPerReferencePlain  = reference->numEntriesPlain  * GPU_REFERENCE_PLAIN__ENTRY_SIZE;
-  const size_t bytesPerReferenceMasked = reference->numEntriesMasked * GPU_REFERENCE_MASKED__ENTRY_SIZE;
+  // The N-run intervals replace the masked reference
+  if(reference->activeNRuns) gpu_reference_nruns_get_size(&reference->nRuns, &bytesPerReferenceMasked);
   if(activeModules & GPU_REFERENCE_PLAIN)  bytesPerReference += bytesPerReferencePlain;
   if(activeModules & GPU_REFERENCE_MASKED) bytesPerReference += bytesPerReferenceMasked;
   (* referenceSize) = bytesPerReference;
   return(SUCCESS);
 }
 
+uint64_t gpu_reference_get_stored_size(const gpu_reference_buffer_t* const reference)
+{
+  // Strand-virtual references only store the forward strand
+  return((reference->forwardSize != 0) ? reference->forwardSize : reference->size);
+}
+
 
 /************************************************************
 String basic functions
@@ -94,6 +102,172 @@ char gpu_complement_base(const char character)
 }
 
 
+/************************************************************
+Host access functions
+************************************************************/
+
+uint64_t gpu_reference_reverse_entry(const uint64_t entry, const uint32_t charLength)
+{
+  // Reverses the order of the packed chars (SWAR swaps of bits, pairs and nibbles, then bytes)
+  uint64_t reversed = entry;
+  if(charLength <= 1) reversed = ((reversed >> 1) & 0x5555555555555555ULL) | ((reversed & 0x5555555555555555ULL) << 1);
+  if(charLength <= 2) reversed = ((reversed >> 2) & 0x3333333333333333ULL) | ((reversed & 0x3333333333333333ULL) << 2);
+  if(charLength <= 4) reversed = ((reversed >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((reversed & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return(__builtin_bswap64(reversed));
+}
+
+uint64_t gpu_reference_expand_masked(const uint32_t maskedChars)
+{
+  // Spreads 32 masked chars (1 bit) to the plain char length (2 bits)
+  uint64_t expanded = maskedChars;
+  expanded = (expanded | (expanded << 16)) & 0x0000FFFF0000FFFFULL;
+  expanded = (expanded | (expanded << 8))  & 0x00FF00FF00FF00FFULL;
+  expanded = (expanded | (expanded << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+  expanded = (expanded | (expanded << 2))  & 0x3333333333333333ULL;
+  expanded = (expanded | (expanded << 1))  & 0x5555555555555555ULL;
+  return(expanded | (expanded << 1));
+}
+
+uint64_t gpu_reference_get_window(const uint64_t* const text, const uint64_t firstChar, const uint32_t charLength)
+{
+  // Packed chars starting at any text position (the request can span 2 entries)
+  const uint64_t charsPerEntry = GPU_UINT64_LENGTH / charLength;
+  const uint64_t idEntry       = firstChar / charsPerEntry;
+  const uint32_t shiftBits     = (firstChar % charsPerEntry) * charLength;
+  uint64_t window = text[idEntry] >> shiftBits;
+  if(shiftBits != 0) window |= text[idEntry + 1] << (GPU_UINT64_LENGTH - shiftBits);
+  return(window);
+}
+
+uint64_t gpu_reference_get_char(const uint64_t* const text, const uint64_t position, const uint32_t charLength)
+{
+  const uint64_t charsPerEntry = GPU_UINT64_LENGTH / charLength;
+  const uint64_t charMask      = GPU_UINT64_ONES >> (GPU_UINT64_LENGTH - charLength);
+  return((text[position / charsPerEntry] >> ((position % charsPerEntry) * charLength)) & charMask);
+}
+
+uint64_t gpu_reference_get_masked_window(const gpu_reference_buffer_t* const reference, const uint64_t firstChar)
+{
+  // The masked bitmap is not kept once it is replaced by the N-run intervals
+  if(reference->h_reference_masked == NULL) return(gpu_reference_nruns_get_window(&reference->nRuns, firstChar));
+  return(gpu_reference_get_window(reference->h_reference_masked, firstChar, GPU_REFERENCE_MASKED__CHAR_LENGTH));
+}
+
+bool gpu_reference_stored_is_N(const gpu_reference_buffer_t* const reference, const uint64_t position)
+{
+  gpu_reference_nruns_cursor_t cursor;
+  if(reference->h_reference_masked != NULL)
+    return(gpu_reference_get_char(reference->h_reference_masked, position, GPU_REFERENCE_MASKED__CHAR_LENGTH));
+  gpu_reference_nruns_init_cursor(&cursor);
+  return(gpu_reference_nruns_is_N(&reference->nRuns, position, &cursor));
+}
+
+uint64_t gpu_reference_get_base_plain(const gpu_reference_buffer_t* const reference, const uint64_t position)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  // Reverse positions are complemented reads of the mirrored forward position (non-bases remain As)
+  if(position < forwardSize) return(gpu_reference_get_char(reference->h_reference_plain, position, GPU_REFERENCE_PLAIN__CHAR_LENGTH));
+  if((position + 2) > (2 * forwardSize)) return(GPU_ENC_DNA_CHAR_A);
+  const uint64_t mirrorPosition = (2 * forwardSize) - position - 2;
+  if(gpu_reference_stored_is_N(reference, mirrorPosition)) return(GPU_ENC_DNA_CHAR_A);
+  return(gpu_reference_get_char(reference->h_reference_plain, mirrorPosition, GPU_REFERENCE_PLAIN__CHAR_LENGTH) ^ GPU_REFERENCE_PLAIN__MASK_BASE);
+}
+
+uint64_t gpu_reference_get_base_masked(const gpu_reference_buffer_t* const reference, const uint64_t position)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  if(position < forwardSize) return(gpu_reference_stored_is_N(reference, position));
+  if((position + 2) > (2 * forwardSize)) return(GPU_UINT64_ZEROS);
+  return(gpu_reference_stored_is_N(reference, (2 * forwardSize) - position - 2));
+}
+
+uint64_t gpu_reference_get_entry_plain(const gpu_reference_buffer_t* const reference, const uint64_t idEntry)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  const uint64_t firstChar   = idEntry * GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY;
+  uint64_t entry = 0, idBase;
+  // References storing both strands (or forward entries) are directly served
+  if((forwardSize == 0) || ((firstChar + GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) <= forwardSize))
+    return(reference->h_reference_plain[idEntry]);
+  // Entries completely placed in the reverse strand: word-level reverse-complement of the mirrored window
+  if((firstChar >= forwardSize) && ((firstChar + GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY + 1) <= (2 * forwardSize))){
+    const uint64_t mirrorFirstChar = (2 * forwardSize) - firstChar - GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY - 1;
+    const uint64_t plain   = gpu_reference_get_window(reference->h_reference_plain,  mirrorFirstChar, GPU_REFERENCE_PLAIN__CHAR_LENGTH);
+    const uint64_t masked  = gpu_reference_get_masked_window(reference, mirrorFirstChar);
+    const uint64_t nonBase = gpu_reference_expand_masked(gpu_reference_reverse_entry(masked, GPU_REFERENCE_MASKED__CHAR_LENGTH) >> GPU_UINT32_LENGTH);
+    return(gpu_reference_reverse_entry(plain, GPU_REFERENCE_PLAIN__CHAR_LENGTH) ^ (~nonBase));
+  }
+  // Entries crossing the strand boundaries are composed base by base
+  for(idBase = 0; idBase < GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY; ++idBase)
+    entry |= gpu_reference_get_base_plain(reference, firstChar + idBase) << (idBase * GPU_REFERENCE_PLAIN__CHAR_LENGTH);
+  return(entry);
+}
+
+uint64_t gpu_reference_get_entry_masked(const gpu_reference_buffer_t* const reference, const uint64_t idEntry)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  const uint64_t firstChar   = idEntry * GPU_REFERENCE_MASKED__CHARS_PER_ENTRY;
+  uint64_t entry = 0, idBase;
+  // References storing both strands (or forward entries) are directly served
+  if((forwardSize == 0) || ((firstChar + GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) <= forwardSize))
+    return(gpu_reference_get_masked_window(reference, firstChar));
+  // Entries completely placed in the reverse strand: word-level reverse of the mirrored window
+  if((firstChar >= forwardSize) && ((firstChar + GPU_REFERENCE_MASKED__CHARS_PER_ENTRY + 1) <= (2 * forwardSize))){
+    const uint64_t mirrorFirstChar = (2 * forwardSize) - firstChar - GPU_REFERENCE_MASKED__CHARS_PER_ENTRY - 1;
+    return(gpu_reference_reverse_entry(gpu_reference_get_masked_window(reference, mirrorFirstChar), GPU_REFERENCE_MASKED__CHAR_LENGTH));
+  }
+  // Entries crossing the strand boundaries are composed base by base
+  for(idBase = 0; idBase < GPU_REFERENCE_MASKED__CHARS_PER_ENTRY; ++idBase)
+    entry |= gpu_reference_get_base_masked(reference, firstChar + idBase) << (idBase * GPU_REFERENCE_MASKED__CHAR_LENGTH);
+  return(entry);
+}
+
+bool gpu_reference_stored_window_has_N(const gpu_reference_buffer_t* const reference, const uint64_t position, const uint64_t endPosition,
+                                       gpu_reference_nruns_cursor_t* const cursor)
+{
+  uint64_t idChar;
+  if(position >= endPosition) return(false);
+  if(reference->h_reference_masked == NULL)
+    return(gpu_reference_nruns_window_has_N(&reference->nRuns, position, endPosition - position, cursor));
+  // Masked bitmap: checks 64 bases per step
+  for(idChar = position; idChar < endPosition; idChar += GPU_REFERENCE_MASKED__CHARS_PER_ENTRY){
+    const uint64_t numChars = GPU_MIN(endPosition - idChar, GPU_REFERENCE_MASKED__CHARS_PER_ENTRY);
+    const uint64_t mask     = (numChars == GPU_UINT64_LENGTH) ? GPU_UINT64_ONES : ((((uint64_t) GPU_UINT64_MASK_ONE_LOW) << numChars) - 1);
+    if(gpu_reference_get_window(reference->h_reference_masked, idChar, GPU_REFERENCE_MASKED__CHAR_LENGTH) & mask) return(true);
+  }
+  return(false);
+}
+
+bool gpu_reference_is_N(const gpu_reference_buffer_t* const reference, const uint64_t position, gpu_reference_nruns_cursor_t* const cursor)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  uint64_t storedPosition = position;
+  // Reverse positions of strand-virtual references are mirrored
+  if((forwardSize != 0) && (position >= forwardSize)){
+    if((position + 2) > (2 * forwardSize)) return(false);
+    storedPosition = (2 * forwardSize) - position - 2;
+  }
+  if(reference->h_reference_masked != NULL)
+    return(gpu_reference_get_char(reference->h_reference_masked, storedPosition, GPU_REFERENCE_MASKED__CHAR_LENGTH));
+  return(gpu_reference_nruns_is_N(&reference->nRuns, storedPosition, cursor));
+}
+
+bool gpu_reference_window_has_N(const gpu_reference_buffer_t* const reference, const uint64_t position, const uint64_t length,
+                                gpu_reference_nruns_cursor_t* const cursor)
+{
+  const uint64_t forwardSize = reference->forwardSize;
+  const uint64_t endPosition = position + length;
+  uint64_t reverseStart, reverseEnd;
+  if(forwardSize == 0) return(gpu_reference_stored_window_has_N(reference, position, GPU_MIN(endPosition, reference->size), cursor));
+  // Strand-virtual references: the reverse part of the window is a mirrored forward window
+  if(gpu_reference_stored_window_has_N(reference, position, GPU_MIN(endPosition, forwardSize), cursor)) return(true);
+  reverseStart = GPU_MAX(position, forwardSize);
+  reverseEnd   = GPU_MIN(endPosition, (2 * forwardSize) - 1);
+  if(reverseStart >= reverseEnd) return(false);
+  return(gpu_reference_stored_window_has_N(reference, (2 * forwardSize) - 1 - reverseEnd, (2 * forwardSize) - 1 - reverseStart, cursor));
+}
+
+
 /************************************************************
 Transform reference functions
 ************************************************************/
@@ -237,6 +411,27 @@ gpu_error_t gpu_reference_transform_GEM_FULL(const gpu_gem_ref_dto_t* const gem_
   return(SUCCESS);
 }
 
+gpu_error_t gpu_reference_transform_GEM_VIRTUAL(const gpu_gem_ref_dto_t* const gem_reference, gpu_reference_buffer_t* const reference,
+                                                const gpu_module_t activeModules)
+{
+  // Serves the full reference (forward + reverse-complement) storing only the forward strand
+  const char* const h_gem_reference = gem_reference->reference;
+  const uint64_t forward_ref_size   = gem_reference->ref_length;
+  // Module sanity checker
+  if((activeModules & GPU_REFERENCE) == 0)
+    return(E_MODULE_NOT_FOUND);
+  //Transform the reference content in a compact representation
+  reference->size             = 2 * forward_ref_size;
+  reference->forwardSize      = forward_ref_size;
+  reference->numEntriesPlain  = GPU_DIV_CEIL(forward_ref_size, GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  reference->numEntriesMasked = GPU_DIV_CEIL(forward_ref_size, GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  //The reverse strand is not stored (complete size equal to the forward size)
+  GPU_ERROR(gpu_reference_transform_plain_GEM_FULL(h_gem_reference, reference->h_reference_plain, forward_ref_size, forward_ref_size, reference->numEntriesPlain));
+  GPU_ERROR(gpu_reference_transform_masked_GEM_FULL(h_gem_reference, reference->h_reference_masked, forward_ref_size, forward_ref_size, reference->numEntriesMasked));
+  // Return
+  return(SUCCESS);
+}
+
 
 /************************************************************
 Input & Output reference functions
@@ -244,7 +439,8 @@ Input & Output reference functions
 
 gpu_error_t gpu_reference_read_specs(int fp, gpu_reference_buffer_t* const reference, const gpu_module_t activeModules)
 {
-  size_t result, bytesRequest;
+  size_t   result, bytesRequest;
+  uint64_t sizeCoding;
   // Module sanity checker
   if((activeModules & GPU_REFERENCE) == 0)
     return(E_MODULE_NOT_FOUND);
@@ -256,14 +452,18 @@ gpu_error_t gpu_reference_read_specs(int fp, gpu_reference_buffer_t* const refer
   result = read(fp, (void* )&reference->numEntriesMasked, bytesRequest);
   if (result != bytesRequest) return (E_READING_FILE);
   bytesRequest = sizeof(uint64_t);
-  result = read(fp, (void* )&reference->size, bytesRequest);
+  result = read(fp, (void* )&sizeCoding, bytesRequest);
   if (result != bytesRequest) return (E_READING_FILE);
+  // Strand-virtual references only store the forward half
+  reference->size        = sizeCoding & ~GPU_REFERENCE_SPECS_FLAGS;
+  reference->forwardSize = (sizeCoding & GPU_REFERENCE_SPECS_STRAND_VIRTUAL) ? reference->size / 2 : 0;
   // Succeed
   return (SUCCESS);
 }
 
 gpu_error_t gpu_reference_write_specs(int fp, const gpu_reference_buffer_t* const reference, const gpu_module_t activeModules)
 {
+  const uint64_t sizeCoding = reference->size | ((reference->forwardSize != 0) ? GPU_REFERENCE_SPECS_STRAND_VIRTUAL : 0);
   size_t result, bytesRequest;
   // Module sanity checker
   if((activeModules & GPU_REFERENCE) == 0)
@@ -276,7 +476,7 @@ gpu_error_t gpu_reference_write_specs(int fp, const gpu_reference_buffer_t* cons
   result = write(fp, (void* )&reference->numEntriesMasked, bytesRequest);
   if (result != bytesRequest) return (E_READING_FILE);
   bytesRequest = sizeof(uint64_t);
-  result = write(fp, (void* )&reference->size, bytesRequest);
+  result = write(fp, (void* )&sizeCoding, bytesRequest);
   if (result != bytesRequest) return (E_READING_FILE);
   // Succeed
   return (SUCCESS);
@@ -297,6 +497,14 @@ gpu_error_t gpu_reference_read(int fp, gpu_reference_buffer_t* const reference,
   // Read the masked reference in a block iterative way
   bytesRequest = GPU_REFERENCE_MASKED__ENTRY_SIZE * reference->numEntriesMasked;
   GPU_ERROR(gpu_io_read_buffered(fp, (void* )reference->h_reference_masked, bytesRequest));
+  // Read the N-run intervals appended to the masked reference (if stored)
+  if(reference->activeNRuns)
+    GPU_ERROR(gpu_reference_nruns_read(fp, &reference->nRuns, gpu_reference_get_stored_size(reference)));
+  else if(reference->activeMinimizers)
+    GPU_ERROR(gpu_reference_nruns_skip(fp));
+  // Read the minimizer index appended to the N-run intervals (if stored with the same sampling)
+  if(reference->activeMinimizers)
+    GPU_ERROR(gpu_reference_minimizers_read(fp, &reference->minimizers, reference->size));
   // Succeed
   return (SUCCESS);
 }
@@ -314,8 +522,25 @@ gpu_error_t gpu_reference_write(int fp, const gpu_reference_buffer_t* const refe
   bytesRequest = GPU_REFERENCE_PLAIN__ENTRY_SIZE * reference->numEntriesPlain;
   GPU_ERROR(gpu_io_write_buffered(fp, (void* )reference->h_reference_plain,  bytesRequest));
   // Write the masked reference in a block iterative way
-  bytesRequest = GPU_REFERENCE_MASKED__ENTRY_SIZE * reference->numEntriesMasked;
-  GPU_ERROR(gpu_io_write_buffered(fp, (void* )reference->h_reference_masked, bytesRequest));
+  if(reference->h_reference_masked != NULL){
+    bytesRequest = GPU_REFERENCE_MASKED__ENTRY_SIZE * reference->numEntriesMasked;
+    GPU_ERROR(gpu_io_write_buffered(fp, (void* )reference->h_reference_masked, bytesRequest));
+  }else{
+    GPU_ERROR(gpu_reference_nruns_write_masked(fp, &reference->nRuns, reference->numEntriesMasked));
+  }
+  // Append the N-run intervals (ignored by the readers using the masked reference)
+  if(reference->nRuns.h_runs != NULL){
+    GPU_ERROR(gpu_reference_nruns_write(fp, &reference->nRuns));
+  }else{
+    gpu_reference_nruns_t nRuns;
+    GPU_ERROR(gpu_reference_nruns_init_dto(&nRuns));
+    GPU_ERROR(gpu_reference_nruns_build(&nRuns, reference->h_reference_masked, gpu_reference_get_stored_size(reference)));
+    GPU_ERROR(gpu_reference_nruns_write(fp, &nRuns));
+    GPU_ERROR(gpu_reference_nruns_free_host(&nRuns));
+  }
+  // Append the minimizer index (only when it has been built)
+  if(reference->minimizers.h_entries != NULL)
+    GPU_ERROR(gpu_reference_minimizers_write(fp, &reference->minimizers));
   // Succeed
   return (SUCCESS);
 }
@@ -329,6 +554,7 @@ gpu_error_t gpu_reference_init_dto(gpu_reference_buffer_t* const ref)
 {
   //Initialize the reference structure
   ref->size                = 0;
+  ref->forwardSize         = 0;
   //Initialize basic reference
   ref->numEntriesPlain     = 0;
   ref->h_reference_plain   = NULL;
@@ -337,6 +563,12 @@ gpu_error_t gpu_reference_init_dto(gpu_reference_buffer_t* const ref)
   ref->numEntriesMasked    = 0;
   ref->h_reference_masked  = NULL;
   ref->d_reference_masked  = NULL;
+  //Initialize N-run intervals
+  ref->activeNRuns         = false;
+  GPU_ERROR(gpu_reference_nruns_init_dto(&ref->nRuns));
+  //Initialize minimizer index
+  ref->activeMinimizers    = false;
+  GPU_ERROR(gpu_reference_minimizers_init_dto(&ref->minimizers));
   //Initialize reference allocation policies
   ref->hostAllocStats 	   = GPU_PAGE_UNLOCKED;
   ref->memorySpace         = NULL;
@@ -362,6 +594,11 @@ gpu_error_t gpu_reference_set_specs(gpu_reference_buffer_t* const ref, const cha
     case GPU_REF_GEM_ONLY_FORWARD:
       /* Not require special I/O initialization */
       break;
+    case GPU_REF_GEM_VIRTUAL_FULL:
+      /* Allocations are sized by the forward strand */
+      ref->forwardSize = ((gpu_gem_ref_dto_t*)referenceRaw)->ref_length;
+      ref->size        = 2 * ref->forwardSize;
+      break;
     case GPU_REF_GEM_FILE:
       GPU_ERROR(gpu_io_load_reference_specs_GEM_FULL(referenceRaw, ref, activeModules));
       break;
@@ -396,6 +633,9 @@ gpu_error_t gpu_reference_transform(gpu_reference_buffer_t* const ref, const cha
     case GPU_REF_GEM_FULL:
       GPU_ERROR(gpu_reference_transform_GEM_FULL((gpu_gem_ref_dto_t*)referenceRaw, ref, activeModules));
       break;
+    case GPU_REF_GEM_VIRTUAL_FULL:
+      GPU_ERROR(gpu_reference_transform_GEM_VIRTUAL((gpu_gem_ref_dto_t*)referenceRaw, ref, activeModules));
+      break;
     case GPU_REF_GEM_FILE:
       GPU_ERROR(gpu_io_load_reference_GEM_FULL(referenceRaw, ref, activeModules));
       break;
@@ -440,6 +680,13 @@ gpu_error_t gpu_reference_init(gpu_reference_buffer_t **reference, const gpu_ref
   }
   // Setting file headers and descriptions
   GPU_ERROR(gpu_reference_set_specs(ref, referenceRaw->reference, referenceRaw->refCoding, activeModules));
+  // Setting the N-run intervals
+  ref->activeNRuns = referenceRaw->maskedNRuns;
+  GPU_ERROR(gpu_reference_nruns_init(&ref->nRuns, ref->memorySpace, numSupportedDevices));
+  ref->nRuns.size  = gpu_reference_get_stored_size(ref);
+  // Setting the minimizer sampling (the index is built or loaded with the reference)
+  ref->activeMinimizers = (activeModules & GPU_MINIMIZER_SEED) != 0;
+  GPU_ERROR(gpu_reference_minimizers_init(&ref->minimizers, referenceRaw->minimizerW, referenceRaw->minimizerK));
   (* reference) = ref;
   // Succeed
   return (SUCCESS);
@@ -451,23 +698,17 @@ gpu_error_t gpu_reference_allocate(gpu_reference_buffer_t *reference, const gpu_
   if((activeModules & GPU_REFERENCE) == 0)
     return(E_MODULE_NOT_FOUND);
   // Setting size for host allocations dedicated to device transference
-  const uint64_t numEntriesPlain  = GPU_DIV_CEIL(reference->size, GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY)  + GPU_REFERENCE_END_PADDING;
-  const uint64_t numEntriesMasked = GPU_DIV_CEIL(reference->size, GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
+  const uint64_t storedSize       = gpu_reference_get_stored_size(reference);
+  const uint64_t numEntriesPlain  = GPU_DIV_CEIL(storedSize, GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY)  + GPU_REFERENCE_END_PADDING;
+  const uint64_t numEntriesMasked = GPU_DIV_CEIL(storedSize, GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) + GPU_REFERENCE_END_PADDING;
   const size_t   cpySizeRefPlain  = numEntriesPlain  * GPU_REFERENCE_PLAIN__ENTRY_SIZE;
   const size_t   cpySizeRefMasked = numEntriesMasked * GPU_REFERENCE_MASKED__ENTRY_SIZE;
   // Setting reference sizes
   reference->numEntriesPlain  = numEntriesPlain;
   reference->numEntriesMasked = numEntriesMasked;
-  // Pinned or non-pinned allocation to optimize zero transfer requests
-  if(reference->hostAllocStats & GPU_PAGE_LOCKED){
-   CUDA_ERROR(cudaHostAlloc((void**) &reference->h_reference_plain, cpySizeRefPlain, cudaHostAllocMapped));
-   CUDA_ERROR(cudaHostAlloc((void**) &reference->h_reference_masked, cpySizeRefMasked, cudaHostAllocMapped));
-  }else{
-    reference->h_reference_plain = malloc(cpySizeRefPlain);
-    if (reference->h_reference_plain == NULL) return (E_DATA_NOT_ALLOCATED);
-    reference->h_reference_masked = malloc(cpySizeRefMasked);
-    if (reference->h_reference_masked == NULL) return (E_DATA_NOT_ALLOCATED);
-  }
+  // Pinned or non-pinned allocation to optimize zero transfer requests (huge pages when enabled)
+  GPU_ERROR(gpu_hugepages_alloc((void**) &reference->h_reference_plain, cpySizeRefPlain, reference->hostAllocStats));
+  GPU_ERROR(gpu_hugepages_alloc((void**) &reference->h_reference_masked, cpySizeRefMasked, reference->hostAllocStats));
   // Succeed
   return(SUCCESS);
 }
@@ -481,6 +722,56 @@ gpu_error_t gpu_reference_load(gpu_reference_buffer_t *reference, const gpu_refe
   // Managing the device references
   GPU_ERROR(gpu_reference_allocate(reference, activeModules));
   GPU_ERROR(gpu_reference_transform(reference, referenceRaw->reference, referenceRaw->refCoding, activeModules));
+  if(reference->activeMinimizers) GPU_ERROR(gpu_reference_build_minimizers(reference));
+  if(reference->activeNRuns) GPU_ERROR(gpu_reference_replace_masked(reference));
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_replace_masked(gpu_reference_buffer_t* const reference)
+{
+  // Building the N-run intervals (if not loaded from the container)
+  if(reference->nRuns.h_runs == NULL)
+    GPU_ERROR(gpu_reference_nruns_build(&reference->nRuns, reference->h_reference_masked, gpu_reference_get_stored_size(reference)));
+  // Deallocate masked reference from host
+  if(reference->h_reference_masked != NULL){
+    GPU_ERROR(gpu_hugepages_free(reference->h_reference_masked, reference->hostAllocStats));
+    reference->h_reference_masked = NULL;
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_build_minimizers(gpu_reference_buffer_t* const reference)
+{
+  gpu_reference_minimizers_t* const minimizers = &reference->minimizers;
+  const uint64_t                    size       = reference->size;
+  const uint64_t                    numEntries = GPU_DIV_CEIL(size, GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY);
+  uint64_t maxEntries = GPU_MAX(GPU_DIV_CEIL(2 * size, minimizers->w + 1), GPU_REFERENCE_MINIMIZERS_MIN_ENTRIES);
+  uint64_t idEntry, position = 0;
+  uint32_t idBase;
+  gpu_reference_minimizers_sketch_t sketch;
+  gpu_reference_minimizer_t         minimizer;
+  gpu_reference_nruns_cursor_t      cursor;
+  // Index loaded from the container
+  if(minimizers->h_entries != NULL) return(SUCCESS);
+  minimizers->size       = size;
+  minimizers->numEntries = 0;
+  minimizers->h_entries  = (gpu_reference_minimizer_t *) malloc(maxEntries * sizeof(gpu_reference_minimizer_t));
+  if (minimizers->h_entries == NULL) return (E_ALLOCATE_MEM);
+  gpu_reference_minimizers_sketch_init(&sketch, minimizers->w, minimizers->k);
+  gpu_reference_nruns_init_cursor(&cursor);
+  // Sampling the complete text (strand-virtual references are served with both strands)
+  for(idEntry = 0; idEntry < numEntries; ++idEntry){
+    const uint64_t entry = gpu_reference_get_entry_plain(reference, idEntry);
+    for(idBase = 0; (idBase < GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) && (position < size); ++idBase, ++position){
+      uint32_t base = (entry >> (idBase * GPU_REFERENCE_PLAIN__CHAR_LENGTH)) & GPU_REFERENCE_PLAIN__MASK_BASE;
+      if(gpu_reference_is_N(reference, position, &cursor)) base = GPU_ENC_DNA_CHAR_N;
+      if(gpu_reference_minimizers_sketch_push(&sketch, base, position, &minimizer))
+        GPU_ERROR(gpu_reference_minimizers_add(minimizers, &maxEntries, &minimizer));
+    }
+  }
+  GPU_ERROR(gpu_reference_minimizers_sort(minimizers));
   // Succeed
   return(SUCCESS);
 }
@@ -503,13 +794,15 @@ gpu_error_t gpu_reference_transfer_CPU_to_GPUs(gpu_reference_buffer_t* const ref
       if ((GPU_CONVERT__B_TO_MB(cpySize)) > deviceFreeMemory) return(E_INSUFFICIENT_MEM_GPU);
       CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
       //Synchronous allocate & transfer plain reference to GPU
-      if(activeModules & GPU_REFERENCE_PLAIN){
+      if((activeModules & GPU_REFERENCE_PLAIN) &&
+         !gpu_shm_open_device(GPU_SHM_REFERENCE_PLAIN, devices[idSupportedDevice], (void**) &reference->d_reference_plain[idSupportedDevice])){
         gpu_reference_get_size(reference, &cpySize, GPU_REFERENCE_PLAIN);
     	CUDA_ERROR(cudaMalloc((void**) &reference->d_reference_plain[idSupportedDevice], cpySize));
         CUDA_ERROR(cudaMemcpy(reference->d_reference_plain[idSupportedDevice], reference->h_reference_plain, cpySize, cudaMemcpyHostToDevice));
       }
-      //Synchronous allocate & transfer masked reference to GPU
-      if(activeModules & GPU_REFERENCE_MASKED){
+      //Synchronous allocate & transfer masked reference to GPU (shared index copies are imported)
+      if((activeModules & GPU_REFERENCE_MASKED) && !reference->activeNRuns &&
+         !gpu_shm_open_device(GPU_SHM_REFERENCE_MASKED, devices[idSupportedDevice], (void**) &reference->d_reference_masked[idSupportedDevice])){
         gpu_reference_get_size(reference, &cpySize, GPU_REFERENCE_MASKED);
     	CUDA_ERROR(cudaMalloc((void**) &reference->d_reference_masked[idSupportedDevice], cpySize));
         CUDA_ERROR(cudaMemcpy(reference->d_reference_masked[idSupportedDevice], reference->h_reference_masked, cpySize, cudaMemcpyHostToDevice));
@@ -517,10 +810,13 @@ gpu_error_t gpu_reference_transfer_CPU_to_GPUs(gpu_reference_buffer_t* const ref
     }else{
       if(activeModules & GPU_REFERENCE_PLAIN)
     	  reference->d_reference_plain[idSupportedDevice] = reference->h_reference_plain;
-      if(activeModules & GPU_REFERENCE_MASKED)
+      if((activeModules & GPU_REFERENCE_MASKED) && !reference->activeNRuns)
     	  reference->d_reference_masked[idSupportedDevice] = reference->h_reference_masked;
     }
   }
+  // N-run intervals replacing the masked reference
+  if((activeModules & GPU_REFERENCE_MASKED) && reference->activeNRuns)
+    GPU_ERROR(gpu_reference_nruns_transfer_CPU_to_GPUs(&reference->nRuns, devices));
   // Succeed
   return (SUCCESS);
 }
@@ -534,14 +830,12 @@ gpu_error_t gpu_reference_free_host(gpu_reference_buffer_t* const reference)
 {
   // Deallocate plain reference from host
   if(reference->h_reference_plain != NULL){
-    if(reference->hostAllocStats == GPU_PAGE_LOCKED) CUDA_ERROR(cudaFreeHost(reference->h_reference_plain));
-    else free(reference->h_reference_plain);
+    GPU_ERROR(gpu_hugepages_free(reference->h_reference_plain, reference->hostAllocStats));
     reference->h_reference_plain = NULL;
   }
   // Deallocate masked reference from host
   if(reference->h_reference_masked != NULL){
-    if(reference->hostAllocStats == GPU_PAGE_LOCKED) CUDA_ERROR(cudaFreeHost(reference->h_reference_masked));
-    else free(reference->h_reference_masked);
+    GPU_ERROR(gpu_hugepages_free(reference->h_reference_masked, reference->hostAllocStats));
     reference->h_reference_masked = NULL;
   }
   // Succeed
@@ -580,15 +874,17 @@ gpu_error_t gpu_reference_free_device(gpu_reference_buffer_t* const reference, g
     if(reference->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED){
       // Free the device plain reference
       if(reference->d_reference_plain[idSupportedDevice] != NULL)
-        CUDA_ERROR(cudaFree(reference->d_reference_plain[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(reference->d_reference_plain[idSupportedDevice]));
       // Free the device masked reference
       if(reference->d_reference_masked[idSupportedDevice] != NULL)
-        CUDA_ERROR(cudaFree(reference->d_reference_masked[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(reference->d_reference_masked[idSupportedDevice]));
       // Resetting pointer values
       reference->d_reference_plain[idSupportedDevice]  = NULL;
       reference->d_reference_masked[idSupportedDevice] = NULL;
     }
   }
+  // Free the device N-run intervals
+  GPU_ERROR(gpu_reference_nruns_free_device(&reference->nRuns, devices));
   // Free the device plain reference list
   if(reference->d_reference_plain != NULL){
     free(reference->d_reference_plain);
@@ -609,6 +905,11 @@ gpu_error_t gpu_reference_free(gpu_reference_buffer_t **reference, gpu_device_in
   // Free device and host references
   if(activeModules & GPU_REFERENCE){
     GPU_ERROR(gpu_reference_free_host(ref));
+    // Shared N-run intervals and minimizers belong to the mapped segment
+    if(ref->hostAllocStats != GPU_PAGE_SHARED){
+      GPU_ERROR(gpu_reference_nruns_free_host(&ref->nRuns));
+      GPU_ERROR(gpu_reference_minimizers_free_host(&ref->minimizers));
+    }
     GPU_ERROR(gpu_reference_free_device(ref, devices));
   }
   // Free memory space specifications
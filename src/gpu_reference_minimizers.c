@@ -0,0 +1,341 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_MINIMIZERS_C_
+#define GPU_REFERENCE_MINIMIZERS_C_
+
+#include "../include/gpu_reference_minimizers.h"
+#include "../include/gpu_io.h"
+
+/************************************************************
+Get information functions
+************************************************************/
+
+gpu_error_t gpu_reference_minimizers_get_size(const gpu_reference_minimizers_t* const minimizers, size_t* const bytesPerMinimizers)
+{
+  (* bytesPerMinimizers) = (minimizers->numEntries * sizeof(gpu_reference_minimizer_t)) + ((minimizers->numBuckets + 1) * sizeof(uint64_t));
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Sketch functions
+************************************************************/
+
+uint64_t gpu_reference_minimizers_hash(const uint64_t kmer, const uint64_t kmerMask)
+{
+  // Invertible integer hash restricted to the k-mer bits (spreads the low complexity k-mers)
+  uint64_t key = kmer;
+  key = (~key + (key << 21)) & kmerMask;
+  key = key ^ (key >> 24);
+  key = ((key + (key << 3)) + (key << 8)) & kmerMask;
+  key = key ^ (key >> 14);
+  key = ((key + (key << 2)) + (key << 4)) & kmerMask;
+  key = key ^ (key >> 28);
+  key = (key + (key << 31)) & kmerMask;
+  return(key);
+}
+
+uint32_t gpu_reference_minimizers_base_ASCII(const char base)
+{
+  // Same encoding than the plain reference
+  switch(base){
+    case 'A': case 'a': return(GPU_ENC_DNA_CHAR_A);
+    case 'C': case 'c': return(GPU_ENC_DNA_CHAR_C);
+    case 'G': case 'g': return(GPU_ENC_DNA_CHAR_G);
+    case 'T': case 't': return(GPU_ENC_DNA_CHAR_T);
+    default:            return(GPU_ENC_DNA_CHAR_N);
+  }
+}
+
+void gpu_reference_minimizers_sketch_init(gpu_reference_minimizers_sketch_t* const sketch, const uint32_t w, const uint32_t k)
+{
+  sketch->w                = w;
+  sketch->k                = k;
+  sketch->kmerMask         = GPU_UINT64_ONES >> (GPU_UINT64_LENGTH - (2 * k));
+  sketch->kmer             = 0;
+  sketch->numBases         = 0;
+  sketch->numKmers         = 0;
+  sketch->idRing           = 0;
+  sketch->minimum.hash     = GPU_UINT64_ONES;
+  sketch->minimum.position = 0;
+}
+
+void gpu_reference_minimizers_sketch_rescan(gpu_reference_minimizers_sketch_t* const sketch)
+{
+  uint32_t idKmer;
+  // The ring is walked from the oldest k-mer (the leftmost one wins on ties)
+  sketch->minimum = sketch->ring[sketch->idRing];
+  for(idKmer = 1; idKmer < sketch->w; ++idKmer){
+    const gpu_reference_minimizer_t* const kmer = &sketch->ring[(sketch->idRing + idKmer) % sketch->w];
+    if(kmer->hash < sketch->minimum.hash) sketch->minimum = (* kmer);
+  }
+}
+
+bool gpu_reference_minimizers_sketch_push(gpu_reference_minimizers_sketch_t* const sketch, const uint32_t base, const uint64_t position,
+                                          gpu_reference_minimizer_t* const minimizer)
+{
+  gpu_reference_minimizer_t current;
+  // Non-bases restart the k-mers and the window
+  if(base >= GPU_ENC_DNA_CHAR_N){
+    sketch->numBases     = 0;
+    sketch->numKmers     = 0;
+    sketch->idRing       = 0;
+    sketch->minimum.hash = GPU_UINT64_ONES;
+    return(false);
+  }
+  sketch->kmer = ((sketch->kmer << 2) | base) & sketch->kmerMask;
+  if(++sketch->numBases < sketch->k) return(false);
+  current.hash     = gpu_reference_minimizers_hash(sketch->kmer, sketch->kmerMask);
+  current.position = position + 1 - sketch->k;
+  sketch->ring[sketch->idRing] = current;
+  sketch->idRing = (sketch->idRing + 1) % sketch->w;
+  // Filling the first window (reported once it is complete)
+  if(sketch->numKmers < sketch->w){
+    if((sketch->numKmers == 0) || (current.hash < sketch->minimum.hash)) sketch->minimum = current;
+    if(++sketch->numKmers < sketch->w) return(false);
+    (* minimizer) = sketch->minimum;
+    return(true);
+  }
+  // Sliding window: only the changes of minimizer are reported
+  if(current.hash < sketch->minimum.hash){
+    sketch->minimum = current;
+  }else if(sketch->minimum.position + sketch->w <= current.position){
+    gpu_reference_minimizers_sketch_rescan(sketch);
+  }else{
+    return(false);
+  }
+  (* minimizer) = sketch->minimum;
+  return(true);
+}
+
+
+/************************************************************
+Query functions
+************************************************************/
+
+uint64_t gpu_reference_minimizers_search(const gpu_reference_minimizers_t* const minimizers, const uint64_t hash, uint64_t* const idFirstEntry)
+{
+  // Binary searches of the hash range (bounded by the bucket of the prefix)
+  const uint32_t hashBits = 2 * minimizers->k;
+  const uint64_t idBucket = hash >> (hashBits - minimizers->bucketBits);
+  uint64_t lo, hi, first;
+  if((minimizers->h_entries == NULL) || (idBucket >= minimizers->numBuckets)) return(0);
+  lo = minimizers->h_buckets[idBucket];
+  hi = minimizers->h_buckets[idBucket + 1];
+  while(lo < hi){
+    const uint64_t idEntry = lo + ((hi - lo) / 2);
+    if(minimizers->h_entries[idEntry].hash < hash) lo = idEntry + 1;
+    else hi = idEntry;
+  }
+  first = lo;
+  hi    = minimizers->h_buckets[idBucket + 1];
+  while(lo < hi){
+    const uint64_t idEntry = lo + ((hi - lo) / 2);
+    if(minimizers->h_entries[idEntry].hash <= hash) lo = idEntry + 1;
+    else hi = idEntry;
+  }
+  (* idFirstEntry) = first;
+  return(lo - first);
+}
+
+
+/************************************************************
+Build functions
+************************************************************/
+
+gpu_error_t gpu_reference_minimizers_add(gpu_reference_minimizers_t* const minimizers, uint64_t* const maxEntries,
+                                         const gpu_reference_minimizer_t* const minimizer)
+{
+  // Growing the table (the initial size is the expected density 2 / (w + 1))
+  if(minimizers->numEntries == (* maxEntries)){
+    gpu_reference_minimizer_t* const entries = (gpu_reference_minimizer_t *) realloc(minimizers->h_entries,
+                                                                                      2 * (* maxEntries) * sizeof(gpu_reference_minimizer_t));
+    if (entries == NULL) return (E_ALLOCATE_MEM);
+    minimizers->h_entries = entries;
+    (* maxEntries) *= 2;
+  }
+  minimizers->h_entries[minimizers->numEntries] = (* minimizer);
+  minimizers->numEntries++;
+  // Succeed
+  return(SUCCESS);
+}
+
+int gpu_reference_minimizers_cmp_entries(const void* const a, const void* const b)
+{
+  const gpu_reference_minimizer_t* const entryA = (const gpu_reference_minimizer_t *) a;
+  const gpu_reference_minimizer_t* const entryB = (const gpu_reference_minimizer_t *) b;
+  if(entryA->hash != entryB->hash) return((entryA->hash < entryB->hash) ? -1 : 1);
+  return((entryA->position < entryB->position) ? -1 : (entryA->position > entryB->position));
+}
+
+bool gpu_reference_minimizers_sorted_positions(const gpu_reference_minimizers_t* const minimizers)
+{
+  uint64_t idEntry;
+  for(idEntry = 1; idEntry < minimizers->numEntries; ++idEntry)
+    if(minimizers->h_entries[idEntry - 1].position > minimizers->h_entries[idEntry].position) return(false);
+  return(true);
+}
+
+gpu_error_t gpu_reference_minimizers_radix_sort(gpu_reference_minimizers_t* const minimizers)
+{
+  const uint32_t             hashBits   = 2 * minimizers->k;
+  const uint64_t             numEntries = minimizers->numEntries;
+  gpu_reference_minimizer_t* scratch    = (gpu_reference_minimizer_t *) malloc(GPU_MAX(numEntries, 1) * sizeof(gpu_reference_minimizer_t));
+  gpu_reference_minimizer_t  *source = minimizers->h_entries, *target = scratch, *swap;
+  uint64_t                   offsets[GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS], idEntry, offset;
+  uint32_t                   shift, idDigit;
+  if (scratch == NULL) return (E_ALLOCATE_MEM);
+  // Stable passes from the least significant digit (the entries keep their position order inside a hash)
+  for(shift = 0; shift < hashBits; shift += GPU_REFERENCE_MINIMIZERS_RADIX_BITS){
+    memset(offsets, 0, sizeof(offsets));
+    for(idEntry = 0; idEntry < numEntries; ++idEntry)
+      offsets[(source[idEntry].hash >> shift) & (GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS - 1)]++;
+    // All the hashes share the digit
+    if(offsets[(source[0].hash >> shift) & (GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS - 1)] == numEntries) continue;
+    for(idDigit = 0, offset = 0; idDigit < GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS; ++idDigit){
+      const uint64_t count = offsets[idDigit];
+      offsets[idDigit] = offset;
+      offset += count;
+    }
+    for(idEntry = 0; idEntry < numEntries; ++idEntry)
+      target[offsets[(source[idEntry].hash >> shift) & (GPU_REFERENCE_MINIMIZERS_RADIX_BUCKETS - 1)]++] = source[idEntry];
+    swap = source; source = target; target = swap;
+  }
+  if(source != minimizers->h_entries) memcpy(minimizers->h_entries, source, numEntries * sizeof(gpu_reference_minimizer_t));
+  free(scratch);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_minimizers_sort(gpu_reference_minimizers_t* const minimizers)
+{
+  // Occurrences of a hash are consecutive and sorted by position (the sketch emits them in position order)
+  if((minimizers->numEntries > 1) && gpu_reference_minimizers_sorted_positions(minimizers)){
+    GPU_ERROR(gpu_reference_minimizers_radix_sort(minimizers));
+  }else{
+    qsort(minimizers->h_entries, minimizers->numEntries, sizeof(gpu_reference_minimizer_t), gpu_reference_minimizers_cmp_entries);
+  }
+  GPU_ERROR(gpu_reference_minimizers_build_buckets(minimizers));
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_minimizers_build_buckets(gpu_reference_minimizers_t* const minimizers)
+{
+  const uint32_t hashBits = 2 * minimizers->k;
+  uint64_t idBucket, idEntry = 0;
+  minimizers->bucketBits = GPU_MIN(GPU_REFERENCE_MINIMIZERS_BUCKET_BITS, hashBits);
+  minimizers->numBuckets = 1UL << minimizers->bucketBits;
+  if(minimizers->h_buckets != NULL) free(minimizers->h_buckets);
+  minimizers->h_buckets = (uint64_t *) malloc((minimizers->numBuckets + 1) * sizeof(uint64_t));
+  if (minimizers->h_buckets == NULL) return (E_ALLOCATE_MEM);
+  // Sweep of the sorted entries
+  for(idBucket = 0; idBucket < minimizers->numBuckets; ++idBucket){
+    while((idEntry < minimizers->numEntries) && ((minimizers->h_entries[idEntry].hash >> (hashBits - minimizers->bucketBits)) < idBucket)) idEntry++;
+    minimizers->h_buckets[idBucket] = idEntry;
+  }
+  minimizers->h_buckets[minimizers->numBuckets] = minimizers->numEntries;
+  // Succeed
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Stream functions
+************************************************************/
+
+gpu_error_t gpu_reference_minimizers_read(int fp, gpu_reference_minimizers_t* const minimizers, const uint64_t size)
+{
+  uint32_t params[2] = {0, 0};
+  uint64_t numEntries = 0;
+  size_t   result, bytesRequest = sizeof(params);
+  // Containers without the table end after the N-run intervals (built later from the reference)
+  result = read(fp, (void* )params, bytesRequest);
+  if (result == 0) return (SUCCESS);
+  if (result != bytesRequest) return (E_READING_FILE);
+  bytesRequest = sizeof(uint64_t);
+  result = read(fp, (void* )&numEntries, bytesRequest);
+  if (result != bytesRequest) return (E_READING_FILE);
+  // Tables sampled with other (w,k) are ignored (the requested ones are built)
+  if((params[0] != minimizers->w) || (params[1] != minimizers->k)) return (SUCCESS);
+  if(minimizers->h_entries != NULL) free(minimizers->h_entries);
+  minimizers->size       = size;
+  minimizers->numEntries = numEntries;
+  minimizers->h_entries  = (gpu_reference_minimizer_t *) malloc(GPU_MAX(numEntries, 1) * sizeof(gpu_reference_minimizer_t));
+  if (minimizers->h_entries == NULL) return (E_ALLOCATE_MEM);
+  GPU_ERROR(gpu_io_read_buffered(fp, (void* )minimizers->h_entries, numEntries * sizeof(gpu_reference_minimizer_t)));
+  GPU_ERROR(gpu_reference_minimizers_build_buckets(minimizers));
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_minimizers_write(int fp, const gpu_reference_minimizers_t* const minimizers)
+{
+  const uint32_t params[2] = {minimizers->w, minimizers->k};
+  size_t result, bytesRequest = sizeof(params);
+  // Write the sorted entries (the accelerator is rebuilt at load time)
+  result = write(fp, (void* )params, bytesRequest);
+  if (result != bytesRequest) return (E_WRITING_FILE);
+  bytesRequest = sizeof(uint64_t);
+  result = write(fp, (void* )&minimizers->numEntries, bytesRequest);
+  if (result != bytesRequest) return (E_WRITING_FILE);
+  GPU_ERROR(gpu_io_write_buffered(fp, (void* )minimizers->h_entries, minimizers->numEntries * sizeof(gpu_reference_minimizer_t)));
+  // Succeed
+  return (SUCCESS);
+}
+
+
+/************************************************************
+Initialize and free functions
+************************************************************/
+
+gpu_error_t gpu_reference_minimizers_init_dto(gpu_reference_minimizers_t* const minimizers)
+{
+  minimizers->w          = GPU_REFERENCE_MINIMIZERS_DEFAULT_W;
+  minimizers->k          = GPU_REFERENCE_MINIMIZERS_DEFAULT_K;
+  minimizers->size       = 0;
+  minimizers->numEntries = 0;
+  minimizers->h_entries  = NULL;
+  minimizers->bucketBits = 0;
+  minimizers->numBuckets = 0;
+  minimizers->h_buckets  = NULL;
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_minimizers_init(gpu_reference_minimizers_t* const minimizers, const uint32_t w, const uint32_t k)
+{
+  // Zero selects the default sampling
+  const uint32_t windowKmers = (w != 0) ? w : GPU_REFERENCE_MINIMIZERS_DEFAULT_W;
+  const uint32_t kmerLength  = (k != 0) ? k : GPU_REFERENCE_MINIMIZERS_DEFAULT_K;
+  if((windowKmers < GPU_REFERENCE_MINIMIZERS_MIN_W) || (windowKmers > GPU_REFERENCE_MINIMIZERS_MAX_W) ||
+     (kmerLength  < GPU_REFERENCE_MINIMIZERS_MIN_K) || (kmerLength  > GPU_REFERENCE_MINIMIZERS_MAX_K))
+    return (E_USE_CASE_NOT_ALLOWED);
+  minimizers->w = windowKmers;
+  minimizers->k = kmerLength;
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_minimizers_free_host(gpu_reference_minimizers_t* const minimizers)
+{
+  if(minimizers->h_entries != NULL){
+    free(minimizers->h_entries);
+    minimizers->h_entries = NULL;
+  }
+  if(minimizers->h_buckets != NULL){
+    free(minimizers->h_buckets);
+    minimizers->h_buckets = NULL;
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+#endif /* GPU_REFERENCE_MINIMIZERS_C_ */
@@ -0,0 +1,361 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_NRUNS_C_
+#define GPU_REFERENCE_NRUNS_C_
+
+#include "../include/gpu_reference_nruns.h"
+#include "../include/gpu_io.h"
+#include "../include/gpu_shm.h"
+
+/************************************************************
+Get information functions
+************************************************************/
+
+gpu_error_t gpu_reference_nruns_get_size(const gpu_reference_nruns_t* const nRuns, size_t* const bytesPerNRuns)
+{
+  // Buckets are accounted even before the runs are built (the runs are negligible)
+  const uint64_t numBuckets = (nRuns->size >> GPU_REFERENCE_NRUNS_BUCKET_BITS) + 1;
+  (* bytesPerNRuns) = (nRuns->numRuns * sizeof(gpu_reference_nrun_t)) + ((numBuckets + 1) * sizeof(uint64_t));
+  return(SUCCESS);
+}
+
+gpu_reference_nruns_view_t gpu_reference_nruns_get_view(const gpu_reference_nruns_t* const nRuns, const uint32_t idSupportedDevice)
+{
+  gpu_reference_nruns_view_t view = {NULL, NULL, 0, 0};
+  if((nRuns->d_runs != NULL) && (nRuns->d_buckets != NULL)){
+    view.runs       = nRuns->d_runs[idSupportedDevice];
+    view.buckets    = nRuns->d_buckets[idSupportedDevice];
+    view.numRuns    = nRuns->numRuns;
+    view.numBuckets = nRuns->numBuckets;
+  }
+  return(view);
+}
+
+
+/************************************************************
+Query functions
+************************************************************/
+
+void gpu_reference_nruns_init_cursor(gpu_reference_nruns_cursor_t* const cursor)
+{
+  cursor->start = 0;
+  cursor->end   = 0;
+  cursor->isN   = false;
+}
+
+uint64_t gpu_reference_nruns_search(const gpu_reference_nruns_t* const nRuns, const uint64_t position)
+{
+  // Binary search of the first run ending after the position (bounded by the bucket)
+  const uint64_t idBucket = GPU_MIN(position >> GPU_REFERENCE_NRUNS_BUCKET_BITS, nRuns->numBuckets - 1);
+  uint64_t lo = nRuns->h_buckets[idBucket], hi = nRuns->h_buckets[idBucket + 1];
+  while(lo < hi){
+    const uint64_t idRun = lo + ((hi - lo) / 2);
+    if((nRuns->h_runs[idRun].start + nRuns->h_runs[idRun].length) <= position) lo = idRun + 1;
+    else hi = idRun;
+  }
+  return(lo);
+}
+
+bool gpu_reference_nruns_is_N(const gpu_reference_nruns_t* const nRuns, const uint64_t position, gpu_reference_nruns_cursor_t* const cursor)
+{
+  uint64_t idRun;
+  // Sequential scans are served from the cached interval
+  if((position >= cursor->start) && (position < cursor->end)) return(cursor->isN);
+  idRun = gpu_reference_nruns_search(nRuns, position);
+  cursor->isN = (idRun < nRuns->numRuns) && (nRuns->h_runs[idRun].start <= position);
+  if(cursor->isN){
+    cursor->start = nRuns->h_runs[idRun].start;
+    cursor->end   = nRuns->h_runs[idRun].start + nRuns->h_runs[idRun].length;
+  }else{
+    cursor->start = (idRun > 0) ? nRuns->h_runs[idRun - 1].start + nRuns->h_runs[idRun - 1].length : 0;
+    cursor->end   = (idRun < nRuns->numRuns) ? nRuns->h_runs[idRun].start : GPU_UINT64_MAX_VALUE;
+  }
+  return(cursor->isN);
+}
+
+bool gpu_reference_nruns_window_has_N(const gpu_reference_nruns_t* const nRuns, const uint64_t position, const uint64_t length,
+                                      gpu_reference_nruns_cursor_t* const cursor)
+{
+  if(length == 0) return(false);
+  if(gpu_reference_nruns_is_N(nRuns, position, cursor)) return(true);
+  // The cursor holds the gap around the position: the window contains N if it reaches the next run
+  return((position + length) > cursor->end);
+}
+
+uint64_t gpu_reference_nruns_get_window(const gpu_reference_nruns_t* const nRuns, const uint64_t firstChar)
+{
+  // Masked bitmap representation (LSB first) of the 64 positions starting at firstChar
+  const uint64_t lastChar = firstChar + GPU_UINT64_LENGTH;
+  gpu_reference_nruns_cursor_t cursor;
+  uint64_t window = GPU_UINT64_ZEROS, position = firstChar;
+  gpu_reference_nruns_init_cursor(&cursor);
+  while(position < lastChar){
+    const bool     isN         = gpu_reference_nruns_is_N(nRuns, position, &cursor);
+    const uint64_t endInterval = GPU_MIN(cursor.end, lastChar);
+    if(isN){
+      const uint64_t numBits = endInterval - position;
+      const uint64_t bits    = (numBits == GPU_UINT64_LENGTH) ? GPU_UINT64_ONES : ((((uint64_t) GPU_UINT64_MASK_ONE_LOW) << numBits) - 1);
+      window |= bits << (position - firstChar);
+    }
+    position = endInterval;
+  }
+  return(window);
+}
+
+
+/************************************************************
+Build functions
+************************************************************/
+
+gpu_error_t gpu_reference_nruns_add_run(gpu_reference_nruns_t* const nRuns, uint64_t* const maxRuns, const uint64_t start, const uint64_t length)
+{
+  // Growing the table (few hundreds of runs are expected for real assemblies)
+  if(nRuns->numRuns == (* maxRuns)){
+    gpu_reference_nrun_t* const runs = (gpu_reference_nrun_t *) realloc(nRuns->h_runs, 2 * (* maxRuns) * sizeof(gpu_reference_nrun_t));
+    if (runs == NULL) return (E_ALLOCATE_MEM);
+    nRuns->h_runs = runs;
+    (* maxRuns) *= 2;
+  }
+  nRuns->h_runs[nRuns->numRuns].start  = start;
+  nRuns->h_runs[nRuns->numRuns].length = length;
+  nRuns->numRuns++;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_build_buckets(gpu_reference_nruns_t* const nRuns)
+{
+  uint64_t idBucket, idRun = 0;
+  nRuns->numBuckets = (nRuns->size >> GPU_REFERENCE_NRUNS_BUCKET_BITS) + 1;
+  if(nRuns->h_buckets != NULL) free(nRuns->h_buckets);
+  nRuns->h_buckets = (uint64_t *) malloc((nRuns->numBuckets + 1) * sizeof(uint64_t));
+  if (nRuns->h_buckets == NULL) return (E_ALLOCATE_MEM);
+  // Sweep of the sorted runs
+  for(idBucket = 0; idBucket < nRuns->numBuckets; ++idBucket){
+    const uint64_t bucketStart = idBucket << GPU_REFERENCE_NRUNS_BUCKET_BITS;
+    while((idRun < nRuns->numRuns) && ((nRuns->h_runs[idRun].start + nRuns->h_runs[idRun].length) <= bucketStart)) idRun++;
+    nRuns->h_buckets[idBucket] = idRun;
+  }
+  nRuns->h_buckets[nRuns->numBuckets] = nRuns->numRuns;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_build(gpu_reference_nruns_t* const nRuns, const uint64_t* const h_masked, const uint64_t size)
+{
+  const uint64_t numEntries = GPU_DIV_CEIL(size, GPU_UINT64_LENGTH);
+  uint64_t maxRuns = GPU_REFERENCE_NRUNS_MIN_RUNS, idEntry, idBit, runStart = 0;
+  bool     inRun = false;
+  // Allocating the initial table
+  if(nRuns->h_runs != NULL) free(nRuns->h_runs);
+  nRuns->size    = size;
+  nRuns->numRuns = 0;
+  nRuns->h_runs  = (gpu_reference_nrun_t *) malloc(maxRuns * sizeof(gpu_reference_nrun_t));
+  if (nRuns->h_runs == NULL) return (E_ALLOCATE_MEM);
+  // Scanning the masked bitmap (entries without state changes are skipped)
+  for(idEntry = 0; idEntry < numEntries; ++idEntry){
+    const uint64_t bitmap = h_masked[idEntry];
+    if((!inRun && (bitmap == GPU_UINT64_ZEROS)) || (inRun && (bitmap == GPU_UINT64_ONES))) continue;
+    for(idBit = 0; idBit < GPU_UINT64_LENGTH; ++idBit){
+      const uint64_t position = idEntry * GPU_UINT64_LENGTH + idBit;
+      const bool     isN      = (bitmap >> idBit) & GPU_UINT64_MASK_ONE_LOW;
+      if(position >= size) break;
+      if(isN && !inRun){
+        runStart = position;
+        inRun    = true;
+      }else if(!isN && inRun){
+        GPU_ERROR(gpu_reference_nruns_add_run(nRuns, &maxRuns, runStart, position - runStart));
+        inRun = false;
+      }
+    }
+  }
+  if(inRun) GPU_ERROR(gpu_reference_nruns_add_run(nRuns, &maxRuns, runStart, size - runStart));
+  // Building the search accelerator
+  GPU_ERROR(gpu_reference_nruns_build_buckets(nRuns));
+  // Succeed
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Stream functions
+************************************************************/
+
+gpu_error_t gpu_reference_nruns_read(int fp, gpu_reference_nruns_t* const nRuns, const uint64_t size)
+{
+  size_t result, bytesRequest = sizeof(uint64_t);
+  uint64_t numRuns = 0;
+  // Containers without the table end after the masked reference (built later from the bitmap)
+  result = read(fp, (void* )&numRuns, bytesRequest);
+  if (result == 0) return (SUCCESS);
+  if (result != bytesRequest) return (E_READING_FILE);
+  // Read the runs and rebuild the search accelerator
+  if(nRuns->h_runs != NULL) free(nRuns->h_runs);
+  nRuns->size    = size;
+  nRuns->numRuns = numRuns;
+  nRuns->h_runs  = (gpu_reference_nrun_t *) malloc(GPU_MAX(numRuns, 1) * sizeof(gpu_reference_nrun_t));
+  if (nRuns->h_runs == NULL) return (E_ALLOCATE_MEM);
+  GPU_ERROR(gpu_io_read_buffered(fp, (void* )nRuns->h_runs, numRuns * sizeof(gpu_reference_nrun_t)));
+  GPU_ERROR(gpu_reference_nruns_build_buckets(nRuns));
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_skip(int fp)
+{
+  size_t result, bytesRequest = sizeof(uint64_t);
+  uint64_t numRuns = 0;
+  // Readers using the masked reference move to the sections appended after the table
+  result = read(fp, (void* )&numRuns, bytesRequest);
+  if (result == 0) return (SUCCESS);
+  if (result != bytesRequest) return (E_READING_FILE);
+  if (lseek64(fp, numRuns * sizeof(gpu_reference_nrun_t), SEEK_CUR) < 0) return (E_READING_FILE);
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_write(int fp, const gpu_reference_nruns_t* const nRuns)
+{
+  size_t result, bytesRequest = sizeof(uint64_t);
+  // Write the runs (the accelerator is rebuilt at load time)
+  result = write(fp, (void* )&nRuns->numRuns, bytesRequest);
+  if (result != bytesRequest) return (E_WRITING_FILE);
+  GPU_ERROR(gpu_io_write_buffered(fp, (void* )nRuns->h_runs, nRuns->numRuns * sizeof(gpu_reference_nrun_t)));
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_write_masked(int fp, const gpu_reference_nruns_t* const nRuns, const uint64_t numEntriesMasked)
+{
+  // Regenerates the masked bitmap by blocks (the bitmap is not kept when the runs are active)
+  uint64_t* const block = (uint64_t *) malloc(GPU_REFERENCE_NRUNS_WRITE_ENTRIES * sizeof(uint64_t));
+  uint64_t idEntry, idBlockEntry;
+  if (block == NULL) return (E_ALLOCATE_MEM);
+  for(idEntry = 0; idEntry < numEntriesMasked; idEntry += GPU_REFERENCE_NRUNS_WRITE_ENTRIES){
+    const uint64_t numBlockEntries = GPU_MIN(GPU_REFERENCE_NRUNS_WRITE_ENTRIES, numEntriesMasked - idEntry);
+    for(idBlockEntry = 0; idBlockEntry < numBlockEntries; ++idBlockEntry)
+      block[idBlockEntry] = gpu_reference_nruns_get_window(nRuns, (idEntry + idBlockEntry) * GPU_UINT64_LENGTH);
+    GPU_ERROR(gpu_io_write_buffered(fp, (void* )block, numBlockEntries * sizeof(uint64_t)));
+  }
+  free(block);
+  // Succeed
+  return (SUCCESS);
+}
+
+
+/************************************************************
+Initialize, transfer and free functions
+************************************************************/
+
+gpu_error_t gpu_reference_nruns_init_dto(gpu_reference_nruns_t* const nRuns)
+{
+  nRuns->size        = 0;
+  nRuns->numRuns     = 0;
+  nRuns->h_runs      = NULL;
+  nRuns->d_runs      = NULL;
+  nRuns->numBuckets  = 0;
+  nRuns->h_buckets   = NULL;
+  nRuns->d_buckets   = NULL;
+  nRuns->memorySpace = NULL;
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_init(gpu_reference_nruns_t* const nRuns, memory_alloc_t* const memorySpace, const uint32_t numSupportedDevices)
+{
+  uint32_t idSupDevice;
+  // Allocating the description for the GPU tables
+  nRuns->d_runs = (gpu_reference_nrun_t **) malloc(numSupportedDevices * sizeof(gpu_reference_nrun_t *));
+  if (nRuns->d_runs == NULL) return (E_ALLOCATE_MEM);
+  nRuns->d_buckets = (uint64_t **) malloc(numSupportedDevices * sizeof(uint64_t *));
+  if (nRuns->d_buckets == NULL) return (E_ALLOCATE_MEM);
+  for(idSupDevice = 0; idSupDevice < numSupportedDevices; ++idSupDevice){
+    nRuns->d_runs[idSupDevice]    = NULL;
+    nRuns->d_buckets[idSupDevice] = NULL;
+  }
+  nRuns->memorySpace = memorySpace;
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_transfer_CPU_to_GPUs(gpu_reference_nruns_t* const nRuns, gpu_device_info_t** const devices)
+{
+  const uint32_t numSupportedDevices = devices[0]->numSupportedDevices;
+  uint32_t deviceFreeMemory, idSupportedDevice;
+  // Transfer data for each GPU on the system
+  for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
+    if(nRuns->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED){
+      const size_t cpySizeRuns    = GPU_MAX(nRuns->numRuns, 1) * sizeof(gpu_reference_nrun_t);
+      const size_t cpySizeBuckets = (nRuns->numBuckets + 1) * sizeof(uint64_t);
+      deviceFreeMemory = gpu_device_get_free_memory(devices[idSupportedDevice]->idDevice);
+      if ((GPU_CONVERT__B_TO_MB(cpySizeRuns + cpySizeBuckets)) > deviceFreeMemory) return(E_INSUFFICIENT_MEM_GPU);
+      CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
+      //Synchronous allocate & transfer the N-run table to the GPU (or import the copy of a shared index)
+      if(!gpu_shm_open_device(GPU_SHM_NRUNS_RUNS, devices[idSupportedDevice], (void**) &nRuns->d_runs[idSupportedDevice])){
+        CUDA_ERROR(cudaMalloc((void**) &nRuns->d_runs[idSupportedDevice], cpySizeRuns));
+        CUDA_ERROR(cudaMemcpy(nRuns->d_runs[idSupportedDevice], nRuns->h_runs, nRuns->numRuns * sizeof(gpu_reference_nrun_t), cudaMemcpyHostToDevice));
+      }
+      if(!gpu_shm_open_device(GPU_SHM_NRUNS_BUCKETS, devices[idSupportedDevice], (void**) &nRuns->d_buckets[idSupportedDevice])){
+        CUDA_ERROR(cudaMalloc((void**) &nRuns->d_buckets[idSupportedDevice], cpySizeBuckets));
+        CUDA_ERROR(cudaMemcpy(nRuns->d_buckets[idSupportedDevice], nRuns->h_buckets, cpySizeBuckets, cudaMemcpyHostToDevice));
+      }
+    }else{
+      nRuns->d_runs[idSupportedDevice]    = nRuns->h_runs;
+      nRuns->d_buckets[idSupportedDevice] = nRuns->h_buckets;
+    }
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_free_host(gpu_reference_nruns_t* const nRuns)
+{
+  if(nRuns->h_runs != NULL){
+    free(nRuns->h_runs);
+    nRuns->h_runs = NULL;
+  }
+  if(nRuns->h_buckets != NULL){
+    free(nRuns->h_buckets);
+    nRuns->h_buckets = NULL;
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_reference_nruns_free_device(gpu_reference_nruns_t* const nRuns, gpu_device_info_t** const devices)
+{
+  const uint32_t numSupportedDevices = devices[0]->numSupportedDevices;
+  uint32_t idSupportedDevice;
+  // Free all the tables in the devices
+  if((nRuns->d_runs != NULL) && (nRuns->d_buckets != NULL)){
+    for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
+      if(nRuns->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED){
+        CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
+        if(nRuns->d_runs[idSupportedDevice] != NULL)    GPU_ERROR(gpu_shm_free_device(nRuns->d_runs[idSupportedDevice]));
+        if(nRuns->d_buckets[idSupportedDevice] != NULL) GPU_ERROR(gpu_shm_free_device(nRuns->d_buckets[idSupportedDevice]));
+      }
+      nRuns->d_runs[idSupportedDevice]    = NULL;
+      nRuns->d_buckets[idSupportedDevice] = NULL;
+    }
+  }
+  // Free the device table lists
+  if(nRuns->d_runs != NULL){
+    free(nRuns->d_runs);
+    nRuns->d_runs = NULL;
+  }
+  if(nRuns->d_buckets != NULL){
+    free(nRuns->d_buckets);
+    nRuns->d_buckets = NULL;
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+#endif /* GPU_REFERENCE_NRUNS_C_ */
@@ -0,0 +1,308 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_REFERENCE_TEXT_C_
+#define GPU_REFERENCE_TEXT_C_
+
+#include "../include/gpu_reference_text.h"
+
+/************************************************************
+Word-level primitives (one byte per base)
+************************************************************/
+
+uint64_t gpu_reference_text_spread_bases(const uint32_t packedBases)
+{
+  // Spreads 8 plain bases (2 bits) to the low bits of 8 bytes
+  uint64_t spread = packedBases & 0xFFFFu;
+  spread = (spread | (spread << 24)) & 0x000000FF000000FFULL;
+  spread = (spread | (spread << 12)) & 0x000F000F000F000FULL;
+  spread = (spread | (spread << 6))  & 0x0303030303030303ULL;
+  return(spread);
+}
+
+uint64_t gpu_reference_text_spread_masked(const uint32_t maskedBases)
+{
+  // Spreads 8 masked bases (1 bit) to the low bit of 8 bytes
+  uint64_t spread = maskedBases & GPU_UINT8_ONES;
+  spread = (spread | (spread << 28)) & 0x0000000F0000000FULL;
+  spread = (spread | (spread << 14)) & 0x0003000300030003ULL;
+  spread = (spread | (spread << 7))  & GPU_REFERENCE_TEXT_LANE_BYTES;
+  return(spread);
+}
+
+uint32_t gpu_reference_text_pack_bases(const uint64_t codes)
+{
+  // Inverse of the spreading (non-bases lose the high bit and are packed as A)
+  uint64_t packed = codes & 0x0303030303030303ULL;
+  packed = (packed | (packed >> 6))  & 0x000F000F000F000FULL;
+  packed = (packed | (packed >> 12)) & 0x000000FF000000FFULL;
+  packed = (packed | (packed >> 24)) & 0xFFFFu;
+  return((uint32_t) packed);
+}
+
+uint64_t gpu_reference_text_reverse_complement(const uint64_t codes)
+{
+  // Bases are complemented as (3 - base), non-bases (4) are kept
+  const uint64_t reversed = __builtin_bswap64(codes);
+  const uint64_t nonBases = (reversed >> 2) & GPU_REFERENCE_TEXT_LANE_BYTES;
+  return(reversed ^ ((GPU_REFERENCE_TEXT_LANE_BYTES * GPU_ENC_DNA_CHAR_T) & ~(nonBases * GPU_UINT8_ONES)));
+}
+
+
+/************************************************************
+Sequential access to the packed reference
+************************************************************/
+
+void gpu_reference_text_init_stream(gpu_reference_text_stream_t* const stream, const gpu_reference_buffer_t* const reference)
+{
+  stream->reference     = reference;
+  stream->idEntryPlain  = GPU_UINT64_ONES;
+  stream->idEntryMasked = GPU_UINT64_ONES;
+}
+
+uint64_t gpu_reference_text_fetch_plain(const gpu_reference_buffer_t* const reference, const uint64_t idEntry)
+{
+  // Entries placed after the text are not read (the padding is not mirrored for strand-virtual references)
+  if((idEntry * GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) >= reference->size) return(GPU_UINT64_ZEROS);
+  return(gpu_reference_get_entry_plain(reference, idEntry));
+}
+
+uint64_t gpu_reference_text_fetch_masked(const gpu_reference_buffer_t* const reference, const uint64_t idEntry)
+{
+  if((idEntry * GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) >= reference->size) return(GPU_UINT64_ZEROS);
+  return(gpu_reference_get_entry_masked(reference, idEntry));
+}
+
+uint64_t gpu_reference_text_get_plain(gpu_reference_text_stream_t* const stream, const uint64_t firstChar)
+{
+  const uint64_t idEntry   = firstChar / GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY;
+  const uint32_t shiftBits = (firstChar % GPU_REFERENCE_PLAIN__CHARS_PER_ENTRY) * GPU_REFERENCE_PLAIN__CHAR_LENGTH;
+  // Consecutive steps only fetch the next entry
+  if(idEntry != stream->idEntryPlain){
+    if((stream->idEntryPlain != GPU_UINT64_ONES) && (idEntry == (stream->idEntryPlain + 1))) stream->plain[0] = stream->plain[1];
+    else stream->plain[0] = gpu_reference_text_fetch_plain(stream->reference, idEntry);
+    stream->plain[1]     = gpu_reference_text_fetch_plain(stream->reference, idEntry + 1);
+    stream->idEntryPlain = idEntry;
+  }
+  if(shiftBits == 0) return(stream->plain[0]);
+  return((stream->plain[0] >> shiftBits) | (stream->plain[1] << (GPU_UINT64_LENGTH - shiftBits)));
+}
+
+uint32_t gpu_reference_text_get_masked(gpu_reference_text_stream_t* const stream, const uint64_t firstChar)
+{
+  const uint64_t idEntry   = firstChar / GPU_REFERENCE_MASKED__CHARS_PER_ENTRY;
+  const uint32_t shiftBits = (firstChar % GPU_REFERENCE_MASKED__CHARS_PER_ENTRY) * GPU_REFERENCE_MASKED__CHAR_LENGTH;
+  // A masked entry covers two steps
+  if(idEntry != stream->idEntryMasked){
+    if((stream->idEntryMasked != GPU_UINT64_ONES) && (idEntry == (stream->idEntryMasked + 1))) stream->masked[0] = stream->masked[1];
+    else stream->masked[0] = gpu_reference_text_fetch_masked(stream->reference, idEntry);
+    stream->masked[1]     = gpu_reference_text_fetch_masked(stream->reference, idEntry + 1);
+    stream->idEntryMasked = idEntry;
+  }
+  if(shiftBits == 0) return((uint32_t) stream->masked[0]);
+  return((uint32_t) ((stream->masked[0] >> shiftBits) | (stream->masked[1] << (GPU_UINT64_LENGTH - shiftBits))));
+}
+
+
+/************************************************************
+Functions to extract a single window
+************************************************************/
+
+uint64_t gpu_reference_text_get_bytes(const uint32_t size, const gpu_reference_text_format_t format)
+{
+  const uint32_t basesPerByte = GPU_UINT8_LENGTH / GPU_REFERENCE_PLAIN__CHAR_LENGTH;
+  if(format == GPU_REFERENCE_TEXT_2BITS) return(GPU_DIV_CEIL((uint64_t) size, basesPerByte));
+  return(size);
+}
+
+void gpu_reference_text_extract_codes(const gpu_reference_buffer_t* const reference, const uint64_t position, const uint32_t size,
+                                      uint8_t* const codes)
+{
+  const uint64_t numValid = (position < reference->size) ? GPU_MIN(reference->size - position, size) : 0;
+  gpu_reference_text_stream_t stream;
+  uint64_t idBase;
+  uint32_t idLane;
+  gpu_reference_text_init_stream(&stream, reference);
+  // One plain entry per step: the bases and their N-mask are unpacked 8 at a time
+  for(idBase = 0; idBase < numValid; idBase += GPU_REFERENCE_TEXT_CHARS_PER_STEP){
+    const uint64_t plain  = gpu_reference_text_get_plain(&stream, position + idBase);
+    const uint32_t masked = gpu_reference_text_get_masked(&stream, position + idBase);
+    for(idLane = 0; (idLane < GPU_REFERENCE_TEXT_CHARS_PER_STEP) && ((idBase + idLane) < numValid); idLane += GPU_REFERENCE_TEXT_CHARS_PER_LANE){
+      const uint64_t bases    = gpu_reference_text_spread_bases((uint32_t) (plain >> (idLane * GPU_REFERENCE_PLAIN__CHAR_LENGTH)));
+      const uint64_t nonBases = gpu_reference_text_spread_masked(masked >> idLane);
+      const uint64_t lane     = (bases & ~(nonBases * GPU_UINT8_ONES)) | (nonBases * GPU_ENC_DNA_CHAR_N);
+      memcpy(codes + idBase + idLane, &lane, GPU_MIN(numValid - idBase - idLane, GPU_REFERENCE_TEXT_CHARS_PER_LANE));
+    }
+  }
+  // Windows running out of the reference are padded with non-bases
+  memset(codes + numValid, GPU_ENC_DNA_CHAR_N, size - numValid);
+}
+
+void gpu_reference_text_reverse_codes(uint8_t* const codes, const uint32_t size)
+{
+  uint64_t laneLow, laneHigh;
+  uint32_t low = 0, high = size;
+  // Lanes from both ends are swapped and complemented
+  while((low + (2 * GPU_REFERENCE_TEXT_CHARS_PER_LANE)) <= high){
+    high -= GPU_REFERENCE_TEXT_CHARS_PER_LANE;
+    memcpy(&laneLow, codes + low, GPU_REFERENCE_TEXT_CHARS_PER_LANE);
+    memcpy(&laneHigh, codes + high, GPU_REFERENCE_TEXT_CHARS_PER_LANE);
+    laneLow  = gpu_reference_text_reverse_complement(laneLow);
+    laneHigh = gpu_reference_text_reverse_complement(laneHigh);
+    memcpy(codes + low, &laneHigh, GPU_REFERENCE_TEXT_CHARS_PER_LANE);
+    memcpy(codes + high, &laneLow, GPU_REFERENCE_TEXT_CHARS_PER_LANE);
+    low += GPU_REFERENCE_TEXT_CHARS_PER_LANE;
+  }
+  // Remaining center of the window (less than two lanes, the central base of odd windows is swapped with itself)
+  while(low < high){
+    const uint8_t baseLow  = codes[low];
+    const uint8_t baseHigh = codes[--high];
+    codes[low++] = (baseHigh < GPU_ENC_DNA_CHAR_N) ? (baseHigh ^ GPU_ENC_DNA_CHAR_T) : baseHigh;
+    codes[high]  = (baseLow  < GPU_ENC_DNA_CHAR_N) ? (baseLow  ^ GPU_ENC_DNA_CHAR_T) : baseLow;
+  }
+}
+
+void gpu_reference_text_codes_to_ASCII(uint8_t* const codes, const uint32_t size)
+{
+  const char ASCII[] = {'A', 'C', 'G', 'T', 'N'};
+  uint32_t idBase;
+  for(idBase = 0; idBase < size; ++idBase)
+    codes[idBase] = ASCII[codes[idBase]];
+}
+
+void gpu_reference_text_codes_to_2bits(const uint8_t* const codes, const uint32_t size, uint8_t* const text)
+{
+  const uint32_t bytesPerLane = GPU_REFERENCE_TEXT_CHARS_PER_LANE / (GPU_UINT8_LENGTH / GPU_REFERENCE_PLAIN__CHAR_LENGTH);
+  uint32_t idBase;
+  for(idBase = 0; idBase < size; idBase += GPU_REFERENCE_TEXT_CHARS_PER_LANE){
+    const uint32_t numBases = GPU_MIN(size - idBase, GPU_REFERENCE_TEXT_CHARS_PER_LANE);
+    uint64_t lane = 0;
+    uint32_t packed;
+    memcpy(&lane, codes + idBase, numBases);
+    packed = gpu_reference_text_pack_bases(lane);
+    memcpy(text + (idBase / GPU_REFERENCE_TEXT_CHARS_PER_LANE) * bytesPerLane, &packed,
+           GPU_MIN(gpu_reference_text_get_bytes(numBases, GPU_REFERENCE_TEXT_2BITS), bytesPerLane));
+  }
+}
+
+gpu_error_t gpu_reference_text_extract(gpu_reference_text_worker_t* const worker, const gpu_reference_text_request_t* const request)
+{
+  const gpu_reference_text_context_t* const context = worker->context;
+  uint8_t* const                            text    = context->text + request->init_offset;
+  uint8_t*                                  codes   = text;
+  // The 2-bit windows are unpacked in the scratch of the worker (the rest are built in place)
+  if(context->format == GPU_REFERENCE_TEXT_2BITS){
+    if(request->size > worker->maxCodes){
+      uint8_t* const scratch = (uint8_t *) realloc(worker->h_codes, request->size);
+      if(scratch == NULL) return(E_ALLOCATE_MEM);
+      worker->h_codes  = scratch;
+      worker->maxCodes = request->size;
+    }
+    codes = worker->h_codes;
+  }
+  gpu_reference_text_extract_codes(context->reference, request->position, request->size, codes);
+  if(request->strand == GPU_REFERENCE_TEXT_REVERSE) gpu_reference_text_reverse_codes(codes, request->size);
+  if(context->format == GPU_REFERENCE_TEXT_ASCII) gpu_reference_text_codes_to_ASCII(codes, request->size);
+  if(context->format == GPU_REFERENCE_TEXT_2BITS) gpu_reference_text_codes_to_2bits(codes, request->size, text);
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Functions to distribute the windows among the host threads
+************************************************************/
+
+void* gpu_reference_text_worker(void* const threadWorker)
+{
+  gpu_reference_text_worker_t* const  worker  = (gpu_reference_text_worker_t *) threadWorker;
+  gpu_reference_text_context_t* const context = worker->context;
+  // Dynamic scheduling: window sizes are irregular (candidates, complete reads or regions)
+  while(worker->error == SUCCESS){
+    const uint32_t initRequest = __sync_fetch_and_add(&context->nextRequest, GPU_REFERENCE_TEXT_REQUESTS_PER_TASK);
+    const uint32_t endRequest  = GPU_MIN(initRequest + GPU_REFERENCE_TEXT_REQUESTS_PER_TASK, context->numRequests);
+    uint32_t idRequest;
+    if(initRequest >= context->numRequests) break;
+    for(idRequest = initRequest; (idRequest < endRequest) && (worker->error == SUCCESS); ++idRequest)
+      worker->error = gpu_reference_text_extract(worker, &context->requests[idRequest]);
+  }
+  return(NULL);
+}
+
+uint32_t gpu_reference_text_get_num_threads(const uint32_t numThreads, const uint32_t numRequests)
+{
+  return(gpu_get_num_workers(numThreads, GPU_DIV_CEIL(numRequests, GPU_REFERENCE_TEXT_REQUESTS_PER_TASK), GPU_REFERENCE_TEXT_MAX_THREADS));
+}
+
+gpu_error_t gpu_reference_text_extract_batch(const gpu_reference_buffer_t* const reference, gpu_reference_text_request_t* const requests,
+                                             const uint32_t numRequests, const gpu_reference_text_format_t format, const uint32_t numThreads,
+                                             uint8_t* const text)
+{
+  const uint32_t threads = gpu_reference_text_get_num_threads(numThreads, numRequests);
+  gpu_reference_text_context_t context;
+  gpu_reference_text_worker_t  workers[GPU_REFERENCE_TEXT_MAX_THREADS];
+  gpu_error_t error = SUCCESS;
+  uint64_t    offset = 0;
+  uint32_t    idRequest, idThread, numLaunched = 0;
+  if(reference->h_reference_plain == NULL) return(E_DATA_NOT_ALLOCATED);
+  // Windows are stored back to back in the request order
+  for(idRequest = 0; idRequest < numRequests; ++idRequest){
+    requests[idRequest].init_offset = offset;
+    offset += gpu_reference_text_get_bytes(requests[idRequest].size, format);
+  }
+  // Extraction setup shared by all the threads
+  context.reference   = reference;
+  context.requests    = requests;
+  context.numRequests = numRequests;
+  context.format      = format;
+  context.text        = text;
+  context.nextRequest = 0;
+  for(idThread = 0; idThread < threads; ++idThread){
+    workers[idThread].context  = &context;
+    workers[idThread].h_codes  = NULL;
+    workers[idThread].maxCodes = 0;
+    workers[idThread].error    = SUCCESS;
+  }
+  // The calling thread works as the first worker (a failed launch only reduces the parallelism)
+  for(idThread = 1; idThread < threads; ++idThread){
+    if(pthread_create(&workers[idThread].thread, NULL, gpu_reference_text_worker, &workers[idThread]) != 0) break;
+    numLaunched++;
+  }
+  gpu_reference_text_worker(&workers[0]);
+  for(idThread = 1; idThread <= numLaunched; ++idThread)
+    pthread_join(workers[idThread].thread, NULL);
+  for(idThread = 0; idThread < threads; ++idThread){
+    if(error == SUCCESS) error = workers[idThread].error;
+    free(workers[idThread].h_codes);
+  }
+  return(error);
+}
+
+
+/************************************************************
+Functions to extract the candidate text (public)
+************************************************************/
+
+uint64_t gpu_reference_get_text_size_(const gpu_reference_text_request_t* const requests, const uint32_t numRequests,
+                                      const gpu_reference_text_format_t format)
+{
+  uint64_t bytes = 0;
+  uint32_t idRequest;
+  for(idRequest = 0; idRequest < numRequests; ++idRequest)
+    bytes += gpu_reference_text_get_bytes(requests[idRequest].size, format);
+  return(bytes);
+}
+
+void gpu_reference_extract_text_(const void* const gpuBuffer, gpu_reference_text_request_t* const requests, const uint32_t numRequests,
+                                 const gpu_reference_text_format_t format, const uint32_t numThreads, uint8_t* const text)
+{
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) gpuBuffer;
+  GPU_ERROR(gpu_reference_text_extract_batch(mBuff->reference, requests, numRequests, format, numThreads, text));
+}
+
+#endif /* GPU_REFERENCE_TEXT_C_ */
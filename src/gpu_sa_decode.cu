@@ -12,7 +12,7 @@
 
 #include "../include/gpu_sa_core.h"
 
-void __global__ gpu_sa_decoding_kernel(const uint64_t* const d_SA, const uint32_t samplingRate,
+void __global__ gpu_sa_decoding_kernel(const uint64_t* const d_SA, const uint32_t samplingRate, const uint32_t bitsPerSample,
                                        const uint32_t numDecodings, const ulonglong2* const d_endBWTPos,
                                        uint64_t* const d_textPos)
 {
@@ -22,43 +22,16 @@ void __global__ gpu_sa_decoding_kernel(const uint64_t* const d_SA, const uint32_
     const ulonglong2 saPosition   = d_endBWTPos[idDecoding];
           uint64_t   textPosition = GPU_UINT64_MAX_VALUE;
 
-    if((saPosition.x < GPU_UINT64_MAX_VALUE) && (saPosition.y < GPU_UINT64_MAX_VALUE))
-      textPosition = d_SA[saPosition.x / samplingRate] + saPosition.y;
+    if((saPosition.x < GPU_UINT64_MAX_VALUE) && (saPosition.y < GPU_UINT64_MAX_VALUE)){
+      const uint64_t saSample = gpu_sa_gather_sample(d_SA, bitsPerSample, saPosition.x / samplingRate);
+      // Samples re-densified from an N are not resolvable
+      if(saSample < GPU_UINT64_MAX_VALUE) textPosition = saSample + saPosition.y;
+    }
     
     d_textPos[idDecoding] = textPosition;
   }
 }
 
-extern "C"
-gpu_error_t gpu_sa_decoding_launch_kernel(const uint64_t* const d_SA, const uint32_t samplingRate,
-		                                      const uint32_t numDecodings, const ulonglong2* const d_endBWTPos,
-		                                      uint64_t* const d_textPos)
-{
-  const uint32_t threads = 128;
-  const uint32_t blocks  = GPU_DIV_CEIL(numDecodings, threads);
-  const uint32_t nreps   = 10;
-
-  float elapsed_time_ms = 0.0f;
-  cudaEvent_t start, stop;
-  cudaEventCreate(&start);
-  cudaEventCreate(&stop);
-  cudaEventRecord(start, 0);
-
-    for(uint32_t iteration = 0; iteration < nreps; ++iteration)
-      gpu_sa_decoding_kernel<<<blocks,threads>>>(d_SA, samplingRate, numDecodings, d_endBWTPos, d_textPos);
-
-  cudaEventRecord(stop, 0);
-  cudaThreadSynchronize();
-  cudaEventElapsedTime(&elapsed_time_ms, start, stop);
-  elapsed_time_ms /= nreps;
-
-  cudaEventDestroy(start);
-  cudaEventDestroy(stop);
-  printf("\t Time Kernel GPU:  %8.2f ms\n", elapsed_time_ms);
-
-  return(SUCCESS);
-}
-
 extern "C"
 gpu_error_t gpu_sa_decode_process_buffer(gpu_buffer_t* const mBuff)
 {
@@ -78,11 +51,11 @@ gpu_error_t gpu_sa_decode_process_buffer(gpu_buffer_t* const mBuff)
   gpu_device_kernel_thread_configuration(device, numThreads, &blocksPerGrid, &threadsPerBlock);
   // Sanity-check (checks buffer overflowing)
   if((numDecodings > numMaxEndPositions) || (numDecodings > numMaxTextPositions)){
-    printf("DECODING SA textPositions.numDecodings=%u, endPositions.numDecodings=%u, maxDecodings=%u \n", numDecodings, mBuff->data.decode.endPositions.numDecodings, mBuff->data.decode.numMaxTextPositions);
+    gpu_stats_add_overflow(&mBuff->stats);
     return(E_OVERFLOWING_BUFFER);
   }
 
-  gpu_sa_decoding_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>(index->sa.d_sa[idSupDev], samplingRate, numDecodings,
+  gpu_sa_decoding_kernel<<<blocksPerGrid, threadsPerBlock, 0, idStream>>>(index->sa.d_sa[idSupDev], samplingRate, index->sa.bitsPerSample, numDecodings,
 		                                                                      (ulonglong2*) endPos->d_endBWTPos, (uint64_t*) textPos->d_textPos);
 
   return(SUCCESS);
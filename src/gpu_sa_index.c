@@ -11,6 +11,10 @@
 #define GPU_SA_INDEX_C_
 
 #include "../include/gpu_sa_index.h"
+#include "../include/gpu_shm.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 /************************************************************
 Get information functions
@@ -18,7 +22,246 @@ Get information functions
 
 gpu_error_t gpu_sa_index_get_size(const gpu_sa_buffer_t* const sa, size_t* const bytesPerSA)
 {
-  (* bytesPerSA) = sa->numEntries * sizeof(gpu_sa_entry_t);
+  // Pending resampling and packing determine the final size of the SA
+  const uint64_t numEntries    = (sa->resamplingRate != 0) ? sa->resamplingEntries : sa->numEntries;
+  const uint32_t bitsPerSample = (sa->packingBits != 0) ? sa->packingBits : sa->bitsPerSample;
+  (* bytesPerSA) = gpu_sa_index_get_num_words(numEntries, bitsPerSample) * sizeof(uint64_t);
+  return (SUCCESS);
+}
+
+size_t gpu_sa_index_get_storage_size(const gpu_sa_buffer_t* const sa)
+{
+  // Current size of the host & device copies
+  return(gpu_sa_index_get_num_words(sa->numEntries, sa->bitsPerSample) * sizeof(uint64_t));
+}
+
+uint64_t gpu_sa_index_get_num_entries(const uint64_t saLength, const uint64_t samplingRate)
+{
+  return(GPU_DIV_CEIL(saLength, samplingRate));
+}
+
+
+/************************************************************
+ GLOBAL METHODS: Functions to resample the SA
+************************************************************/
+
+gpu_error_t gpu_sa_index_select_sampling_rate(gpu_sa_buffer_t* const sa, const uint64_t saLength, const bool densifyAllowed)
+{
+  const size_t   maxBytes = GPU_CONVERT_MB_TO__B(sa->maxMbSA);
+  const uint64_t minRate  = (densifyAllowed && (sa->minSamplingRate != 0)) ? sa->minSamplingRate : sa->sampligRate;
+  uint64_t samplingRate   = sa->sampligRate;
+
+  sa->resamplingRate    = 0;
+  sa->resamplingEntries = 0;
+  if((sa->maxMbSA == 0) || (sa->sampligRate == 0) || (saLength == 0)) return (SUCCESS);
+
+  // Densest rate reachable from the stored samples (divisors of the stored rate)
+  while(((samplingRate % 2) == 0) && ((samplingRate / 2) >= minRate))
+    samplingRate /= 2;
+  // Sparser rates (multiples of the stored rate) until it fits in the memory budget
+  while((samplingRate < minRate) ||
+        ((gpu_sa_index_get_num_entries(saLength, samplingRate) * sizeof(gpu_sa_entry_t) > maxBytes) && (samplingRate < saLength)))
+    samplingRate *= 2;
+
+  if(samplingRate != sa->sampligRate){
+    sa->resamplingRate    = samplingRate;
+    sa->resamplingEntries = gpu_sa_index_get_num_entries(saLength, samplingRate);
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_sa_entry_t gpu_sa_index_densify_entry(const gpu_sa_entry_t* const h_sa, const uint64_t samplingRate,
+                                          const gpu_fmi_buffer_t* const fmi, const uint64_t saPosition)
+{
+  uint64_t interval = saPosition, numSteps = 0;
+  // Walks backward until a stored sample (same rule than the decoding kernels)
+  while(interval % samplingRate){
+    if(!gpu_fmi_index_host_LF_step(fmi, &interval)) return(GPU_UINT64_MAX_VALUE);
+    numSteps++;
+  }
+  return(h_sa[interval / samplingRate] + numSteps);
+}
+
+gpu_error_t gpu_sa_index_resample(gpu_sa_buffer_t* const sa, const gpu_fmi_buffer_t* const fmi)
+{
+  const uint64_t        samplingRate   = sa->sampligRate;
+  const uint64_t        resamplingRate = sa->resamplingRate;
+  const memory_stats_t  hostAllocStats = sa->hostAllocStats;
+  gpu_sa_entry_t*       h_storedSA     = NULL;
+  uint64_t idEntry;
+
+  if((resamplingRate == 0) || (resamplingRate == samplingRate)) return (SUCCESS);
+  // Resampling works over the plain samples
+  GPU_ERROR(gpu_sa_index_unpack(sa));
+  h_storedSA = sa->h_sa;
+  if(h_storedSA == NULL) return (E_DATA_NOT_ALLOCATED);
+  // Densify requires the FM-index in the host side
+  if((samplingRate % resamplingRate) == 0){
+    if((fmi == NULL) || (fmi->h_fmi == NULL)) return (E_DATA_NOT_ALLOCATED);
+  }else if((resamplingRate % samplingRate) != 0){
+    return (E_NOT_IMPLEMENTED);
+  }
+
+  sa->h_sa       = NULL;
+  sa->numEntries = sa->resamplingEntries;
+  GPU_ERROR(gpu_sa_index_allocate(sa));
+
+  if((resamplingRate % samplingRate) == 0){
+    // Downsampling (exact: the new samples are a subset of the stored ones)
+    const uint64_t stride = resamplingRate / samplingRate;
+    for(idEntry = 0; idEntry < sa->numEntries; ++idEntry)
+      sa->h_sa[idEntry] = h_storedSA[idEntry * stride];
+  }else{
+    // Densify (the new samples are decoded with the FM-index, positions reaching an N are invalidated)
+    for(idEntry = 0; idEntry < sa->numEntries; ++idEntry)
+      sa->h_sa[idEntry] = gpu_sa_index_densify_entry(h_storedSA, samplingRate, fmi, idEntry * resamplingRate);
+  }
+
+  GPU_ERROR(gpu_hugepages_free(h_storedSA, hostAllocStats));
+
+  sa->sampligRate       = resamplingRate;
+  sa->resamplingRate    = 0;
+  sa->resamplingEntries = 0;
+  // Succeed
+  return (SUCCESS);
+}
+
+
+/************************************************************
+ GLOBAL METHODS: Functions to bit-pack the SA
+************************************************************/
+
+uint32_t gpu_sa_index_get_bits_per_sample(const uint64_t saLength)
+{
+  // Text positions [0, saLength) plus the all-ones code for the invalid samples
+  return((saLength == 0) ? 1 : GPU_UINT64_LENGTH - __builtin_clzll(saLength));
+}
+
+uint64_t gpu_sa_index_get_num_words(const uint64_t numEntries, const uint32_t bitsPerSample)
+{
+  if(bitsPerSample >= GPU_SA_PACKED_WORD_LENGTH) return(numEntries);
+  return(GPU_DIV_CEIL(numEntries * bitsPerSample, GPU_SA_PACKED_WORD_LENGTH) + GPU_SA_PACKED_PADDING_WORDS);
+}
+
+gpu_error_t gpu_sa_index_select_packing(gpu_sa_buffer_t* const sa, const uint64_t saLength)
+{
+  sa->packingBits = 0;
+  if(sa->activePacking && (saLength != 0)){
+    const uint32_t bitsPerSample = gpu_sa_index_get_bits_per_sample(saLength);
+    if(bitsPerSample < sa->bitsPerSample) sa->packingBits = bitsPerSample;
+  }
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_sa_entry_t gpu_sa_index_get_sample(const gpu_sa_buffer_t* const sa, const uint64_t idSample)
+{
+  const uint32_t bitsPerSample = sa->bitsPerSample;
+  const uint64_t* const h_words = (uint64_t *) sa->h_sa;
+  if(bitsPerSample >= GPU_SA_PACKED_WORD_LENGTH) return(sa->h_sa[idSample]);
+  {
+    const uint64_t mask        = ((uint64_t) GPU_UINT64_MASK_ONE_LOW << bitsPerSample) - 1;
+    const uint64_t bitPosition = idSample * bitsPerSample;
+    const uint64_t idWord      = bitPosition / GPU_SA_PACKED_WORD_LENGTH;
+    const uint32_t offset      = bitPosition % GPU_SA_PACKED_WORD_LENGTH;
+    uint64_t sample = h_words[idWord] >> offset;
+    if((offset + bitsPerSample) > GPU_SA_PACKED_WORD_LENGTH)
+      sample |= h_words[idWord + 1] << (GPU_SA_PACKED_WORD_LENGTH - offset);
+    sample &= mask;
+    return((sample == mask) ? GPU_UINT64_MAX_VALUE : sample);
+  }
+}
+
+void gpu_sa_index_unpack_samples(const gpu_sa_buffer_t* const sa, const uint64_t idSample, const uint64_t numSamples,
+                                 gpu_sa_entry_t* const samples)
+{
+  const uint32_t bitsPerSample = sa->bitsPerSample;
+  uint64_t idBatch = 0;
+  if(bitsPerSample >= GPU_SA_PACKED_WORD_LENGTH){
+    memcpy(samples, sa->h_sa + idSample, numSamples * sizeof(gpu_sa_entry_t));
+    return;
+  }
+#ifdef __AVX2__
+  {
+    // 4 samples per iteration: gathering the 2 words of each sample and shifting them with variable shifts
+    // (AVX2 shifts of 64 or more bits give 0, so the samples contained in a single word need no special case)
+    const uint64_t* const h_words = (uint64_t *) sa->h_sa;
+    const __m256i vMask   = _mm256_set1_epi64x(((uint64_t) GPU_UINT64_MASK_ONE_LOW << bitsPerSample) - 1);
+    const __m256i vWord   = _mm256_set1_epi64x(GPU_SA_PACKED_WORD_LENGTH);
+    const __m256i vOffset = _mm256_set1_epi64x(GPU_SA_PACKED_WORD_LENGTH - 1);
+    const __m256i vLanes  = _mm256_set_epi64x(3 * bitsPerSample, 2 * bitsPerSample, bitsPerSample, 0);
+    for(; (idBatch + 4) <= numSamples; idBatch += 4){
+      const __m256i vBitPosition = _mm256_add_epi64(_mm256_set1_epi64x((idSample + idBatch) * bitsPerSample), vLanes);
+      const __m256i vIdWord      = _mm256_srli_epi64(vBitPosition, 6);
+      const __m256i vShift       = _mm256_and_si256(vBitPosition, vOffset);
+      const __m256i vLow         = _mm256_i64gather_epi64((const long long *) h_words, vIdWord, 8);
+      const __m256i vHigh        = _mm256_i64gather_epi64((const long long *) (h_words + 1), vIdWord, 8);
+      __m256i vSample = _mm256_or_si256(_mm256_srlv_epi64(vLow, vShift), _mm256_sllv_epi64(vHigh, _mm256_sub_epi64(vWord, vShift)));
+      vSample = _mm256_and_si256(vSample, vMask);
+      // Invalid samples are restored to the plain invalid value
+      vSample = _mm256_or_si256(vSample, _mm256_cmpeq_epi64(vSample, vMask));
+      _mm256_storeu_si256((__m256i *) (samples + idBatch), vSample);
+    }
+  }
+#endif
+  for(; idBatch < numSamples; ++idBatch)
+    samples[idBatch] = gpu_sa_index_get_sample(sa, idSample + idBatch);
+}
+
+gpu_error_t gpu_sa_index_pack(gpu_sa_buffer_t* const sa)
+{
+  const uint32_t        bitsPerSample = sa->packingBits;
+  const memory_stats_t  hostAllocStats = sa->hostAllocStats;
+  gpu_sa_entry_t* const h_plainSA     = sa->h_sa;
+  uint64_t              *h_words, idEntry;
+
+  sa->packingBits = 0;
+  if((bitsPerSample == 0) || (sa->bitsPerSample != GPU_SA_PACKED_WORD_LENGTH)) return (SUCCESS);
+  if(h_plainSA == NULL) return (E_DATA_NOT_ALLOCATED);
+  {
+    const uint64_t mask = ((uint64_t) GPU_UINT64_MASK_ONE_LOW << bitsPerSample) - 1;
+    // The packed size was already published (a sample out of the text range means an inconsistent SA)
+    for(idEntry = 0; idEntry < sa->numEntries; ++idEntry)
+      if((h_plainSA[idEntry] != GPU_UINT64_MAX_VALUE) && (h_plainSA[idEntry] >= mask)) return (E_INDEX_CODING);
+
+    sa->h_sa          = NULL;
+    sa->bitsPerSample = bitsPerSample;
+    GPU_ERROR(gpu_sa_index_allocate(sa));
+    h_words = (uint64_t *) sa->h_sa;
+    memset(h_words, 0, gpu_sa_index_get_storage_size(sa));
+
+    for(idEntry = 0; idEntry < sa->numEntries; ++idEntry){
+      const uint64_t sample      = (h_plainSA[idEntry] == GPU_UINT64_MAX_VALUE) ? mask : h_plainSA[idEntry];
+      const uint64_t bitPosition = idEntry * bitsPerSample;
+      const uint64_t idWord      = bitPosition / GPU_SA_PACKED_WORD_LENGTH;
+      const uint32_t offset      = bitPosition % GPU_SA_PACKED_WORD_LENGTH;
+      h_words[idWord] |= sample << offset;
+      if((offset + bitsPerSample) > GPU_SA_PACKED_WORD_LENGTH)
+        h_words[idWord + 1] |= sample >> (GPU_SA_PACKED_WORD_LENGTH - offset);
+    }
+  }
+
+  GPU_ERROR(gpu_hugepages_free(h_plainSA, hostAllocStats));
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_sa_index_unpack(gpu_sa_buffer_t* const sa)
+{
+  const memory_stats_t hostAllocStats = sa->hostAllocStats;
+  gpu_sa_buffer_t      packedSA       = (* sa);
+
+  if(sa->bitsPerSample == GPU_SA_PACKED_WORD_LENGTH) return (SUCCESS);
+  if(sa->h_sa == NULL) return (E_DATA_NOT_ALLOCATED);
+
+  sa->h_sa          = NULL;
+  sa->bitsPerSample = GPU_SA_PACKED_WORD_LENGTH;
+  GPU_ERROR(gpu_sa_index_allocate(sa));
+  gpu_sa_index_unpack_samples(&packedSA, 0, sa->numEntries, sa->h_sa);
+
+  GPU_ERROR(gpu_hugepages_free(packedSA.h_sa, hostAllocStats));
+  // Succeed
   return (SUCCESS);
 }
 
@@ -37,13 +280,17 @@ gpu_error_t gpu_sa_index_read_specs(int fp, gpu_sa_buffer_t* const sa)
   bytesRequest = sizeof(uint64_t);
   result = read(fp, (void *)&sa->sampligRate, bytesRequest);
   if (result != bytesRequest) return (E_READING_FILE);
+  // Packed SAs store the bits per sample in the top byte of the sampling rate (0 for the plain SAs)
+  sa->bitsPerSample = sa->sampligRate >> GPU_SA_SPECS_BITS_OFFSET;
+  sa->bitsPerSample = (sa->bitsPerSample == 0) ? GPU_SA_PACKED_WORD_LENGTH : sa->bitsPerSample;
+  sa->sampligRate  &= GPU_SA_SPECS_RATE_MASK;
   // Succeed
   return (SUCCESS);
 }
 
 gpu_error_t gpu_sa_index_read(int fp, gpu_sa_buffer_t* const sa)
 {
-  const size_t   bytesRequest = sizeof(gpu_sa_entry_t) * sa->numEntries;
+  const size_t   bytesRequest = gpu_sa_index_get_storage_size(sa);
   const uint64_t numRequests  = GPU_DIV_CEIL(bytesRequest, GPU_FILE_SIZE_BLOCK);
   size_t result, numBytesRequested = 0;
   uint64_t idRequest;
@@ -60,13 +307,15 @@ gpu_error_t gpu_sa_index_read(int fp, gpu_sa_buffer_t* const sa)
 
 gpu_error_t gpu_sa_index_write_specs(int fp, const gpu_sa_buffer_t* const sa)
 {
+  const uint64_t packedBits   = (sa->bitsPerSample == GPU_SA_PACKED_WORD_LENGTH) ? 0 : sa->bitsPerSample;
+  const uint64_t samplingRate = (packedBits << GPU_SA_SPECS_BITS_OFFSET) | sa->sampligRate;
   size_t result, bytesRequest;
   // Write the specifications of the SA
   bytesRequest = sizeof(uint64_t);
   result = write(fp, (void *)&sa->numEntries, bytesRequest);
   if (result != bytesRequest) return (E_WRITING_FILE);
   bytesRequest = sizeof(uint64_t);
-  result = write(fp, (void *)&sa->sampligRate, bytesRequest);
+  result = write(fp, (void *)&samplingRate, bytesRequest);
   if (result != bytesRequest) return (E_WRITING_FILE);
   // Succeed
   return (SUCCESS);
@@ -74,7 +323,7 @@ gpu_error_t gpu_sa_index_write_specs(int fp, const gpu_sa_buffer_t* const sa)
 
 gpu_error_t gpu_sa_index_write(int fp, const gpu_sa_buffer_t* const sa)
 {
-  const size_t   bytesRequest = sizeof(gpu_sa_entry_t) * sa->numEntries;
+  const size_t   bytesRequest = gpu_sa_index_get_storage_size(sa);
   const uint64_t numRequests  = GPU_DIV_CEIL(bytesRequest, GPU_FILE_SIZE_BLOCK);
   size_t result, numBytesRequested = 0;
   uint64_t idRequest;
@@ -100,10 +349,12 @@ gpu_error_t gpu_sa_index_transfer_CPU_to_GPUs(gpu_sa_buffer_t* const sa, gpu_dev
 
   for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
     if(sa->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED){
-      const size_t cpySize = sa->numEntries * sizeof(gpu_sa_entry_t);
+      const size_t cpySize = gpu_sa_index_get_storage_size(sa);
+      CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
+      //Device copy exported by the publisher of a shared index
+      if(gpu_shm_open_device(GPU_SHM_SA, devices[idSupportedDevice], (void**) &sa->d_sa[idSupportedDevice])) continue;
       deviceFreeMemory = gpu_device_get_free_memory(devices[idSupportedDevice]->idDevice);
       if ((GPU_CONVERT__B_TO_MB(cpySize)) > deviceFreeMemory) return(E_INSUFFICIENT_MEM_GPU);
-      CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
       //Synchronous allocate & transfer the FM-index to the GPU
       CUDA_ERROR(cudaMalloc((void**) &sa->d_sa[idSupportedDevice], cpySize));
       CUDA_ERROR(cudaMemcpy(sa->d_sa[idSupportedDevice], sa->h_sa, cpySize, cudaMemcpyHostToDevice));
@@ -164,6 +415,15 @@ gpu_error_t gpu_sa_index_init_dto(gpu_sa_buffer_t* const sa)
   sa->memorySpace    = NULL;
   sa->numEntries     = 0;
   sa->sampligRate    = 0;
+  /* Resampling disabled by default */
+  sa->resamplingRate    = 0;
+  sa->resamplingEntries = 0;
+  sa->maxMbSA           = 0;
+  sa->minSamplingRate   = 0;
+  /* Plain samples by default */
+  sa->bitsPerSample     = GPU_SA_PACKED_WORD_LENGTH;
+  sa->packingBits       = 0;
+  sa->activePacking     = false;
 
   return (SUCCESS);
 }
@@ -192,12 +452,7 @@ gpu_error_t gpu_sa_index_init(gpu_sa_buffer_t* const sa, const uint64_t saNumEnt
 
 gpu_error_t gpu_sa_index_allocate(gpu_sa_buffer_t* const sa)
 {
-  if(sa->hostAllocStats & GPU_PAGE_LOCKED){
-    CUDA_ERROR(cudaHostAlloc((void**) &sa->h_sa, sa->numEntries * sizeof(gpu_sa_entry_t), cudaHostAllocMapped));
-  }else{
-    sa->h_sa = malloc (sa->numEntries * sizeof(gpu_sa_entry_t));
-    if (sa->h_sa == NULL) return (E_ALLOCATE_MEM);
-  }
+  GPU_ERROR(gpu_hugepages_alloc((void**) &sa->h_sa, gpu_sa_index_get_storage_size(sa), sa->hostAllocStats));
 
   return(SUCCESS);
 }
@@ -209,8 +464,7 @@ gpu_error_t gpu_sa_index_allocate(gpu_sa_buffer_t* const sa)
 gpu_error_t gpu_sa_index_free_host(gpu_sa_buffer_t* const sa)
 {
     if(sa->h_sa != NULL){
-      if(sa->hostAllocStats == GPU_PAGE_LOCKED) CUDA_ERROR(cudaFreeHost(sa->h_sa));
-      else free(sa->h_sa);
+      GPU_ERROR(gpu_hugepages_free(sa->h_sa, sa->hostAllocStats));
       sa->h_sa = NULL;
     }
 
@@ -245,7 +499,7 @@ gpu_error_t gpu_sa_index_free_device(gpu_sa_buffer_t* const sa, gpu_device_info_
     CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
     if(sa->d_sa[idSupportedDevice] != NULL){
       if(sa->memorySpace[idSupportedDevice] == GPU_DEVICE_MAPPED)
-        CUDA_ERROR(cudaFree(sa->d_sa[idSupportedDevice]));
+        GPU_ERROR(gpu_shm_free_device(sa->d_sa[idSupportedDevice]));
       sa->d_sa[idSupportedDevice] = NULL;
     }
   }
@@ -18,6 +18,22 @@ gpu_sa_entry_t* gpu_sa_buffer_get_index_(const void* const saBuffer){
   return(mBuff->index->sa.h_sa);
 }
 
+uint32_t gpu_sa_buffer_get_bits_per_sample_(const void* const saBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) saBuffer;
+  return(mBuff->index->sa.bitsPerSample);
+}
+
+uint32_t gpu_sa_buffer_get_sampling_rate_(const void* const saBuffer){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) saBuffer;
+  return(mBuff->index->sa.sampligRate);
+}
+
+void gpu_sa_buffer_unpack_samples_(const void* const saBuffer, const uint64_t idSample, const uint64_t numSamples,
+                                   gpu_sa_entry_t* const samples){
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) saBuffer;
+  gpu_sa_index_unpack_samples(&mBuff->index->sa, idSample, numSamples, samples);
+}
+
 gpu_sa_decode_text_pos_t* gpu_sa_decode_buffer_get_ref_pos_(const void* const saBuffer){
   const gpu_buffer_t* const mBuff = (gpu_buffer_t *) saBuffer;
   return(mBuff->data.decode.textPositions.h_textPos);
@@ -0,0 +1,474 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_SHM_C_
+#define GPU_SHM_C_
+
+#include "../include/gpu_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+/* Segment mapped by the process (a single index is served per process) */
+static gpu_shm_t gpu_shm = {NULL, 0, false, "", 0};
+
+/************************************************************
+Functions to describe the sections
+************************************************************/
+
+void** gpu_shm_get_section_host(const gpu_shm_section_t section, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index)
+{
+  switch(section){
+    case GPU_SHM_FMI:               return((void**) &index->fmi.h_fmi);
+    case GPU_SHM_FMI_HOST:          return((void**) &index->fmi.h_fmiHost);
+    case GPU_SHM_FMI_TABLE_OFFSETS: return((void**) &index->fmi.table.h_offsetsTableLUT);
+    case GPU_SHM_FMI_TABLE_LUT:     return((void**) &index->fmi.table.h_fmiTableLUT);
+    case GPU_SHM_SA:                return((void**) &index->sa.h_sa);
+    case GPU_SHM_REFERENCE_PLAIN:   return((void**) &reference->h_reference_plain);
+    case GPU_SHM_REFERENCE_MASKED:  return((void**) &reference->h_reference_masked);
+    case GPU_SHM_NRUNS_RUNS:        return((void**) &reference->nRuns.h_runs);
+    case GPU_SHM_NRUNS_BUCKETS:     return((void**) &reference->nRuns.h_buckets);
+    case GPU_SHM_MINIMIZERS_ENTRIES: return((void**) &reference->minimizers.h_entries);
+    case GPU_SHM_MINIMIZERS_BUCKETS: return((void**) &reference->minimizers.h_buckets);
+    default:                        return(NULL);
+  }
+}
+
+void* gpu_shm_get_section_device(const gpu_shm_section_t section, const gpu_reference_buffer_t* const reference,
+                                 const gpu_index_buffer_t* const index, const uint32_t idSupportedDevice)
+{
+  // Only the private device copies can be exported (host-mapped ones are served by the segment)
+  switch(section){
+    case GPU_SHM_FMI:
+      if((index->fmi.d_fmi == NULL) || (index->fmi.memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(index->fmi.d_fmi[idSupportedDevice]);
+    case GPU_SHM_FMI_TABLE_OFFSETS:
+      if((index->fmi.table.d_offsetsTableLUT == NULL) || (index->fmi.table.memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(index->fmi.table.d_offsetsTableLUT[idSupportedDevice]);
+    case GPU_SHM_FMI_TABLE_LUT:
+      if((index->fmi.table.d_fmiTableLUT == NULL) || (index->fmi.table.memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(index->fmi.table.d_fmiTableLUT[idSupportedDevice]);
+    case GPU_SHM_SA:
+      if((index->sa.d_sa == NULL) || (index->sa.memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(index->sa.d_sa[idSupportedDevice]);
+    case GPU_SHM_REFERENCE_PLAIN:
+      if((reference->d_reference_plain == NULL) || (reference->memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(reference->d_reference_plain[idSupportedDevice]);
+    case GPU_SHM_REFERENCE_MASKED:
+      if((reference->d_reference_masked == NULL) || (reference->memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(reference->d_reference_masked[idSupportedDevice]);
+    case GPU_SHM_NRUNS_RUNS:
+      if((reference->nRuns.d_runs == NULL) || (reference->memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(reference->nRuns.d_runs[idSupportedDevice]);
+    case GPU_SHM_NRUNS_BUCKETS:
+      if((reference->nRuns.d_buckets == NULL) || (reference->memorySpace[idSupportedDevice] != GPU_DEVICE_MAPPED)) return(NULL);
+      return(reference->nRuns.d_buckets[idSupportedDevice]);
+    default:
+      return(NULL);
+  }
+}
+
+uint64_t gpu_shm_get_descriptor_size(const gpu_shm_section_t section, const gpu_reference_buffer_t* const reference, const gpu_index_buffer_t* const index)
+{
+  const bool activeFMI       = (index->activeModules & GPU_FMI) != 0;
+  const bool activeSA        = (index->activeModules & GPU_SA) != 0;
+  const bool activeReference = (reference->activeModules & GPU_REFERENCE) != 0;
+  switch(section){
+    case GPU_SHM_FMI:               return(activeFMI ? index->fmi.numEntries * sizeof(gpu_fmi_entry_t) : 0);
+    case GPU_SHM_FMI_HOST:          return(activeFMI ? index->fmi.numEntries * sizeof(gpu_fmi_host_entry_t) : 0);
+    case GPU_SHM_FMI_TABLE_OFFSETS: return(activeFMI ? index->fmi.table.maxLevelsTableLUT * sizeof(offset_table_t) : 0);
+    case GPU_SHM_FMI_TABLE_LUT:     return(activeFMI ? index->fmi.table.totalElemTableLUT * sizeof(gpu_sa_entry_t) : 0);
+    case GPU_SHM_SA:                return(activeSA ? gpu_sa_index_get_storage_size(&index->sa) : 0);
+    case GPU_SHM_REFERENCE_PLAIN:   return(activeReference ? reference->numEntriesPlain * GPU_REFERENCE_PLAIN__ENTRY_SIZE : 0);
+    case GPU_SHM_REFERENCE_MASKED:  return(activeReference ? reference->numEntriesMasked * GPU_REFERENCE_MASKED__ENTRY_SIZE : 0);
+    case GPU_SHM_NRUNS_RUNS:        return(activeReference ? reference->nRuns.numRuns * sizeof(gpu_reference_nrun_t) : 0);
+    case GPU_SHM_NRUNS_BUCKETS:     return(activeReference ? (reference->nRuns.numBuckets + 1) * sizeof(uint64_t) : 0);
+    case GPU_SHM_MINIMIZERS_ENTRIES: return(activeReference ? reference->minimizers.numEntries * sizeof(gpu_reference_minimizer_t) : 0);
+    case GPU_SHM_MINIMIZERS_BUCKETS: return(activeReference ? (reference->minimizers.numBuckets + 1) * sizeof(uint64_t) : 0);
+    default:                        return(0);
+  }
+}
+
+uint64_t gpu_shm_get_section_size(const gpu_shm_section_t section, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index)
+{
+  // Structures not built by the publisher are not shared
+  if((* gpu_shm_get_section_host(section, reference, index)) == NULL) return(0);
+  return(gpu_shm_get_descriptor_size(section, reference, index));
+}
+
+void gpu_shm_bind_sections(const gpu_shm_header_t* const header, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index)
+{
+  uint32_t idSection;
+  // Host pointers of the process are redirected to the segment (never released by the modules)
+  for(idSection = 0; idSection < GPU_SHM_NUM_SECTIONS; ++idSection){
+    const gpu_shm_extent_t* const extent = &header->sections[idSection];
+    void** const h_memory = gpu_shm_get_section_host(idSection, reference, index);
+    (* h_memory) = (extent->size != 0) ? (void *)((uint8_t *) header + extent->offset) : NULL;
+  }
+  reference->hostAllocStats      = GPU_PAGE_SHARED;
+  index->fmi.hostAllocStats       = GPU_PAGE_SHARED;
+  index->fmi.table.hostAllocStats = GPU_PAGE_SHARED;
+  index->sa.hostAllocStats        = GPU_PAGE_SHARED;
+}
+
+
+/************************************************************
+Functions to restore the published descriptors
+************************************************************/
+
+void gpu_shm_restore_reference(gpu_reference_buffer_t* const reference, const gpu_reference_buffer_t* const published)
+{
+  // Process local fields: device copies, placement and module selection
+  uint64_t**             const d_reference_plain  = reference->d_reference_plain;
+  uint64_t**             const d_reference_masked = reference->d_reference_masked;
+  gpu_reference_nrun_t** const d_runs             = reference->nRuns.d_runs;
+  uint64_t**             const d_buckets          = reference->nRuns.d_buckets;
+  memory_alloc_t*        const memorySpace        = reference->memorySpace;
+  const gpu_module_t           activeModules      = reference->activeModules;
+  (* reference) = (* published);
+  reference->d_reference_plain  = d_reference_plain;
+  reference->d_reference_masked = d_reference_masked;
+  reference->nRuns.d_runs       = d_runs;
+  reference->nRuns.d_buckets    = d_buckets;
+  reference->nRuns.memorySpace  = memorySpace;
+  reference->memorySpace        = memorySpace;
+  reference->activeModules      = activeModules;
+}
+
+void gpu_shm_restore_fmi(gpu_fmi_buffer_t* const fmi, const gpu_fmi_buffer_t* const published)
+{
+  // Process local fields: device copies, placement and per-node replicas
+  gpu_fmi_entry_t** const d_fmi             = fmi->d_fmi;
+  offset_table_t**  const d_offsetsTableLUT = fmi->table.d_offsetsTableLUT;
+  gpu_sa_entry_t**  const d_fmiTableLUT     = fmi->table.d_fmiTableLUT;
+  memory_alloc_t*   const memorySpace       = fmi->memorySpace;
+  memory_alloc_t*   const tableMemorySpace  = fmi->table.memorySpace;
+  (* fmi) = (* published);
+  fmi->d_fmi                   = d_fmi;
+  fmi->table.d_offsetsTableLUT = d_offsetsTableLUT;
+  fmi->table.d_fmiTableLUT     = d_fmiTableLUT;
+  fmi->memorySpace             = memorySpace;
+  fmi->table.memorySpace       = tableMemorySpace;
+  gpu_numa_replicas_init_dto(&fmi->hostReplicas);
+}
+
+void gpu_shm_restore_sa(gpu_sa_buffer_t* const sa, const gpu_sa_buffer_t* const published)
+{
+  // Process local fields: device copies and placement
+  gpu_sa_entry_t** const d_sa        = sa->d_sa;
+  memory_alloc_t*  const memorySpace = sa->memorySpace;
+  (* sa) = (* published);
+  sa->d_sa        = d_sa;
+  sa->memorySpace = memorySpace;
+}
+
+gpu_error_t gpu_shm_check_header(const gpu_shm_header_t* const header, const gpu_reference_buffer_t* const reference,
+                                 const gpu_index_buffer_t* const index)
+{
+  // Segments of other versions or builds are not interpreted
+  if((header->magic != GPU_SHM_MAGIC) || (header->version != GPU_SHM_VERSION)) return(E_SHARED_INDEX_INCOMPATIBLE);
+  if((header->sizeofFMI != sizeof(gpu_fmi_buffer_t)) || (header->sizeofSA != sizeof(gpu_sa_buffer_t)) ||
+     (header->sizeofReference != sizeof(gpu_reference_buffer_t))) return(E_SHARED_INDEX_INCOMPATIBLE);
+  // The published structures must cover the modules (and the inputs) of the process
+  if((reference->activeModules & ~header->referenceModules) || (index->activeModules & ~header->indexModules))
+    return(E_SHARED_INDEX_INCOMPATIBLE);
+  if((reference->activeModules & GPU_REFERENCE) && (reference->size != header->reference.size))
+    return(E_SHARED_INDEX_INCOMPATIBLE);
+  if((index->activeModules & GPU_FMI) && (index->fmi.bwtSize != header->fmi.bwtSize))
+    return(E_SHARED_INDEX_INCOMPATIBLE);
+  if(reference->activeMinimizers && ((header->sections[GPU_SHM_MINIMIZERS_ENTRIES].size == 0) ||
+     (reference->minimizers.w != header->reference.minimizers.w) || (reference->minimizers.k != header->reference.minimizers.k)))
+    return(E_SHARED_INDEX_INCOMPATIBLE);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_shm_check_sections(const gpu_shm_header_t* const header, const uint64_t mappedSize)
+{
+  const uint64_t headerSize = GPU_ROUND_TO(sizeof(gpu_shm_header_t), GPU_SHM_ALIGNMENT);
+  gpu_reference_buffer_t reference = header->reference;
+  gpu_index_buffer_t     index;
+  uint64_t endOffset = headerSize;
+  uint32_t idSection;
+  // Descriptors of the publisher (the sizes must follow from them)
+  reference.activeModules = header->referenceModules;
+  index.activeModules     = header->indexModules;
+  index.fmi               = header->fmi;
+  index.sa                = header->sa;
+  if((header->segmentSize > mappedSize) || (header->numDevices > GPU_SHM_MAX_DEVICES)) return(E_SHARED_INDEX_INCOMPATIBLE);
+  // Sections are aligned, laid out in order and inside the segment
+  for(idSection = 0; idSection < GPU_SHM_NUM_SECTIONS; ++idSection){
+    const gpu_shm_extent_t* const extent = &header->sections[idSection];
+    if(extent->size == 0){
+      if(extent->offset != 0) return(E_SHARED_INDEX_INCOMPATIBLE);
+      continue;
+    }
+    if((extent->offset % GPU_SHM_ALIGNMENT) || (extent->offset < endOffset) || (extent->size > (header->segmentSize - extent->offset)))
+      return(E_SHARED_INDEX_INCOMPATIBLE);
+    if(extent->size != gpu_shm_get_descriptor_size(idSection, &reference, &index)) return(E_SHARED_INDEX_INCOMPATIBLE);
+    endOffset = extent->offset + extent->size;
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Functions to share the host structures
+************************************************************/
+
+bool gpu_shm_is_stale(const char* const name)
+{
+  // Only a segment of this user and version whose publisher is gone is replaced
+  struct stat segmentStats;
+  gpu_shm_header_t* header = NULL;
+  bool stale = false;
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if(fd < 0) return(errno == ENOENT);
+  if((fstat(fd, &segmentStats) == 0) && (segmentStats.st_uid == geteuid()) &&
+     (segmentStats.st_size >= (off_t) sizeof(gpu_shm_header_t))){
+    header = (gpu_shm_header_t *) mmap(NULL, sizeof(gpu_shm_header_t), PROT_READ, MAP_SHARED, fd, 0);
+    if(header != MAP_FAILED){
+      stale = (header->magic == GPU_SHM_MAGIC) && (header->version == GPU_SHM_VERSION) &&
+              (kill(header->publisherPid, 0) != 0) && (errno == ESRCH);
+      munmap(header, sizeof(gpu_shm_header_t));
+    }
+  }
+  close(fd);
+  return(stale);
+}
+
+gpu_error_t gpu_shm_publish(const char* const name, gpu_reference_buffer_t* const reference, gpu_index_buffer_t* const index)
+{
+  gpu_shm_header_t* header = NULL;
+  uint64_t segmentSize = GPU_ROUND_TO(sizeof(gpu_shm_header_t), GPU_SHM_ALIGNMENT);
+  gpu_shm_extent_t sections[GPU_SHM_NUM_SECTIONS];
+  uint32_t idSection;
+  int fd;
+  if((name == NULL) || (gpu_shm.header != NULL)) return(E_USE_CASE_NOT_ALLOWED);
+  // Layout of the sections
+  for(idSection = 0; idSection < GPU_SHM_NUM_SECTIONS; ++idSection){
+    sections[idSection].size   = gpu_shm_get_section_size(idSection, reference, index);
+    sections[idSection].offset = (sections[idSection].size != 0) ? segmentSize : 0;
+    segmentSize += GPU_ROUND_TO(sections[idSection].size, GPU_SHM_ALIGNMENT);
+  }
+  // Creating the segment (only a stale one left by a dead publisher is replaced, live or foreign names are kept)
+  fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if((fd < 0) && (errno == EEXIST)){
+    if(!gpu_shm_is_stale(name)) return(E_SHARED_INDEX_IN_USE);
+    shm_unlink(name);
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  }
+  if(fd < 0) return((errno == EEXIST) ? E_SHARED_INDEX_IN_USE : E_ALLOCATE_MEM);
+  if(ftruncate(fd, segmentSize) != 0){
+    close(fd);
+    shm_unlink(name);
+    return(E_ALLOCATE_MEM);
+  }
+  header = (gpu_shm_header_t *) mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(header == MAP_FAILED){
+    shm_unlink(name);
+    return(E_ALLOCATE_MEM);
+  }
+  // Header (the ready flag is raised once the device handles are exported)
+  header->magic            = GPU_SHM_MAGIC;
+  header->version          = GPU_SHM_VERSION;
+  header->ready            = 0;
+  header->publisherPid     = getpid();
+  header->sizeofFMI        = sizeof(gpu_fmi_buffer_t);
+  header->sizeofSA         = sizeof(gpu_sa_buffer_t);
+  header->sizeofReference  = sizeof(gpu_reference_buffer_t);
+  header->segmentSize      = segmentSize;
+  header->referenceModules = reference->activeModules;
+  header->indexModules     = index->activeModules;
+  header->reference        = (* reference);
+  header->fmi              = index->fmi;
+  header->sa               = index->sa;
+  header->numDevices       = 0;
+  memcpy(header->sections, sections, sizeof(sections));
+  // Copying the prepared structures
+  for(idSection = 0; idSection < GPU_SHM_NUM_SECTIONS; ++idSection){
+    if(sections[idSection].size != 0)
+      memcpy((uint8_t *) header + sections[idSection].offset, (* gpu_shm_get_section_host(idSection, reference, index)), sections[idSection].size);
+  }
+  // The publisher also serves from the segment (a single host copy per node)
+  if(reference->activeModules & GPU_REFERENCE){
+    GPU_ERROR(gpu_reference_free_host(reference));
+    GPU_ERROR(gpu_reference_nruns_free_host(&reference->nRuns));
+    GPU_ERROR(gpu_reference_minimizers_free_host(&reference->minimizers));
+  }
+  GPU_ERROR(gpu_index_free_host(index, index->activeModules));
+  gpu_shm_bind_sections(header, reference, index);
+  gpu_shm.header     = header;
+  gpu_shm.mappedSize = segmentSize;
+  gpu_shm.owner      = true;
+  snprintf(gpu_shm.name, GPU_SHM_NAME_SIZE, "%s", name);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_shm_header_t* gpu_shm_wait_header(const char* const name, const uint32_t timeoutMs, int* const fd)
+{
+  uint64_t elapsedUs = 0;
+  struct stat segmentStats;
+  gpu_shm_header_t* header = NULL;
+  // The publisher may not be started yet or may still be loading the structures
+  while(elapsedUs < (timeoutMs * 1000UL)){
+    if((* fd) < 0) (* fd) = shm_open(name, O_RDONLY, 0);
+    if(((* fd) >= 0) && (header == NULL) && (fstat((* fd), &segmentStats) == 0) &&
+       (segmentStats.st_size >= (off_t) sizeof(gpu_shm_header_t))){
+      header = (gpu_shm_header_t *) mmap(NULL, sizeof(gpu_shm_header_t), PROT_READ, MAP_SHARED, (* fd), 0);
+      if(header == MAP_FAILED) return(NULL);
+    }
+    if((header != NULL) && header->ready){
+      __sync_synchronize();
+      return(header);
+    }
+    usleep(GPU_SHM_ATTACH_POLL_US);
+    elapsedUs += GPU_SHM_ATTACH_POLL_US;
+  }
+  if(header != NULL) munmap(header, sizeof(gpu_shm_header_t));
+  return(NULL);
+}
+
+gpu_error_t gpu_shm_attach(const char* const name, const uint32_t timeoutMs, gpu_reference_buffer_t* const reference,
+                           gpu_index_buffer_t* const index)
+{
+  gpu_shm_header_t *header = NULL, *segment = NULL;
+  struct stat segmentStats;
+  gpu_error_t error;
+  uint64_t segmentSize;
+  int fd = -1;
+  if((name == NULL) || (gpu_shm.header != NULL)) return(E_USE_CASE_NOT_ALLOWED);
+  // Opening the segment published by another process (read-only)
+  header = gpu_shm_wait_header(name, (timeoutMs != 0) ? timeoutMs : GPU_SHM_ATTACH_TIMEOUT_MS, &fd);
+  if(header == NULL){
+    if(fd >= 0) close(fd);
+    return(E_SHARED_INDEX_NOT_FOUND);
+  }
+  error = gpu_shm_check_header(header, reference, index);
+  if((error == SUCCESS) && (fstat(fd, &segmentStats) != 0)) error = E_SHARED_INDEX_NOT_FOUND;
+  if(error == SUCCESS) error = gpu_shm_check_sections(header, segmentStats.st_size);
+  segmentSize = header->segmentSize;
+  munmap(header, sizeof(gpu_shm_header_t));
+  if(error != SUCCESS){
+    close(fd);
+    return(error);
+  }
+  segment = (gpu_shm_header_t *) mmap(NULL, segmentSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(segment == MAP_FAILED) return(E_SHARED_INDEX_NOT_FOUND);
+  // Descriptors of the published structures (no load nor transform is performed)
+  if(reference->activeModules & GPU_REFERENCE) gpu_shm_restore_reference(reference, &segment->reference);
+  if(index->activeModules & GPU_FMI) gpu_shm_restore_fmi(&index->fmi, &segment->fmi);
+  if(index->activeModules & GPU_SA) gpu_shm_restore_sa(&index->sa, &segment->sa);
+  gpu_shm_bind_sections(segment, reference, index);
+  gpu_shm.header     = segment;
+  gpu_shm.mappedSize = segmentSize;
+  gpu_shm.owner      = false;
+  snprintf(gpu_shm.name, GPU_SHM_NAME_SIZE, "%s", name);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_shm_release()
+{
+  if(gpu_shm.header == NULL) return(SUCCESS);
+  // Attached processes keep their own mappings after the name is removed
+  if(gpu_shm.owner) shm_unlink(gpu_shm.name);
+  munmap(gpu_shm.header, gpu_shm.mappedSize);
+  gpu_shm.header     = NULL;
+  gpu_shm.mappedSize = 0;
+  gpu_shm.owner      = false;
+  gpu_shm.numOpened  = 0;
+  // Succeed
+  return(SUCCESS);
+}
+
+
+/************************************************************
+Functions to share the device structures
+************************************************************/
+
+gpu_error_t gpu_shm_publish_devices(gpu_device_info_t** const devices, const gpu_reference_buffer_t* const reference, const gpu_index_buffer_t* const index)
+{
+  const uint32_t numSupportedDevices = GPU_MIN(devices[0]->numSupportedDevices, GPU_SHM_MAX_DEVICES);
+  gpu_shm_header_t* const header = gpu_shm.header;
+  uint32_t idSupportedDevice, idSection;
+  if((header == NULL) || !gpu_shm.owner) return(E_USE_CASE_NOT_ALLOWED);
+  // Exporting the device copies (attached processes fall back to their own copies on failure)
+  for(idSupportedDevice = 0; idSupportedDevice < numSupportedDevices; ++idSupportedDevice){
+    gpu_shm_device_t* const shmDevice = &header->devices[idSupportedDevice];
+    memset(shmDevice, 0, sizeof(gpu_shm_device_t));
+    if(cudaDeviceGetPCIBusId(shmDevice->busId, GPU_SHM_BUS_ID_SIZE, devices[idSupportedDevice]->idDevice) != cudaSuccess){
+      cudaGetLastError();
+      continue;
+    }
+    CUDA_ERROR(cudaSetDevice(devices[idSupportedDevice]->idDevice));
+    for(idSection = 0; idSection < GPU_SHM_NUM_SECTIONS; ++idSection){
+      void* const d_memory = gpu_shm_get_section_device(idSection, reference, index, idSupportedDevice);
+      if(d_memory == NULL) continue;
+      shmDevice->activeHandle[idSection] = (cudaIpcGetMemHandle(&shmDevice->handle[idSection], d_memory) == cudaSuccess);
+      if(!shmDevice->activeHandle[idSection]) cudaGetLastError();
+    }
+  }
+  header->numDevices = numSupportedDevices;
+  // Publishing the segment
+  __sync_synchronize();
+  header->ready = 1;
+  // Succeed
+  return(SUCCESS);
+}
+
+bool gpu_shm_open_device(const gpu_shm_section_t section, gpu_device_info_t* const device, void** const d_memory)
+{
+  const gpu_shm_header_t* const header = gpu_shm.header;
+  char busId[GPU_SHM_BUS_ID_SIZE];
+  uint32_t idDevice;
+  // Only the attached processes import the device copies (the calling thread has the device selected)
+  if((header == NULL) || gpu_shm.owner) return(false);
+  if(gpu_shm.numOpened == (GPU_SHM_MAX_DEVICES * GPU_SHM_NUM_SECTIONS)) return(false);
+  if(cudaDeviceGetPCIBusId(busId, GPU_SHM_BUS_ID_SIZE, device->idDevice) != cudaSuccess){
+    cudaGetLastError();
+    return(false);
+  }
+  // Devices are matched by their PCI location (the CUDA ordinals depend on each process environment)
+  for(idDevice = 0; idDevice < header->numDevices; ++idDevice){
+    const gpu_shm_device_t* const shmDevice = &header->devices[idDevice];
+    if((strncmp(shmDevice->busId, busId, GPU_SHM_BUS_ID_SIZE) != 0) || !shmDevice->activeHandle[section]) continue;
+    if(cudaIpcOpenMemHandle(d_memory, shmDevice->handle[section], cudaIpcMemLazyEnablePeerAccess) != cudaSuccess){
+      cudaGetLastError();
+      return(false);
+    }
+    gpu_shm.opened[gpu_shm.numOpened++] = (* d_memory);
+    return(true);
+  }
+  return(false);
+}
+
+gpu_error_t gpu_shm_free_device(void* const d_memory)
+{
+  uint32_t idOpened;
+  // Imported copies are closed (the exporting process owns the allocation)
+  for(idOpened = 0; idOpened < gpu_shm.numOpened; ++idOpened){
+    if(gpu_shm.opened[idOpened] == d_memory){
+      CUDA_ERROR(cudaIpcCloseMemHandle(d_memory));
+      gpu_shm.opened[idOpened] = gpu_shm.opened[--gpu_shm.numOpened];
+      return(SUCCESS);
+    }
+  }
+  CUDA_ERROR(cudaFree(d_memory));
+  // Succeed
+  return(SUCCESS);
+}
+
+#endif /* GPU_SHM_C_ */
@@ -0,0 +1,346 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_STATS_C_
+#define GPU_STATS_C_
+
+#include "../include/gpu_buffer.h"
+
+/* Phase where is accounted each device segment */
+static const gpu_stats_phase_t gpu_stats_segment_phase[GPU_STATS_NUM_SEGMENTS] = {
+  GPU_STATS_PHASE_TRANSFER, GPU_STATS_PHASE_KERNEL, GPU_STATS_PHASE_TRANSFER
+};
+
+/* Names of the traced events */
+static const char* const gpu_stats_phase_name[GPU_STATS_NUM_PHASES] = {
+  "layout", "binning", "transfer", "kernel", "reorder"
+};
+static const char* const gpu_stats_segment_name[GPU_STATS_NUM_SEGMENTS] = {
+  "CPU->GPU", "kernel", "GPU->CPU"
+};
+
+/************************************************************
+Functions to initialize and release the counters
+************************************************************/
+
+void gpu_stats_clear_dto(gpu_stats_dto_t* const stats)
+{
+  memset(stats, 0, sizeof(gpu_stats_dto_t));
+}
+
+void gpu_stats_reset(gpu_stats_buffer_t* const stats)
+{
+  uint32_t idModule, idSegment, idSlot;
+  for(idModule = 0; idModule < GPU_STATS_NUM_MODULES; ++idModule)
+    gpu_stats_clear_dto(&stats->module[idModule]);
+  for(idSegment = 0; idSegment < GPU_STATS_NUM_SEGMENTS; ++idSegment){
+    for(idSlot = 0; idSlot < GPU_STATS_SEGMENT_SLOTS; ++idSlot)
+      stats->pendingSegment[idSegment][idSlot] = false;
+    stats->idSlot[idSegment]           = 0;
+    stats->recordingSegment[idSegment] = false;
+  }
+}
+
+gpu_error_t gpu_stats_create_events(gpu_stats_buffer_t* const stats)
+{
+  uint32_t idSegment, idSlot;
+  // Events are created in the current device (the counters are kept)
+  for(idSegment = 0; idSegment < GPU_STATS_NUM_SEGMENTS; ++idSegment){
+    for(idSlot = 0; idSlot < GPU_STATS_SEGMENT_SLOTS; ++idSlot){
+      CUDA_ERROR(cudaEventCreate(&stats->startSegment[idSegment][idSlot]));
+      CUDA_ERROR(cudaEventCreate(&stats->endSegment[idSegment][idSlot]));
+      stats->pendingSegment[idSegment][idSlot] = false;
+    }
+    stats->idSlot[idSegment]           = 0;
+    stats->recordingSegment[idSegment] = false;
+  }
+  stats->lastEvent      = stats->endSegment[0][0];
+  stats->activeSegments = true;
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_stats_init(gpu_stats_buffer_t* const stats)
+{
+  GPU_ERROR(gpu_stats_create_events(stats));
+  stats->idModule       = 0;
+  gpu_trace_set_track(&stats->track, 0, 0, 0);
+  gpu_stats_reset(stats);
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_stats_free(gpu_stats_buffer_t* const stats)
+{
+  uint32_t idSegment, idSlot;
+  if(stats->activeSegments){
+    for(idSegment = 0; idSegment < GPU_STATS_NUM_SEGMENTS; ++idSegment){
+      for(idSlot = 0; idSlot < GPU_STATS_SEGMENT_SLOTS; ++idSlot){
+        CUDA_ERROR(cudaEventDestroy(stats->startSegment[idSegment][idSlot]));
+        CUDA_ERROR(cudaEventDestroy(stats->endSegment[idSegment][idSlot]));
+      }
+    }
+    stats->activeSegments = false;
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+void gpu_stats_set_module(gpu_stats_buffer_t* const stats, const gpu_module_t module)
+{
+  // Buffers are accounted in their first active module (position of the lowest active bit)
+  const uint32_t lowestModule = (uint32_t) module & (~((uint32_t) module) + 1);
+  stats->idModule = (lowestModule != 0) ? GPU_MIN(gpu_count_active_bits(lowestModule - 1), GPU_STATS_NUM_MODULES - 1) : 0;
+}
+
+void gpu_stats_set_track(gpu_stats_buffer_t* const stats, const uint32_t idBuffer, const uint32_t idDevice, const uint32_t idStream)
+{
+  gpu_trace_set_track(&stats->track, idBuffer, idDevice, idStream);
+}
+
+/************************************************************
+Functions to time the host phases
+************************************************************/
+
+void gpu_stats_start_phase(gpu_stats_buffer_t* const stats, const gpu_stats_phase_t phase)
+{
+  stats->startPhase[phase] = gpu_sample_time();
+}
+
+void gpu_stats_stop_phase(gpu_stats_buffer_t* const stats, const gpu_stats_phase_t phase)
+{
+  const double timeStop = gpu_sample_time();
+  stats->module[stats->idModule].timePhase[phase] += timeStop - stats->startPhase[phase];
+  gpu_trace_record_span(&stats->track, GPU_TRACE_LANE_BUFFER, gpu_stats_phase_name[phase], stats->startPhase[phase], timeStop);
+}
+
+/************************************************************
+Functions to time the device segments
+************************************************************/
+
+gpu_error_t gpu_stats_resolve_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const uint32_t idSlot,
+                                      const cudaEvent_t anchorEvent, const double timeAnchor)
+{
+  const gpu_stats_phase_t phase = gpu_stats_segment_phase[segment];
+  float elapsedTimeMs = 0.0f, offsetTimeMs = 0.0f;
+  // Both events are completed here (only called once the end event has been reached)
+  CUDA_ERROR(cudaEventElapsedTime(&elapsedTimeMs, stats->startSegment[segment][idSlot], stats->endSegment[segment][idSlot]));
+  stats->module[stats->idModule].timePhase[phase] += elapsedTimeMs / 1000.0;
+  stats->pendingSegment[segment][idSlot] = false;
+  // Device events are placed in the host timeline relative to the last completed event (anchor)
+  if(gpu_trace_is_active()){
+    CUDA_ERROR(cudaEventElapsedTime(&offsetTimeMs, stats->endSegment[segment][idSlot], anchorEvent));
+    const double timeEnd = timeAnchor - offsetTimeMs / 1000.0;
+    gpu_trace_record_span(&stats->track, GPU_TRACE_LANE_STREAM, gpu_stats_segment_name[segment], timeEnd - elapsedTimeMs / 1000.0, timeEnd);
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_stats_harvest_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const uint32_t idSlot,
+                                      const cudaEvent_t anchorEvent, const double timeAnchor, bool* const completed)
+{
+  // Polls the end event: the host never waits for the stream to time a segment
+  const cudaError_t status = cudaEventQuery(stats->endSegment[segment][idSlot]);
+  (*completed) = false;
+  if(status == cudaErrorNotReady) return(SUCCESS);
+  CUDA_ERROR(status);
+  (*completed) = true;
+  return(gpu_stats_resolve_segment(stats, segment, idSlot, anchorEvent, timeAnchor));
+}
+
+gpu_error_t gpu_stats_start_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const cudaStream_t idStream)
+{
+  const uint32_t idSlot = (stats->idSlot[segment] + 1) % GPU_STATS_SEGMENT_SLOTS;
+  bool completed = true;
+  if(!stats->activeSegments) return(SUCCESS);
+  // Launches before the synchronization point rotate the event pairs (i.e. cutoff iterations)
+  if(stats->pendingSegment[segment][idSlot]){
+    const cudaEvent_t endEvent = stats->endSegment[segment][idSlot];
+    gpu_error_t error = gpu_stats_harvest_segment(stats, segment, idSlot, endEvent, gpu_trace_sample_time(), &completed);
+    if(error != SUCCESS) return(error);
+  }
+  // All the pairs are still in flight: this launch is not timed rather than blocking the send path
+  stats->recordingSegment[segment] = completed;
+  if(!completed) return(SUCCESS);
+  stats->idSlot[segment] = idSlot;
+  CUDA_ERROR(cudaEventRecord(stats->startSegment[segment][idSlot], idStream));
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_stats_stop_segment(gpu_stats_buffer_t* const stats, const gpu_stats_segment_t segment, const cudaStream_t idStream)
+{
+  const uint32_t idSlot = stats->idSlot[segment];
+  if(!stats->activeSegments || !stats->recordingSegment[segment]) return(SUCCESS);
+  CUDA_ERROR(cudaEventRecord(stats->endSegment[segment][idSlot], idStream));
+  stats->pendingSegment[segment][idSlot] = true;
+  stats->recordingSegment[segment]       = false;
+  stats->lastEvent                       = stats->endSegment[segment][idSlot];
+  // Succeed
+  return(SUCCESS);
+}
+
+gpu_error_t gpu_stats_update_segments(gpu_stats_buffer_t* const stats)
+{
+  // Called at receive time: the last recorded event is the anchor placing the device spans in the host timeline
+  const double timeAnchor = gpu_trace_sample_time();
+  uint32_t     idSegment, idSlot;
+  bool         completed;
+  if(!stats->activeSegments) return(SUCCESS);
+  for(idSegment = 0; idSegment < GPU_STATS_NUM_SEGMENTS; ++idSegment){
+    for(idSlot = 0; idSlot < GPU_STATS_SEGMENT_SLOTS; ++idSlot){
+      if(stats->pendingSegment[idSegment][idSlot]){
+        gpu_error_t error = gpu_stats_harvest_segment(stats, idSegment, idSlot, stats->lastEvent, timeAnchor, &completed);
+        if(error != SUCCESS) return(error);
+      }
+    }
+  }
+  // Succeed
+  return(SUCCESS);
+}
+
+/************************************************************
+Functions to accumulate the counters
+************************************************************/
+
+void gpu_stats_add_submission(gpu_stats_buffer_t* const stats, const uint32_t numElements, const uint32_t maxElements)
+{
+  gpu_stats_dto_t* const counters    = &stats->module[stats->idModule];
+  const double           utilization = (maxElements != 0) ? (double) numElements / (double) maxElements : 0.0;
+  counters->numSubmissions++;
+  counters->numElements    += numElements;
+  counters->accUtilization += utilization;
+  counters->maxUtilization  = GPU_MAX(counters->maxUtilization, utilization);
+}
+
+void gpu_stats_add_transfer_CPU_to_GPU(gpu_stats_buffer_t* const stats, const size_t bytes)
+{
+  stats->module[stats->idModule].bytesCPUtoGPU += bytes;
+}
+
+void gpu_stats_add_transfer_GPU_to_CPU(gpu_stats_buffer_t* const stats, const size_t bytes)
+{
+  stats->module[stats->idModule].bytesGPUtoCPU += bytes;
+}
+
+void gpu_stats_add_cutoff_iteration(gpu_stats_buffer_t* const stats, const uint32_t numTiles)
+{
+  stats->module[stats->idModule].numCutOffIterations++;
+  stats->module[stats->idModule].numRescheduledTiles += numTiles;
+}
+
+void gpu_stats_add_reallocation(gpu_stats_buffer_t* const stats)
+{
+  stats->module[stats->idModule].numReallocations++;
+}
+
+void gpu_stats_add_overflow(gpu_stats_buffer_t* const stats)
+{
+  stats->module[stats->idModule].numOverflows++;
+}
+
+void gpu_stats_add_split(gpu_stats_buffer_t* const stats, const uint32_t numSubBatches)
+{
+  stats->module[stats->idModule].numSplitBatches++;
+  stats->module[stats->idModule].numSubBatches += numSubBatches;
+}
+
+void gpu_stats_add_layout_tuning(gpu_stats_buffer_t* const stats)
+{
+  stats->module[stats->idModule].numLayoutTunings++;
+}
+
+void gpu_stats_add_cache_lookups(gpu_stats_buffer_t* const stats, const uint32_t numHits, const uint32_t numMisses)
+{
+  stats->module[stats->idModule].numCacheHits   += numHits;
+  stats->module[stats->idModule].numCacheMisses += numMisses;
+}
+
+void gpu_stats_add_prefilter(gpu_stats_buffer_t* const stats, const uint32_t numResolved)
+{
+  stats->module[stats->idModule].numPrefilterResolved += numResolved;
+}
+
+void gpu_stats_add_migration(gpu_stats_buffer_t* const stats)
+{
+  stats->module[stats->idModule].numMigrations++;
+}
+
+void gpu_stats_add_regions(gpu_stats_buffer_t* const stats, const uint64_t numRegions, const uint64_t numCandidates)
+{
+  stats->module[stats->idModule].numRegions          += numRegions;
+  stats->module[stats->idModule].numRegionCandidates += numCandidates;
+}
+
+/************************************************************
+Functions to aggregate the counters
+************************************************************/
+
+void gpu_stats_accumulate(const gpu_stats_buffer_t* const stats, const gpu_module_t modules, gpu_stats_dto_t* const acc)
+{
+  uint32_t idModule, idPhase;
+  for(idModule = 0; idModule < GPU_STATS_NUM_MODULES; ++idModule){
+    const gpu_stats_dto_t* const counters = &stats->module[idModule];
+    if(!(modules & (GPU_UINT32_ONE_MASK << idModule))) continue;
+    acc->numSubmissions      += counters->numSubmissions;
+    acc->numElements         += counters->numElements;
+    acc->bytesCPUtoGPU       += counters->bytesCPUtoGPU;
+    acc->bytesGPUtoCPU       += counters->bytesGPUtoCPU;
+    for(idPhase = 0; idPhase < GPU_STATS_NUM_PHASES; ++idPhase)
+      acc->timePhase[idPhase] += counters->timePhase[idPhase];
+    acc->numCutOffIterations += counters->numCutOffIterations;
+    acc->numRescheduledTiles += counters->numRescheduledTiles;
+    acc->accUtilization      += counters->accUtilization;
+    acc->maxUtilization       = GPU_MAX(acc->maxUtilization, counters->maxUtilization);
+    acc->numReallocations    += counters->numReallocations;
+    acc->numOverflows        += counters->numOverflows;
+    acc->numSplitBatches     += counters->numSplitBatches;
+    acc->numSubBatches       += counters->numSubBatches;
+    acc->numLayoutTunings    += counters->numLayoutTunings;
+    acc->numCacheHits        += counters->numCacheHits;
+    acc->numCacheMisses      += counters->numCacheMisses;
+    acc->numPrefilterResolved += counters->numPrefilterResolved;
+    acc->numMigrations       += counters->numMigrations;
+    acc->numRegions          += counters->numRegions;
+    acc->numRegionCandidates += counters->numRegionCandidates;
+  }
+}
+
+void gpu_buffer_get_stats_(const void* const gpuBuffer, const gpu_module_t modules, gpu_stats_dto_t* const stats)
+{
+  const gpu_buffer_t* const mBuff = (gpu_buffer_t *) gpuBuffer;
+  gpu_stats_clear_dto(stats);
+  gpu_stats_accumulate(&mBuff->stats, modules, stats);
+}
+
+void gpu_buffer_reset_stats_(void* const gpuBuffer)
+{
+  gpu_buffer_t* const mBuff = (gpu_buffer_t *) gpuBuffer;
+  gpu_stats_reset(&mBuff->stats);
+}
+
+void gpu_get_stats_(const gpu_buffers_dto_t* const buff, const gpu_module_t modules, gpu_stats_dto_t* const stats)
+{
+  gpu_buffer_t** const mBuff = (gpu_buffer_t **) buff->buffer;
+  uint32_t idBuffer;
+  gpu_stats_clear_dto(stats);
+  for(idBuffer = 0; idBuffer < mBuff[0]->numBuffers; ++idBuffer)
+    gpu_stats_accumulate(&mBuff[idBuffer]->stats, modules, stats);
+}
+
+void gpu_reset_stats_(const gpu_buffers_dto_t* const buff)
+{
+  gpu_buffer_t** const mBuff = (gpu_buffer_t **) buff->buffer;
+  uint32_t idBuffer;
+  for(idBuffer = 0; idBuffer < mBuff[0]->numBuffers; ++idBuffer)
+    gpu_stats_reset(&mBuff[idBuffer]->stats);
+}
+
+#endif /* GPU_STATS_C_ */
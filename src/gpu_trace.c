@@ -0,0 +1,187 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+#ifndef GPU_TRACE_C_
+#define GPU_TRACE_C_
+
+#include "../include/gpu_trace.h"
+
+/* Process-wide recorder shared by all the buffers and threads */
+static gpu_trace_t gpu_trace = {false, 0.0, NULL, 0, 0, 0};
+
+/************************************************************
+Functions to record the events
+************************************************************/
+
+bool gpu_trace_is_active()
+{
+  return(gpu_trace.active);
+}
+
+double gpu_trace_sample_time()
+{
+  return(gpu_trace.active ? gpu_sample_time() : 0.0);
+}
+
+void gpu_trace_set_track(gpu_trace_track_t* const track, const uint32_t idBuffer, const uint32_t idDevice, const uint32_t idStream)
+{
+  track->idBuffer = idBuffer;
+  track->idDevice = idDevice;
+  track->idStream = idStream;
+}
+
+void gpu_trace_record_span(const gpu_trace_track_t* const track, const gpu_trace_lane_t lane, const char* const name,
+                           const double timeStart, const double timeEnd)
+{
+  if(!gpu_trace.active) return;
+  // Registered writers keep the ring alive: the recorder is checked again once registered
+  __sync_fetch_and_add(&gpu_trace.numWriters, 1);
+  // Spans sampled before this recording session (i.e. while stopped) are discarded
+  if(gpu_trace.active && (timeStart >= gpu_trace.initTime)){
+    // Lock-free reservation of the next slot of the ring (the oldest events are overwritten)
+    const uint64_t           idEvent = __sync_fetch_and_add(&gpu_trace.numEvents, 1);
+    gpu_trace_event_t* const event   = &gpu_trace.events[idEvent % gpu_trace.maxEvents];
+    event->sequence = 0;
+    __sync_synchronize();
+    event->name      = name;
+    event->timeStart = timeStart;
+    event->timeEnd   = timeEnd;
+    event->track     = (* track);
+    event->lane      = lane;
+    __sync_synchronize();
+    event->sequence  = idEvent + 1;
+  }
+  __sync_fetch_and_sub(&gpu_trace.numWriters, 1);
+}
+
+void gpu_trace_record(const gpu_trace_track_t* const track, const gpu_trace_lane_t lane, const char* const name, const double timeStart)
+{
+  if(gpu_trace.active)
+    gpu_trace_record_span(track, lane, name, timeStart, gpu_sample_time());
+}
+
+/************************************************************
+Functions to export the events (Chrome trace JSON format)
+************************************************************/
+
+uint32_t gpu_trace_event_tid(const gpu_trace_event_t* const event)
+{
+  return((event->lane == GPU_TRACE_LANE_STREAM) ? GPU_TRACE_STREAM_TID_BASE + event->track.idStream : event->track.idBuffer);
+}
+
+int gpu_trace_cmp_tracks(const void* const a, const void* const b)
+{
+  const uint64_t trackA = *((const uint64_t *) a), trackB = *((const uint64_t *) b);
+  return((trackA > trackB) - (trackA < trackB));
+}
+
+gpu_error_t gpu_trace_dump_tracks(FILE* const fp, const uint64_t firstEvent, const uint64_t numEvents, uint64_t* const numDumped)
+{
+  // Each track is named once: one process per device, one thread per buffer and stream
+  uint64_t* const tracks = (uint64_t *) malloc((numEvents - firstEvent + 1) * sizeof(uint64_t));
+  uint64_t        idEvent, idTrack, numTracks = 0;
+  if (tracks == NULL) return (E_ALLOCATE_MEM);
+  for(idEvent = firstEvent; idEvent < numEvents; ++idEvent){
+    const gpu_trace_event_t* const event = &gpu_trace.events[idEvent % gpu_trace.maxEvents];
+    if(event->sequence != (idEvent + 1)) continue;
+    // Key: device, lane and thread id (streams and buffers named apart)
+    tracks[numTracks++] = ((uint64_t) event->track.idDevice << 33) | ((uint64_t) event->lane << 32) | gpu_trace_event_tid(event);
+  }
+  qsort(tracks, numTracks, sizeof(uint64_t), gpu_trace_cmp_tracks);
+  for(idTrack = 0; idTrack < numTracks; ++idTrack){
+    const uint32_t idDevice = (uint32_t) (tracks[idTrack] >> 33);
+    const bool     stream   = (tracks[idTrack] >> 32) & 1;
+    const uint32_t tid      = (uint32_t) tracks[idTrack];
+    if((idTrack > 0) && (tracks[idTrack] == tracks[idTrack - 1])) continue;
+    if((idTrack == 0) || (idDevice != (uint32_t) (tracks[idTrack - 1] >> 33)))
+      fprintf(fp, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"GPU device %u\"}}\n",
+              ((*numDumped)++ == 0) ? "" : ",", idDevice, idDevice);
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}\n",
+            ((*numDumped)++ == 0) ? "" : ",", idDevice, tid, stream ? "stream" : "buffer", stream ? tid - GPU_TRACE_STREAM_TID_BASE : tid);
+  }
+  free(tracks);
+  // Succeed
+  return (SUCCESS);
+}
+
+gpu_error_t gpu_trace_dump(const char* const fileName)
+{
+  const uint64_t numEvents  = gpu_trace.numEvents;
+  const uint64_t firstEvent = (numEvents > gpu_trace.maxEvents) ? numEvents - gpu_trace.maxEvents : 0;
+  uint64_t       idEvent, numDumped = 0;
+  gpu_error_t    error;
+  FILE           *fp = NULL;
+
+  fp = fopen(fileName, "w");
+  if (fp == NULL) return (E_OPENING_FILE);
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  error = gpu_trace_dump_tracks(fp, firstEvent, numEvents, &numDumped);
+  if(error != SUCCESS){
+    fclose(fp);
+    return (error);
+  }
+  for(idEvent = firstEvent; idEvent < numEvents; ++idEvent){
+    gpu_trace_event_t event = gpu_trace.events[idEvent % gpu_trace.maxEvents];
+    // Discarding the events overwritten or still being written
+    if(event.sequence != (idEvent + 1)) continue;
+    const uint32_t tid = gpu_trace_event_tid(&event);
+    fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"buffer\":%u,\"stream\":%u}}\n",
+            (numDumped == 0) ? "" : ",", event.name, (event.lane == GPU_TRACE_LANE_STREAM) ? "device" : "host", event.track.idDevice, tid,
+            (event.timeStart - gpu_trace.initTime) * 1000000.0, GPU_MAX(event.timeEnd - event.timeStart, 0.0) * 1000000.0,
+            event.track.idBuffer, event.track.idStream);
+    numDumped++;
+  }
+  fprintf(fp, "]}\n");
+
+  if(fclose(fp) != 0) return (E_WRITING_FILE);
+  // Succeed
+  return (SUCCESS);
+}
+
+/************************************************************
+Functions to start and stop the recorder
+************************************************************/
+
+void gpu_trace_start_(const uint64_t maxEvents)
+{
+  const uint64_t numEvents = (maxEvents == 0) ? GPU_TRACE_DEFAULT_EVENTS : maxEvents;
+  if(gpu_trace.active) return;
+  // Writers that observed the recorder active before the last stop are drained before touching the ring
+  while(gpu_trace.numWriters != 0) sched_yield();
+  if(numEvents != gpu_trace.maxEvents){
+    if(gpu_trace.events != NULL) free(gpu_trace.events);
+    gpu_trace.events = (gpu_trace_event_t *) calloc(numEvents, sizeof(gpu_trace_event_t));
+    if (gpu_trace.events == NULL) GPU_ERROR(E_ALLOCATE_MEM);
+    gpu_trace.maxEvents = numEvents;
+  } else {
+    // Reused ring: the sequences of the previous session would collide with the new event ids
+    memset(gpu_trace.events, 0, numEvents * sizeof(gpu_trace_event_t));
+  }
+  gpu_trace.numEvents = 0;
+  gpu_trace.initTime  = gpu_sample_time();
+  __sync_synchronize();
+  gpu_trace.active    = true;
+}
+
+void gpu_trace_dump_(const char* const fileName)
+{
+  if(gpu_trace.events != NULL)
+    GPU_ERROR(gpu_trace_dump(fileName));
+}
+
+void gpu_trace_stop_()
+{
+  // The ring lives until the process ends: events are kept until the next start (dumped after stopping the recorder)
+  gpu_trace.active = false;
+  __sync_synchronize();
+}
+
+#endif /* GPU_TRACE_C_ */
@@ -0,0 +1,536 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+/*
+ * Synthetic workload generator: simulates reads from a multi-FASTA reference and
+ * derives the inputs consumed by the benchmarks and builders of every module.
+ *   <prefix>.reads.fasta    Simulated reads (adaptive search queries)
+ *   <prefix>.seeds.prof     Exact search profile: "seedSize seed lo hi steps"
+ *   <prefix>.decode.prof    Decode profile: "initBWTPos endBWTPos steps bookmark As Cs Gs Ts Xs"
+ *   <prefix>.regions.prof   BPM / k-mer candidates: "query\tarea:strand:position:score\t..." (gpu_build_regions input)
+ * SA intervals and decoded positions are computed against the FM-index profile replayed by the
+ * benchmarks (<bwt>.<bwtSize>.128.fmi), so the result checkers stay enabled for every module.
+ * Candidate scores are exact (semi-global edit distance against the candidate region).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#define FILE_SIZE_LINES       250
+#define MAX_SEED_SIZE         60   /* 2 bits per base in 128 bits minus the 8-bit size field */
+#define MAX_READ_RETRIES      16
+#define MAX_REPEAT_LOCI       64
+
+#define	BWT_CHAR_LENGTH       3
+#define FMI_NUM_COUNTERS      4
+#define FMI_ALTERNATE_COUNTERS 2
+#define FMI_ENTRY_SIZE        128
+#define FMI_TABLE_SPECS_SIZE  (3 * sizeof(uint32_t))   /* LUT table specs stored by the library profiles */
+#define	UINT32_LENGTH         32
+#define UINT64_MAX_VALUE      0xFFFFFFFFFFFFFFFFULL
+
+/* Encoded DNA Nucleotides */
+#define ENC_DNA_CHAR_A        0
+#define ENC_DNA_CHAR_C        1
+#define ENC_DNA_CHAR_G        2
+#define ENC_DNA_CHAR_T        3
+#define ENC_DNA_CHAR_X        4
+
+#define CATCH_ERROR(error)              {{if (error) { fprintf(stderr, "%s\n", processError(error)); exit(EXIT_FAILURE); }}}
+#define	DIV_CEIL(NUMERATOR,DENOMINATOR) (((NUMERATOR)+((DENOMINATOR)-1))/(DENOMINATOR))
+#define MIN(NUM_A, NUM_B)               ((NUM_A < NUM_B) ? NUM_A : NUM_B)
+#define MAX(NUM_A, NUM_B)               ((NUM_A > NUM_B) ? NUM_A : NUM_B)
+
+typedef struct {
+	uint32_t numReads;
+	uint32_t minReadSize;
+	uint32_t maxReadSize;
+	float    substitutionRate;
+	float    indelRate;
+	uint32_t seedSize;
+	uint32_t candidatesPerRead;
+	float    truePositiveRatio;
+	float    repeatRatio;
+	uint64_t randomSeed;
+	uint32_t samplingRate;
+} workload_specs_t;
+
+typedef struct {
+	uint64_t size;
+	char     *char_reference;
+} reference_buffer_t;
+
+// FMI Entry (64 Bytes) using:
+//    4 letters: Alternate counters   (2  uint64_t)
+//    5 letters: 12 Bitmaps x 32 bits (3 uint128_t)
+typedef struct {
+	uint64_t counters[FMI_NUM_COUNTERS / FMI_ALTERNATE_COUNTERS];
+	uint32_t bitmaps[FMI_ENTRY_SIZE * BWT_CHAR_LENGTH / UINT32_LENGTH];
+} fmi_entry_t;
+
+typedef struct {
+	uint64_t    bwtSize;
+	uint64_t    numEntries;
+	fmi_entry_t *h_fmi;
+} fmi_buffer_t;
+
+typedef struct {
+	uint64_t state;
+} random_t;
+
+/* Portable xorshift64* generator: same workload on every platform for the same seed */
+uint64_t randomNext(random_t *rnd)
+{
+	rnd->state ^= rnd->state >> 12;
+	rnd->state ^= rnd->state << 25;
+	rnd->state ^= rnd->state >> 27;
+	return (rnd->state * 2685821657736338717ULL);
+}
+
+uint64_t randomRange(random_t *rnd, uint64_t range)
+{
+	return ((range == 0) ? 0 : randomNext(rnd) % range);
+}
+
+float randomUnit(random_t *rnd)
+{
+	return ((float)(randomNext(rnd) >> 40) / (float)(1ULL << 24));
+}
+
+char randomBase(random_t *rnd, char excluded)
+{
+	const char bases[4] = {'A', 'C', 'G', 'T'};
+	char base;
+	do{
+		base = bases[randomRange(rnd, 4)];
+	}while(base == excluded);
+	return (base);
+}
+
+uint32_t loadReferenceMFASTA(const char *fn, reference_buffer_t *ref)
+{
+	FILE *fp = NULL;
+	char lineFile[FILE_SIZE_LINES];
+	uint64_t sizeFile = 0, position = 0, idChar;
+	int32_t charsRead = 0;
+
+	fp = fopen(fn, "rb");
+	if (fp == NULL) return (30);
+
+	fseek(fp, 0L, SEEK_END);
+	sizeFile = ftell(fp);
+	rewind(fp);
+
+	ref->char_reference = (char*) malloc(sizeFile * sizeof(char));
+	if (ref->char_reference == NULL) return (31);
+
+	if ((fgets(lineFile, FILE_SIZE_LINES, fp) == NULL) || (lineFile[0] != '>'))
+		return (32);
+
+	while((!feof(fp)) && (fgets(lineFile, FILE_SIZE_LINES, fp) != NULL)){
+		if (lineFile[0] != '>'){
+			charsRead = strlen(lineFile);
+			if(charsRead && (lineFile[charsRead - 1] == '\n')) charsRead--;
+			for(idChar = 0; idChar < charsRead; ++idChar)
+				ref->char_reference[position + idChar] = toupper(lineFile[idChar]);
+			position += charsRead;
+		}
+	}
+
+	ref->size = position;
+	printf("Reference size: %llu\n", ref->size);
+
+	fclose(fp);
+	return (0);
+}
+
+uint32_t charToBin(char base)
+{
+	switch(base){
+		case 'A': return (ENC_DNA_CHAR_A);
+		case 'C': return (ENC_DNA_CHAR_C);
+		case 'G': return (ENC_DNA_CHAR_G);
+		case 'T': return (ENC_DNA_CHAR_T);
+		default:  return (ENC_DNA_CHAR_X);
+	}
+}
+
+uint32_t loadFMI(const char *fn, fmi_buffer_t *fmi)
+{
+	FILE *fp = NULL;
+	struct stat fileInfo;
+	uint64_t headerSize = 2 * sizeof(uint64_t);
+
+	fp = fopen(fn, "rb");
+	if (fp == NULL) return (35);
+	if (fstat(fileno(fp), &fileInfo) != 0) return (35);
+
+	if ((fread(&fmi->numEntries, sizeof(uint64_t), 1, fp) != 1) || (fread(&fmi->bwtSize, sizeof(uint64_t), 1, fp) != 1))
+		return (36);
+	// Profiles saved by the library keep the LUT table specs between the header and the entries (gpu_build_index ones do not)
+	if ((uint64_t) fileInfo.st_size >= (headerSize + FMI_TABLE_SPECS_SIZE + fmi->numEntries * sizeof(fmi_entry_t)))
+		headerSize += FMI_TABLE_SPECS_SIZE;
+	if ((uint64_t) fileInfo.st_size < (headerSize + fmi->numEntries * sizeof(fmi_entry_t))) return (36);
+	if (fmi->numEntries < (DIV_CEIL(fmi->bwtSize, FMI_ENTRY_SIZE) + 1)) return (36);
+
+	fmi->h_fmi = (fmi_entry_t *) malloc(fmi->numEntries * sizeof(fmi_entry_t));
+	if (fmi->h_fmi == NULL) return (31);
+
+	fseek(fp, headerSize, SEEK_SET);
+	if (fread(fmi->h_fmi, sizeof(fmi_entry_t), fmi->numEntries, fp) != fmi->numEntries) return (36);
+	printf("FMI size: %llu, FMI entries: %llu\n", fmi->bwtSize, fmi->numEntries);
+
+	fclose(fp);
+	return (0);
+}
+
+/* Bitmap of packet idPacket (32 bases) and bit idBit (bit0, bit1, valid) in the packed entry layout */
+uint32_t getBitmapFMI(const fmi_entry_t *entry, uint32_t idPacket, uint32_t idBit)
+{
+	const uint32_t LUT[12] = {3,7,11,0,1,2,4,5,6,8,9,10};
+	return (entry->bitmaps[LUT[idPacket * BWT_CHAR_LENGTH + idBit]]);
+}
+
+uint32_t getBaseFMI(const fmi_buffer_t *fmi, uint64_t bwtPosition)
+{
+	const fmi_entry_t *entry     = &fmi->h_fmi[bwtPosition / FMI_ENTRY_SIZE];
+	const uint32_t    idPacket   = (bwtPosition % FMI_ENTRY_SIZE) / UINT32_LENGTH;
+	const uint32_t    alignment  = UINT32_LENGTH - ((bwtPosition % UINT32_LENGTH) + 1);
+	const uint32_t    bit0       = (getBitmapFMI(entry, idPacket, 0) >> alignment) & 1;
+	const uint32_t    bit1       = (getBitmapFMI(entry, idPacket, 1) >> alignment) & 1;
+	const uint32_t    valid      = (getBitmapFMI(entry, idPacket, 2) >> alignment) & 1;
+	return (valid ? ((bit1 << 1) | bit0) : ENC_DNA_CHAR_X);
+}
+
+/* LF-mapping of the device kernels: counters of the entry (or of the next one for the alternate letters) and bitmap ranks */
+uint64_t mappingLF(const fmi_buffer_t *fmi, uint64_t bwtPosition, uint32_t base)
+{
+	const uint64_t idEntry        = bwtPosition / FMI_ENTRY_SIZE;
+	const uint32_t bitmapPosition = bwtPosition % FMI_ENTRY_SIZE;
+	const uint32_t bit0 = base & 1, bit1 = (base >> 1) & 1;
+	const uint32_t missedEntry    = ((idEntry % FMI_ALTERNATE_COUNTERS) != bit1);
+	const fmi_entry_t *entry      = &fmi->h_fmi[idEntry];
+	const uint64_t counter        = fmi->h_fmi[idEntry + missedEntry].counters[bit0];
+	uint32_t idPacket, numBases = 0;
+
+	for(idPacket = 0; idPacket < (FMI_ENTRY_SIZE / UINT32_LENGTH); ++idPacket){
+		const int32_t shift = bitmapPosition - (idPacket * UINT32_LENGTH);
+		uint32_t mask = (shift >= UINT32_LENGTH) ? 0xFFFFFFFFu : ((shift <= 0) ? 0 : (0xFFFFFFFFu << (UINT32_LENGTH - shift)));
+		uint32_t bitmap = (bit0 ? getBitmapFMI(entry, idPacket, 0) : ~getBitmapFMI(entry, idPacket, 0))
+		                & (bit1 ? getBitmapFMI(entry, idPacket, 1) : ~getBitmapFMI(entry, idPacket, 1))
+		                & getBitmapFMI(entry, idPacket, 2);
+		if(missedEntry) mask = ~mask;
+		numBases += __builtin_popcount(bitmap & mask);
+	}
+
+	return (missedEntry ? counter - numBases : counter + numBases);
+}
+
+/* Exact backward search of the seed (last base first), stops as soon as the interval is empty */
+void searchSeed(const fmi_buffer_t *fmi, const char *seed, uint32_t seedSize, uint64_t *lo, uint64_t *hi, uint32_t *steps)
+{
+	uint64_t low = 0, high = fmi->bwtSize;
+	uint32_t idStep = 0;
+
+	while((idStep < seedSize) && (low != high)){
+		const uint32_t base = charToBin(seed[seedSize - idStep - 1]);
+		low  = mappingLF(fmi, low, base);
+		high = mappingLF(fmi, high, base);
+		idStep++;
+	}
+
+	(* lo) = low; (* hi) = high; (* steps) = idStep;
+}
+
+/* LF-walk up to the next sampled position, returns 0 if the walk reaches an N (the decoding is not resolved on the GPU) */
+uint32_t decodePosition(const fmi_buffer_t *fmi, uint64_t initBWTPos, uint32_t samplingRate,
+                        uint64_t *endBWTPos, uint32_t *steps, uint32_t *numBases)
+{
+	uint64_t bwtPosition = initBWTPos;
+	uint32_t idStep = 0;
+
+	memset(numBases, 0, (ENC_DNA_CHAR_X + 1) * sizeof(uint32_t));
+	while(bwtPosition % samplingRate){
+		const uint32_t base = getBaseFMI(fmi, bwtPosition);
+		numBases[base]++;
+		if(base == ENC_DNA_CHAR_X) return (0);
+		bwtPosition = mappingLF(fmi, bwtPosition, base);
+		idStep++;
+	}
+
+	(* endBWTPos) = bwtPosition; (* steps) = idStep;
+	return (1);
+}
+
+/* Semi-global edit distance: the whole query against any substring of the candidate region */
+uint32_t computeScore(const char *query, uint32_t sizeQuery, const char *candidate, uint32_t sizeCandidate, uint32_t *column)
+{
+	uint32_t idQuery, idCandidate, bestScore = sizeQuery;
+
+	for(idQuery = 0; idQuery <= sizeQuery; ++idQuery)
+		column[idQuery] = idQuery;
+
+	for(idCandidate = 0; idCandidate < sizeCandidate; ++idCandidate){
+		uint32_t diagonal = column[0];
+		column[0] = 0;
+		for(idQuery = 1; idQuery <= sizeQuery; ++idQuery){
+			const uint32_t match = diagonal + ((query[idQuery - 1] == candidate[idCandidate]) ? 0 : 1);
+			const uint32_t score = MIN(match, MIN(column[idQuery], column[idQuery - 1]) + 1);
+			diagonal = column[idQuery];
+			column[idQuery] = score;
+		}
+		bestScore = MIN(bestScore, column[sizeQuery]);
+	}
+
+	return (bestScore);
+}
+
+/* Mutates the reference region starting at position, returns the number of reference bases consumed */
+uint64_t simulateRead(const reference_buffer_t *ref, uint64_t position, uint32_t sizeRead,
+                      const workload_specs_t *specs, random_t *rnd, char *read)
+{
+	uint64_t idRef = position;
+	uint32_t idRead = 0;
+
+	while((idRead < sizeRead) && (idRef < ref->size)){
+		const float event = randomUnit(rnd);
+		if(event < (specs->indelRate / 2)){
+			read[idRead++] = randomBase(rnd, 'N');
+		}else if(event < specs->indelRate){
+			idRef++;
+		}else{
+			const char base = ref->char_reference[idRef++];
+			read[idRead++] = (randomUnit(rnd) < specs->substitutionRate) ? randomBase(rnd, base) : base;
+		}
+	}
+	read[idRead] = '\0';
+
+	return (idRef - position);
+}
+
+uint32_t containsN(const char *text, uint64_t size)
+{
+	uint64_t idChar;
+	for(idChar = 0; idChar < size; ++idChar)
+		if(text[idChar] == 'N') return (1);
+	return (0);
+}
+
+uint32_t buildWorkload(const char *prefix, const reference_buffer_t *ref, const fmi_buffer_t *fmi, const workload_specs_t *specs)
+{
+	FILE *fpReads = NULL, *fpSeeds = NULL, *fpDecode = NULL, *fpRegions = NULL;
+	char fileName[512];
+	char *read = NULL, seed[MAX_SEED_SIZE + 1];
+	uint32_t *column = NULL;
+	uint64_t repeatLoci[MAX_REPEAT_LOCI];
+	uint64_t numSeeds = 0, numDecodings = 0, numCandidates = 0, numTruePositives = 0;
+	uint32_t numSkippedReads = 0, numSkippedDecodings = 0;
+	uint32_t idRead, idLoci, idSeed, idCandidate, idRetry;
+	random_t rnd = {.state = (specs->randomSeed == 0) ? 0x9E3779B97F4A7C15ULL : specs->randomSeed};
+	const uint32_t maxReadSize = specs->maxReadSize;
+	const uint32_t maxError    = (uint32_t)((maxReadSize * (specs->substitutionRate + specs->indelRate)) + 1);
+
+	if (ref->size <= (maxReadSize + 2 * maxError)) return (33);
+
+	read   = (char *) malloc((maxReadSize + 1) * sizeof(char));
+	column = (uint32_t *) malloc((maxReadSize + 1) * sizeof(uint32_t));
+	if ((read == NULL) || (column == NULL)) return (43);
+
+	sprintf(fileName, "%s.reads.fasta", prefix);
+	fpReads = fopen(fileName, "w");
+	sprintf(fileName, "%s.seeds.prof", prefix);
+	fpSeeds = fopen(fileName, "w");
+	sprintf(fileName, "%s.decode.prof", prefix);
+	fpDecode = fopen(fileName, "w");
+	sprintf(fileName, "%s.regions.prof", prefix);
+	fpRegions = fopen(fileName, "w");
+	if ((fpReads == NULL) || (fpSeeds == NULL) || (fpDecode == NULL) || (fpRegions == NULL)) return (47);
+
+	// Repetitive content: a fraction of the reads is sampled from a small pool of loci
+	for(idLoci = 0; idLoci < MAX_REPEAT_LOCI; ++idLoci)
+		repeatLoci[idLoci] = randomRange(&rnd, ref->size - maxReadSize - 2 * maxError) + maxError;
+
+	for(idRead = 0; idRead < specs->numReads; ++idRead){
+		const uint32_t sizeRead = specs->minReadSize + randomRange(&rnd, specs->maxReadSize - specs->minReadSize + 1);
+		uint64_t position = 0, refSpan = 0, sizeRegion;
+		// Sampling the read origin (avoiding the N regions)
+		for(idRetry = 0; idRetry < MAX_READ_RETRIES; ++idRetry){
+			position = (randomUnit(&rnd) < specs->repeatRatio) ? repeatLoci[randomRange(&rnd, MAX_REPEAT_LOCI)]
+			                                                   : randomRange(&rnd, ref->size - maxReadSize - 2 * maxError) + maxError;
+			if(!containsN(ref->char_reference + position, sizeRead)) break;
+		}
+		// The seeds of reads covering N regions cannot be searched, so the read is reported and dropped
+		if(idRetry == MAX_READ_RETRIES){
+			numSkippedReads++;
+			continue;
+		}
+		refSpan = simulateRead(ref, position, sizeRead, specs, &rnd, read);
+		sizeRegion = refSpan + 2 * maxError;
+		fprintf(fpReads, ">read_%u_%llu\n%s\n", idRead, position, read);
+
+		// Exact search seeds & decode positions (reference values computed on the FM-index)
+		for(idSeed = 0; (idSeed + 1) * specs->seedSize <= sizeRead; ++idSeed){
+			uint64_t lo, hi, initBWTPos, endBWTPos;
+			uint32_t steps, numBases[ENC_DNA_CHAR_X + 1];
+			memcpy(seed, read + idSeed * specs->seedSize, specs->seedSize);
+			seed[specs->seedSize] = '\0';
+			searchSeed(fmi, seed, specs->seedSize, &lo, &hi, &steps);
+			fprintf(fpSeeds, "%u %s %llu %llu %u\n", specs->seedSize, seed, lo, hi, steps);
+			numSeeds++;
+			// Decodings crossing an N are resampled, the ones still unresolved are reported and dropped
+			for(idRetry = 0; idRetry < MAX_READ_RETRIES; ++idRetry){
+				initBWTPos = randomRange(&rnd, fmi->bwtSize);
+				if(decodePosition(fmi, initBWTPos, specs->samplingRate, &endBWTPos, &steps, numBases)) break;
+			}
+			if(idRetry == MAX_READ_RETRIES){
+				numSkippedDecodings++;
+				continue;
+			}
+			fprintf(fpDecode, "%llu %llu %u %c %u %u %u %u %u\n", initBWTPos, endBWTPos, steps, '-',
+			        numBases[ENC_DNA_CHAR_A], numBases[ENC_DNA_CHAR_C], numBases[ENC_DNA_CHAR_G],
+			        numBases[ENC_DNA_CHAR_T], numBases[ENC_DNA_CHAR_X]);
+			numDecodings++;
+		}
+
+		// Filtering & alignment candidates with controlled true/false positive ratio
+		fprintf(fpRegions, "%s", read);
+		for(idCandidate = 0; idCandidate < specs->candidatesPerRead; ++idCandidate){
+			const uint32_t truePositive = (randomUnit(&rnd) < specs->truePositiveRatio);
+			const uint64_t candidate    = truePositive ? position - maxError : randomRange(&rnd, ref->size - sizeRegion);
+			const uint32_t score        = computeScore(read, strlen(read), ref->char_reference + candidate,
+			                                           MIN(sizeRegion, ref->size - candidate), column);
+			fprintf(fpRegions, "\tsynthetic:%c:%llu:%u", truePositive ? '+' : '-', candidate, score);
+			numTruePositives += truePositive;
+			numCandidates++;
+		}
+		fprintf(fpRegions, "\n");
+	}
+
+	printf("Reads: %u, Seeds: %llu, Decodings: %llu, Candidates: %llu (True positives: %llu)\n",
+	       specs->numReads - numSkippedReads, numSeeds, numDecodings, numCandidates, numTruePositives);
+	if(numSkippedReads || numSkippedDecodings)
+		printf("Skipped (N regions after %u retries): Reads: %u, Decodings: %u\n",
+		       MAX_READ_RETRIES, numSkippedReads, numSkippedDecodings);
+
+	fclose(fpReads);
+	fclose(fpSeeds);
+	fclose(fpDecode);
+	fclose(fpRegions);
+	free(read);
+	free(column);
+	return (0);
+}
+
+uint32_t freeReference(reference_buffer_t *ref)
+{
+	if(ref->char_reference != NULL){
+		free(ref->char_reference);
+		ref->char_reference = NULL;
+	}
+	return (0);
+}
+
+uint32_t freeFMI(fmi_buffer_t *fmi)
+{
+	if(fmi->h_fmi != NULL){
+		free(fmi->h_fmi);
+		fmi->h_fmi = NULL;
+	}
+	return (0);
+}
+
+char *processError(uint32_t e)
+{
+	switch(e) {
+		case 0:  return "No error"; break;
+		case 30: return "Cannot open reference file"; break;
+		case 31: return "Cannot allocate reference"; break;
+		case 32: return "Reference file isn't multifasta format"; break;
+		case 33: return "Reference is too small for the requested read sizes"; break;
+		case 34: return "Invalid workload parameters"; break;
+		case 35: return "Cannot open FMI file"; break;
+		case 36: return "FMI file is truncated or isn't a GEM-cutter FMI profile"; break;
+		case 43: return "Cannot allocate reads"; break;
+		case 47: return "Cannot open workload files on write mode"; break;
+		default: return "Unknown error";
+	}
+}
+
+uint32_t checkSpecs(const workload_specs_t *specs)
+{
+	if((specs->minReadSize == 0) || (specs->minReadSize > specs->maxReadSize)) return (34);
+	if((specs->seedSize == 0) || (specs->seedSize > MAX_SEED_SIZE)) return (34);
+	if((specs->substitutionRate < 0) || (specs->indelRate < 0) || (specs->substitutionRate + specs->indelRate >= 1)) return (34);
+	if((specs->truePositiveRatio < 0) || (specs->truePositiveRatio > 1)) return (34);
+	if((specs->repeatRatio < 0) || (specs->repeatRatio > 1)) return (34);
+	if(specs->samplingRate == 0) return (34);
+	return (0);
+}
+
+int32_t main(int argc, char *argv[])
+{
+	reference_buffer_t ref = {.size = 0, .char_reference = NULL};
+	workload_specs_t specs = {.numReads          = 100000,
+	                          .minReadSize       = 100,
+	                          .maxReadSize       = 100,
+	                          .substitutionRate  = 0.01,
+	                          .indelRate         = 0.001,
+	                          .seedSize          = 20,
+	                          .candidatesPerRead = 8,
+	                          .truePositiveRatio = 0.25,
+	                          .repeatRatio       = 0.1,
+	                          .randomSeed        = 1,
+	                          .samplingRate      = 4};
+	fmi_buffer_t fmi = {.bwtSize = 0, .numEntries = 0, .h_fmi = NULL};
+	int error;
+
+	if(argc < 4) {
+		printf("Usage: gpu_build_workload reference.fasta index.fmi output_prefix [numReads minReadSize maxReadSize substitutionRate \
+		       \n                          indelRate seedSize candidatesPerRead truePositiveRatio repeatRatio randomSeed samplingRate] \
+		       \n example: bin/gpu_build_workload input/human_g1k_v37.fasta input/human_g1k_v37.3137161264.128.fmi input/synthetic \
+		       \n                                 1000000 100 250 0.01 0.001 20 8 0.25 0.1 7 4 \n");
+		exit(0);
+	}
+
+	if(argc > 4)  specs.numReads          = atoi(argv[4]);
+	if(argc > 5)  specs.minReadSize       = atoi(argv[5]);
+	if(argc > 6)  specs.maxReadSize       = atoi(argv[6]);
+	if(argc > 7)  specs.substitutionRate  = atof(argv[7]);
+	if(argc > 8)  specs.indelRate         = atof(argv[8]);
+	if(argc > 9)  specs.seedSize          = atoi(argv[9]);
+	if(argc > 10) specs.candidatesPerRead = atoi(argv[10]);
+	if(argc > 11) specs.truePositiveRatio = atof(argv[11]);
+	if(argc > 12) specs.repeatRatio       = atof(argv[12]);
+	if(argc > 13) specs.randomSeed        = strtoull(argv[13], NULL, 10);
+	if(argc > 14) specs.samplingRate      = atoi(argv[14]);
+
+	error = checkSpecs(&specs);
+	CATCH_ERROR(error);
+
+	error = loadReferenceMFASTA(argv[1], &ref);
+	CATCH_ERROR(error);
+
+	error = loadFMI(argv[2], &fmi);
+	CATCH_ERROR(error);
+
+	error = buildWorkload(argv[3], &ref, &fmi, &specs);
+	CATCH_ERROR(error);
+
+	error = freeReference(&ref);
+	CATCH_ERROR(error);
+
+	error = freeFMI(&fmi);
+	CATCH_ERROR(error);
+
+	return (0);
+}
@@ -0,0 +1,214 @@
+/*
+ *  GEM-Cutter "Highly optimized genomic resources for GPUs"
+ *  Copyright (c) 2011-2018 by Alejandro Chacon    <alejandro.chacond@gmail.com>
+ *
+ *  Licensed under GNU General Public License 3.0 or later.
+ *  Some rights reserved. See LICENSE, AUTHORS.
+ *  @license GPL-3.0+ <http://www.gnu.org/licenses/gpl-3.0.en.html>
+ */
+
+/*
+ * Drives the buffer balancer with virtual devices (no GPU needed): each device serves the
+ * submissions in order at its own rate, each buffer alternates host work and one submission.
+ * The same workload is replayed with the static split and with the runtime migrations.
+ * With enough buffers to keep every device busy both splits reach the same makespan (migrations
+ * can not improve it), the balancer only pays off when the fast devices are starved of buffers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../include/gpu_balancer.h"
+
+#define SIM_MAX_DEVICES              16
+#define SIM_ELEMENTS_PER_SUBMISSION  100000
+#define SIM_HOST_SPEED               1000000.0 /* Elements per second packed and consumed by the host thread of a buffer */
+#define SIM_MIGRATION_TIME           0.005     /* Seconds re-creating the buffer in the target device */
+#define SIM_REPORT_PERIOD            1000      /* Submissions between the reports of the split */
+#define SIM_MODULE                   0
+
+#define CATCH_ERROR(error) {{if (error) { fprintf(stderr, "%s\n", processError(error)); exit(EXIT_FAILURE); }}}
+
+typedef struct {
+  uint32_t  numDevices;
+  uint32_t  numBuffers;
+  uint64_t  numSubmissions;
+  double    speed[SIM_MAX_DEVICES];     /* Elements per second of each device */
+  uint64_t  slowdownAt;                 /* Submission changing the speed of a device (0 = never) */
+  uint32_t  slowDevice;
+  double    slowFactor;
+} sim_config_t;
+
+typedef struct {
+  uint32_t  idDevice;
+  bool      inFlight;
+  double    nextEvent;                  /* Submission time (idle) or completion time (in flight) */
+} sim_buffer_t;
+
+typedef struct {
+  double    makespan;
+  uint64_t  numMigrations;
+  uint64_t  elements[SIM_MAX_DEVICES];
+  uint32_t  buffers[SIM_MAX_DEVICES];
+} sim_result_t;
+
+char *processError(int e){
+  switch(e) {
+    case 0:  return "No error"; break;
+    case 1:  return "Error: wrong device speeds"; break;
+    case 2:  return "Error: wrong number of buffers or submissions"; break;
+    case 3:  return "Error: balancer initialization"; break;
+    case 4:  return "Error: allocating the buffers"; break;
+    default: return "Unknown error";
+  }
+}
+
+int parseSpeeds(const char* const list, sim_config_t* const config)
+{
+  char *next = (char *) list;
+  config->numDevices = 0;
+  while((* next) != '\0'){
+    if(config->numDevices == SIM_MAX_DEVICES) return (1);
+    config->speed[config->numDevices] = strtod(next, &next) * 1000000.0;
+    if(config->speed[config->numDevices] <= 0.0) return (1);
+    config->numDevices++;
+    if((* next) == ',') next++;
+      else if((* next) != '\0') return (1);
+  }
+  return ((config->numDevices == 0) ? 1 : 0);
+}
+
+uint32_t nextBuffer(const sim_buffer_t* const buffers, const uint32_t numBuffers)
+{
+  uint32_t idBuffer, idNext = 0;
+  for(idBuffer = 1; idBuffer < numBuffers; ++idBuffer)
+    if(buffers[idBuffer].nextEvent < buffers[idNext].nextEvent) idNext = idBuffer;
+  return (idNext);
+}
+
+void reportSplit(const char* const label, const double time, const sim_buffer_t* const buffers, const sim_config_t* const config)
+{
+  uint32_t owned[SIM_MAX_DEVICES] = {0}, idBuffer, idDevice;
+  for(idBuffer = 0; idBuffer < config->numBuffers; ++idBuffer)
+    owned[buffers[idBuffer].idDevice]++;
+  printf("%-8s t=%8.3fs buffers:", label, time);
+  for(idDevice = 0; idDevice < config->numDevices; ++idDevice)
+    printf(" %3u", owned[idDevice]);
+  printf("\n");
+}
+
+int simulate(const sim_config_t* const config, const bool balance, const bool verbose, sim_result_t* const result)
+{
+  uint32_t      buffersPerDevice[SIM_MAX_DEVICES] = {0};
+  double        speed[SIM_MAX_DEVICES], deviceFree[SIM_MAX_DEVICES] = {0.0};
+  sim_buffer_t  *buffers  = (sim_buffer_t *) malloc(config->numBuffers * sizeof(sim_buffer_t));
+  gpu_balancer_t *balancer = NULL;
+  uint64_t      numSubmitted = 0, numCompleted = 0;
+  uint32_t      idBuffer, idDevice;
+
+  if(buffers == NULL) return (4);
+  memset(result, 0, sizeof(sim_result_t));
+  memcpy(speed, config->speed, sizeof(speed));
+  // Static split: the buffers are dealt evenly (the static estimation ignores the runtime rates)
+  for(idBuffer = 0; idBuffer < config->numBuffers; ++idBuffer){
+    buffers[idBuffer].idDevice  = idBuffer % config->numDevices;
+    buffers[idBuffer].inFlight  = false;
+    buffers[idBuffer].nextEvent = idBuffer * 1e-6;
+    buffersPerDevice[buffers[idBuffer].idDevice]++;
+  }
+  if(gpu_balancer_init(&balancer, config->numDevices, buffersPerDevice) != SUCCESS) return (3);
+
+  while(numCompleted < config->numSubmissions){
+    const uint32_t idNext = nextBuffer(buffers, config->numBuffers);
+    sim_buffer_t* const buffer = &buffers[idNext];
+    const double time = buffer->nextEvent;
+    if(buffer->inFlight){
+      // Completion of the submission (the buffer packs the next one in the host)
+      gpu_balancer_complete(balancer, buffer->idDevice, SIM_MODULE, SIM_ELEMENTS_PER_SUBMISSION, time);
+      result->elements[buffer->idDevice] += SIM_ELEMENTS_PER_SUBMISSION;
+      result->makespan  = time;
+      buffer->inFlight  = false;
+      buffer->nextEvent = (numSubmitted < config->numSubmissions) ? time + (SIM_ELEMENTS_PER_SUBMISSION / SIM_HOST_SPEED) : 1e300;
+      numCompleted++;
+      if(verbose && ((numCompleted % SIM_REPORT_PERIOD) == 0)) reportSplit(balance ? "dynamic" : "static", time, buffers, config);
+      continue;
+    }
+    // Idle buffer: decides its device (same point than the module initialization) and submits
+    if(balance){
+      const uint32_t idTarget = gpu_balancer_migration(balancer, buffer->idDevice);
+      if(idTarget != GPU_BALANCER_NO_MIGRATION){
+        buffer->idDevice = idTarget;
+        buffer->nextEvent = time + SIM_MIGRATION_TIME;
+        result->numMigrations++;
+        continue;
+      }
+    }
+    if((config->slowdownAt != 0) && (numSubmitted == config->slowdownAt))
+      speed[config->slowDevice] = config->speed[config->slowDevice] * config->slowFactor;
+    idDevice = buffer->idDevice;
+    gpu_balancer_submit(balancer, idDevice, SIM_MODULE, time);
+    deviceFree[idDevice] = ((deviceFree[idDevice] > time) ? deviceFree[idDevice] : time) + (SIM_ELEMENTS_PER_SUBMISSION / speed[idDevice]);
+    buffer->inFlight  = true;
+    buffer->nextEvent = deviceFree[idDevice];
+    numSubmitted++;
+  }
+
+  for(idBuffer = 0; idBuffer < config->numBuffers; ++idBuffer)
+    result->buffers[buffers[idBuffer].idDevice]++;
+  gpu_balancer_free(&balancer);
+  free(buffers);
+  return (0);
+}
+
+void printResult(const char* const label, const sim_result_t* const result, const sim_config_t* const config)
+{
+  uint32_t idDevice;
+  printf("%-8s makespan %8.3fs  throughput %8.2f Melem/s  migrations %4lu  buffers:", label, result->makespan,
+         (config->numSubmissions * (double) SIM_ELEMENTS_PER_SUBMISSION) / (result->makespan * 1000000.0), result->numMigrations);
+  for(idDevice = 0; idDevice < config->numDevices; ++idDevice)
+    printf(" %3u", result->buffers[idDevice]);
+  printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+  sim_config_t config;
+  sim_result_t staticResult, dynamicResult;
+  double allSpeed = 0.0;
+  uint32_t idDevice;
+
+  if((argc < 3) || (argc == 5) || (argc == 6) || (argc > 7)){
+    printf("Usage: gpu_simulate_balancer numBuffers speeds [numSubmissions] [slowdownAt slowDevice slowFactor]\n");
+    printf("       speeds: Melements per second of each virtual device (i.e. 2.0,1.0)\n");
+    printf("example: bin/gpu_simulate_balancer 4 4.0,0.5 5000\n");
+    exit(0);
+  }
+
+  config.numBuffers     = atoi(argv[1]);
+  config.numSubmissions = (argc > 3) ? strtoull(argv[3], NULL, 10) : 10000;
+  config.slowdownAt     = (argc > 4) ? strtoull(argv[4], NULL, 10) : 0;
+  config.slowDevice     = (argc > 4) ? atoi(argv[5]) : 0;
+  config.slowFactor     = (argc > 4) ? atof(argv[6]) : 1.0;
+  CATCH_ERROR(parseSpeeds(argv[2], &config));
+  if((config.numBuffers < config.numDevices) || (config.numSubmissions == 0)) CATCH_ERROR(2);
+  if((config.slowDevice >= config.numDevices) || (config.slowFactor <= 0.0)) CATCH_ERROR(1);
+
+  // Ideal split (proportional to the final rates of the devices)
+  for(idDevice = 0; idDevice < config.numDevices; ++idDevice)
+    allSpeed += config.speed[idDevice] * (((config.slowdownAt != 0) && (idDevice == config.slowDevice)) ? config.slowFactor : 1.0);
+  printf("ideal    buffers:");
+  for(idDevice = 0; idDevice < config.numDevices; ++idDevice){
+    const double rate = config.speed[idDevice] * (((config.slowdownAt != 0) && (idDevice == config.slowDevice)) ? config.slowFactor : 1.0);
+    printf(" %5.1f", config.numBuffers * rate / allSpeed);
+  }
+  printf("\n");
+
+  CATCH_ERROR(simulate(&config, false, false, &staticResult));
+  CATCH_ERROR(simulate(&config, true, true, &dynamicResult));
+  printResult("static", &staticResult, &config);
+  printResult("dynamic", &dynamicResult, &config);
+  printf("speedup  %.3fx\n", staticResult.makespan / dynamicResult.makespan);
+
+  return (0);
+}